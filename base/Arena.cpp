@@ -0,0 +1,103 @@
+#include "base/Arena.h"
+
+#include <new>
+#include <stdlib.h>
+
+namespace Miren
+{
+namespace base
+{
+    Arena::Arena(size_t chunkSize)
+        : chunkSize_(chunkSize),
+          current_(0),
+          ptr_(nullptr),
+          end_(nullptr),
+          upstreamAllocations_(0)
+    {
+    }
+
+    Arena::~Arena()
+    {
+        for(const Chunk& chunk : chunks_) {
+            ::free(chunk.data);
+        }
+        for(const Chunk& chunk : large_) {
+            ::free(chunk.data);
+        }
+    }
+
+    void Arena::reset()
+    {
+        for(const Chunk& chunk : large_) {
+            ::free(chunk.data);
+        }
+        large_.clear();
+        current_ = 0;
+        if(chunks_.empty()) {
+            ptr_ = end_ = nullptr;
+        }
+        else {
+            ptr_ = chunks_[0].data;
+            end_ = ptr_ + chunks_[0].size;
+        }
+    }
+
+    size_t Arena::bytesUsed() const
+    {
+        size_t used = 0;
+        for(size_t i = 0; i < current_ && i < chunks_.size(); ++i) {
+            used += chunks_[i].size;
+        }
+        if(current_ < chunks_.size()) {
+            used += static_cast<size_t>(ptr_ - chunks_[current_].data);
+        }
+        for(const Chunk& chunk : large_) {
+            used += chunk.size;
+        }
+        return used;
+    }
+
+    size_t Arena::bytesReserved() const
+    {
+        size_t reserved = 0;
+        for(const Chunk& chunk : chunks_) {
+            reserved += chunk.size;
+        }
+        for(const Chunk& chunk : large_) {
+            reserved += chunk.size;
+        }
+        return reserved;
+    }
+
+    // 当前块放不下：大于块的1/4单独分配，不浪费当前块剩下的空间；否则换到下一个块
+    void* Arena::allocSlow(size_t bytes, size_t alignment)
+    {
+        if(bytes + alignment > chunkSize_ / 4) {
+            size_t size = bytes + alignment;
+            char* data = static_cast<char*>(::malloc(size));
+            if(!data) {
+                throw std::bad_alloc();
+            }
+            ++upstreamAllocations_;
+            large_.push_back(Chunk{data, size});
+            uintptr_t p = (reinterpret_cast<uintptr_t>(data) + alignment - 1) & ~(alignment - 1);
+            return reinterpret_cast<void*>(p);
+        }
+
+        if(ptr_ != nullptr) {
+            ++current_;
+        }
+        if(current_ == chunks_.size()) {
+            char* data = static_cast<char*>(::malloc(chunkSize_));
+            if(!data) {
+                throw std::bad_alloc();
+            }
+            ++upstreamAllocations_;
+            chunks_.push_back(Chunk{data, chunkSize_});
+        }
+        ptr_ = chunks_[current_].data;
+        end_ = ptr_ + chunks_[current_].size;
+        return alloc(bytes, alignment);
+    }
+}
+}
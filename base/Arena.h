@@ -0,0 +1,71 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+
+#include <memory_resource>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Miren
+{
+namespace base
+{
+    /*
+    单调递增的内存区，分配只移动指针，单独释放什么也不做，reset()一次释放全部
+    用于生命周期相同的一批对象，例如一次HTTP请求中的头部、URL和发送的数据段
+    本身就是std::pmr::memory_resource，可以直接交给std::pmr容器：
+        base::Arena arena;
+        std::pmr::map<std::pmr::string, std::pmr::string> headers(&arena);
+        ...
+        arena.reset();      //之前分配的对象都不能再使用
+    reset()保留常规大小的块，下一轮不再向系统申请；超过chunkSize的大块每轮归还
+    不是线程安全的，一个线程(EventLoop)使用一个
+    */
+    class Arena : public std::pmr::memory_resource, NonCopyable
+    {
+    public:
+        static const size_t kDefaultChunkSize = 16 * 1024;
+
+        explicit Arena(size_t chunkSize = kDefaultChunkSize);
+        ~Arena() override;
+
+        void* alloc(size_t bytes, size_t alignment = alignof(std::max_align_t))
+        {
+            uintptr_t p = (reinterpret_cast<uintptr_t>(ptr_) + alignment - 1) & ~(alignment - 1);
+            if(p + bytes <= reinterpret_cast<uintptr_t>(end_)) {
+                ptr_ = reinterpret_cast<char*>(p + bytes);
+                return reinterpret_cast<void*>(p);
+            }
+            return allocSlow(bytes, alignment);
+        }
+
+        void reset();
+
+        size_t bytesUsed() const;               //本轮已经分配的字节数(包括对齐浪费的)
+        size_t bytesReserved() const;           //持有的块的总大小
+        int64_t upstreamAllocations() const { return upstreamAllocations_; }   //向系统申请块的次数
+
+    private:
+        struct Chunk
+        {
+            char* data;
+            size_t size;
+        };
+
+        void* do_allocate(size_t bytes, size_t alignment) override { return alloc(bytes, alignment); }
+        void do_deallocate(void*, size_t, size_t) override {}
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+        void* allocSlow(size_t bytes, size_t alignment);
+
+        const size_t chunkSize_;
+        std::vector<Chunk> chunks_;     //常规大小的块，reset后重复使用
+        std::vector<Chunk> large_;      //超过chunkSize的分配，reset时释放
+        size_t current_;                //chunks_中正在使用的块
+        char* ptr_;
+        char* end_;
+        int64_t upstreamAllocations_;
+    };
+}
+}
@@ -10,6 +10,10 @@
 #include <string>
 #include <string_view>
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#endif
+
 #if defined(__cpp_lib_bit_cast)
 #include <bit>  // For std::bit_cast.
 #endif
@@ -488,8 +492,281 @@ std::array<char, 256> constexpr encode_table_1 = {
     'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+',
     '/'};
 
+// SIMD kernels for the bulk of the input. They are compiled with per-function
+// target attributes and picked at runtime, so the header does not depend on
+// -mavx2/-msse4.1 or -march=native and the binary still runs on older CPUs.
+// Encoding follows Mula's pshufb lookup; decoding validates every character
+// with the nibble bitmask check and falls back to the scalar loop for the tail
+// (and for the last quad, which may contain padding).
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && \
+    !defined(BASE64_NO_SIMD)
+#define BASE64_X86_SIMD 1
+#endif
+
+#ifdef BASE64_X86_SIMD
+
+__attribute__((target("sse4.1"))) inline __m128i encode_lookup_sse(
+    __m128i indices) {
+  // 0..25 -> 'A'.., 26..51 -> 'a'.., 52..61 -> '0'.., 62 -> '+', 63 -> '/'
+  const __m128i shift_lut = _mm_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  const __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+  result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+  result = _mm_shuffle_epi8(shift_lut, result);
+  return _mm_add_epi8(result, indices);
+}
+
+// Spreads 12 input bytes into 16 six-bit indices, one per byte.
+__attribute__((target("sse4.1"))) inline __m128i encode_split_sse(__m128i in) {
+  in = _mm_shuffle_epi8(
+      in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(t1, t3);
+}
+
+// Returns the number of input bytes consumed (a multiple of 3).
+__attribute__((target("sse4.1"))) inline size_t encode_sse41(
+    const uint8_t* src, size_t len, char* dst) {
+  size_t done = 0;
+  while (len - done >= 16) {
+    const __m128i in =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + done));
+    const __m128i out = encode_lookup_sse(encode_split_sse(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out);
+    done += 12;
+    dst += 16;
+  }
+  return done;
+}
+
+__attribute__((target("avx2"))) inline size_t encode_avx2(const uint8_t* src,
+                                                          size_t len,
+                                                          char* dst) {
+  const __m256i split = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  const __m256i shift_lut = _mm256_setr_epi8(
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  size_t done = 0;
+  // Each 128-bit lane takes 12 bytes: lane 0 from src, lane 1 from src + 12.
+  while (len - done >= 28) {
+    const __m128i lo =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + done));
+    const __m128i hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + done + 12));
+    __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+    in = _mm256_shuffle_epi8(in, split);
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    const __m256i indices = _mm256_or_si256(t1, t3);
+
+    __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    result =
+        _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    result = _mm256_shuffle_epi8(shift_lut, result);
+    result = _mm256_add_epi8(result, indices);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), result);
+    done += 24;
+    dst += 32;
+  }
+  return done + encode_sse41(src + done, len - done, dst);
+}
+
+// Maps 16 characters to their 6-bit values. Returns false if any character is
+// outside the alphabet ('=' included).
+__attribute__((target("sse4.1"))) inline bool decode_values_sse(__m128i str,
+                                                                __m128i* out) {
+  const __m128i lut_lo =
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                    0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i lut_hi =
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10,
+                    0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lut_roll =
+      _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i mask_2f = _mm_set1_epi8(0x2f);
+
+  const __m128i hi_nibbles =
+      _mm_and_si128(_mm_srli_epi32(str, 4), mask_2f);
+  const __m128i lo_nibbles = _mm_and_si128(str, mask_2f);
+  const __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+  const __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+  if (!_mm_testz_si128(lo, hi)) {
+    return false;
+  }
+  const __m128i eq_2f = _mm_cmpeq_epi8(str, mask_2f);
+  const __m128i roll =
+      _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+  *out = _mm_add_epi8(str, roll);
+  return true;
+}
+
+// Returns the number of characters consumed (a multiple of 4). Every store
+// writes 4 bytes past the decoded data, so the loop leaves at least 8
+// characters (6 output bytes) for the caller.
+__attribute__((target("sse4.1"))) inline size_t decode_sse41(
+    const uint8_t* src, size_t len, char* dst) {
+  size_t done = 0;
+  while (len - done >= 24) {
+    __m128i values;
+    if (!decode_values_sse(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + done)),
+            &values)) {
+      throw std::runtime_error{
+          "Invalid base64 encoded data - Invalid character"};
+    }
+    const __m128i merged =
+        _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    __m128i out = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+    out = _mm_shuffle_epi8(out, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14,
+                                              13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), out);
+    done += 16;
+    dst += 12;
+  }
+  return done;
+}
+
+// Same contract as decode_sse41; a store writes 8 bytes past the decoded data.
+__attribute__((target("avx2"))) inline size_t decode_avx2(const uint8_t* src,
+                                                          size_t len,
+                                                          char* dst) {
+  const __m256i lut_lo = _mm256_setr_epi8(
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+      0x1B, 0x1B, 0x1B, 0x1A, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m256i lut_hi = _mm256_setr_epi8(
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8(
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+
+  size_t done = 0;
+  while (len - done >= 48) {
+    const __m256i str =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + done));
+    const __m256i hi_nibbles =
+        _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_2f);
+    const __m256i lo_nibbles = _mm256_and_si256(str, mask_2f);
+    const __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    const __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    if (!_mm256_testz_si256(lo, hi)) {
+      throw std::runtime_error{
+          "Invalid base64 encoded data - Invalid character"};
+    }
+    const __m256i eq_2f = _mm256_cmpeq_epi8(str, mask_2f);
+    const __m256i roll =
+        _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    const __m256i values = _mm256_add_epi8(str, roll);
+
+    const __m256i merged =
+        _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    __m256i out = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+    out = _mm256_shuffle_epi8(out, pack);
+    out = _mm256_permutevar8x32_epi32(out,
+                                      _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), out);
+    done += 32;
+    dst += 24;
+  }
+  return done + decode_sse41(src + done, len - done, dst);
+}
+
+#endif  // BASE64_X86_SIMD
+
 }  // namespace detail
 
+enum class simd_level { scalar, sse41, avx2 };
+
+namespace detail {
+
+inline simd_level detect_simd_level() {
+#ifdef BASE64_X86_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return simd_level::avx2;
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return simd_level::sse41;
+  }
+#endif
+  return simd_level::scalar;
+}
+
+inline simd_level& active_simd_level() {
+  static simd_level level = detect_simd_level();
+  return level;
+}
+
+// Bulk of the encoding, returns the number of input bytes consumed.
+inline size_t encode_bulk(const uint8_t* src, size_t len, char* dst) {
+#ifdef BASE64_X86_SIMD
+  switch (active_simd_level()) {
+    case simd_level::avx2:
+      return encode_avx2(src, len, dst);
+    case simd_level::sse41:
+      return encode_sse41(src, len, dst);
+    case simd_level::scalar:
+      break;
+  }
+#else
+  (void)src;
+  (void)len;
+  (void)dst;
+#endif
+  return 0;
+}
+
+// Bulk of the decoding, returns the number of characters consumed.
+inline size_t decode_bulk(const uint8_t* src, size_t len, char* dst) {
+#ifdef BASE64_X86_SIMD
+  switch (active_simd_level()) {
+    case simd_level::avx2:
+      return decode_avx2(src, len, dst);
+    case simd_level::sse41:
+      return decode_sse41(src, len, dst);
+    case simd_level::scalar:
+      break;
+  }
+#else
+  (void)src;
+  (void)len;
+  (void)dst;
+#endif
+  return 0;
+}
+
+}  // namespace detail
+
+// The best kernel this CPU supports.
+inline simd_level supported_simd_level() { return detail::detect_simd_level(); }
+
+inline simd_level get_simd_level() { return detail::active_simd_level(); }
+
+// Forces a kernel, e.g. for benchmarks and tests; levels the CPU does not
+// support are lowered to the best supported one. Not thread-safe, call it
+// before encoding/decoding on other threads.
+inline void set_simd_level(simd_level level) {
+  detail::active_simd_level() = std::min(level, supported_simd_level());
+}
+
 template <class OutputBuffer, class InputIterator>
 inline OutputBuffer encode_into(InputIterator begin, InputIterator end) {
   typedef std::decay_t<decltype(*begin)> input_value_type;
@@ -510,7 +787,11 @@ inline OutputBuffer encode_into(InputIterator begin, InputIterator end) {
   const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&*begin);
   char* currEncoding = reinterpret_cast<char*>(&encoded[0]);
 
-  for (size_t i = binarytextsize / 3; i; --i) {
+  const size_t simdsize = detail::encode_bulk(bytes, binarytextsize, currEncoding);
+  bytes += simdsize;
+  currEncoding += simdsize / 3 * 4;
+
+  for (size_t i = (binarytextsize - simdsize) / 3; i; --i) {
     const uint8_t t1 = *bytes++;
     const uint8_t t2 = *bytes++;
     const uint8_t t3 = *bytes++;
@@ -590,7 +871,12 @@ inline OutputBuffer decode_into(std::string_view base64Text) {
   const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&base64Text[0]);
   char* currDecoding = reinterpret_cast<char*>(&decoded[0]);
 
-  for (size_t i = (base64Text.size() >> 2) - (numPadding != 0); i; --i) {
+  const size_t numQuads = (base64Text.size() >> 2) - (numPadding != 0);
+  const size_t simdsize = detail::decode_bulk(bytes, numQuads << 2, currDecoding);
+  bytes += simdsize;
+  currDecoding += simdsize / 4 * 3;
+
+  for (size_t i = numQuads - (simdsize >> 2); i; --i) {
     const uint8_t t1 = *bytes++;
     const uint8_t t2 = *bytes++;
     const uint8_t t3 = *bytes++;
@@ -0,0 +1,319 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <assert.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Miren
+{
+namespace base
+{
+    /*
+    无锁的有界多生产者多消费者队列，BoundedBlockingQueue的无锁版本
+    环形数组，每个槽位带一个序号(Dmitry Vyukov的bounded MPMC queue)：
+      序号 == pos        槽位空，生产者可以写入pos
+      序号 == pos + 1    槽位满，消费者可以读出pos
+    生产者和消费者只在各自的位置上CAS，读写数据不需要锁
+
+    put/take在队列满/空时先自旋，之后在futex上睡眠；
+    只有存在睡眠的线程时，另一端才会调用futex唤醒，平时没有系统调用
+    putMany/takeMany每批只检查一次是否需要唤醒
+    close()唤醒所有等待的线程，之后不再阻塞：队列满时put丢弃元素，队列空时take返回T()、takeMany返回0
+    容量向上取整为2的幂，T需要可默认构造，关闭后take返回值初始化的T()
+    */
+    template<typename T>
+    class BoundedMpmcQueue : NonCopyable
+    {
+    public:
+        explicit BoundedMpmcQueue(size_t capacity)
+            : mask_(roundUp(capacity) - 1),
+              cells_(new Cell[mask_ + 1])
+        {
+            for (size_t i = 0; i <= mask_; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ~BoundedMpmcQueue()
+        {
+            // 析构时没有其他线程访问了，销毁剩下的元素
+            T x{};
+            while (tryTake(x)) {
+            }
+            delete[] cells_;
+        }
+
+        // 非阻塞，队列满返回false
+        bool tryPut(const T& x) { return tryEmplace(x); }
+        bool tryPut(T&& x) { return tryEmplace(std::move(x)); }
+
+        // 非阻塞，队列空返回false
+        bool tryTake(T& x)
+        {
+            size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+            Cell* cell;
+            for (;;) {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                if (diff == 0) {
+                    if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;   //空
+                }
+                else {
+                    pos = dequeuePos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            T* slot = cell->ptr();
+            x = std::move(*slot);
+            slot->~T();
+            //这个槽位下一轮(pos + capacity)才能被写入
+            cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+            return true;
+        }
+
+        void put(const T& x)
+        {
+            T copy(x);
+            put(std::move(copy));
+        }
+
+        void put(T&& x)
+        {
+            if (waitUntil(notFull_, [&] { return tryPut(std::move(x)); })) {
+                wake(notEmpty_, 1);
+            }
+        }
+
+        T take()
+        {
+            T x{};
+            if (waitUntil(notEmpty_, [&] { return tryTake(x); })) {
+                wake(notFull_, 1);
+            }
+            return x;
+        }
+
+        // 放入n个元素，队列满时阻塞，返回时全部放入
+        void putMany(T* items, size_t n)
+        {
+            size_t i = 0;
+            while (i < n) {
+                size_t batch = 0;
+                while (i < n && tryPut(std::move(items[i]))) {
+                    ++i;
+                    ++batch;
+                }
+                if (batch > 0) {
+                    wake(notEmpty_, batch);
+                }
+                if (i < n) {
+                    if (!waitUntil(notFull_, [&] { return tryPut(std::move(items[i])); })) {
+                        return;
+                    }
+                    ++i;
+                    wake(notEmpty_, 1);
+                }
+            }
+        }
+
+        // 至少取出1个，最多maxItems个，队列空时阻塞，返回取出的个数
+        size_t takeMany(T* items, size_t maxItems)
+        {
+            assert(maxItems > 0);
+            if (!waitUntil(notEmpty_, [&] { return tryTake(items[0]); })) {
+                return 0;
+            }
+            size_t n = 1;
+            while (n < maxItems && tryTake(items[n])) {
+                ++n;
+            }
+            wake(notFull_, n);
+            return n;
+        }
+
+        // 不再阻塞，唤醒所有阻塞在put/take上的线程，已经在队列中的元素仍然可以取出
+        void close()
+        {
+            closed_.store(true, std::memory_order_seq_cst);
+            wakeAll(notEmpty_);
+            wakeAll(notFull_);
+        }
+
+        bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+        // 并发时只是近似值
+        size_t size() const
+        {
+            size_t tail = enqueuePos_.load(std::memory_order_relaxed);
+            size_t head = dequeuePos_.load(std::memory_order_relaxed);
+            return tail > head ? tail - head : 0;
+        }
+
+        bool empty() const { return size() == 0; }
+        bool full() const { return size() >= capacity(); }
+        size_t capacity() const { return mask_ + 1; }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+            T* ptr() { return reinterpret_cast<T*>(&storage); }
+        };
+
+        // 一端等待另一端的事件
+        // waiters是登记等待的线程数，pending是已经发出、还没被消耗的唤醒数；
+        // pending >= waiters时被唤醒的线程还没来得及运行，不需要再调用FUTEX_WAKE
+        struct alignas(64) Event
+        {
+            std::atomic<uint32_t> seq {0};
+            std::atomic<uint32_t> waiters {0};
+            std::atomic<uint32_t> pending {0};
+        };
+
+        template<typename U>
+        bool tryEmplace(U&& x)
+        {
+            size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+            Cell* cell;
+            for (;;) {
+                cell = &cells_[pos & mask_];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                if (diff == 0) {
+                    if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                }
+                else if (diff < 0) {
+                    return false;   //满
+                }
+                else {
+                    pos = enqueuePos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            new (cell->ptr()) T(std::forward<U>(x));
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // 成功返回true，队列关闭后返回false
+        template<typename F>
+        bool waitUntil(Event& event, F&& tryOnce)
+        {
+            // 单核上自旋只会浪费对端的时间片
+            static const int spinRounds = std::thread::hardware_concurrency() > 1 ? kSpinRounds : 0;
+            for (int i = 0; i < spinRounds; ++i) {
+                if (tryOnce()) {
+                    return true;
+                }
+                pause();
+            }
+
+            for (;;) {
+                // 先登记再检查，和wake中的fence配对：
+                // 要么对端看到waiters，要么这里看到对端的修改
+                event.waiters.fetch_add(1, std::memory_order_seq_cst);
+                // close()先设置closed_再增加seq，这里反过来读，不会在关闭后睡下去
+                uint32_t seq = event.seq.load(std::memory_order_seq_cst);
+                bool done = tryOnce();
+                bool closed = !done && closed_.load(std::memory_order_seq_cst);
+                if (!done && !closed) {
+                    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&event.seq),
+                              FUTEX_WAIT_PRIVATE, seq, nullptr, nullptr, 0);
+                }
+                event.waiters.fetch_sub(1, std::memory_order_seq_cst);
+                // 每次离开都消耗一次唤醒，多减只会导致多唤醒，不会丢失唤醒
+                uint32_t pending = event.pending.load(std::memory_order_relaxed);
+                while (pending > 0 &&
+                       !event.pending.compare_exchange_weak(pending, pending - 1, std::memory_order_relaxed)) {
+                }
+                if (done) {
+                    return true;
+                }
+                if (closed) {
+                    return false;
+                }
+            }
+        }
+
+        static void wake(Event& event, size_t n)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            uint32_t waiters = event.waiters.load(std::memory_order_relaxed);
+            if (waiters == 0) {
+                return;
+            }
+            uint32_t pending = event.pending.load(std::memory_order_relaxed);
+            uint32_t count;
+            do {
+                if (pending >= waiters) {
+                    return;
+                }
+                count = static_cast<uint32_t>(std::min<size_t>(n, waiters - pending));
+            } while (!event.pending.compare_exchange_weak(pending, pending + count, std::memory_order_relaxed));
+
+            event.seq.fetch_add(1, std::memory_order_release);
+            ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&event.seq),
+                      FUTEX_WAKE_PRIVATE, static_cast<int>(count), nullptr, nullptr, 0);
+        }
+
+        static void wakeAll(Event& event)
+        {
+            event.seq.fetch_add(1, std::memory_order_seq_cst);
+            ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(&event.seq),
+                      FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+        }
+
+        static void pause()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#else
+            std::this_thread::yield();
+#endif
+        }
+
+        static size_t roundUp(size_t n)
+        {
+            size_t cap = 2;
+            while (cap < n) {
+                cap <<= 1;
+            }
+            return cap;
+        }
+
+        static const int kSpinRounds = 64;
+
+        const size_t mask_;
+        Cell* const cells_;
+        // 生产者和消费者的位置放在不同的cache line，避免false sharing
+        alignas(64) std::atomic<size_t> enqueuePos_ {0};
+        alignas(64) std::atomic<size_t> dequeuePos_ {0};
+        std::atomic<bool> closed_ {false};
+        Event notEmpty_;
+        Event notFull_;
+    };
+}
+}
@@ -0,0 +1,204 @@
+#include "base/Clock.h"
+
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace Miren::base
+{
+    namespace
+    {
+        // 在一段时间内同时读TSC和CLOCK_MONOTONIC，得到每个tick的纳秒数
+        double calibrate()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            const int64_t kCalibrateNanos = 10 * 1000 * 1000;
+            uint64_t startTicks = TscClock::ticks();
+            int64_t start = Clock::monotonicNanos();
+            int64_t now;
+            do {
+                ::usleep(1000);
+                now = Clock::monotonicNanos();
+            } while(now - start < kCalibrateNanos);
+            uint64_t endTicks = TscClock::ticks();
+            if(endTicks <= startTicks) {
+                return 1.0;
+            }
+            return static_cast<double>(now - start) / static_cast<double>(endTicks - startTicks);
+#else
+            return 1.0;
+#endif
+        }
+
+        const char* const kWeekDays[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+        const char* const kMonths[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+        inline char* put2(char* p, int v)
+        {
+            p[0] = static_cast<char>('0' + v / 10);
+            p[1] = static_cast<char>('0' + v % 10);
+            return p + 2;
+        }
+
+        inline char* put4(char* p, int v)
+        {
+            p = put2(p, v / 100);
+            return put2(p, v % 100);
+        }
+
+        // 共享的缓存，字符串按8字节原子地读写，seqlock为奇数时正在更新
+        const int kLogWords = (CachedDate::kLogTimeLength + 7) / 8;
+        const int kHttpWords = (CachedDate::kHttpDateLength + 7) / 8;
+
+        struct alignas(64) DateSlot
+        {
+            std::atomic<uint64_t> seq {0};
+            std::atomic<int64_t> seconds {-1};
+            std::atomic<uint64_t> logTime[kLogWords];
+            std::atomic<uint64_t> httpDate[kHttpWords];
+        };
+
+        DateSlot g_date;
+
+        // 只拷贝格式化出来的length个字符，最后一个字的其余字节填0
+        void store(std::atomic<uint64_t>* words, int length, const char* buf)
+        {
+            for(int i = 0; i * 8 < length; ++i) {
+                uint64_t w = 0;
+                memcpy(&w, buf + i * 8, static_cast<size_t>(std::min(8, length - i * 8)));
+                words[i].store(w, std::memory_order_relaxed);
+            }
+        }
+
+        void load(const std::atomic<uint64_t>* words, int n, char* buf)
+        {
+            for(int i = 0; i < n; ++i) {
+                uint64_t w = words[i].load(std::memory_order_relaxed);
+                memcpy(buf + i * 8, &w, 8);
+            }
+        }
+
+        // 从缓存中读出seconds对应的字符串，成功返回true
+        bool readCache(time_t seconds, bool http, char* out)
+        {
+            uint64_t seq = g_date.seq.load(std::memory_order_acquire);
+            if((seq & 1) || g_date.seconds.load(std::memory_order_relaxed) != seconds) {
+                return false;
+            }
+            char buf[kHttpWords * 8];
+            if(http) {
+                load(g_date.httpDate, kHttpWords, buf);
+            }
+            else {
+                load(g_date.logTime, kLogWords, buf);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(g_date.seq.load(std::memory_order_relaxed) != seq) {
+                return false;
+            }
+            memcpy(out, buf, http ? CachedDate::kHttpDateLength : CachedDate::kLogTimeLength);
+            return true;
+        }
+
+        // 格式化seconds，抢到seqlock时顺便更新缓存
+        void fill(time_t seconds, bool http, char* out)
+        {
+            char logTime[kLogWords * 8];
+            char httpDate[kHttpWords * 8];
+            CachedDate::formatLogTime(seconds, logTime);
+            CachedDate::formatHttpDate(seconds, httpDate);
+            memcpy(out, http ? httpDate : logTime, http ? CachedDate::kHttpDateLength : CachedDate::kLogTimeLength);
+
+            uint64_t seq = g_date.seq.load(std::memory_order_relaxed);
+            // 只更新到更新的时间，避免落后的线程把缓存改回旧的一秒
+            if((seq & 1) || g_date.seconds.load(std::memory_order_relaxed) >= seconds ||
+               !g_date.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+                return;
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+            g_date.seconds.store(seconds, std::memory_order_relaxed);
+            store(g_date.logTime, CachedDate::kLogTimeLength, logTime);
+            store(g_date.httpDate, CachedDate::kHttpDateLength, httpDate);
+            g_date.seq.store(seq + 2, std::memory_order_release);
+        }
+    }
+
+    bool TscClock::invariant()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        unsigned eax, ebx, ecx, edx;
+        if(__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) {
+            return false;
+        }
+        __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+        return (edx & (1u << 8)) != 0;
+#else
+        return false;
+#endif
+    }
+
+    double TscClock::nanosPerTick()
+    {
+        static const double nanosPerTick = calibrate();
+        return nanosPerTick;
+    }
+
+    void CachedDate::logTime(time_t seconds, char* buf)
+    {
+        if(!readCache(seconds, false, buf)) {
+            fill(seconds, false, buf);
+        }
+    }
+
+    void CachedDate::httpDate(time_t seconds, char* buf)
+    {
+        if(!readCache(seconds, true, buf)) {
+            fill(seconds, true, buf);
+        }
+    }
+
+    void CachedDate::formatLogTime(time_t seconds, char* buf)
+    {
+        struct tm tm_time;
+        ::gmtime_r(&seconds, &tm_time);
+        char* p = put4(buf, tm_time.tm_year + 1900);
+        p = put2(p, tm_time.tm_mon + 1);
+        p = put2(p, tm_time.tm_mday);
+        *p++ = ' ';
+        p = put2(p, tm_time.tm_hour);
+        *p++ = ':';
+        p = put2(p, tm_time.tm_min);
+        *p++ = ':';
+        put2(p, tm_time.tm_sec);
+    }
+
+    void CachedDate::formatHttpDate(time_t seconds, char* buf)
+    {
+        struct tm tm_time;
+        ::gmtime_r(&seconds, &tm_time);
+        char* p = buf;
+        memcpy(p, kWeekDays[tm_time.tm_wday], 3);
+        p += 3;
+        *p++ = ',';
+        *p++ = ' ';
+        p = put2(p, tm_time.tm_mday);
+        *p++ = ' ';
+        memcpy(p, kMonths[tm_time.tm_mon], 3);
+        p += 3;
+        *p++ = ' ';
+        p = put4(p, tm_time.tm_year + 1900);
+        *p++ = ' ';
+        p = put2(p, tm_time.tm_hour);
+        *p++ = ':';
+        p = put2(p, tm_time.tm_min);
+        *p++ = ':';
+        p = put2(p, tm_time.tm_sec);
+        memcpy(p, " GMT", 4);
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "base/Timestamp.h"
+
+#include <atomic>
+#include <stdint.h>
+#include <time.h>
+
+namespace Miren
+{
+namespace base
+{
+    /*
+    几种代价不同的时钟，热点路径按需要的精度选择
+      Clock::now()              CLOCK_REALTIME，和Timestamp::now()相同，setSource(kRealtimeCoarse)后变为粗粒度时钟
+      Clock::coarseNow()        CLOCK_REALTIME_COARSE，精度是一个时钟节拍(1~4ms)，只读vDSO中的变量
+      Clock::monotonicNanos()   CLOCK_MONOTONIC，计算时间间隔
+      Clock::monotonicCoarseNanos()  CLOCK_MONOTONIC_COARSE
+    EventLoop的pollReturnTime()由Clock::now()得到，每轮poll只读一次时钟
+    */
+    class Clock
+    {
+    public:
+        enum Source
+        {
+            kRealtime,
+            kRealtimeCoarse,
+        };
+
+        // 在启动时设置，影响Clock::now()以及poll返回时间
+        static void setSource(Source source) { source_.store(source, std::memory_order_relaxed); }
+        static Source source() { return source_.load(std::memory_order_relaxed); }
+
+        static Timestamp now()
+        {
+            return fromTimespec(source() == kRealtime ? CLOCK_REALTIME : CLOCK_REALTIME_COARSE);
+        }
+
+        static Timestamp coarseNow() { return fromTimespec(CLOCK_REALTIME_COARSE); }
+
+        static int64_t monotonicNanos() { return nanos(CLOCK_MONOTONIC); }
+        static int64_t monotonicCoarseNanos() { return nanos(CLOCK_MONOTONIC_COARSE); }
+
+    private:
+        static Timestamp fromTimespec(clockid_t clock)
+        {
+            struct timespec ts;
+            ::clock_gettime(clock, &ts);
+            return Timestamp(static_cast<int64_t>(ts.tv_sec) * Timestamp::kMicroSecondsPerSecond + ts.tv_nsec / 1000);
+        }
+
+        static int64_t nanos(clockid_t clock)
+        {
+            struct timespec ts;
+            ::clock_gettime(clock, &ts);
+            return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        }
+
+        inline static std::atomic<Source> source_ {kRealtime};
+    };
+
+    /*
+    读TSC计数器，用于测量100ns以下的时间间隔，不能用作墙上时间
+    第一次调用toNanos/ticksPerNanosecond时用CLOCK_MONOTONIC校准(约10ms)
+    不是x86时ticks就是CLOCK_MONOTONIC的纳秒数；invariant()为false时不同核上的读数不能直接比较
+    */
+    class TscClock
+    {
+    public:
+        static uint64_t ticks()
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            return __builtin_ia32_rdtsc();
+#else
+            return static_cast<uint64_t>(Clock::monotonicNanos());
+#endif
+        }
+
+        static int64_t toNanos(uint64_t ticks) { return static_cast<int64_t>(static_cast<double>(ticks) * nanosPerTick()); }
+        static double ticksPerNanosecond() { return 1.0 / nanosPerTick(); }
+        // CPU声明了invariant TSC，各个核上频率恒定且同步
+        static bool invariant();
+
+    private:
+        static double nanosPerTick();
+    };
+
+    /*
+    按秒缓存的格式化时间(UTC)，所有线程共享：每秒只有一个线程格式化，其他线程只是拷贝
+    用seqlock保护，读不需要加锁；正在更新或者不是同一秒时直接格式化，不等待
+    */
+    class CachedDate
+    {
+    public:
+        static const int kLogTimeLength = 17;     // "20240612 08:30:00"，日志使用
+        static const int kHttpDateLength = 29;    // "Wed, 12 Jun 2024 08:30:00 GMT"，HTTP Date头部使用
+
+        // 写入kLogTimeLength/kHttpDateLength个字符，不加'\0'
+        static void logTime(time_t seconds, char* buf);
+        static void httpDate(time_t seconds, char* buf);
+
+        // 直接格式化，不经过缓存
+        static void formatLogTime(time_t seconds, char* buf);
+        static void formatHttpDate(time_t seconds, char* buf);
+    };
+}
+}
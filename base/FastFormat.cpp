@@ -0,0 +1,209 @@
+#include "base/FastFormat.h"
+
+#include <charconv>
+#include <stdio.h>
+#include <sys/types.h>
+
+namespace Miren
+{
+namespace base
+{
+    namespace
+    {
+        enum Length
+        {
+            kDefault,
+            kChar,      // hh
+            kShort,     // h
+            kLong,      // l
+            kLongLong,  // ll
+            kSize,      // z
+            kIntmax,    // j
+            kPtrdiff,   // t
+        };
+
+        // p指向'%'后面的字符，解析长度修饰和转换字符，成功时p指向转换说明之后
+        bool parseSpec(const char*& p, Length* length, char* conversion)
+        {
+            *length = kDefault;
+            switch(*p) {
+                case 'h':
+                    *length = p[1] == 'h' ? kChar : kShort;
+                    p += p[1] == 'h' ? 2 : 1;
+                    break;
+                case 'l':
+                    *length = p[1] == 'l' ? kLongLong : kLong;
+                    p += p[1] == 'l' ? 2 : 1;
+                    break;
+                case 'z':
+                    *length = kSize;
+                    ++p;
+                    break;
+                case 'j':
+                    *length = kIntmax;
+                    ++p;
+                    break;
+                case 't':
+                    *length = kPtrdiff;
+                    ++p;
+                    break;
+                default:
+                    break;
+            }
+            *conversion = *p;
+            switch(*p) {
+                case 'd':
+                case 'i':
+                case 'u':
+                    ++p;
+                    return true;
+                case 's':
+                case 'c':
+                case '%':
+                    ++p;
+                    return *length == kDefault;
+                default:
+                    return false;
+            }
+        }
+
+        bool isSimple(const char* fmt)
+        {
+            for(const char* p = strchr(fmt, '%'); p; p = strchr(p, '%')) {
+                ++p;
+                Length length;
+                char conversion;
+                if(!parseSpec(p, &length, &conversion)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // va_list按指针传递，在各种ABI下读参数后调用者的va_list都会前进
+        int64_t signedArg(va_list* ap, Length length)
+        {
+            switch(length) {
+                case kChar:
+                    return static_cast<signed char>(va_arg(*ap, int));
+                case kShort:
+                    return static_cast<short>(va_arg(*ap, int));
+                case kLong:
+                    return va_arg(*ap, long);
+                case kLongLong:
+                    return va_arg(*ap, long long);
+                case kSize:
+                    return va_arg(*ap, ssize_t);
+                case kIntmax:
+                    return va_arg(*ap, intmax_t);
+                case kPtrdiff:
+                    return va_arg(*ap, ptrdiff_t);
+                default:
+                    return va_arg(*ap, int);
+            }
+        }
+
+        uint64_t unsignedArg(va_list* ap, Length length)
+        {
+            switch(length) {
+                case kChar:
+                    return static_cast<unsigned char>(va_arg(*ap, unsigned int));
+                case kShort:
+                    return static_cast<unsigned short>(va_arg(*ap, unsigned int));
+                case kLong:
+                    return va_arg(*ap, unsigned long);
+                case kLongLong:
+                    return va_arg(*ap, unsigned long long);
+                case kSize:
+                    return va_arg(*ap, size_t);
+                case kIntmax:
+                    return va_arg(*ap, uintmax_t);
+                case kPtrdiff:
+                    return static_cast<uint64_t>(va_arg(*ap, ptrdiff_t));
+                default:
+                    return va_arg(*ap, unsigned int);
+            }
+        }
+
+        // 先用栈上的缓冲区，不够时再按实际长度分配
+        std::string formatSlow(const char* fmt, va_list ap)
+        {
+            char buf[256];
+            va_list copy;
+            va_copy(copy, ap);
+            int len = vsnprintf(buf, sizeof buf, fmt, copy);
+            va_end(copy);
+            if(len < 0) {
+                return "";
+            }
+            if(static_cast<size_t>(len) < sizeof buf) {
+                return std::string(buf, static_cast<size_t>(len));
+            }
+            std::string result(static_cast<size_t>(len), '\0');
+            vsnprintf(&result[0], result.size() + 1, fmt, ap);
+            return result;
+        }
+    }
+
+    size_t FastFormat::formatDouble(char* buf, double value)
+    {
+        std::to_chars_result result = std::to_chars(buf, buf + kMaxDoubleLength, value);
+        return static_cast<size_t>(result.ptr - buf);
+    }
+
+    size_t FastFormat::formatHex(char* buf, uint64_t value)
+    {
+        static const char kHexDigits[] = "0123456789ABCDEF";
+        const int bits = 64 - __builtin_clzll(value | 1);
+        const size_t n = static_cast<size_t>((bits + 3) / 4);
+        for(char* p = buf + n; p != buf; value >>= 4) {
+            *--p = kHexDigits[value & 15];
+        }
+        return n;
+    }
+
+    std::string FastFormat::formatv(const char* fmt, va_list ap)
+    {
+        if(!isSimple(fmt)) {
+            return formatSlow(fmt, ap);
+        }
+
+        va_list args;
+        va_copy(args, ap);
+        std::string result;
+        result.reserve(strlen(fmt) + 32);
+        char buf[kMaxIntegerLength];
+        const char* p = fmt;
+        while(const char* percent = strchr(p, '%')) {
+            result.append(p, percent);
+            p = percent + 1;
+            Length length;
+            char conversion;
+            parseSpec(p, &length, &conversion);
+            switch(conversion) {
+                case 'd':
+                case 'i':
+                    result.append(buf, formatInteger(buf, signedArg(&args, length)));
+                    break;
+                case 'u':
+                    result.append(buf, formatUnsigned(buf, unsignedArg(&args, length)));
+                    break;
+                case 's': {
+                    const char* str = va_arg(args, const char*);
+                    result.append(str ? str : "(null)");
+                    break;
+                }
+                case 'c':
+                    result.push_back(static_cast<char>(va_arg(args, int)));
+                    break;
+                default:
+                    result.push_back('%');
+                    break;
+            }
+        }
+        va_end(args);
+        result.append(p);
+        return result;
+    }
+}
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <type_traits>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace Miren
+{
+namespace base
+{
+    /*
+    不经过printf和locale的数字格式化，LogStream、StringUtil::Format和HTTP的Content-Length使用
+      整数：先用位数表算出长度，再从后向前每次写两位数字(查200字节的表)，没有逐位的除法和reverse
+      浮点数：std::to_chars的最短表示，解析回来和原值完全相同，例如0.1+0.05输出0.15000000000000002
+    所有format函数都不加'\0'，返回写入的长度
+    */
+    class FastFormat
+    {
+    public:
+        static const int kMaxIntegerLength = 20;    // "-9223372036854775808"，"18446744073709551615"
+        static const int kMaxDoubleLength = 24;     // "-2.2250738585072014e-308"
+        static const int kMaxHexLength = 16;
+
+        template<typename T>
+        static size_t formatInteger(char* buf, T value)
+        {
+            static_assert(std::is_integral<T>::value, "integer required");
+            if constexpr(std::is_signed<T>::value) {
+                if(value < 0) {
+                    *buf = '-';
+                    return 1 + formatUnsigned(buf + 1, 0 - static_cast<uint64_t>(value));
+                }
+            }
+            return formatUnsigned(buf, static_cast<uint64_t>(value));
+        }
+
+        static size_t formatUnsigned(char* buf, uint64_t value)
+        {
+            const size_t n = digits10(value);
+            char* p = buf + n;
+            while(value >= 100) {
+                p -= 2;
+                memcpy(p, kDigitPairs + (value % 100) * 2, 2);
+                value /= 100;
+            }
+            if(value >= 10) {
+                memcpy(p - 2, kDigitPairs + value * 2, 2);
+            }
+            else {
+                *(p - 1) = static_cast<char>('0' + value);
+            }
+            return n;
+        }
+
+        // 十进制的位数，0是1位
+        static size_t digits10(uint64_t value)
+        {
+            // value|1不会跨过10的幂，并且去掉了clz(0)
+            const uint64_t v = value | 1;
+            const int bits = 64 - __builtin_clzll(v);
+            const int t = (bits * 1233) >> 12;      // 约等于bits * log10(2)
+            return static_cast<size_t>(t - (v < kPowersOf10[t]) + 1);
+        }
+
+        // 最短的能精确还原的表示，和"%.12g"一样在定点和科学计数法中选短的一种
+        static size_t formatDouble(char* buf, double value);
+        // 大写十六进制，不带0x
+        static size_t formatHex(char* buf, uint64_t value);
+
+        template<typename T>
+        static std::string toString(T value)
+        {
+            char buf[kMaxDoubleLength];
+            size_t n;
+            if constexpr(std::is_floating_point<T>::value) {
+                n = formatDouble(buf, static_cast<double>(value));
+            }
+            else {
+                n = formatInteger(buf, value);
+            }
+            return std::string(buf, n);
+        }
+
+        // printf风格的格式化
+        // 只有%d %i %u %s %c %%(可以带hh/h/l/ll/z/j/t长度修饰，不带标志、宽度和精度)时直接格式化，
+        // 其他情况交给vsnprintf，结果和vsnprintf相同
+        static std::string formatv(const char* fmt, va_list ap);
+
+    private:
+        inline static constexpr uint64_t kPowersOf10[20] = {
+            1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+            1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+            100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+            1000000000000000000ULL, 10000000000000000000ULL,
+        };
+
+        inline static constexpr char kDigitPairs[201] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+    };
+}
+}
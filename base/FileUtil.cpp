@@ -1,12 +1,16 @@
 #include "base/FileUtil.h"
 #include "base/Types.h"
 #include "base/ErrorInfo.h"
+#include "base/Clock.h"
+#include <algorithm>
 #include <assert.h>
+#include <string.h>
 #include <stdio.h>
 #include <errno.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 
 namespace Miren
 {
@@ -107,8 +111,7 @@ namespace FileUtil
     //----------------------------AppendFile----------------------------------
     //不是线程安全的
     AppendFile::AppendFile(Miren::base::StringArg filename)
-            :fp_(::fopen(filename.c_str(), "ae")),
-            writtenBytes_(0)
+            :fp_(::fopen(filename.c_str(), "ae"))
     {
         assert(fp_);
         ::setbuffer(fp_, buffer_, sizeof buffer_);  //设置文件指针fp_的缓冲区设定64K，也就是文件的stream大小
@@ -144,6 +147,141 @@ namespace FileUtil
     size_t AppendFile::write(const char *logline, size_t len) {
         return ::fwrite_unlocked(logline, 1, len, fp_);//不加锁的方式写入，效率高，not thread safe
     }
+
+    namespace
+    {
+        int64_t nowMilliSeconds()
+        {
+            return Clock::monotonicCoarseNanos() / 1000000;
+        }
+    }
+
+    MmapAppendFile::MmapAppendFile(StringArg filename, const Options& options)
+            :options_(options),
+            fd_(::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666)),
+            offset_(0),
+            allocated_(0),
+            window_(nullptr),
+            windowStart_(0),
+            windowSize_(0),
+            lastSync_(nowMilliSeconds()),
+            dirty_(false),
+            syncCount_(0)
+    {
+        assert(fd_ >= 0);
+        struct stat st;
+        if(::fstat(fd_, &st) == 0) {
+            offset_ = st.st_size;   //和AppendFile一样接着已有的内容写
+            allocated_ = st.st_size;
+        }
+        mapWindow(offset_);
+    }
+
+    MmapAppendFile::~MmapAppendFile()
+    {
+        unmapWindow();
+        if(::ftruncate(fd_, offset_) < 0) {     //去掉预分配但没有写的部分
+            fprintf(stderr, "MmapAppendFile ftruncate failed %s\n", ErrorInfo::strerror_tl(errno));
+        }
+        if(options_.syncInterval > 0 && dirty_) {
+            sync();
+        }
+        ::close(fd_);
+    }
+
+    void MmapAppendFile::append(const char* logline, const size_t len)
+    {
+        size_t n = 0;
+        while(n < len) {
+            if(!window_) {
+                ssize_t x = ::pwrite(fd_, logline + n, len - n, offset_);
+                if(x <= 0) {
+                    fprintf(stderr, "MmapAppendFile::append() failed %s\n", ErrorInfo::strerror_tl(errno));
+                    break;
+                }
+                n += static_cast<size_t>(x);
+                offset_ += x;
+                continue;
+            }
+            off_t windowEnd = windowStart_ + static_cast<off_t>(windowSize_);
+            if(offset_ == windowEnd) {
+                mapWindow(offset_);     //失败时window_为nullptr，下一轮用pwrite
+                continue;
+            }
+            size_t x = std::min(len - n, static_cast<size_t>(windowEnd - offset_));
+            ::memcpy(window_ + (offset_ - windowStart_), logline + n, x);
+            n += x;
+            offset_ += static_cast<off_t>(x);
+        }
+        writtenBytes_ += static_cast<off_t>(len);
+        dirty_ = true;
+    }
+
+    //写入映射的内容已经在page cache中，只需要按间隔同步到磁盘
+    void MmapAppendFile::flush()
+    {
+        if(options_.syncInterval > 0 && dirty_ && nowMilliSeconds() - lastSync_ >= options_.syncInterval) {
+            sync();
+        }
+    }
+
+    //映射包含offset的窗口，窗口范围内的文件空间先分配好，写映射内存时不会因为空洞或磁盘满收到SIGBUS
+    bool MmapAppendFile::mapWindow(off_t offset)
+    {
+        unmapWindow();
+        const off_t pageSize = static_cast<off_t>(::sysconf(_SC_PAGESIZE));
+        size_t size = std::max(options_.windowSize, static_cast<size_t>(pageSize));
+        off_t start = offset / pageSize * pageSize;
+        if(!reserve(start + static_cast<off_t>(size))) {
+            return false;
+        }
+        void* addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, start);
+        if(addr == MAP_FAILED) {
+            fprintf(stderr, "MmapAppendFile mmap failed %s, fall back to pwrite\n", ErrorInfo::strerror_tl(errno));
+            return false;
+        }
+#ifdef MADV_POPULATE_WRITE
+        //一次建立好可写的页表，避免逐页的缺页中断；MAP_POPULATE对共享映射只预读，写时还要再缺页一次
+        ::madvise(addr, size, MADV_POPULATE_WRITE);     //老内核不支持，忽略错误
+#endif
+        window_ = static_cast<char*>(addr);
+        windowStart_ = start;
+        windowSize_ = size;
+        return true;
+    }
+
+    void MmapAppendFile::unmapWindow()
+    {
+        if(window_) {
+            ::munmap(window_, windowSize_);
+            window_ = nullptr;
+        }
+    }
+
+    bool MmapAppendFile::reserve(off_t end)
+    {
+        if(end <= allocated_) {
+            return true;
+        }
+        off_t size = std::max(end, allocated_ + options_.preallocateSize);
+        if(::fallocate(fd_, 0, allocated_, size - allocated_) < 0) {
+            fprintf(stderr, "MmapAppendFile fallocate failed %s, fall back to pwrite\n", ErrorInfo::strerror_tl(errno));
+            return false;
+        }
+        allocated_ = size;
+        return true;
+    }
+
+    //fdatasync同时写回通过映射修改的页
+    void MmapAppendFile::sync()
+    {
+        if(::fdatasync(fd_) < 0) {
+            fprintf(stderr, "MmapAppendFile fdatasync failed %s\n", ErrorInfo::strerror_tl(errno));
+        }
+        lastSync_ = nowMilliSeconds();
+        dirty_ = false;
+        ++syncCount_;
+    }
 }
 }
 }
\ No newline at end of file
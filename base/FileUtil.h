@@ -48,19 +48,34 @@ namespace FileUtil
         return file.readToString(maxSize, content, fileSize, modifyTime, createTime);
     }
 
-    //封装了一个文件指针的操作类,用于把数据写入文件中
-    class AppendFile : NonCopyable
+    //追加写文件的接口，LogFile按配置选择下面的一种实现
+    //都不是线程安全的，需要外部加锁
+    class AppendOnlyFile : NonCopyable
     {
     public:
-        explicit AppendFile(StringArg filename);
+        virtual ~AppendOnlyFile() = default;
 
-        void append(const char* logline, const size_t len);
+        virtual void append(const char* logline, const size_t len) = 0;
 
-        void flush();
+        virtual void flush() = 0;
 
         off_t writtenBytes() const { return writtenBytes_; }
 
-        ~AppendFile();
+    protected:
+        off_t writtenBytes_ = 0;    //已经写入的字节数
+    };
+
+    //封装了一个文件指针的操作类,用于把数据写入文件中
+    class AppendFile : public AppendOnlyFile
+    {
+    public:
+        explicit AppendFile(StringArg filename);
+
+        void append(const char* logline, const size_t len) override;
+
+        void flush() override;
+
+        ~AppendFile() override;
 
     private:
         size_t write(const char* logline, size_t len);
@@ -68,8 +83,51 @@ namespace FileUtil
     private:
         FILE* fp_;
         char buffer_[64*1024];  //文件缓冲区，64K
-        off_t writtenBytes_;    //已经写入的字节数
+    };
 
+    /*
+    用mmap追加写文件：每次用fallocate预先扩展preallocateSize，日志直接拷贝到映射的窗口中，
+    没有write系统调用，也没有stdio缓冲区到page cache的拷贝；窗口写满后映射下一段
+    flush()不需要系统调用，其他进程读文件就能看到；距离上一次fdatasync超过syncInterval时才同步到磁盘
+    关闭时ftruncate到实际写入的大小；进程崩溃时文件末尾会留下预分配的'\0'
+    fallocate或者mmap失败时(磁盘满、文件系统不支持)改用pwrite
+    */
+    class MmapAppendFile : public AppendOnlyFile
+    {
+    public:
+        struct Options
+        {
+            size_t windowSize = 4 * 1024 * 1024;        //每次映射的大小，页大小的整数倍
+            off_t preallocateSize = 64 * 1024 * 1024;   //每次fallocate扩展的大小
+            int syncInterval = 0;                       //fdatasync的最小间隔(ms)，0表示不主动同步，由内核回写
+        };
+
+        explicit MmapAppendFile(StringArg filename) : MmapAppendFile(filename, Options()) {}
+        MmapAppendFile(StringArg filename, const Options& options);
+        ~MmapAppendFile() override;     //fdatasync(syncInterval > 0时)并ftruncate到实际大小
+
+        void append(const char* logline, const size_t len) override;
+
+        void flush() override;
+
+        int64_t syncCount() const { return syncCount_; }
+
+    private:
+        bool mapWindow(off_t offset);
+        void unmapWindow();
+        bool reserve(off_t end);
+        void sync();
+
+        const Options options_;
+        int fd_;
+        off_t offset_;          //文件中下一个写入的位置
+        off_t allocated_;       //fallocate过的文件大小
+        char* window_;          //映射的窗口，nullptr表示使用pwrite
+        off_t windowStart_;
+        size_t windowSize_;
+        int64_t lastSync_;      //上一次fdatasync的时间(ms, CLOCK_MONOTONIC)
+        bool dirty_;            //上一次fdatasync之后有没有写入
+        int64_t syncCount_;
     };
 
     class File : NonCopyable
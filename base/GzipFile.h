@@ -37,6 +37,7 @@ namespace base
         int read(void* buf, int len) { return ::gzread(file_, buf, len); }
         int write(base::StringPiece buf) { return ::gzwrite(file_, buf.data(), static_cast<unsigned>(buf.size())); }
         off_t tell() const { return ::gztell(file_); }
+        bool setParams(int level, int strategy = Z_DEFAULT_STRATEGY) { return ::gzsetparams(file_, level, strategy) == Z_OK; }
 
 
     #if ZLIB_VERNUM >= 0x1240
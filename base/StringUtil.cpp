@@ -1,4 +1,5 @@
 #include "base/StringUtil.h"
+#include "base/FastFormat.h"
 #include <stdarg.h>
 #include <string.h>
 namespace Miren
@@ -15,14 +16,7 @@ std::string StringUtil::Format(const char* fmt, ...) {
 }
 
 std::string StringUtil::Formatv(const char* fmt, va_list ap) {
-    char* buf = nullptr;
-    auto len = vasprintf(&buf, fmt, ap);
-    if(len == -1) {
-        return "";
-    }
-    std::string ret(buf, len);
-    free(buf);
-    return ret;
+    return FastFormat::formatv(fmt, ap);
 }
 
 static const char uri_chars[256] = {
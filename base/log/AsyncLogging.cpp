@@ -2,27 +2,63 @@
 // Created by 37496 on 2024/6/24.
 //
 #include "base/log/AsyncLogging.h"
+#include "base/log/BinaryLog.h"
 #include "base/log/LogFile.h"
-#include "base/Timestamp.h"
+#include "base/log/LogRing.h"
+#include "base/thread/CurrentThread.h"
+#include "base/Clock.h"
+
+#include <algorithm>
+#include <sched.h>
 
 namespace Miren::log
 {
+    namespace
+    {
+        std::atomic<uint64_t> g_nextId(1);
+
+        const size_t kDefaultRingSize = 1024 * 1024;   //每个线程1M
+        const double kPollSeconds = 0.05;               //没有前端唤醒时，后端的轮询间隔
+
+        //线程局部的环，线程退出时标记为关闭，由后端读完后释放
+        struct ThreadRings
+        {
+            uint64_t lastId = 0;
+            detail::LogRing* last = nullptr;    //最近一次使用的环，通常只有一个AsyncLogging
+            std::vector<std::pair<uint64_t, std::shared_ptr<detail::LogRing>>> rings;
+
+            ~ThreadRings()
+            {
+                for(auto& ring : rings) {
+                    ring.second->close();
+                }
+            }
+        };
+
+        thread_local ThreadRings t_rings;
+    }
+
     AsyncLogging::AsyncLogging(const std::string& basename, off_t rollSize, int flushInterval)
                     :flushInterval_(flushInterval), //设置超时时间
                     running_(false),
                     basename_(basename),
                     rollSize_(rollSize),
+                    id_(g_nextId.fetch_add(1)),
+                    fullPolicy_(kDrop),
+                    ringSize_(kDefaultRingSize),
+                    dropped_(0),
+                    binaryOutput_(false),
+                    mmap_(false),
+                    decoder_(new LogDecoder(true)),
+                    definedRollCount_(0),
                     thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging"), //日志线程,设置线程启动执行的函数
                     latch_(1),
                     mutex_(),
                     cond_(mutex_),
-                    currentBuffer_(new Buffer),
-                    nextBuffer_(new Buffer),
-                    buffers_()
+                    wakeupPending_(false),
+                    rings_(),
+                    ringsVersion_(0)
     {
-        currentBuffer_->bzero();
-        nextBuffer_->bzero();
-        buffers_.reserve(16);   //缓冲区列表预留16个空间
     }
 
     AsyncLogging::~AsyncLogging()
@@ -32,29 +68,64 @@ namespace Miren::log
         }
     }
 
-    //前端写日志消息进currentBuffer_缓冲并在写满时通知后端
-    void AsyncLogging::append(const char* logline, int len)
+    //找到当前线程的环，第一次调用时创建并登记到后端
+    detail::LogRing* AsyncLogging::ringOfThisThread()
     {
-        base::MutexLockGuard lock(mutex_);
-        if(currentBuffer_->avail() > len) {
-            currentBuffer_->append(logline, len);   //当前currentBuffer_未满，直接追加日志数据到当前Buffer
+        if(t_rings.lastId == id_) {
+            return t_rings.last;
         }
-        else {
-            //否则，说明当前缓冲已写满，就先把currentBuffer_记录的日志消息移入待写入文件的buffers_列表
-            buffers_.push_back(std::move(currentBuffer_));
 
-            if(nextBuffer_) {   //把预备好的另一块缓冲nextBuffer_移用为当前缓冲
-                currentBuffer_ = std::move(nextBuffer_);
+        detail::LogRing* ring = nullptr;
+        for(auto& entry : t_rings.rings) {
+            if(entry.first == id_) {
+                ring = entry.second.get();
+                break;
             }
-            else {  //那就再分配一块新的Buffer(如果前端写入太快，导致current和next Buffer缓冲都用完了)
-                currentBuffer_.reset(new Buffer);
+        }
+        if(!ring) {
+            RingPtr newRing(new detail::LogRing(ringSize_, base::CurrentThread::tid()));
+            {
+                base::MutexLockGuard lock(mutex_);
+                rings_.push_back(newRing);
+                ringsVersion_.fetch_add(1, std::memory_order_release);
             }
-            currentBuffer_->append(logline, len);   //currentBuffer_弄好后，追加日志消息到currentBuffer_中
-            cond_.notify();     //并通知（唤醒）后端开始写入日志数据
+            t_rings.rings.emplace_back(id_, newRing);
+            ring = newRing.get();
         }
+        t_rings.lastId = id_;
+        t_rings.last = ring;
+        return ring;
     }
 
+    void AsyncLogging::wakeBackend()
+    {
+        if(!wakeupPending_.load(std::memory_order_relaxed) && !wakeupPending_.exchange(true)) {
+            base::MutexLockGuard lock(mutex_);
+            cond_.notify();
+        }
+    }
 
+    //前端只写当前线程的环，不加锁；环用了一半时提前唤醒后端
+    void AsyncLogging::append(const char* logline, int len)
+    {
+        detail::LogRing* ring = ringOfThisThread();
+        int64_t now = base::Clock::now().microSecondsSinceEpoch();
+
+        while(!ring->tryAppend(logline, len, now)) {
+            if(fullPolicy_ == kDrop || !running_) {
+                ring->addDropped();
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                wakeBackend();
+                return;
+            }
+            wakeBackend();
+            ::sched_yield();
+        }
+
+        if(ring->used() > ring->capacity() / 2) {
+            wakeBackend();
+        }
+    }
 
     void AsyncLogging::start()
     {
@@ -66,9 +137,88 @@ namespace Miren::log
     void AsyncLogging::stop() NO_THREAD_SAFETY_ANALYSIS
     {
         running_ = false;
-        cond_.notify();
+        {
+            base::MutexLockGuard lock(mutex_);
+            cond_.notify();
+        }
         thread_.join();
-    }  
+    }
+
+    //每次从各个环中取出时间戳最小的一条，直到本轮开始时看到的记录都写完
+    size_t AsyncLogging::drainRings(LogFile& output, std::vector<RingPtr>& rings)
+    {
+        const size_t n = rings.size();
+        std::vector<uint64_t> limits(n);
+        std::vector<const detail::LogRing::Record*> heads(n);
+        for(size_t i = 0; i < n; i++) {
+            limits[i] = rings[i]->readLimit();
+            heads[i] = rings[i]->peek(limits[i]);
+        }
+
+        size_t written = 0;
+        for(;;) {
+            size_t next = n;
+            for(size_t i = 0; i < n; i++) {
+                if(heads[i] && (next == n || heads[i]->timestamp < heads[next]->timestamp)) {
+                    next = i;
+                }
+            }
+            if(next == n) {
+                break;
+            }
+            const detail::LogRing::Record* record = heads[next];
+            writeRecord(output, record->data(), static_cast<int>(record->len));
+            rings[next]->pop(record);
+            heads[next] = rings[next]->peek(limits[next]);
+            ++written;
+        }
+
+        //丢弃的日志条数也写进文件
+        for(const auto& ring : rings) {
+            uint64_t dropped = ring->takeDropped();
+            if(dropped > 0) {
+                char buf[256];
+                int len = snprintf(buf, sizeof buf, "Dropped %lu log messages of thread %d at %s, ring full\n",
+                                   dropped, ring->tid(), base::Timestamp::now().toFormattedString().c_str());
+                fputs(buf, stderr);
+                output.append(buf, len);
+            }
+        }
+        return written;
+    }
+
+    //二进制记录在这里格式化；或者原样写入，并保证文件中有它的调用点定义
+    void AsyncLogging::writeRecord(LogFile& output, const char* data, int len)
+    {
+        if(!binary::isBinary(data, len)) {
+            output.append(data, len);
+            return;
+        }
+
+        if(!binaryOutput_) {
+            decoded_.clear();
+            decoder_->decode(data, len, &decoded_);
+            output.append(decoded_.data(), static_cast<int>(decoded_.size()));
+            return;
+        }
+
+        if(output.rollCount() != definedRollCount_) {
+            definedRollCount_ = output.rollCount();
+            definedSites_.clear();
+        }
+        binary::RecordHeader header;
+        memcpy(&header, data, sizeof header);
+        if(header.siteId >= definedSites_.size()) {
+            definedSites_.resize(header.siteId + 1);
+        }
+        if(!definedSites_[header.siteId]) {
+            definedSites_[header.siteId] = true;
+            decoded_.clear();
+            binary::appendSiteDef(header.siteId, &decoded_);
+            output.append(decoded_.data(), static_cast<int>(decoded_.size()));
+        }
+        output.append(data, len);
+    }
 
     //接收方后端线程把前端传来的日志写入到文件中
     void AsyncLogging::threadFunc()
@@ -77,76 +227,54 @@ namespace Miren::log
         latch_.countDown();
 
         LogFile output(basename_, rollSize_, false, flushInterval_);
+        output.setArchiver(archiver_);
+        if(mmap_) {
+            output.setMmap(mmapOptions_);
+        }
 
-        BufferUPtr newBuffer1(new Buffer);
-        BufferUPtr newBuffer2(new Buffer);
-        newBuffer1->bzero();
-        newBuffer2->bzero();
-
-        BufferVector buffersToWrite;
-        buffersToWrite.reserve(16);
-
-        while (running_)
-        {
-            assert(newBuffer1 && newBuffer1->length() == 0);
-            assert(newBuffer2 && newBuffer2->length() == 0);
-            assert(buffersToWrite.empty());
+        std::vector<RingPtr> rings;     //rings_的副本，遍历时不需要加锁
+        uint64_t version = 0;
+        bool unflushed = false;
 
-            {
+        for(;;) {
+            bool running = running_;
+            wakeupPending_.store(false, std::memory_order_relaxed);
+            if(ringsVersion_.load(std::memory_order_acquire) != version) {
                 base::MutexLockGuard lock(mutex_);
-                //在临界区内等待条件触发。1.超时（flushInterval_） 2.前端写满了一个或多个buffer，见append
-                if(buffers_.empty()) {
-                    cond_.waitForSeconds(flushInterval_);
-                }
-                buffers_.push_back(std::move(currentBuffer_));
-                currentBuffer_ = std::move(newBuffer1); //并立刻将空闲的newBuffer移为当前缓冲
-                buffersToWrite.swap(buffers_);
-                if(!nextBuffer_) {
-                    nextBuffer_ = std::move(newBuffer2);
-                }
+                rings = rings_;
+                version = ringsVersion_.load(std::memory_order_relaxed);
             }
 
-            assert(!buffersToWrite.empty());
-            //消息堆积
-            //前端陷入死循环，拼命发送日志消息，超过后端的处理能力，这就是典型的生产速度
-            //超过消费速度的问题，会造成数据在内存中堆积，严重时引发性能问题（可用内存不足）
-            //或程序崩溃（分配内存失败）
-            if(buffersToWrite.size() > 25) {
-                char buf[256];
-                snprintf(buf, sizeof buf, "Dropped log message at %s, %zd larger buffers\n",
-                base::Timestamp::now().toFormattedString().c_str(),
-                buffersToWrite.size() - 2);
-                fputs(buf, stderr);
-                output.append(buf, static_cast<int>(strlen(buf)));
-                buffersToWrite.erase(buffersToWrite.begin()+2, buffersToWrite.end());
-            }
-
-            for(const auto& buffer : buffersToWrite) {
-                output.append(buffer->data(), buffer->length());
+            size_t written = drainRings(output, rings);
+            if(written > 0) {
+                unflushed = true;
             }
 
-            if(buffersToWrite.size() > 2) {
-                buffersToWrite.resize(2);   //仅保留两个buffer，用于newBuffer1 newBuffer2
+            //释放已经退出并且读完的线程的环
+            if(std::any_of(rings.begin(), rings.end(), [](const RingPtr& ring) { return ring->finished(); })) {
+                base::MutexLockGuard lock(mutex_);
+                rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                                            [](const RingPtr& ring) { return ring->finished(); }),
+                             rings_.end());
+                rings = rings_;
+                version = ringsVersion_.fetch_add(1, std::memory_order_release) + 1;
             }
 
-            if(!newBuffer1) {
-                assert(!buffersToWrite.empty());
-                newBuffer1 = std::move(buffersToWrite.back());
-                buffersToWrite.pop_back();
-                newBuffer1->reset();
+            if(!running) {
+                break;
             }
 
-            if(!newBuffer2) {
-                assert(!buffersToWrite.empty());
-                newBuffer2 = std::move(buffersToWrite.back());
-                buffersToWrite.pop_back();
-                newBuffer2->reset();
+            if(written == 0) {
+                if(unflushed) {
+                    output.flush();     //空闲时把已写的日志刷到文件
+                    unflushed = false;
+                }
+                base::MutexLockGuard lock(mutex_);
+                if(!wakeupPending_.load(std::memory_order_relaxed) && running_) {
+                    cond_.waitForSeconds(kPollSeconds);
+                }
             }
-
-            buffersToWrite.clear();
-            output.flush();
         }
         output.flush();
-        
     }
-}
\ No newline at end of file
+}
@@ -2,6 +2,7 @@
 
 #include "base/log/LogStream.h"
 #include "base/Noncopyable.h"
+#include "base/FileUtil.h"
 #include "base/thread/Thread.h"
 #include "base/thread/CountDownLatch.h"
 #include "base/thread/Mutex.h"
@@ -9,20 +10,42 @@
 #include <vector>
 #include <memory>
 #include <atomic>
+#include <string>
 
 namespace Miren
 {
 namespace log
 {
+    class LogFile;
+    class LogDecoder;
+    class LogArchiver;
+
+    namespace detail
+    {
+        class LogRing;
+    }
+
     /*
-    muduo异步日志库采用的双缓冲技术：
-    前端负责往Buffer A填日志消息，后端负责将Buffer B的日志消息写入文件。
-    当Buffer A写满后，交换A和B，让后端将Buffer A的数据写入文件，而前端则往Buffer B
-    填入新的日志消息，如此往复。
+    每个写日志的线程有自己的单生产者单消费者环形缓冲(LogRing)，第一次append时向后端登记，
+    前端append只写自己的环，不需要加锁。后端线程轮询所有环，按时间戳归并后写入文件。
+    环满时按FullPolicy处理：
+      kDrop   丢弃这条日志并计数，后端在文件中记录每个线程丢弃的条数
+      kBlock  唤醒后端并等待，直到环中有空间
+    线程退出时它的环被标记为关闭，后端读完后释放
+    Logger::setBinaryMode时前端写入的是二进制记录，由后端格式化成文本后写入文件；
+    setBinaryOutput(true)则直接写入二进制记录，每个文件中第一次出现的调用点前写一条调用点定义，
+    用log_decoder转换成文本
+    setArchiver后滚动出的旧文件由LogArchiver在它自己的线程中压缩和清理，后端线程只负责通知
     */
     class AsyncLogging : public base::NonCopyable
     {
     public:
+        enum FullPolicy
+        {
+            kDrop,
+            kBlock,
+        };
+
         AsyncLogging(const std::string& basename, off_t rollSize, 
                         int flushInterval = 3);//超时时间默认3s（在超时时间内没有写满，也要将缓冲区的数据添加到文件当中）
         ~AsyncLogging();
@@ -31,28 +54,51 @@ namespace log
 
         void start();
         void stop() NO_THREAD_SAFETY_ANALYSIS;
+
+        void setFullPolicy(FullPolicy policy) { fullPolicy_ = policy; }
+        void setRingSize(size_t bytes) { ringSize_ = bytes; }   //每个线程的环大小，在append之前设置
+        uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }  //kDrop丢弃的总条数
+        void setBinaryOutput(bool on) { binaryOutput_ = on; }   //在start之前设置
+        void setArchiver(std::shared_ptr<LogArchiver> archiver) { archiver_ = std::move(archiver); }  //在start之前设置
+        //用mmap写日志文件，在start之前设置；options.syncInterval控制fdatasync的间隔
+        void setMmap(const base::FileUtil::MmapAppendFile::Options& options) { mmap_ = true; mmapOptions_ = options; }
         
     private:
+        typedef std::shared_ptr<detail::LogRing> RingPtr;
+
         void threadFunc();  //供后端消费者线程调用（将数据写到日志文件）
+        detail::LogRing* ringOfThisThread();
+        void wakeBackend();
+        size_t drainRings(LogFile& output, std::vector<RingPtr>& rings);   //返回写入的条数
+        void writeRecord(LogFile& output, const char* data, int len);
 
     private:
-        typedef Miren::log::detail::FixedBuffer<Miren::log::detail::kLargeBuffer> Buffer;   //固定一个Buffer大小为4M
-        typedef std::vector<std::unique_ptr<Buffer>> BufferVector;
-        typedef BufferVector::value_type BufferUPtr;
-
         const int flushInterval_;       //刷新间隔，在超时时间内没有写满，也要将这块缓冲区的数据添加到文件当中
         std::atomic<bool> running_;     //线程是否执行的标志
         const std::string basename_;    //日志文件名称
         const off_t rollSize_;          //日志文件滚动大小，当超过一定大小，则滚动一个新的日志文件
+        const uint64_t id_;             //区分不同的AsyncLogging对象，线程局部的环按它查找
+        FullPolicy fullPolicy_;
+        size_t ringSize_;
+        std::atomic<uint64_t> dropped_;
+        bool binaryOutput_;
+        std::shared_ptr<LogArchiver> archiver_;
+        bool mmap_;
+        base::FileUtil::MmapAppendFile::Options mmapOptions_;
+
+        //以下只在后端线程中使用
+        std::unique_ptr<LogDecoder> decoder_;
+        std::string decoded_;
+        std::vector<bool> definedSites_;    //当前文件中已经写过定义的调用点
+        int definedRollCount_;              //definedSites_对应的文件
 
         Miren::base::Thread thread_;    //使用了一个单独的线程来记录日志！
         Miren::base::CountDownLatch latch_; //用于等待线程启动
         Miren::base::MutexLock mutex_;
         Miren::base::Condition cond_ GUARDED_BY(mutex_);
-        BufferUPtr currentBuffer_ GUARDED_BY(mutex_);   //当前缓冲
-        BufferUPtr nextBuffer_ GUARDED_BY(mutex_);      //预备缓冲
-        BufferVector buffers_ GUARDED_BY(mutex_);       //待写入文件的已填满的缓冲列表，供后端写入的buffer
-
+        std::atomic<bool> wakeupPending_;   //前端已经请求过唤醒后端
+        std::vector<RingPtr> rings_ GUARDED_BY(mutex_);     //所有登记的环
+        std::atomic<uint64_t> ringsVersion_;    //rings_变化时加1，后端据此更新自己的副本
     };
 }
-}
\ No newline at end of file
+}
@@ -0,0 +1,233 @@
+#include "base/log/BinaryLog.h"
+#include "base/log/Logging.h"
+#include "base/ErrorInfo.h"
+#include "base/Timestamp.h"
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+namespace Miren::log
+{
+    extern const char* LogLevelName[Logger::NUM_LOG_LEVELS];
+    extern base::TimeZone global_logTimeZone;
+
+    namespace binary
+    {
+        void appendSiteDef(uint32_t siteId, std::string* out)
+        {
+            const LogSite* site = findLogSite(siteId);
+            if(!site) {
+                return;
+            }
+            SiteDefHeader header;
+            header.magic = kMagic;
+            header.kind = kSiteDef;
+            header.length = static_cast<uint16_t>(sizeof header + site->size());
+            header.siteId = siteId;
+            header.line = site->line();
+            header.fileLength = static_cast<uint32_t>(site->size());
+            out->append(reinterpret_cast<const char*>(&header), sizeof header);
+            out->append(site->file(), site->size());
+        }
+    }
+
+    namespace
+    {
+        //按类型标签读出一个参数，用文本模式的LogStream格式化，保证和文本日志完全一致
+        template<typename T>
+        bool readValue(const char*& p, const char* end, T* v)
+        {
+            if(static_cast<size_t>(end - p) < sizeof(T)) {
+                return false;
+            }
+            memcpy(v, p, sizeof(T));
+            p += sizeof(T);
+            return true;
+        }
+
+        template<typename T>
+        bool formatValue(const char*& p, const char* end, LogStream& stream)
+        {
+            T v;
+            if(!readValue(p, end, &v)) {
+                return false;
+            }
+            stream << v;
+            return true;
+        }
+
+        bool formatArg(const char*& p, const char* end, LogStream& stream)
+        {
+            uint8_t tag = static_cast<uint8_t>(*p++);
+            switch(tag) {
+                case binary::kBool: {
+                    uint8_t v;
+                    if(!readValue(p, end, &v)) {
+                        return false;
+                    }
+                    stream << (v != 0);
+                    return true;
+                }
+                case binary::kChar:
+                    return formatValue<char>(p, end, stream);
+                case binary::kInt32:
+                    return formatValue<int32_t>(p, end, stream);
+                case binary::kUInt32:
+                    return formatValue<uint32_t>(p, end, stream);
+                case binary::kInt64:
+                    return formatValue<int64_t>(p, end, stream);
+                case binary::kUInt64:
+                    return formatValue<uint64_t>(p, end, stream);
+                case binary::kDouble:
+                    return formatValue<double>(p, end, stream);
+                case binary::kPointer: {
+                    uint64_t v;
+                    if(!readValue(p, end, &v)) {
+                        return false;
+                    }
+                    stream << reinterpret_cast<const void*>(static_cast<uintptr_t>(v));
+                    return true;
+                }
+                case binary::kString: {
+                    uint16_t len;
+                    if(!readValue(p, end, &len) || static_cast<size_t>(end - p) < len) {
+                        return false;
+                    }
+                    stream << base::StringPiece(p, len);
+                    p += len;
+                    return true;
+                }
+                default:
+                    return false;
+            }
+        }
+    }
+
+    LogDecoder::LogDecoder(bool inProcess)
+        : inProcess_(inProcess),
+          lastSecond_(-1)
+    {
+    }
+
+    size_t LogDecoder::recordLength(const char* data, size_t len)
+    {
+        if(binary::isBinary(data, len)) {
+            uint16_t length;
+            memcpy(&length, data + offsetof(binary::RecordHeader, length), sizeof length);
+            return length <= len ? length : 0;
+        }
+        const char* eol = static_cast<const char*>(memchr(data, '\n', len));
+        return eol ? static_cast<size_t>(eol - data + 1) : 0;
+    }
+
+    const LogDecoder::Site* LogDecoder::findSite(uint32_t id)
+    {
+        if(id < sites_.size() && !sites_[id].file.empty()) {
+            return &sites_[id];
+        }
+        if(!inProcess_) {
+            return nullptr;
+        }
+        const LogSite* site = findLogSite(id);
+        if(!site) {
+            return nullptr;
+        }
+        if(id >= sites_.size()) {
+            sites_.resize(id + 1);
+        }
+        sites_[id].file.assign(site->file(), site->size());
+        sites_[id].line = site->line();
+        return &sites_[id];
+    }
+
+    //和Logger::Impl::formatTime的格式相同
+    void LogDecoder::formatTime(int64_t microSecondsSinceEpoch, std::string* out)
+    {
+        const base::TimeZone& tz = inProcess_ ? global_logTimeZone : timeZone_;
+        time_t seconds = static_cast<time_t>(microSecondsSinceEpoch / base::Timestamp::kMicroSecondsPerSecond);
+        int microseconds = static_cast<int>(microSecondsSinceEpoch % base::Timestamp::kMicroSecondsPerSecond);
+        if(seconds != lastSecond_) {
+            lastSecond_ = seconds;
+            struct tm tm_time;
+            if(tz.valid()) {
+                tm_time = tz.toLocalTime(seconds);
+            }
+            else {
+                ::gmtime_r(&seconds, &tm_time);
+            }
+            int len = snprintf(timeBuf_, sizeof(timeBuf_), "%4d%02d%02d %02d:%02d:%02d",
+                               tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+                               tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+            assert(len == 17); (void)len;
+        }
+        out->append(timeBuf_, 17);
+        Fmt us(tz.valid() ? ".%06d " : ".%06dZ ", microseconds);
+        out->append(us.data(), us.length());
+    }
+
+    bool LogDecoder::decode(const char* data, size_t len, std::string* out)
+    {
+        if(!binary::isBinary(data, len)) {
+            out->append(data, len);
+            return true;
+        }
+
+        if(data[1] == binary::kSiteDef) {
+            binary::SiteDefHeader header;
+            if(len < sizeof header) {
+                return false;
+            }
+            memcpy(&header, data, sizeof header);
+            if(sizeof header + header.fileLength > len) {
+                return false;
+            }
+            if(header.siteId >= sites_.size()) {
+                sites_.resize(header.siteId + 1);
+            }
+            sites_[header.siteId].file.assign(data + sizeof header, header.fileLength);
+            sites_[header.siteId].line = header.line;
+            return true;
+        }
+
+        binary::RecordHeader header;
+        if(data[1] != binary::kRecord || len < sizeof header) {
+            return false;
+        }
+        memcpy(&header, data, sizeof header);
+        if(header.level >= Logger::NUM_LOG_LEVELS) {
+            return false;
+        }
+
+        formatTime(header.microSecondsSinceEpoch, out);
+        char tid[32];
+        int n = snprintf(tid, sizeof tid, "%5d ", header.tid);
+        out->append(tid, n);
+        out->append(LogLevelName[header.level], 6);
+
+        LogStream stream;
+        if(header.savedErrno != 0) {
+            stream << base::ErrorInfo::strerror_tl(header.savedErrno) << " (errno=" << header.savedErrno << ") ";
+        }
+        const char* p = data + sizeof header;
+        const char* end = data + std::min<size_t>(len, header.length);
+        bool ok = true;
+        while(p < end) {
+            if(!formatArg(p, end, stream)) {
+                ok = false;
+                break;
+            }
+        }
+
+        const Site* site = findSite(header.siteId);
+        if(site) {
+            stream << " - " << site->file << ':' << site->line << '\n';
+        }
+        else {
+            stream << " - <unknown site " << header.siteId << ">\n";
+            ok = false;
+        }
+        out->append(stream.buffer().data(), stream.buffer().length());
+        return ok;
+    }
+}
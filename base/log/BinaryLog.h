@@ -0,0 +1,116 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "base/TimeZone.h"
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Miren
+{
+namespace log
+{
+    /*
+    二进制日志格式(Logger::setBinaryMode)：前端只记录调用点id和参数的原始字节，
+    由AsyncLogging的后端线程或离线工具(log_decoder)格式化成文本，文本和muduo格式完全一致
+    记录的开头是RecordHeader，之后是若干个参数，每个参数是1字节的类型标签加上原始字节：
+      整数/浮点/指针按本机字节序存放，字符串是uint16长度加内容
+    调用点定义记录(kSiteDef)把id映射到文件名和行号，写进每个日志文件，离线解码时使用
+    文本日志的第一个字节是数字，不会是kMagic，所以两种记录可以混在同一个文件中
+    */
+    namespace binary
+    {
+        const uint8_t kMagic = 0xB1;
+
+        enum Kind : uint8_t
+        {
+            kRecord = 1,
+            kSiteDef = 2,
+        };
+
+        enum Tag : uint8_t
+        {
+            kBool = 1,
+            kChar,
+            kInt32,
+            kUInt32,
+            kInt64,
+            kUInt64,
+            kDouble,
+            kPointer,
+            kString,
+        };
+
+        struct RecordHeader
+        {
+            uint8_t magic;
+            uint8_t kind;
+            uint16_t length;        //整条记录的字节数，包括头部
+            uint32_t siteId;
+            int64_t microSecondsSinceEpoch;
+            int32_t tid;
+            int32_t savedErrno;     //LOG_SYSERR时的errno，其他为0
+            uint8_t level;
+            uint8_t reserved[7];
+        };
+        static_assert(sizeof(RecordHeader) == 32, "RecordHeader layout");
+
+        struct SiteDefHeader
+        {
+            uint8_t magic;
+            uint8_t kind;
+            uint16_t length;
+            uint32_t siteId;
+            int32_t line;
+            uint32_t fileLength;    //之后是文件名
+        };
+        static_assert(sizeof(SiteDefHeader) == 16, "SiteDefHeader layout");
+
+        // data开头是否是一条二进制记录(kRecord或kSiteDef)
+        inline bool isBinary(const char* data, size_t len)
+        {
+            return len >= 4 && static_cast<uint8_t>(data[0]) == kMagic;
+        }
+
+        // 生成id对应的调用点定义记录，追加到out
+        void appendSiteDef(uint32_t siteId, std::string* out);
+    }
+
+    // 把二进制记录格式化成文本
+    class LogDecoder : base::NonCopyable
+    {
+    public:
+        // inProcess为true时，未知的调用点id从本进程登记的LogSite中查找，时区使用Logger::setTimeZone的设置；
+        // 否则只认识数据中出现过的kSiteDef，时区使用setTimeZone，默认UTC
+        explicit LogDecoder(bool inProcess);
+
+        void setTimeZone(const base::TimeZone& tz) { timeZone_ = tz; }
+
+        // data开头一条记录的长度，不是完整的二进制记录时返回文本行的长度(包括'\n')
+        // 数据不完整返回0
+        static size_t recordLength(const char* data, size_t len);
+
+        // 解码一条记录(recordLength的长度)并追加到out，kSiteDef只登记不输出，文本原样输出
+        // 记录格式错误或调用点未知时返回false
+        bool decode(const char* data, size_t len, std::string* out);
+
+    private:
+        struct Site
+        {
+            std::string file;
+            int line = 0;
+        };
+
+        const Site* findSite(uint32_t id);
+        void formatTime(int64_t microSecondsSinceEpoch, std::string* out);
+
+        const bool inProcess_;
+        base::TimeZone timeZone_;
+        std::vector<Site> sites_;   //下标是调用点id
+        int64_t lastSecond_;
+        char timeBuf_[64];
+    };
+}
+}
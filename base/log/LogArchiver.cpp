@@ -0,0 +1,357 @@
+#include "base/log/LogArchiver.h"
+#include "base/thread/CurrentThread.h"
+#include "base/ErrorInfo.h"
+#include "base/Timestamp.h"
+
+#ifdef MIREN_HAVE_ZLIB
+#include "base/GzipFile.h"
+#endif
+#ifdef MIREN_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace Miren::log
+{
+    namespace
+    {
+        const size_t kChunkSize = 256 * 1024;
+
+        // linux/ioprio.h在较老的系统上没有
+        const int kIoprioWhoProcess = 1;
+        const int kIoprioClassIdle = 3;
+        const int kIoprioClassShift = 13;
+
+        // 压缩和删除不能和写日志抢CPU和磁盘
+        void lowerPriority()
+        {
+            pid_t tid = base::CurrentThread::tid();
+            if(::setpriority(PRIO_PROCESS, static_cast<id_t>(tid), 19) < 0) {
+                fprintf(stderr, "LogArchiver setpriority failed %s\n", base::ErrorInfo::strerror_tl(errno));
+            }
+#ifdef SYS_ioprio_set
+            ::syscall(SYS_ioprio_set, kIoprioWhoProcess, tid, kIoprioClassIdle << kIoprioClassShift);
+#endif
+        }
+
+        bool endsWith(const std::string& str, const char* suffix)
+        {
+            size_t len = strlen(suffix);
+            return str.size() >= len && str.compare(str.size() - len, len, suffix) == 0;
+        }
+
+        // 压缩后的文件保留原文件的修改时间，按时间清理时才不会把它当成新文件
+        void copyModifyTime(const std::string& from, const std::string& to)
+        {
+            struct stat st;
+            if(::stat(from.c_str(), &st) == 0) {
+                struct timespec times[2] = { st.st_atim, st.st_mtim };
+                ::utimensat(AT_FDCWD, to.c_str(), times, 0);
+            }
+        }
+
+        struct OldFile
+        {
+            std::string name;
+            time_t mtime;
+            int64_t size;
+        };
+    }
+
+    LogArchiver::LogArchiver(const Options& options)
+        : options_(options),
+          queue_(),
+          thread_(std::bind(&LogArchiver::threadFunc, this), "LogArchiver"),
+          pending_(0),
+          filesCompressed_(0),
+          bytesIn_(0),
+          bytesOut_(0),
+          filesDeleted_(0),
+          busyMicroSeconds_(0)
+    {
+    }
+
+    LogArchiver::~LogArchiver()
+    {
+        if(thread_.started()) {
+            queue_.put(Task());     //空的basename表示退出
+            thread_.join();
+        }
+    }
+
+    void LogArchiver::start()
+    {
+        thread_.start();
+    }
+
+    void LogArchiver::archive(const std::string& basename, const std::string& closedFile, const std::string& activeFile)
+    {
+        pending_.fetch_add(1, std::memory_order_relaxed);
+        queue_.put(Task{basename, closedFile, activeFile});
+    }
+
+    LogArchiver::Stats LogArchiver::stats() const
+    {
+        Stats stats;
+        stats.filesCompressed = filesCompressed_.load(std::memory_order_relaxed);
+        stats.bytesIn = bytesIn_.load(std::memory_order_relaxed);
+        stats.bytesOut = bytesOut_.load(std::memory_order_relaxed);
+        stats.filesDeleted = filesDeleted_.load(std::memory_order_relaxed);
+        stats.busyMicroSeconds = busyMicroSeconds_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void LogArchiver::waitIdle()
+    {
+        while(pending_.load(std::memory_order_acquire) > 0) {
+            ::usleep(1000);
+        }
+    }
+
+    bool LogArchiver::supports(Compression compression)
+    {
+        switch(compression) {
+            case kNone:
+                return true;
+            case kGzip:
+#ifdef MIREN_HAVE_ZLIB
+                return true;
+#else
+                return false;
+#endif
+            case kZstd:
+#ifdef MIREN_HAVE_ZSTD
+                return true;
+#else
+                return false;
+#endif
+        }
+        return false;
+    }
+
+    void LogArchiver::threadFunc()
+    {
+        lowerPriority();
+        for(;;) {
+            Task task = queue_.take();
+            if(task.basename.empty()) {
+                break;
+            }
+            int64_t start = base::Timestamp::now().microSecondsSinceEpoch();
+            if(options_.compression != kNone) {
+                compress(task.closedFile);
+            }
+            applyRetention(task.basename, task.activeFile);
+            busyMicroSeconds_.fetch_add(base::Timestamp::now().microSecondsSinceEpoch() - start,
+                                        std::memory_order_relaxed);
+            pending_.fetch_sub(1, std::memory_order_release);
+        }
+    }
+
+    // 先写到.tmp，完成后再改名并删除原文件，中途退出不会留下不完整的压缩文件
+    bool LogArchiver::compress(const std::string& filename)
+    {
+        Compression compression = options_.compression;
+        if(compression == kZstd && !supports(kZstd)) {
+            compression = kGzip;
+        }
+        if(!supports(compression)) {
+            return false;
+        }
+
+        std::string target = filename + (compression == kZstd ? ".zst" : ".gz");
+        std::string tmp = target + ".tmp";
+        bool ok = compression == kZstd ? compressZstd(filename, tmp) : compressGzip(filename, tmp);
+        if(!ok) {
+            ::unlink(tmp.c_str());
+            return false;
+        }
+
+        struct stat st;
+        if(::stat(tmp.c_str(), &st) == 0) {
+            bytesOut_.fetch_add(st.st_size, std::memory_order_relaxed);
+        }
+        copyModifyTime(filename, tmp);
+        if(::rename(tmp.c_str(), target.c_str()) < 0) {
+            fprintf(stderr, "LogArchiver rename %s failed %s\n", tmp.c_str(), base::ErrorInfo::strerror_tl(errno));
+            ::unlink(tmp.c_str());
+            return false;
+        }
+        ::unlink(filename.c_str());
+        filesCompressed_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool LogArchiver::compressGzip(const std::string& filename, const std::string& target)
+    {
+#ifdef MIREN_HAVE_ZLIB
+        FILE* in = ::fopen(filename.c_str(), "rbe");
+        if(!in) {
+            fprintf(stderr, "LogArchiver open %s failed %s\n", filename.c_str(), base::ErrorInfo::strerror_tl(errno));
+            return false;
+        }
+        base::GzipFile out = base::GzipFile::openForWriteTruncate(target);
+        bool ok = out.valid();
+        if(ok && options_.level > 0) {
+            ok = out.setParams(options_.level);
+        }
+#if ZLIB_VERNUM >= 0x1240
+        if(ok) {
+            out.setBuffer(static_cast<int>(kChunkSize));
+        }
+#endif
+
+        std::unique_ptr<char[]> buf(new char[kChunkSize]);
+        int64_t start = base::Timestamp::now().microSecondsSinceEpoch();
+        int64_t total = 0;
+        size_t n;
+        while(ok && (n = ::fread(buf.get(), 1, kChunkSize, in)) > 0) {
+            ok = out.write(base::StringPiece(buf.get(), n)) == static_cast<int>(n);
+            total += static_cast<int64_t>(n);
+            throttle(start, total);
+        }
+        ok = ok && !::ferror(in);
+        ::fclose(in);
+        if(ok) {
+            bytesIn_.fetch_add(total, std::memory_order_relaxed);
+        }
+        return ok;  //out析构时gzclose
+#else
+        (void)filename;
+        (void)target;
+        return false;
+#endif
+    }
+
+    bool LogArchiver::compressZstd(const std::string& filename, const std::string& target)
+    {
+#ifdef MIREN_HAVE_ZSTD
+        FILE* in = ::fopen(filename.c_str(), "rbe");
+        if(!in) {
+            fprintf(stderr, "LogArchiver open %s failed %s\n", filename.c_str(), base::ErrorInfo::strerror_tl(errno));
+            return false;
+        }
+        FILE* out = ::fopen(target.c_str(), "wbe");
+        if(!out) {
+            ::fclose(in);
+            return false;
+        }
+
+        ZSTD_CCtx* cctx = ZSTD_createCCtx();
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, options_.level > 0 ? options_.level : ZSTD_CLEVEL_DEFAULT);
+        const size_t outSize = ZSTD_CStreamOutSize();
+        std::unique_ptr<char[]> inBuf(new char[kChunkSize]);
+        std::unique_ptr<char[]> outBuf(new char[outSize]);
+
+        int64_t start = base::Timestamp::now().microSecondsSinceEpoch();
+        int64_t total = 0;
+        bool ok = true;
+        for(;;) {
+            size_t n = ::fread(inBuf.get(), 1, kChunkSize, in);
+            bool last = n < kChunkSize;
+            ZSTD_EndDirective mode = last ? ZSTD_e_end : ZSTD_e_continue;
+            ZSTD_inBuffer input = { inBuf.get(), n, 0 };
+            bool finished = false;
+            while(ok && !finished) {
+                ZSTD_outBuffer output = { outBuf.get(), outSize, 0 };
+                size_t remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+                if(ZSTD_isError(remaining)) {
+                    ok = false;
+                    break;
+                }
+                ok = ::fwrite(outBuf.get(), 1, output.pos, out) == output.pos;
+                finished = last ? remaining == 0 : input.pos == input.size;
+            }
+            total += static_cast<int64_t>(n);
+            if(!ok || last) {
+                break;
+            }
+            throttle(start, total);
+        }
+        ok = ok && !::ferror(in);
+        ZSTD_freeCCtx(cctx);
+        ::fclose(in);
+        ok = ::fclose(out) == 0 && ok;
+        if(ok) {
+            bytesIn_.fetch_add(total, std::memory_order_relaxed);
+        }
+        return ok;
+#else
+        (void)filename;
+        (void)target;
+        return false;
+#endif
+    }
+
+    // 按速度上限计算应该用的时间，读得太快就睡一会
+    void LogArchiver::throttle(int64_t startMicroSeconds, int64_t totalBytes)
+    {
+        if(options_.bytesPerSecond <= 0) {
+            return;
+        }
+        int64_t expected = totalBytes * base::Timestamp::kMicroSecondsPerSecond / options_.bytesPerSecond;
+        int64_t elapsed = base::Timestamp::now().microSecondsSinceEpoch() - startMicroSeconds;
+        if(expected > elapsed) {
+            ::usleep(static_cast<useconds_t>(expected - elapsed));
+        }
+    }
+
+    // 旧文件是当前目录下basename.开头的.log/.log.gz/.log.zst，不包括正在写的文件
+    void LogArchiver::applyRetention(const std::string& basename, const std::string& activeFile)
+    {
+        if(options_.maxFiles <= 0 && options_.maxTotalBytes <= 0 && options_.maxAgeSeconds <= 0) {
+            return;
+        }
+
+        std::vector<OldFile> files;
+        const std::string prefix = basename + ".";
+        DIR* dir = ::opendir(".");
+        if(!dir) {
+            return;
+        }
+        while(struct dirent* entry = ::readdir(dir)) {
+            std::string name(entry->d_name);
+            if(name.compare(0, prefix.size(), prefix) != 0 || name == activeFile) {
+                continue;
+            }
+            if(!endsWith(name, ".log") && !endsWith(name, ".log.gz") && !endsWith(name, ".log.zst")) {
+                continue;
+            }
+            struct stat st;
+            if(::stat(name.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+                files.push_back(OldFile{name, st.st_mtime, static_cast<int64_t>(st.st_size)});
+            }
+        }
+        ::closedir(dir);
+
+        // 从新到旧，超过限制的都删除
+        std::sort(files.begin(), files.end(), [](const OldFile& a, const OldFile& b) {
+            return a.mtime != b.mtime ? a.mtime > b.mtime : a.name > b.name;
+        });
+        time_t now = ::time(nullptr);
+        int64_t totalBytes = 0;
+        for(size_t i = 0; i < files.size(); ++i) {
+            totalBytes += files[i].size;
+            bool remove = (options_.maxFiles > 0 && i >= static_cast<size_t>(options_.maxFiles)) ||
+                          (options_.maxTotalBytes > 0 && totalBytes > options_.maxTotalBytes) ||
+                          (options_.maxAgeSeconds > 0 && now - files[i].mtime > options_.maxAgeSeconds);
+            if(remove) {
+                if(::unlink(files[i].name.c_str()) == 0) {
+                    filesDeleted_.fetch_add(1, std::memory_order_relaxed);
+                }
+                totalBytes -= files[i].size;
+            }
+        }
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "base/BlockingQueue.h"
+#include "base/thread/Thread.h"
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+
+namespace Miren
+{
+namespace log
+{
+    /*
+    日志文件滚动后的处理：压缩刚关闭的文件，按个数/总大小/时间删除旧文件
+    LogFile滚动时只把文件名放进队列，压缩和删除都在单独的低优先级线程(nice 19，IO idle)中进行，
+    不会阻塞写日志的线程
+    一个LogArchiver可以给多个LogFile使用，只处理以各自basename开头的文件
+    e.g.
+        LogArchiver::Options options;
+        options.compression = LogArchiver::kGzip;
+        options.maxFiles = 10;
+        auto archiver = std::make_shared<LogArchiver>(options);
+        archiver->start();
+        asyncLog.setArchiver(archiver);
+    */
+    class LogArchiver : base::NonCopyable
+    {
+    public:
+        enum Compression
+        {
+            kNone,
+            kGzip,  //需要zlib
+            kZstd,  //需要libzstd，没有时使用kGzip
+        };
+
+        struct Options
+        {
+            Compression compression = kGzip;
+            int level = 0;                  //压缩级别，0表示默认级别
+            int maxFiles = 0;               //最多保留的旧文件个数，0表示不限制
+            int64_t maxTotalBytes = 0;      //旧文件的总大小上限
+            int maxAgeSeconds = 0;          //旧文件最多保留的时间
+            int64_t bytesPerSecond = 0;     //压缩时读文件的速度上限，减少对写日志的IO影响
+        };
+
+        struct Stats
+        {
+            int64_t filesCompressed = 0;
+            int64_t bytesIn = 0;
+            int64_t bytesOut = 0;
+            int64_t filesDeleted = 0;
+            int64_t busyMicroSeconds = 0;   //压缩和清理用的时间
+        };
+
+        explicit LogArchiver(const Options& options);
+        ~LogArchiver();     //处理完队列中的文件后退出
+
+        void start();
+
+        // 由LogFile在滚动后调用，不阻塞
+        // closedFile是刚关闭的文件，activeFile是正在写的文件，不会被删除
+        void archive(const std::string& basename, const std::string& closedFile, const std::string& activeFile);
+
+        Stats stats() const;
+        // 等待队列中的文件都处理完，测试使用
+        void waitIdle();
+
+        static bool supports(Compression compression);
+
+    private:
+        struct Task
+        {
+            std::string basename;
+            std::string closedFile;
+            std::string activeFile;
+        };
+
+        void threadFunc();
+        bool compress(const std::string& filename);
+        bool compressGzip(const std::string& filename, const std::string& target);
+        bool compressZstd(const std::string& filename, const std::string& target);
+        void applyRetention(const std::string& basename, const std::string& activeFile);
+        void throttle(int64_t startMicroSeconds, int64_t totalBytes);
+
+        const Options options_;
+        base::BlockingQueue<Task> queue_;
+        base::Thread thread_;
+
+        std::atomic<int64_t> pending_;
+        std::atomic<int64_t> filesCompressed_;
+        std::atomic<int64_t> bytesIn_;
+        std::atomic<int64_t> bytesOut_;
+        std::atomic<int64_t> filesDeleted_;
+        std::atomic<int64_t> busyMicroSeconds_;
+    };
+}
+}
@@ -3,6 +3,7 @@
 //
 
 #include "base/log/LogFile.h"
+#include "base/log/LogArchiver.h"
 #include "base/FileUtil.h"
 #include "base/ProcessInfo.h"
 namespace Miren::log
@@ -15,7 +16,9 @@ namespace Miren::log
                 mutex_(threadSafe ? new base::MutexLock() : nullptr),//不是线程安全就不需要构造mutex_
                 startOfPeriod_(0),
                 lastRoll_(0),
-                lastFlush_(0)
+                lastFlush_(0),
+                rollCount_(0),
+                mmap_(false)
     {
         assert(basename.find('/') == std::string::npos);    //断言basename不包含'/'
         rollFile();
@@ -33,6 +36,32 @@ namespace Miren::log
         }
     }
 
+    void LogFile::setMmap(const base::FileUtil::MmapAppendFile::Options& options) {
+        if(mutex_) {
+            base::MutexLockGuard lock(*mutex_);
+            setMmapUnlocked(options);
+        }
+        else {
+            setMmapUnlocked(options);
+        }
+    }
+
+    void LogFile::setMmapUnlocked(const base::FileUtil::MmapAppendFile::Options& options) {
+        mmap_ = true;
+        mmapOptions_ = options;
+        openFile(filename_);
+    }
+
+    void LogFile::openFile(const std::string& filename) {
+        file_.reset();  //先关闭，MmapAppendFile关闭时把文件截断到实际大小
+        if(mmap_) {
+            file_.reset(new base::FileUtil::MmapAppendFile(filename, mmapOptions_));
+        }
+        else {
+            file_.reset(new base::FileUtil::AppendFile(filename));
+        }
+    }
+
     void LogFile::flush() {
         if(mutex_) {
             base::MutexLockGuard lock(*mutex_);
@@ -76,7 +105,12 @@ namespace Miren::log
             lastRoll_ = now;
             lastFlush_ = now;
             startOfPeriod_ = start;
-            file_.reset(new base::FileUtil::AppendFile(filename));
+            ++rollCount_;
+            openFile(filename);         //旧文件在这里关闭
+            if(archiver_ && !filename_.empty()) {
+                archiver_->archive(basename_, filename_, filename);
+            }
+            filename_.swap(filename);
             return true;
         }
         return false;
@@ -7,18 +7,16 @@
 
 #include "base/Noncopyable.h"
 #include "base/thread/Mutex.h"
+#include "base/FileUtil.h"
 #include <string>
 #include <memory>
 
 namespace Miren
 {
-namespace base::FileUtil
-{
-    class AppendFile;
-}
-
 namespace log
 {
+    class LogArchiver;
+
     //用于把日志记录到文件的类
     //一个典型的日志文件名：logfile_test.20130411-115604.popo.7743.log
     //运行程序.时间.主机名.线程名.log
@@ -35,9 +33,16 @@ namespace log
         void append(const char* logline, int len);//将一行长度为len添加到日志文件中
         void flush();       //刷新
         bool rollFile();    //滚动文件
+        int rollCount() const { return rollCount_; }    //已经打开过的文件个数，每次滚动加1
+        //滚动后把关闭的文件交给archiver压缩和清理，在后台线程中进行
+        void setArchiver(std::shared_ptr<LogArchiver> archiver) { archiver_ = std::move(archiver); }
+        //改用mmap写文件(MmapAppendFile)，正在写的文件重新打开，之后滚动出的文件都用mmap
+        void setMmap(const base::FileUtil::MmapAppendFile::Options& options);
 
     private:
         void append_unlock(const char* logline, int len);   //不加锁的append方式
+        void setMmapUnlocked(const base::FileUtil::MmapAppendFile::Options& options);  //不加锁的setMmap
+        void openFile(const std::string& filename);
         //生成日志文件的名称(运行程序.时间.主机名.线程名.log)
         static std::string getLogFileName(const std::string& base, time_t* now);
     private:
@@ -51,7 +56,12 @@ namespace log
         time_t startOfPeriod_;          // 开始记录日志时间（调整到零时时间, 时间/ kRollPerSeconds_ * kRollPerSeconds_）
         time_t lastRoll_;               // 上一次滚动日志文件时间
         time_t lastFlush_;              // 上一次日志写入文件时间
-        std::unique_ptr<base::FileUtil::AppendFile> file_;
+        int rollCount_;
+        bool mmap_;                     //用MmapAppendFile写文件
+        base::FileUtil::MmapAppendFile::Options mmapOptions_;
+        std::unique_ptr<base::FileUtil::AppendOnlyFile> file_;
+        std::string filename_;          // 正在写的文件
+        std::shared_ptr<LogArchiver> archiver_;
 
         const static int kRollPerSeconds_ = 60 * 60 * 24;   //一天的时间
     };
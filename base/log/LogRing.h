@@ -0,0 +1,152 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+
+#include <atomic>
+#include <memory>
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace Miren
+{
+namespace log
+{
+namespace detail
+{
+    /*
+    单生产者单消费者的日志环形缓冲，AsyncLogging为每个写日志的线程分配一个
+    前端线程只写head_，后端线程只写tail_，互相之间不需要锁
+    每条记录: [len(4) pad(4) timestamp(8)][日志内容，补齐到8字节]
+    环尾放不下一条完整记录时，写一个kWrapMarker，从头开始写
+    */
+    class LogRing : base::NonCopyable
+    {
+    public:
+        struct Record
+        {
+            uint32_t len;
+            uint32_t pad;
+            int64_t timestamp;  //微秒，后端按它归并各线程的日志
+
+            const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+        };
+
+        explicit LogRing(size_t capacity, int tid)
+            : mask_(roundUp(capacity) - 1),
+              buf_(new char[mask_ + 1]),
+              tid_(tid)
+        {
+        }
+
+        // ---- 前端线程 ----
+        bool tryAppend(const char* data, int len, int64_t timestamp)
+        {
+            const uint64_t need = recordSize(len);
+            const uint64_t capacity = mask_ + 1;
+            uint64_t head = head_.load(std::memory_order_relaxed);
+            uint64_t contiguous = capacity - (head & mask_);
+            uint64_t total = contiguous < need ? contiguous + need : need;
+            if (need > capacity / 2) {
+                return false;   //单条日志太长
+            }
+
+            if (head + total - cachedTail_ > capacity) {
+                cachedTail_ = tail_.load(std::memory_order_acquire);
+                if (head + total - cachedTail_ > capacity) {
+                    return false;
+                }
+            }
+
+            if (contiguous < need) {
+                // contiguous是8的倍数，至少放得下len字段
+                reinterpret_cast<Record*>(buf_.get() + (head & mask_))->len = kWrapMarker;
+                head += contiguous;
+            }
+
+            Record* record = reinterpret_cast<Record*>(buf_.get() + (head & mask_));
+            record->len = static_cast<uint32_t>(len);
+            record->timestamp = timestamp;
+            memcpy(record + 1, data, len);
+            head_.store(head + need, std::memory_order_release);
+            return true;
+        }
+
+        // 已经使用的字节数，前端据此决定是否提前唤醒后端
+        size_t used() const
+        {
+            return static_cast<size_t>(head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed));
+        }
+
+        size_t capacity() const { return mask_ + 1; }
+
+        void addDropped() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+        void close() { closed_.store(true, std::memory_order_release); }
+
+        // ---- 后端线程 ----
+        // 本轮可以读到的位置，之后前端写入的记录留到下一轮
+        uint64_t readLimit() const { return head_.load(std::memory_order_acquire); }
+
+        // 下一条在limit之前的记录，没有返回nullptr
+        const Record* peek(uint64_t limit)
+        {
+            while (readPos_ < limit) {
+                uint64_t contiguous = mask_ + 1 - (readPos_ & mask_);
+                const Record* record = reinterpret_cast<const Record*>(buf_.get() + (readPos_ & mask_));
+                if (contiguous < sizeof(Record) || record->len == kWrapMarker) {
+                    readPos_ += contiguous;
+                    continue;
+                }
+                return record;
+            }
+            return nullptr;
+        }
+
+        void pop(const Record* record)
+        {
+            readPos_ += recordSize(static_cast<int>(record->len));
+            tail_.store(readPos_, std::memory_order_release);
+        }
+
+        // 线程已经退出，并且它写的日志都读完了
+        bool finished() const
+        {
+            return closed() && readPos_ == head_.load(std::memory_order_acquire);
+        }
+
+        uint64_t takeDropped() { return dropped_.exchange(0, std::memory_order_relaxed); }
+        bool closed() const { return closed_.load(std::memory_order_acquire); }
+        int tid() const { return tid_; }
+
+    private:
+        static uint64_t recordSize(int len)
+        {
+            return sizeof(Record) + ((static_cast<uint64_t>(len) + 7) & ~uint64_t(7));
+        }
+
+        static size_t roundUp(size_t n)
+        {
+            size_t cap = 4096;
+            while (cap < n) {
+                cap <<= 1;
+            }
+            return cap;
+        }
+
+        static const uint32_t kWrapMarker = 0xFFFFFFFF;
+
+        const uint64_t mask_;
+        std::unique_ptr<char[]> buf_;
+        const int tid_;
+
+        alignas(64) std::atomic<uint64_t> head_ {0};    //前端写
+        uint64_t cachedTail_ = 0;                       //前端看到的tail_，减少读后端的cache line
+        std::atomic<uint64_t> dropped_ {0};
+        std::atomic<bool> closed_ {false};               //线程已退出，读完后可以释放
+
+        alignas(64) std::atomic<uint64_t> tail_ {0};    //后端写
+        uint64_t readPos_ = 0;
+    };
+}
+}
+}
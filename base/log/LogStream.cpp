@@ -3,6 +3,8 @@
 //
 
 #include "base/log/LogStream.h"
+#include "base/log/BinaryLog.h"
+#include "base/FastFormat.h"
 #include <algorithm>
 #include <limits>
 #include <assert.h>
@@ -17,50 +19,6 @@ namespace Miren::log
 {
     namespace detail
     {
-        const char digits[] = "9876543210123456789";
-        const char* zero = digits + 9;
-        static_assert(sizeof(digits) == 20, "wrong number of digits");
-
-        const char digitsHex[] = "0123456789ABCDEF";
-        static_assert(sizeof(digitsHex) == 17, "wrong number of digitsHex");
-
-        //实现将一个整数转换成字符串
-        template<typename T>
-        size_t convert(char buf[], T value) {
-            T i = value;
-            char* p = buf;
-
-            do {
-                int lsd = static_cast<int>(i % 10);//lsd意思是last digit，最后一位数字
-                i /= 10;
-                *p++ = zero[lsd];
-            } while (i != 0);
-
-            if(value < 0) { //如果小于0，加个负号
-                *p++ = '-';
-            }
-            *p = '\0';  //加上\0
-            std::reverse(buf, p);
-
-            return p-buf;
-        }
-        
-        //转为十六进制字符串
-        size_t convertHex(char buf[], uintptr_t value) {
-            uintptr_t i = value;
-            char* p = buf;
-
-            do {
-               int lsd = static_cast<int>(i % 16);
-               i /= 16;
-               *p++ = digitsHex[lsd];
-            } while (i != 0);
-
-            *p = '\0';
-            std::reverse(buf, p);
-            return p - buf;
-        }
-
         template class FixedBuffer<kSmallBuffer>;
         template class FixedBuffer<kLargeBuffer>;
 
@@ -86,15 +44,52 @@ namespace Miren::log
     template<typename T>
     void LogStream::formatInteger(T v)
     {
-        if(buffer_.avail() >= kMaxNumericSize) {
-            size_t len = detail::convert(buffer_.current(), v);
+        if(binary_) {
+            if(sizeof(T) <= sizeof(int32_t)) {
+                appendBinary(std::is_signed<T>::value ? binary::kInt32 : binary::kUInt32, v);
+            }
+            else {
+                appendBinary(std::is_signed<T>::value ? binary::kInt64 : binary::kUInt64, v);
+            }
+        }
+        else if(buffer_.avail() >= kMaxNumericSize) {
+            size_t len = base::FastFormat::formatInteger(buffer_.current(), v);
             buffer_.add(len);
         }
     }
 
+    //标签和数据一起写入，缓冲区不够时整个丢弃，不会留下半个参数
+    template<typename T>
+    void LogStream::appendBinary(uint8_t tag, T v)
+    {
+        char buf[1 + sizeof(T)];
+        buf[0] = static_cast<char>(tag);
+        memcpy(buf + 1, &v, sizeof(T));
+        buffer_.append(buf, sizeof buf);
+    }
+
+    //太长的字符串截断到缓冲区剩余的长度
+    void LogStream::appendBinaryString(const char* data, size_t len)
+    {
+        const size_t kHeader = 1 + sizeof(uint16_t);
+        size_t avail = static_cast<size_t>(buffer_.avail());
+        if(avail <= kHeader + 1) {
+            return;
+        }
+        uint16_t n = static_cast<uint16_t>(std::min(len, avail - kHeader - 1));
+        char header[kHeader];
+        header[0] = static_cast<char>(binary::kString);
+        memcpy(header + 1, &n, sizeof n);
+        buffer_.append(header, kHeader);
+        buffer_.append(data, n);
+    }
+
     LogStream &LogStream::operator<<(bool v)
     {
-        if(v) {
+        if(binary_) {
+            appendBinary(binary::kBool, static_cast<uint8_t>(v));
+        }
+        else if(v) {
             buffer_.append("true", 4);
         }
         else {
@@ -153,11 +148,14 @@ namespace Miren::log
     LogStream& LogStream::operator<<(const void* p)
     {
         uintptr_t v = reinterpret_cast<uintptr_t >(p);
-        if(buffer_.avail() >= kMaxNumericSize) {
+        if(binary_) {
+            appendBinary(binary::kPointer, static_cast<uint64_t>(v));
+        }
+        else if(buffer_.avail() >= kMaxNumericSize) {
             char* buf = buffer_.current();
             buf[0] = '0';
             buf[1] = 'x';
-            size_t len = detail::convertHex(buf+2, v);
+            size_t len = base::FastFormat::formatHex(buf+2, v);
             buffer_.add(len+2);
         }
         return *this;
@@ -171,8 +169,12 @@ namespace Miren::log
 
     LogStream& LogStream::operator<<(double v)
     {
-        if(buffer_.avail() >= kMaxNumericSize) {
-            int len = snprintf(buffer_.current(), kMaxNumericSize, "%.12g", v);
+        if(binary_) {
+            appendBinary(binary::kDouble, v);
+        }
+        else if(buffer_.avail() >= kMaxNumericSize) {
+            //最短的能精确还原的表示，比"%.12g"快，也不会丢失精度
+            size_t len = base::FastFormat::formatDouble(buffer_.current(), v);
             buffer_.add(len);
         }
         return *this;
@@ -181,17 +183,22 @@ namespace Miren::log
 
     LogStream& LogStream::operator<<(char v)
     {
-        buffer_.append(&v, 1);
+        if(binary_) {
+            appendBinary(binary::kChar, v);
+        }
+        else {
+            buffer_.append(&v, 1);
+        }
         return *this;
     }
 
     LogStream& LogStream::operator<<(const char* str)
     {
         if(str) {
-            buffer_.append(str, strlen(str));
+            append(str, static_cast<int>(strlen(str)));
         }
         else {
-            buffer_.append("(null)", 6);
+            append("(null)", 6);
         }
         return *this;
     }
@@ -203,13 +210,13 @@ namespace Miren::log
 
     LogStream& LogStream::operator<<(const std::string& v)
     {
-        buffer_.append(v.c_str(), v.length());
+        append(v.c_str(), static_cast<int>(v.length()));
         return *this;
     }
 
     LogStream& LogStream::operator<<(const base::StringPiece& v)
     {
-        buffer_.append(v.data(), v.size());
+        append(v.data(), static_cast<int>(v.size()));
         return *this;
     }
 
@@ -32,6 +32,7 @@ namespace detail
         }
         //返回首地址
         const char* data() const { return data_; }
+        char* data() { return data_; }
         //返回缓冲区已有数据长度
         int length() const { return static_cast<int>(cur_ - data_); }
         //返回当前数据末端地址
@@ -67,6 +68,7 @@ namespace detail
 //重载了各种<<,负责把各个类型的数据转换成字符串，
 //再添加到FixedBuffer中
 //该类主要负责将要记录的日志内容放到这个Buffer里面
+//二进制模式(setBinary)下不做格式化，只记录类型标签和原始字节，见BinaryLog.h
 class LogStream : public base::NonCopyable
 {
 public:
@@ -96,17 +98,35 @@ public:
     LogStream& operator<<(const base::StringPiece&);
     LogStream& operator<<(const Buffer&);
 
-    void append(const char* data, int len) { buffer_.append(data, len); }
+    void append(const char* data, int len)
+    {
+        if(binary_) {
+            appendBinaryString(data, len);
+        }
+        else {
+            buffer_.append(data, len);
+        }
+    }
     const Buffer& buffer() const { return buffer_; }
+    Buffer& buffer() { return buffer_; }
     void resetBuffer() { buffer_.reset(); }
 
+    void setBinary(bool on) { binary_ = on; }
+    bool binary() const { return binary_; }
+    //不经过编码直接写入，用于二进制记录的头部
+    void appendRaw(const void* data, size_t len) { buffer_.append(static_cast<const char*>(data), len); }
+
 private:
     void staticCheck();
 
     template<typename T>
     void formatInteger(T);
+    template<typename T>
+    void appendBinary(uint8_t tag, T v);
+    void appendBinaryString(const char* data, size_t len);
 private:
     Buffer buffer_;
+    bool binary_ = false;
 
     static const int kMaxNumericSize = 48;
 };
@@ -1,7 +1,12 @@
 #include "base/log/Logging.h"
+#include "base/log/BinaryLog.h"
+#include "base/Clock.h"
 #include "base/TimeZone.h"
 #include "base/ErrorInfo.h"
 #include "base/thread/CurrentThread.h"
+#include "base/thread/Mutex.h"
+#include <vector>
+#include <stddef.h>
 #include <stdlib.h>
 #include <assert.h>
 namespace Miren
@@ -26,6 +31,7 @@ namespace Miren
         }
 
         Logger::LogLevel global_logLevel = initLogLevel();
+        bool global_binaryMode = false;
 
 
         const char* LogLevelName[Logger::NUM_LOG_LEVELS] = {
@@ -66,6 +72,15 @@ namespace Miren
 
         void defaultOutput(const char* msg, int len)
         {
+            if(binary::isBinary(msg, len)) {
+                thread_local LogDecoder decoder(true);
+                thread_local std::string text;
+                text.clear();
+                decoder.decode(msg, len, &text);
+                size_t n = fwrite(text.data(), 1, text.size(), stdout);
+                (void)n;
+                return;
+            }
             size_t n = fwrite(msg, 1, len, stdout);
             (void)n;
         }
@@ -74,7 +89,32 @@ namespace Miren
         Logger::FlushFunc global_flush = defaultFlush;
 
         base::TimeZone global_logTimeZone;
+
+        //调用点登记表，下标加1是调用点的id
+        base::MutexLock g_sitesMutex;
+        std::vector<const LogSite*> g_sites GUARDED_BY(g_sitesMutex);
     } // namespace log 
+
+    namespace log
+    {
+        uint32_t LogSite::registerSite()
+        {
+            base::MutexLockGuard lock(g_sitesMutex);
+            uint32_t id = id_.load(std::memory_order_relaxed);
+            if(id == 0) {
+                g_sites.push_back(this);
+                id = static_cast<uint32_t>(g_sites.size());
+                id_.store(id, std::memory_order_relaxed);
+            }
+            return id;
+        }
+
+        const LogSite* findLogSite(uint32_t id)
+        {
+            base::MutexLockGuard lock(g_sitesMutex);
+            return id > 0 && id <= g_sites.size() ? g_sites[id - 1] : nullptr;
+        }
+    }
     
     namespace log
     {
@@ -93,11 +133,32 @@ namespace Miren
         Logger::Logger(SourceFile file, int line, bool toAbort) : impl_(toAbort ? FATAL : ERROR, errno, file, line)
         {
 
+        }
+        Logger::Logger(LogSite& site) : impl_(INFO, 0, site)
+        {
+
+        }
+        Logger::Logger(LogSite& site, LogLevel level) : impl_(level, 0, site)
+        {
+
+        }
+        Logger::Logger(LogSite& site, LogLevel level, const char* func) : impl_(level, 0, site)
+        {
+            impl_.stream_ << func << ' ';
+        }
+        Logger::Logger(LogSite& site, bool toAbort) : impl_(toAbort ? FATAL : ERROR, errno, site)
+        {
+
         }
         Logger::~Logger()
         {
             impl_.finish();
-            const LogStream::Buffer& buf(stream().buffer());
+            LogStream::Buffer& buf(stream().buffer());
+            if(stream().binary()) {
+                //参数都写完了，补上记录长度
+                uint16_t length = static_cast<uint16_t>(buf.length());
+                memcpy(buf.data() + offsetof(binary::RecordHeader, length), &length, sizeof length);
+            }
             global_output(buf.data(), buf.length());
             if(impl_.level_ == FATAL) {
                 global_flush();
@@ -125,21 +186,56 @@ namespace Miren
             global_logTimeZone = tz;
         }
 
+        void Logger::setBinaryMode(bool on)
+        {
+            global_binaryMode = on;
+        }
+
     }
 
     namespace log
     {
         Logger::Impl::Impl(LogLevel level, int old_errno, const SourceFile& file, int line)
-                :time_(base::Timestamp::now()),
+                :time_(base::Clock::now()),
                 stream_(),
                 level_(level),
                 line_(line),
                 basename_(file)
+        {
+            formatHeader(old_errno);
+        }
+
+        Logger::Impl::Impl(LogLevel level, int old_errno, LogSite& site)
+                :time_(base::Clock::now()),
+                stream_(),
+                level_(level),
+                line_(site.line()),
+                basename_(site.file(), site.size())
+        {
+            if(!global_binaryMode) {
+                formatHeader(old_errno);
+                return;
+            }
+            //二进制模式只记录原始数据，由LogDecoder格式化
+            binary::RecordHeader header;
+            memset(&header, 0, sizeof header);
+            header.magic = binary::kMagic;
+            header.kind = binary::kRecord;
+            header.siteId = site.id();
+            header.microSecondsSinceEpoch = time_.microSecondsSinceEpoch();
+            header.tid = base::CurrentThread::tid();
+            header.savedErrno = old_errno;
+            header.level = static_cast<uint8_t>(level);
+            stream_.appendRaw(&header, sizeof header);
+            stream_.setBinary(true);
+        }
+
+        void Logger::Impl::formatHeader(int old_errno)
         {
             formatTime();
             base::CurrentThread::tid();
             stream_ << T(base::CurrentThread::tidString(), base::CurrentThread::tidStringLength());
-            stream_ << T(LogLevelName[level], 6);
+            stream_ << T(LogLevelName[level_], 6);
             if(old_errno != 0) {
                 stream_ << base::ErrorInfo::strerror_tl(old_errno) << " (errno=" << old_errno << ") ";
             }
@@ -152,18 +248,16 @@ namespace Miren
             int microseconds = static_cast<int>(microSecondsSinceEpoch % base::Timestamp::kMicroSecondsPerSecond);
             if(seconds != t_lastSecond) {
                 t_lastSecond = seconds;
-                struct tm tm_time;
                 if(global_logTimeZone.valid()) {
-                    tm_time = global_logTimeZone.toLocalTime(seconds);
+                    struct tm tm_time = global_logTimeZone.toLocalTime(seconds);
+                    int len = snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
+                                        tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+                                        tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+                    assert(len == 17); (void)len;
                 }
                 else {
-                    ::gmtime_r(&seconds, &tm_time);
+                    base::CachedDate::logTime(seconds, t_time);   //UTC时各线程共享同一个格式化结果
                 }
-
-                int len = snprintf(t_time, sizeof(t_time), "%4d%02d%02d %02d:%02d:%02d",
-                                    tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
-                                    tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
-                assert(len == 17); (void)len;
             }
             if(global_logTimeZone.valid()) {
                 Fmt us(".%06d ", microseconds);
@@ -179,6 +273,9 @@ namespace Miren
 
         void Logger::Impl::finish()
         {
+            if(stream_.binary()) {
+                return;     //文件名和行号由调用点id得到
+            }
             stream_ << " - " << basename_ << ':' << line_ << '\n';
         }
     }
@@ -3,6 +3,8 @@
 #include "base/log/LogStream.h"
 #include "base/Timestamp.h"
 
+#include <atomic>
+
 namespace Miren
 {
 namespace base
@@ -12,6 +14,58 @@ namespace base
 
 namespace log
 {
+    //一个日志调用点(文件名和行号)，由LOG_*宏定义为静态变量，在编译期完成初始化
+    //二进制模式下日志只记录调用点的id，第一次使用时分配
+    class LogSite
+    {
+    public:
+        constexpr LogSite(const char* file, int line)
+            : file_(basename(file)), size_(length(basename(file))), line_(line), id_(0)
+        {
+        }
+
+        uint32_t id()
+        {
+            uint32_t id = id_.load(std::memory_order_relaxed);
+            return id != 0 ? id : registerSite();
+        }
+
+        const char* file() const { return file_; }
+        int size() const { return size_; }
+        int line() const { return line_; }
+
+    private:
+        static constexpr const char* basename(const char* path)
+        {
+            const char* base = path;
+            for(const char* p = path; *p; ++p) {
+                if(*p == '/') {
+                    base = p + 1;
+                }
+            }
+            return base;
+        }
+
+        static constexpr int length(const char* str)
+        {
+            int n = 0;
+            while(str[n]) {
+                ++n;
+            }
+            return n;
+        }
+
+        uint32_t registerSite();
+
+        const char* file_;
+        int size_;
+        int line_;
+        std::atomic<uint32_t> id_;
+    };
+
+    //按id查找调用点，id未分配返回nullptr
+    const LogSite* findLogSite(uint32_t id);
+
     //简单的日志记录分析，搭配AsyncLogging使用
     class Logger
     {
@@ -53,6 +107,8 @@ namespace log
                 }
                 size_ = static_cast<int>(strlen(data_));
             }
+
+            SourceFile(const char* basename, int size) : data_(basename), size_(size) {}
         };
 
         //各个构造函数中使用Impl类来生成日志消息格式
@@ -60,6 +116,11 @@ namespace log
         Logger(SourceFile file, int line, LogLevel level);
         Logger(SourceFile file, int line, LogLevel level, const char* func);
         Logger(SourceFile file, int line, bool toAbort);
+        //LOG_*宏使用，二进制模式下输出二进制记录
+        explicit Logger(LogSite& site);
+        Logger(LogSite& site, LogLevel level);
+        Logger(LogSite& site, LogLevel level, const char* func);
+        Logger(LogSite& site, bool toAbort);
         ~Logger();  //注意，是在析构函数中，把消息输出到stdout屏幕上的！
 
         LogStream& stream() { return impl_.stream_; }
@@ -73,6 +134,11 @@ namespace log
         static void setFlush(FlushFunc);    //清空缓冲
         static void setTimeZone(const base::TimeZone& tz);
 
+        //二进制模式：LOG_*宏不在前端格式化，输出的是二进制记录(BinaryLog.h)，
+        //默认的输出函数和AsyncLogging会把它转换成文本，自定义的输出函数需要用LogDecoder解码
+        static void setBinaryMode(bool on);
+        static bool binaryMode();
+
     private:
         //logger类内部的一个嵌套类，封装了Logger的缓冲区stream_,指定了生成日志消息的格式
         //具体实现。如一条日志消息：20180115 06:39:01.712150Z  7070 INFO  pid = 7070 - main.cc:13
@@ -81,6 +147,8 @@ namespace log
         public:
             typedef Logger::LogLevel LogLevel;
             Impl(LogLevel level, int old_errno, const SourceFile& file, int line);
+            Impl(LogLevel level, int old_errno, LogSite& site);
+            void formatHeader(int old_errno);   //时间、线程id、日志等级
             void formatTime();      //格式化time_时间戳为年月日后存于stream_中
             void finish();          //将日志写到缓冲区
 
@@ -94,11 +162,17 @@ namespace log
     };
 
     extern Logger::LogLevel global_logLevel;
+    extern bool global_binaryMode;
 
     inline Logger::LogLevel Logger::logLevel()
     {
         return global_logLevel;
     }
+
+    inline bool Logger::binaryMode()
+    {
+        return global_binaryMode;
+    }
 }
 
     namespace log
@@ -106,17 +180,20 @@ namespace log
         //__FILE__用以指示本行语句所在源文件的文件名
         //__LINE__用以指示本行语句在源文件中的位置信息
         //__func__指示当前的函数名
+        //MIREN_LOG_SITE()是调用点的静态LogSite，常量初始化，没有运行时开销
+        #define MIREN_LOG_SITE() \
+            ([]() -> Miren::log::LogSite& { static Miren::log::LogSite site(__FILE__, __LINE__); return site; }())
         #define LOG_TRACE if (Miren::log::Logger::logLevel() <= Miren::log::Logger::TRACE) \
-            Miren::log::Logger(__FILE__, __LINE__, Miren::log::Logger::TRACE, __func__).stream()
+            Miren::log::Logger(MIREN_LOG_SITE(), Miren::log::Logger::TRACE, __func__).stream()
         #define LOG_DEBUG if (Miren::log::Logger::logLevel() <= Miren::log::Logger::DEBUG) \
-            Miren::log::Logger(__FILE__, __LINE__, Miren::log::Logger::DEBUG, __func__).stream()
+            Miren::log::Logger(MIREN_LOG_SITE(), Miren::log::Logger::DEBUG, __func__).stream()
         #define LOG_INFO if (Miren::log::Logger::logLevel() <= Miren::log::Logger::INFO) \
-            Miren::log::Logger(__FILE__, __LINE__).stream()
-        #define LOG_WARN Miren::log::Logger(__FILE__, __LINE__, Miren::log::Logger::WARN).stream()
-        #define LOG_ERROR Miren::log::Logger(__FILE__, __LINE__, Miren::log::Logger::ERROR).stream()
-        #define LOG_FATAL Miren::log::Logger(__FILE__, __LINE__, Miren::log::Logger::FATAL).stream()
-        #define LOG_SYSERR Miren::log::Logger(__FILE__, __LINE__, false).stream()
-        #define LOG_SYSFATAL Miren::log::Logger(__FILE__, __LINE__, true).stream()
+            Miren::log::Logger(MIREN_LOG_SITE()).stream()
+        #define LOG_WARN Miren::log::Logger(MIREN_LOG_SITE(), Miren::log::Logger::WARN).stream()
+        #define LOG_ERROR Miren::log::Logger(MIREN_LOG_SITE(), Miren::log::Logger::ERROR).stream()
+        #define LOG_FATAL Miren::log::Logger(MIREN_LOG_SITE(), Miren::log::Logger::FATAL).stream()
+        #define LOG_SYSERR Miren::log::Logger(MIREN_LOG_SITE(), false).stream()
+        #define LOG_SYSFATAL Miren::log::Logger(MIREN_LOG_SITE(), true).stream()
     }
 
     #define CHECK_NOTNULL(val) \
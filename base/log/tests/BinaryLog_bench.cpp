@@ -0,0 +1,115 @@
+// 比较文本模式和二进制模式下LOG_INFO在前端的耗时(ns/call)
+// nop: 输出函数什么都不做，只有格式化/编码的开销
+// async: 通过AsyncLogging写文件，二进制记录在后端格式化(或者直接写入二进制文件)
+
+#include "base/log/AsyncLogging.h"
+#include "base/log/Logging.h"
+#include "base/Timestamp.h"
+
+#include <string>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+using Miren::log::Logger;
+
+namespace
+{
+  int64_t g_bytes;
+  Miren::log::AsyncLogging* g_asyncLog = nullptr;
+
+  void nopOutput(const char* msg, int len)
+  {
+    g_bytes += len;
+  }
+
+  void asyncOutput(const char* msg, int len)
+  {
+    g_bytes += len;
+    g_asyncLog->append(msg, len);
+  }
+
+  int64_t nowNanos()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  const int kIterations = 1000 * 1000;
+
+  void logStrings(int i)
+  {
+    LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i;
+  }
+
+  void logIntegers(int i)
+  {
+    LOG_INFO << "conn " << i << " fd " << i % 1024 << " bytes " << static_cast<int64_t>(i) * 4096
+             << " seq " << static_cast<uint64_t>(i) * 2654435761u;
+  }
+
+  void logDoubles(int i)
+  {
+    LOG_INFO << "latency " << i * 0.001 << " ms, ratio " << 1.0 / (i + 1) << " load " << i * 1.5;
+  }
+
+  template<typename F>
+  void bench(const char* name, const char* mode, F f)
+  {
+    g_bytes = 0;
+    int64_t start = nowNanos();
+    for(int i = 0; i < kIterations; ++i) {
+      f(i);
+    }
+    int64_t elapsed = nowNanos() - start;
+    printf("%-8s %-14s %8.1f ns/call %8.1f bytes/call\n",
+           name, mode, static_cast<double>(elapsed) / kIterations, static_cast<double>(g_bytes) / kIterations);
+  }
+
+  template<typename F>
+  void benchBoth(const char* name, F f)
+  {
+    Logger::setBinaryMode(false);
+    bench(name, "text", f);
+    Logger::setBinaryMode(true);
+    bench(name, "binary", f);
+    Logger::setBinaryMode(false);
+  }
+
+  template<typename F>
+  void benchAsync(const char* name, F f)
+  {
+    char basename[64];
+    for(int mode = 0; mode < 3; ++mode) {
+      snprintf(basename, sizeof basename, "binarylog_bench.%d", mode);
+      Miren::log::AsyncLogging log(basename, 500 * 1000 * 1000);
+      log.setFullPolicy(Miren::log::AsyncLogging::kBlock);
+      log.setRingSize(16 * 1024 * 1024);
+      log.setBinaryOutput(mode == 2);
+      log.start();
+      g_asyncLog = &log;
+      Logger::setOutput(asyncOutput);
+      Logger::setBinaryMode(mode != 0);
+      const char* modes[] = { "async text", "async decode", "async binary" };
+      bench(name, modes[mode], f);
+      Logger::setBinaryMode(false);
+      log.stop();
+    }
+    Logger::setOutput(nopOutput);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  Logger::setOutput(nopOutput);
+  benchBoth("strings", logStrings);
+  benchBoth("ints", logIntegers);
+  benchBoth("doubles", logDoubles);
+
+  // 写到当前目录，带参数时跳过
+  if(argc == 1) {
+    benchAsync("strings", logStrings);
+    benchAsync("doubles", logDoubles);
+  }
+}
@@ -0,0 +1,223 @@
+#include "base/log/AsyncLogging.h"
+#include "base/log/BinaryLog.h"
+#include "base/log/Logging.h"
+
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+using Miren::log::Logger;
+using Miren::log::LogDecoder;
+
+namespace
+{
+  std::vector<std::string> g_records;
+
+  void captureOutput(const char* msg, int len)
+  {
+    g_records.emplace_back(msg, len);
+  }
+
+  // 同一个调用点在文本模式和二进制模式下各输出一次
+  void logEverything(int i)
+  {
+    std::string str("std::string");
+    const void* ptr = &str;
+    LOG_INFO << "int " << i << " uint " << 42u << " long " << -1234567890123L
+             << " ull " << 18446744073709551615ULL << " short " << static_cast<short>(-7)
+             << " double " << 3.14159 << " float " << 0.5f << " bool " << true
+             << " char " << 'x' << " ptr " << ptr << " null " << static_cast<const char*>(nullptr)
+             << ' ' << str << ' ' << Miren::base::StringPiece("piece", 3)
+             << ' ' << Miren::log::Fmt("%06d", i);
+  }
+
+  void logSyserr()
+  {
+    errno = ENOENT;
+    LOG_SYSERR << "open failed";
+  }
+
+  void logDebug()
+  {
+    LOG_DEBUG << "debug " << 1;
+  }
+
+  // 去掉时间，它在两次调用之间会变化
+  std::string stripTime(const std::string& line)
+  {
+    return line.substr(line.find(' ', 9) + 1);
+  }
+
+  std::string decode(const std::string& record)
+  {
+    LogDecoder decoder(true);
+    std::string text;
+    EXPECT_TRUE(decoder.decode(record.data(), record.size(), &text));
+    return text;
+  }
+
+  // 先文本后二进制各调用一次f，返回两次的输出
+  template<typename F>
+  std::pair<std::string, std::string> textAndBinary(F f)
+  {
+    g_records.clear();
+    Logger::setOutput(captureOutput);
+    Logger::setBinaryMode(false);
+    f();
+    Logger::setBinaryMode(true);
+    f();
+    Logger::setBinaryMode(false);
+    EXPECT_EQ(g_records.size(), 2u);
+    return std::make_pair(g_records[0], g_records[1]);
+  }
+}
+
+TEST(binaryLog, decodeMatchesText)
+{
+  auto records = textAndBinary([] { logEverything(12345); });
+  EXPECT_FALSE(Miren::log::binary::isBinary(records.first.data(), records.first.size()));
+  ASSERT_TRUE(Miren::log::binary::isBinary(records.second.data(), records.second.size()));
+  EXPECT_EQ(LogDecoder::recordLength(records.second.data(), records.second.size()), records.second.size());
+  EXPECT_EQ(stripTime(decode(records.second)), stripTime(records.first));
+}
+
+TEST(binaryLog, errnoAndFunction)
+{
+  auto records = textAndBinary(logSyserr);
+  EXPECT_NE(records.first.find("(errno=2)"), std::string::npos);
+  EXPECT_EQ(stripTime(decode(records.second)), stripTime(records.first));
+
+  Logger::LogLevel level = Logger::logLevel();
+  Logger::setLogLevel(Logger::DEBUG);
+  records = textAndBinary(logDebug);
+  Logger::setLogLevel(level);
+  EXPECT_NE(records.first.find("logDebug "), std::string::npos);
+  EXPECT_EQ(stripTime(decode(records.second)), stripTime(records.first));
+}
+
+TEST(binaryLog, longStringIsTruncated)
+{
+  std::string longStr(5000, 'X');
+  g_records.clear();
+  Logger::setOutput(captureOutput);
+  Logger::setBinaryMode(true);
+  LOG_INFO << longStr << 1 << longStr;
+  Logger::setBinaryMode(false);
+  ASSERT_EQ(g_records.size(), 1u);
+  EXPECT_LE(g_records[0].size(), static_cast<size_t>(Miren::log::detail::kSmallBuffer));
+  std::string text = decode(g_records[0]);
+  EXPECT_GT(text.size(), 3000u);
+  EXPECT_EQ(text.back(), '\n');
+}
+
+TEST(binaryLog, unknownSite)
+{
+  g_records.clear();
+  Logger::setOutput(captureOutput);
+  Logger::setBinaryMode(true);
+  LOG_WARN << "offline";
+  Logger::setBinaryMode(false);
+  ASSERT_EQ(g_records.size(), 1u);
+
+  // 离线解码需要调用点定义
+  LogDecoder offline(false);
+  std::string text;
+  EXPECT_FALSE(offline.decode(g_records[0].data(), g_records[0].size(), &text));
+
+  uint32_t siteId;
+  memcpy(&siteId, g_records[0].data() + offsetof(Miren::log::binary::RecordHeader, siteId), sizeof siteId);
+  std::string def;
+  Miren::log::binary::appendSiteDef(siteId, &def);
+  EXPECT_EQ(LogDecoder::recordLength(def.data(), def.size()), def.size());
+  text.clear();
+  EXPECT_TRUE(offline.decode(def.data(), def.size(), &text));
+  EXPECT_TRUE(text.empty());
+  EXPECT_TRUE(offline.decode(g_records[0].data(), g_records[0].size(), &text));
+  EXPECT_NE(text.find("WARN  offline - BinaryLog_test.cpp:"), std::string::npos);
+}
+
+namespace
+{
+  Miren::log::AsyncLogging* g_asyncLog = nullptr;
+
+  void asyncOutput(const char* msg, int len)
+  {
+    g_asyncLog->append(msg, len);
+  }
+
+  std::string readLogFile(const std::string& prefix)
+  {
+    std::string content;
+    DIR* dir = ::opendir(".");
+    while(struct dirent* entry = ::readdir(dir)) {
+      std::string name(entry->d_name);
+      if(name.compare(0, prefix.size(), prefix) == 0) {
+        FILE* fp = ::fopen(name.c_str(), "rb");
+        char buf[4096];
+        size_t n;
+        while((n = ::fread(buf, 1, sizeof buf, fp)) > 0) {
+          content.append(buf, n);
+        }
+        ::fclose(fp);
+        ::unlink(name.c_str());
+      }
+    }
+    ::closedir(dir);
+    return content;
+  }
+}
+
+// AsyncLogging写出二进制文件，离线解码的结果和后端格式化成文本的结果相同
+TEST(binaryLog, asyncBinaryOutput)
+{
+  const std::string textName = "binarylog_test_text." + std::to_string(::getpid());
+  const std::string binaryName = "binarylog_test_binary." + std::to_string(::getpid());
+  for(int binaryOutput = 0; binaryOutput < 2; ++binaryOutput) {
+    Miren::log::AsyncLogging log(binaryOutput ? binaryName : textName, 100 * 1000 * 1000);
+    log.setBinaryOutput(binaryOutput);
+    log.start();
+    g_asyncLog = &log;
+    Logger::setOutput(asyncOutput);
+    Logger::setBinaryMode(true);
+    for(int i = 0; i < 100; ++i) {
+      logEverything(i);
+    }
+    Logger::setBinaryMode(false);
+    log.stop();
+  }
+  Logger::setOutput(captureOutput);
+
+  std::string text = readLogFile(textName);
+  std::string binary = readLogFile(binaryName);
+  ASSERT_FALSE(text.empty());
+  ASSERT_FALSE(binary.empty());
+
+  LogDecoder offline(false);
+  std::string decoded;
+  for(size_t pos = 0; pos < binary.size();) {
+    size_t n = LogDecoder::recordLength(binary.data() + pos, binary.size() - pos);
+    ASSERT_GT(n, 0u);
+    EXPECT_TRUE(offline.decode(binary.data() + pos, n, &decoded));
+    pos += n;
+  }
+  // 两次的时间不同，逐行比较时间之后的部分
+  size_t textPos = 0, decodedPos = 0;
+  int lines = 0;
+  while(textPos < text.size() && decodedPos < decoded.size()) {
+    size_t textEnd = text.find('\n', textPos);
+    size_t decodedEnd = decoded.find('\n', decodedPos);
+    EXPECT_EQ(stripTime(decoded.substr(decodedPos, decodedEnd - decodedPos)),
+              stripTime(text.substr(textPos, textEnd - textPos)));
+    textPos = textEnd + 1;
+    decodedPos = decodedEnd + 1;
+    ++lines;
+  }
+  EXPECT_EQ(lines, 100);
+  EXPECT_EQ(textPos, text.size());
+  EXPECT_EQ(decodedPos, decoded.size());
+}
@@ -0,0 +1,160 @@
+// 持续写日志的同时滚动、压缩和清理旧文件，比较开启LogArchiver前后写日志的吞吐和延迟
+// 用法: LogArchiver_bench [seconds] [rollSizeMB]
+
+#include "base/log/AsyncLogging.h"
+#include "base/log/LogArchiver.h"
+#include "base/log/Logging.h"
+#include "base/thread/Thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+using Miren::log::AsyncLogging;
+using Miren::log::LogArchiver;
+
+namespace
+{
+  AsyncLogging* g_asyncLog = nullptr;
+
+  void asyncOutput(const char* msg, int len)
+  {
+    g_asyncLog->append(msg, len);
+  }
+
+  int64_t nowNanos()
+  {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+  // 统计并删除basename开头的文件
+  void collectFiles(const std::string& basename, int* count, int64_t* bytes, bool remove)
+  {
+    *count = 0;
+    *bytes = 0;
+    DIR* dir = ::opendir(".");
+    while(struct dirent* entry = ::readdir(dir)) {
+      std::string name(entry->d_name);
+      if(name.compare(0, basename.size() + 1, basename + ".") == 0) {
+        struct stat st;
+        if(::stat(name.c_str(), &st) == 0) {
+          ++*count;
+          *bytes += st.st_size;
+        }
+        if(remove) {
+          ::unlink(name.c_str());
+        }
+      }
+    }
+    ::closedir(dir);
+  }
+
+  void bench(const char* name, int seconds, off_t rollSize, std::shared_ptr<LogArchiver> archiver)
+  {
+    const int kThreads = 2;
+    const std::string basename = std::string("archiver_bench_") + name;
+    AsyncLogging log(basename, rollSize);
+    log.setFullPolicy(AsyncLogging::kBlock);
+    log.setArchiver(archiver);
+    log.start();
+    g_asyncLog = &log;
+    Miren::log::Logger::setOutput(asyncOutput);
+
+    std::atomic<bool> stop(false);
+    std::vector<std::vector<int64_t>> latencies(kThreads);
+    std::vector<int64_t> lines(kThreads);
+    std::vector<std::unique_ptr<Miren::base::Thread>> threads;
+    for(int t = 0; t < kThreads; ++t) {
+      threads.emplace_back(new Miren::base::Thread([&, t] {
+        std::string payload(80, 'x');
+        int64_t n = 0;
+        while(!stop.load(std::memory_order_relaxed)) {
+          int64_t start = nowNanos();
+          LOG_INFO << "request " << n << " status 200 bytes " << n * 17 % 65536 << ' ' << payload;
+          // 只采样一部分，避免统计本身影响结果
+          if(n % 16 == 0) {
+            latencies[t].push_back(nowNanos() - start);
+          }
+          ++n;
+        }
+        lines[t] = n;
+      }));
+      threads.back()->start();
+    }
+    ::sleep(static_cast<unsigned>(seconds));
+    stop = true;
+    for(auto& thr : threads) {
+      thr->join();
+    }
+    log.stop();
+
+    int64_t drainStart = nowNanos();
+    if(archiver) {
+      archiver->waitIdle();
+    }
+    double drainSeconds = static_cast<double>(nowNanos() - drainStart) / 1e9;
+
+    std::vector<int64_t> all;
+    int64_t total = 0;
+    for(int t = 0; t < kThreads; ++t) {
+      all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+      total += lines[t];
+    }
+    std::sort(all.begin(), all.end());
+    int files;
+    int64_t bytes;
+    collectFiles(basename, &files, &bytes, true);
+
+    printf("%-10s %10.0f lines/s  p50 %5ld ns  p99 %6ld ns  p99.9 %7ld ns  on disk: %3d files %8.1f MiB",
+           name, static_cast<double>(total) / seconds,
+           all[all.size() / 2], all[all.size() * 99 / 100], all[all.size() * 999 / 1000],
+           files, static_cast<double>(bytes) / (1024 * 1024));
+    if(archiver) {
+      LogArchiver::Stats stats = archiver->stats();
+      printf("  compressed %ld files %.1f -> %.1f MiB in %.2fs, deleted %ld, drain %.2fs",
+             stats.filesCompressed, static_cast<double>(stats.bytesIn) / (1024 * 1024),
+             static_cast<double>(stats.bytesOut) / (1024 * 1024),
+             static_cast<double>(stats.busyMicroSeconds) / 1e6, stats.filesDeleted, drainSeconds);
+    }
+    printf("\n");
+  }
+
+  std::shared_ptr<LogArchiver> makeArchiver(LogArchiver::Compression compression, int maxFiles, int64_t bytesPerSecond)
+  {
+    LogArchiver::Options options;
+    options.compression = compression;
+    options.maxFiles = maxFiles;
+    options.bytesPerSecond = bytesPerSecond;
+    auto archiver = std::make_shared<LogArchiver>(options);
+    archiver->start();
+    return archiver;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int seconds = argc > 1 ? atoi(argv[1]) : 5;
+  off_t rollSize = (argc > 2 ? atoi(argv[2]) : 16) * 1024 * 1024;
+  printf("pid = %d, %d seconds per run, roll every %ld MiB, gzip %s, zstd %s\n",
+         getpid(), seconds, rollSize / (1024 * 1024),
+         LogArchiver::supports(LogArchiver::kGzip) ? "yes" : "no",
+         LogArchiver::supports(LogArchiver::kZstd) ? "yes" : "no");
+
+  bench("none", seconds, rollSize, nullptr);
+  bench("retain", seconds, rollSize, makeArchiver(LogArchiver::kNone, 3, 0));
+  bench("gzip", seconds, rollSize, makeArchiver(LogArchiver::kGzip, 0, 0));
+  bench("gzip-64M", seconds, rollSize, makeArchiver(LogArchiver::kGzip, 0, 64 * 1024 * 1024));
+  if(LogArchiver::supports(LogArchiver::kZstd)) {
+    bench("zstd", seconds, rollSize, makeArchiver(LogArchiver::kZstd, 0, 0));
+  }
+}
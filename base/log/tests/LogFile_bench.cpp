@@ -0,0 +1,102 @@
+// 同样的日志分别用AppendFile(fwrite)和MmapAppendFile写入，比较吞吐和写文件线程的CPU时间
+// 用法: LogFile_bench [totalMB] [rollSizeMB]
+
+#include "base/log/LogFile.h"
+#include "base/Clock.h"
+
+#include <string>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using Miren::base::Clock;
+using Miren::base::FileUtil::MmapAppendFile;
+using Miren::log::LogFile;
+
+namespace
+{
+  // 本线程的用户态和内核态CPU时间(秒)
+  void threadCpu(double* user, double* sys)
+  {
+    struct rusage usage;
+    ::getrusage(RUSAGE_THREAD, &usage);
+    *user = static_cast<double>(usage.ru_utime.tv_sec) + static_cast<double>(usage.ru_utime.tv_usec) / 1e6;
+    *sys = static_cast<double>(usage.ru_stime.tv_sec) + static_cast<double>(usage.ru_stime.tv_usec) / 1e6;
+  }
+
+  // 统计并删除basename开头的文件
+  int64_t removeFiles(const std::string& basename)
+  {
+    int64_t bytes = 0;
+    DIR* dir = ::opendir(".");
+    while(struct dirent* entry = ::readdir(dir)) {
+      std::string name(entry->d_name);
+      if(name.compare(0, basename.size() + 1, basename + ".") == 0) {
+        struct stat st;
+        if(::stat(name.c_str(), &st) == 0) {
+          bytes += st.st_size;
+        }
+        ::unlink(name.c_str());
+      }
+    }
+    ::closedir(dir);
+    return bytes;
+  }
+
+  void bench(const char* name, int64_t totalBytes, off_t rollSize, const MmapAppendFile::Options* options)
+  {
+    const std::string basename = std::string("logfile_bench_") + name;
+    // 长短不一的日志行，和真实日志接近
+    std::string lines[4];
+    for(int i = 0; i < 4; ++i) {
+      lines[i] = "20240612 08:30:00.123456Z 12345 INFO  request handled "
+                 + std::string(static_cast<size_t>(20 + 60 * i), 'x') + " - HttpServer.cpp:100\n";
+    }
+
+    int64_t written = 0;
+    int64_t start = Clock::monotonicNanos();
+    double userStart, sysStart;
+    threadCpu(&userStart, &sysStart);
+    int rolls = 0;
+    {
+      LogFile file(basename, rollSize, false, 3, 1024);
+      if(options) {
+        file.setMmap(*options);
+      }
+      for(int i = 0; written < totalBytes; ++i) {
+        const std::string& line = lines[i & 3];
+        file.append(line.data(), static_cast<int>(line.size()));
+        written += static_cast<int64_t>(line.size());
+        if((i & 1023) == 0) {
+          file.flush();
+        }
+      }
+      file.flush();
+      rolls = file.rollCount();
+    }
+    double seconds = static_cast<double>(Clock::monotonicNanos() - start) / 1e9;
+    double user, sys;
+    threadCpu(&user, &sys);
+    int64_t onDisk = removeFiles(basename);
+    printf("%-16s %8.1f MB/s  user %6.3f s  sys %6.3f s  files %d  %s\n", name,
+           static_cast<double>(written) / seconds / 1024 / 1024, user - userStart, sys - sysStart, rolls,
+           onDisk == written ? "size ok" : "SIZE MISMATCH");
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int64_t totalBytes = (argc > 1 ? atoi(argv[1]) : 1024) * int64_t(1024 * 1024);
+  off_t rollSize = (argc > 2 ? atoi(argv[2]) : 256) * off_t(1024 * 1024);
+
+  bench("fwrite", totalBytes, rollSize, nullptr);
+
+  MmapAppendFile::Options options;
+  bench("mmap", totalBytes, rollSize, &options);
+
+  options.syncInterval = 1000;
+  bench("mmap+sync1s", totalBytes, rollSize, &options);
+}
@@ -1,6 +1,12 @@
 #include "base/log/LogStream.h"
+#include "base/FastFormat.h"
+#include "base/StringUtil.h"
 #include "base/Timestamp.h"
 
+#include <algorithm>
+#include <random>
+#include <vector>
+
 #include <sstream>
 #include <stdio.h>
 #define __STDC_FORMAT_MACROS
@@ -55,6 +61,108 @@ void benchLogStream()
   printf("benchLogStream %f\n", timeDifference(end, start));
 }
 
+// 原来LogStream的整数格式化：逐位取余再reverse
+template<typename T>
+size_t convertByDigit(char buf[], T value)
+{
+  static const char digits[] = "9876543210123456789";
+  static const char* zero = digits + 9;
+  T i = value;
+  char* p = buf;
+  do
+  {
+    int lsd = static_cast<int>(i % 10);
+    i /= 10;
+    *p++ = zero[lsd];
+  } while (i != 0);
+  if (value < 0)
+  {
+    *p++ = '-';
+  }
+  std::reverse(buf, p);
+  return p - buf;
+}
+
+volatile size_t g_sink;
+
+template<typename T, typename F>
+void benchFormat(const char* name, const std::vector<T>& values, F f)
+{
+  char buf[64];
+  size_t sum = 0;
+  Timestamp start(Timestamp::now());
+  for (size_t i = 0; i < N; ++i)
+  {
+    sum += f(buf, values[i % values.size()]);
+  }
+  Timestamp end(Timestamp::now());
+  g_sink = sum;
+  printf("  %-28s %6.1f ns/value\n", name, timeDifference(end, start) * 1e9 / N);
+}
+
+// 打点日志中常见的数字：各种位数的整数，带小数的延迟和比例
+void benchFormatting()
+{
+  std::mt19937_64 rng(1);
+  std::vector<int64_t> integers(4096);
+  for (auto& v : integers)
+  {
+    v = static_cast<int64_t>(rng() >> (rng() % 64));
+  }
+  std::vector<double> doubles(4096);
+  for (auto& v : doubles)
+  {
+    v = static_cast<double>(rng() % 1000000) / 1000.0;
+  }
+
+  puts("format int64_t");
+  benchFormat("snprintf %lld", integers, [](char* buf, int64_t v) {
+    return static_cast<size_t>(snprintf(buf, 64, "%lld", (long long)v));
+  });
+  benchFormat("digit by digit (old)", integers, [](char* buf, int64_t v) { return convertByDigit(buf, v); });
+  benchFormat("FastFormat::formatInteger", integers, [](char* buf, int64_t v) {
+    return FastFormat::formatInteger(buf, v);
+  });
+
+  puts("format double");
+  benchFormat("snprintf %.12g (old)", doubles, [](char* buf, double v) {
+    return static_cast<size_t>(snprintf(buf, 64, "%.12g", v));
+  });
+  benchFormat("FastFormat::formatDouble", doubles, [](char* buf, double v) {
+    return FastFormat::formatDouble(buf, v);
+  });
+
+  puts("metrics line");
+  {
+    LogStream os;
+    size_t sum = 0;
+    Timestamp start(Timestamp::now());
+    for (size_t i = 0; i < N; ++i)
+    {
+      os << "qps=" << integers[i % 4096] << " p50=" << doubles[i % 4096] << " p99=" << doubles[(i + 1) % 4096]
+         << " bytes=" << integers[(i + 2) % 4096] << " ok=" << static_cast<int>(i);
+      sum += os.buffer().length();
+      os.resetBuffer();
+    }
+    Timestamp end(Timestamp::now());
+    g_sink = sum;
+    printf("  %-28s %6.1f ns/line\n", "LogStream", timeDifference(end, start) * 1e9 / N);
+  }
+
+  puts("StringUtil::Format");
+  {
+    size_t sum = 0;
+    Timestamp start(Timestamp::now());
+    for (size_t i = 0; i < N; ++i)
+    {
+      sum += StringUtil::Format("Content-Length: %zu\r\n", static_cast<size_t>(integers[i % 4096] & 0xFFFFFF)).size();
+    }
+    Timestamp end(Timestamp::now());
+    g_sink = sum;
+    printf("  %-28s %6.1f ns/call\n", "Content-Length header", timeDifference(end, start) * 1e9 / N);
+  }
+}
+
 int main()
 {
   benchPrintf<int>("%d");
@@ -79,4 +187,6 @@ int main()
   benchStringStream<void*>();
   benchLogStream<void*>();
 
+  benchFormatting();
+
 }
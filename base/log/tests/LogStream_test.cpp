@@ -1,7 +1,13 @@
 #include "base/log/LogStream.h"
+#include "base/FastFormat.h"
+#include "base/StringUtil.h"
 
 #include <limits>
+#include <random>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <gtest/gtest.h>
 
@@ -146,8 +152,9 @@ TEST(logStream, testLogStreamFloats)
   EXPECT_EQ(buf.toString(), std::string("0.15"));
   os.resetBuffer();
 
+  // 最短的能精确还原的表示，不再截断到12位有效数字
   os << a+b;
-  EXPECT_EQ(buf.toString(), std::string("0.15"));
+  EXPECT_EQ(buf.toString(), std::string("0.15000000000000002"));
   os.resetBuffer();
 
   EXPECT_TRUE(a+b != c);
@@ -229,3 +236,66 @@ TEST(logStream, testLogStreamLong)
   EXPECT_EQ(buf.length(), 3999);
   EXPECT_EQ(buf.avail(), 1);
 }
+
+TEST(logStream, testLogStreamDoubleRoundTrip)
+{
+  Miren::log::LogStream os;
+  const Miren::log::LogStream::Buffer& buf = os.buffer();
+
+  os << 1e100 << ' ' << -2.5e-300 << ' ' << 123456789012.0 << ' ' << 1e16;
+  EXPECT_EQ(buf.toString(), std::string("1e+100 -2.5e-300 123456789012 1e+16"));
+  os.resetBuffer();
+
+  std::mt19937_64 rng(1);
+  for (int i = 0; i < 10000; ++i)
+  {
+    uint64_t bits = rng();
+    double v;
+    memcpy(&v, &bits, sizeof v);
+    if (v != v)
+    {
+      continue;
+    }
+    os << v;
+    EXPECT_EQ(strtod(buf.toString().c_str(), NULL), v) << buf.toString();
+    os.resetBuffer();
+  }
+}
+
+TEST(fastFormat, testIntegersMatchPrintf)
+{
+  std::mt19937_64 rng(2);
+  char buf[Miren::base::FastFormat::kMaxIntegerLength];
+  char expected[32];
+  for (int i = 0; i < 10000; ++i)
+  {
+    // 各种位数都要覆盖到
+    int64_t v = static_cast<int64_t>(rng() >> (rng() % 64));
+    if (i % 2)
+    {
+      v = -v;
+    }
+    size_t n = Miren::base::FastFormat::formatInteger(buf, v);
+    snprintf(expected, sizeof expected, "%lld", static_cast<long long>(v));
+    EXPECT_EQ(std::string(buf, n), std::string(expected));
+
+    uint64_t u = rng() >> (rng() % 64);
+    n = Miren::base::FastFormat::formatUnsigned(buf, u);
+    snprintf(expected, sizeof expected, "%llu", static_cast<unsigned long long>(u));
+    EXPECT_EQ(std::string(buf, n), std::string(expected));
+  }
+}
+
+TEST(fastFormat, testStringUtilFormat)
+{
+  using Miren::base::StringUtil;
+  EXPECT_EQ(StringUtil::Format("Content-Length: %zu\r\n", static_cast<size_t>(1234)), "Content-Length: 1234\r\n");
+  EXPECT_EQ(StringUtil::Format("%d %i %u %ld %lld %hd %hhu %%", -1, 2, 3u, -4L, -5LL, static_cast<short>(-6), 300),
+            "-1 2 3 -4 -5 -6 44 %");
+  EXPECT_EQ(StringUtil::Format("%s=%c", "key", 'v'), "key=v");
+  EXPECT_EQ(StringUtil::Format("no conversion"), "no conversion");
+  // 不支持的格式交给vsnprintf
+  EXPECT_EQ(StringUtil::Format("%5d|%.2f|%x", 42, 1.5, 255), "   42|1.50|ff");
+  std::string longValue(1000, 'x');
+  EXPECT_EQ(StringUtil::Format("%-3s%s", "a", longValue.c_str()), "a  " + longValue);
+}
@@ -1,10 +1,16 @@
+#include "base/log/AsyncLogging.h"
 #include "base/log/Logging.h"
 #include "base/log/LogFile.h"
+#include "base/thread/CountDownLatch.h"
+#include "base/thread/Thread.h"
 #include "base/thread/ThreadPool.h"
 #include "base/TimeZone.h"
 
+#include <algorithm>
 #include <stdio.h>
 #include <memory>
+#include <vector>
+#include <time.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 
@@ -48,6 +54,71 @@ void bench(const char* type)
          type, seconds, g_total, n / seconds, g_total / seconds / (1024 * 1024));
 }
 
+Miren::log::AsyncLogging* g_asyncLog = NULL;
+
+void asyncOutput(const char* msg, int len)
+{
+  g_asyncLog->append(msg, len);
+}
+
+int64_t nowNanos()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// numThreads个线程同时通过AsyncLogging写日志，统计总吞吐和每次LOG_INFO的延迟
+void benchAsync(int numThreads, Miren::log::AsyncLogging::FullPolicy policy)
+{
+  const int kLinesPerThread = 100 * 1000;
+  Miren::log::AsyncLogging log("test_log_async", 500*1000*1000);
+  log.setFullPolicy(policy);
+  log.start();
+  g_asyncLog = &log;
+  Miren::log::Logger::setOutput(asyncOutput);
+
+  Miren::base::CountDownLatch latch(1);
+  std::vector<std::vector<int>> latencies(numThreads);
+  std::vector<std::unique_ptr<Miren::base::Thread>> threads;
+  for (int t = 0; t < numThreads; ++t)
+  {
+    threads.emplace_back(new Miren::base::Thread([&latch, &latencies, t] {
+      std::vector<int>& lat = latencies[t];
+      lat.reserve(kLinesPerThread);
+      latch.wait();
+      for (int i = 0; i < kLinesPerThread; ++i)
+      {
+        int64_t start = nowNanos();
+        LOG_INFO << "Hello 0123456789" << " abcdefghijklmnopqrstuvwxyz " << i;
+        lat.push_back(static_cast<int>(nowNanos() - start));
+      }
+    }, "logger"));
+  }
+  for (auto& thr : threads)
+    thr->start();
+
+  int64_t start = nowNanos();
+  latch.countDown();
+  for (auto& thr : threads)
+    thr->join();
+  double seconds = static_cast<double>(nowNanos() - start) / 1e9;
+  log.stop();
+  Miren::log::Logger::setOutput(dummyOutput);
+  g_asyncLog = NULL;
+
+  std::vector<int> all;
+  for (auto& lat : latencies)
+    all.insert(all.end(), lat.begin(), lat.end());
+  std::sort(all.begin(), all.end());
+  int p50 = all[all.size() / 2];
+  int p99 = all[all.size() * 99 / 100];
+  printf("%8s %3d threads: %10.2f lines/s, p50 %6d ns, p99 %8d ns, dropped %lu\n",
+         policy == Miren::log::AsyncLogging::kDrop ? "drop" : "block", numThreads,
+         numThreads * kLinesPerThread / seconds, p50, p99,
+         static_cast<unsigned long>(log.dropped()));
+}
+
 void logInThread()
 {
   LOG_INFO << "logInThread";
@@ -121,4 +192,14 @@ int main()
   g_file = NULL;
   }
   bench("timezone nop");
+
+  Miren::log::Logger::setTimeZone(Miren::base::TimeZone(8*3600, "CST"));
+  for (int threads = 1; threads <= 16; threads *= 2)
+  {
+    benchAsync(threads, Miren::log::AsyncLogging::kDrop);
+  }
+  for (int threads = 1; threads <= 16; threads *= 2)
+  {
+    benchAsync(threads, Miren::log::AsyncLogging::kBlock);
+  }
 }
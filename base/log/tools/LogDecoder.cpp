@@ -0,0 +1,118 @@
+// 把AsyncLogging::setBinaryOutput写出的日志文件转换成文本，输出到stdout
+// 文件中可以混有文本行，原样输出
+// 用法: log_decoder [-z zonefile] [file...]，没有file时读stdin
+
+#include "base/log/BinaryLog.h"
+#include "base/TimeZone.h"
+
+#include <string>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace
+{
+    bool readAll(FILE* fp, std::string* content)
+    {
+        char buf[64 * 1024];
+        size_t n;
+        while((n = fread(buf, 1, sizeof buf, fp)) > 0) {
+            content->append(buf, n);
+        }
+        return !ferror(fp);
+    }
+
+    // 调用点定义可能在记录之后才出现(比如截断过的文件)，先扫描一遍所有定义
+    int decode(const std::string& content, const Miren::base::TimeZone& tz)
+    {
+        using Miren::log::LogDecoder;
+        LogDecoder decoder(false);
+        decoder.setTimeZone(tz);
+
+        std::string unused;
+        const char* data = content.data();
+        size_t len = content.size();
+        for(size_t pos = 0; pos < len;) {
+            size_t n = LogDecoder::recordLength(data + pos, len - pos);
+            if(n == 0) {
+                break;
+            }
+            if(Miren::log::binary::isBinary(data + pos, n) && data[pos + 1] == Miren::log::binary::kSiteDef) {
+                decoder.decode(data + pos, n, &unused);
+            }
+            pos += n;
+        }
+
+        int errors = 0;
+        std::string out;
+        size_t pos = 0;
+        while(pos < len) {
+            size_t n = LogDecoder::recordLength(data + pos, len - pos);
+            if(n == 0) {
+                if(Miren::log::binary::isBinary(data + pos, len - pos)) {
+                    fprintf(stderr, "truncated record at offset %zu\n", pos);
+                    ++errors;
+                }
+                else {
+                    out.append(data + pos, len - pos);  //最后一行没有换行
+                }
+                break;
+            }
+            if(!decoder.decode(data + pos, n, &out)) {
+                ++errors;
+            }
+            pos += n;
+            if(out.size() > 64 * 1024) {
+                fwrite(out.data(), 1, out.size(), stdout);
+                out.clear();
+            }
+        }
+        fwrite(out.data(), 1, out.size(), stdout);
+        return errors;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Miren::base::TimeZone tz;
+    int opt;
+    while((opt = getopt(argc, argv, "z:")) != -1) {
+        if(opt == 'z') {
+            tz = Miren::base::TimeZone(optarg);
+            if(!tz.valid()) {
+                fprintf(stderr, "invalid zone file %s\n", optarg);
+                return 1;
+            }
+        }
+        else {
+            fprintf(stderr, "Usage: %s [-z zonefile] [file...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int errors = 0;
+    if(optind == argc) {
+        std::string content;
+        readAll(stdin, &content);
+        errors += decode(content, tz);
+    }
+    for(int i = optind; i < argc; ++i) {
+        FILE* fp = fopen(argv[i], "rb");
+        if(!fp) {
+            fprintf(stderr, "cannot open %s: %s\n", argv[i], strerror(errno));
+            ++errors;
+            continue;
+        }
+        std::string content;
+        if(!readAll(fp, &content)) {
+            fprintf(stderr, "read %s failed\n", argv[i]);
+            ++errors;
+        }
+        fclose(fp);
+        errors += decode(content, tz);
+    }
+    if(errors > 0) {
+        fprintf(stderr, "%d records could not be decoded\n", errors);
+    }
+    return errors > 0 ? 2 : 0;
+}
@@ -0,0 +1,54 @@
+#include "base/Arena.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+
+using Miren::base::Arena;
+
+// 分配按要求对齐，同一个块内连续分配
+TEST(ArenaTest, alignsAllocations)
+{
+  Arena arena(4096);
+  char* a = static_cast<char*>(arena.alloc(1, 1));
+  void* b = arena.alloc(8, 8);
+  void* c = arena.alloc(3, 64);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(b) % 8, 0u);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(c) % 64, 0u);
+  EXPECT_LE(static_cast<char*>(b) - a, 8);
+  EXPECT_EQ(arena.upstreamAllocations(), 1);
+}
+
+// reset后重复使用已有的块，不再向系统申请；大块每轮归还
+TEST(ArenaTest, resetReusesChunks)
+{
+  Arena arena(4096);
+  for(int round = 0; round < 10; ++round) {
+    for(int i = 0; i < 100; ++i) {
+      arena.alloc(100);
+    }
+    arena.alloc(10000);
+    EXPECT_GE(arena.bytesUsed(), 100u * 100 + 10000);
+    arena.reset();
+    EXPECT_EQ(arena.bytesUsed(), 0u);
+  }
+  // 100 * 100字节需要3个4K的块，加上每轮一次的大块
+  EXPECT_EQ(arena.upstreamAllocations(), 3 + 10);
+  EXPECT_EQ(arena.bytesReserved(), 3u * 4096);
+}
+
+// 作为memory_resource交给pmr容器
+TEST(ArenaTest, backsPmrContainers)
+{
+  Arena arena;
+  {
+    std::pmr::map<std::pmr::string, std::pmr::string> headers(&arena);
+    headers.emplace("User-Agent", std::string(100, 'x'));
+    headers.emplace("Accept-Language", "zh-CN,zh;q=0.9,en;q=0.8");
+    EXPECT_EQ(headers["User-Agent"].size(), 100u);
+    EXPECT_EQ(headers.get_allocator().resource(), &arena);
+  }
+  EXPECT_GT(arena.bytesUsed(), 100u);
+  EXPECT_EQ(arena.upstreamAllocations(), 1);
+}
@@ -0,0 +1,81 @@
+// Base64编解码的吞吐量(GB/s)，按负载大小比较标量、SSE4.1和AVX2实现
+// 用法: Base64_bench [总字节数，默认256MB]
+
+#include "base/Base64.h"
+#include "base/Clock.h"
+
+#include <random>
+#include <string>
+#include <vector>
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using Miren::base::Clock;
+
+namespace
+{
+  volatile size_t g_sink;
+
+  const char* levelName(base64::simd_level level)
+  {
+    switch(level) {
+      case base64::simd_level::scalar:
+        return "scalar";
+      case base64::simd_level::sse41:
+        return "sse4.1";
+      case base64::simd_level::avx2:
+        return "avx2";
+    }
+    return "?";
+  }
+
+  // 每种大小处理大约totalBytes字节，返回GB/s(按原始数据的字节数计算)
+  template<typename F>
+  double throughput(size_t payload, size_t totalBytes, F f)
+  {
+    size_t iterations = totalBytes / payload + 1;
+    size_t sum = 0;
+    int64_t start = Clock::monotonicNanos();
+    for(size_t i = 0; i < iterations; ++i) {
+      sum += f();
+    }
+    int64_t elapsed = Clock::monotonicNanos() - start;
+    g_sink = sum;
+    return static_cast<double>(payload * iterations) / static_cast<double>(elapsed);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  size_t totalBytes = argc > 1 ? static_cast<size_t>(atoll(argv[1])) : 256 * 1024 * 1024;
+  const size_t sizes[] = { 16, 64, 256, 1024, 4096, 64 * 1024, 1024 * 1024 };
+
+  std::vector<base64::simd_level> levels{ base64::simd_level::scalar };
+  if(base64::supported_simd_level() >= base64::simd_level::sse41) {
+    levels.push_back(base64::simd_level::sse41);
+  }
+  if(base64::supported_simd_level() >= base64::simd_level::avx2) {
+    levels.push_back(base64::simd_level::avx2);
+  }
+
+  std::mt19937 rng(1);
+  printf("%-10s %8s %12s %12s\n", "payload", "kernel", "encode GB/s", "decode GB/s");
+  for(size_t size : sizes) {
+    std::string data(size, '\0');
+    for(auto& c : data) {
+      c = static_cast<char>(rng() & 0xFF);
+    }
+    base64::set_simd_level(base64::simd_level::scalar);
+    const std::string encoded = base64::to_base64(data);
+
+    for(auto level : levels) {
+      base64::set_simd_level(level);
+      assert(base64::to_base64(data) == encoded);
+      assert(base64::from_base64(encoded) == data);
+      double enc = throughput(size, totalBytes, [&] { return base64::to_base64(data).size(); });
+      double dec = throughput(size, totalBytes, [&] { return base64::from_base64(encoded).size(); });
+      printf("%-10zu %8s %12.2f %12.2f\n", size, levelName(level), enc, dec);
+    }
+  }
+}
@@ -3,7 +3,9 @@
 
 #include <array>
 #include <cstdint>
+#include <random>
 #include <string>
+#include <vector>
 
 #include "base/Base64.h"
 
@@ -444,4 +446,72 @@ TEST(Base64RoundTripTests, TypeMixTests) {
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
+namespace {
+
+std::vector<base64::simd_level> supported_levels() {
+  std::vector<base64::simd_level> levels{base64::simd_level::scalar};
+  if (base64::supported_simd_level() >= base64::simd_level::sse41) {
+    levels.push_back(base64::simd_level::sse41);
+  }
+  if (base64::supported_simd_level() >= base64::simd_level::avx2) {
+    levels.push_back(base64::simd_level::avx2);
+  }
+  return levels;
+}
+
+std::string random_bytes(std::mt19937& rng, size_t size) {
+  std::string data(size, '\0');
+  for (auto& c : data) {
+    c = static_cast<char>(rng() & 0xFF);
+  }
+  return data;
+}
+
+struct LevelGuard {
+  base64::simd_level saved = base64::get_simd_level();
+  ~LevelGuard() { base64::set_simd_level(saved); }
+};
+
+}  // namespace
+
+// NOLINTNEXTLINE
+TEST(Base64Simd, KernelsAreBitIdentical) {
+  LevelGuard guard;
+  std::mt19937 rng(42);
+  for (size_t size = 0; size < 300; ++size) {
+    std::string const data = random_bytes(rng, size);
+    base64::set_simd_level(base64::simd_level::scalar);
+    std::string const expected = base64::to_base64(data);
+
+    for (auto level : supported_levels()) {
+      base64::set_simd_level(level);
+      std::string const encoded = base64::to_base64(data);
+      ASSERT_EQ(expected, encoded) << "size " << size;
+      ASSERT_EQ(data, base64::from_base64(encoded)) << "size " << size;
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(Base64Simd, KernelsRejectInvalidCharacters) {
+  LevelGuard guard;
+  std::mt19937 rng(7);
+  std::string const encoded = base64::to_base64(random_bytes(rng, 96));
+  std::string const bad_chars{"=*-_ \n\x80\xff", 8};
+
+  for (auto level : supported_levels()) {
+    base64::set_simd_level(level);
+    for (size_t pos = 0; pos < encoded.size(); ++pos) {
+      for (char c : bad_chars) {
+        std::string corrupted = encoded;
+        corrupted[pos] = c;
+        if (c == '=' && pos >= encoded.size() - 2) {
+          continue;  // valid padding
+        }
+        EXPECT_THROW(base64::from_base64(corrupted), std::runtime_error)
+            << "pos " << pos << " char " << static_cast<int>(c);
+      }
+    }
+  }
+}
@@ -0,0 +1,106 @@
+#include "base/BlockingQueue.h"
+#include "base/BoundedMpmcQueue.h"
+#include "base/thread/CountDownLatch.h"
+#include "base/thread/Thread.h"
+#include "base/Timestamp.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace Miren;
+
+// numThreads个生产者和numThreads个消费者，每个消费者收到-1时退出
+// 返回每秒经过队列的元素个数
+template <typename Queue>
+double bench(Queue& queue, int numThreads, int totalItems)
+{
+  const int itemsPerProducer = totalItems / numThreads;
+  base::CountDownLatch latch(1);
+  std::vector<std::unique_ptr<base::Thread>> producers;
+  std::vector<std::unique_ptr<base::Thread>> consumers;
+  std::vector<int64_t> sums(numThreads, 0);
+
+  for (int i = 0; i < numThreads; ++i)
+  {
+    consumers.emplace_back(new base::Thread([&queue, &sums, i] {
+      int64_t sum = 0;
+      int x;
+      while ((x = queue.take()) >= 0)
+      {
+        sum += x;
+      }
+      sums[i] = sum;
+    }, "consumer"));
+    producers.emplace_back(new base::Thread([&queue, &latch, itemsPerProducer] {
+      latch.wait();
+      for (int j = 0; j < itemsPerProducer; ++j)
+      {
+        queue.put(j);
+      }
+    }, "producer"));
+  }
+  for (auto& thr : consumers)
+    thr->start();
+  for (auto& thr : producers)
+    thr->start();
+
+  base::Timestamp start(base::Timestamp::now());
+  latch.countDown();
+  for (auto& thr : producers)
+    thr->join();
+  for (int i = 0; i < numThreads; ++i)
+    queue.put(-1);
+  for (auto& thr : consumers)
+    thr->join();
+  double seconds = timeDifference(base::Timestamp::now(), start);
+
+  int64_t total = 0;
+  for (int64_t s : sums)
+    total += s;
+  int64_t expected = int64_t(itemsPerProducer) * (itemsPerProducer - 1) / 2 * numThreads;
+  if (total != expected)
+  {
+    printf("checksum mismatch: %ld != %ld\n", total, expected);
+    abort();
+  }
+  return itemsPerProducer * numThreads / seconds;
+}
+
+void testMove()
+{
+  base::BlockingQueue<std::unique_ptr<int>> queue;
+  queue.put(std::unique_ptr<int>(new int(42)));
+  std::unique_ptr<int> x = queue.take();
+  printf("took %d\n", *x);
+  *x = 123;
+  queue.put(std::move(x));
+  std::unique_ptr<int> y = queue.take();
+  printf("took %d\n", *y);
+
+  base::BoundedMpmcQueue<std::unique_ptr<int>> mpmc(4);
+  mpmc.put(std::move(y));
+  std::unique_ptr<int> z = mpmc.take();
+  printf("took %d\n", *z);
+}
+
+// usage: BlockQueue_bench [items]
+int main(int argc, char* argv[])
+{
+  printf("pid=%d, tid=%d\n", ::getpid(), base::CurrentThread::tid());
+  testMove();
+
+  int items = argc > 1 ? atoi(argv[1]) : 1000000;
+  printf("%8s %16s %16s\n", "threads", "BlockingQueue", "BoundedMpmcQueue");
+  for (int threads = 1; threads <= 32; threads *= 2)
+  {
+    base::BlockingQueue<int> locked;
+    base::BoundedMpmcQueue<int> lockFree(65536);
+    double a = bench(locked, threads, items);
+    double b = bench(lockFree, threads, items);
+    printf("%5dx%-2d %13.2fM/s %13.2fM/s\n", threads, threads, a / 1e6, b / 1e6);
+  }
+}
@@ -0,0 +1,146 @@
+#include "base/BoundedBlockingQueue.h"
+#include "base/BoundedMpmcQueue.h"
+#include "base/thread/CountDownLatch.h"
+#include "base/thread/CurrentThread.h"
+#include "base/thread/Thread.h"
+#include "base/Timestamp.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace Miren;
+
+const int kCapacity = 1024;
+const int kBatch = 32;
+
+// 逐个put/take，队列容量kCapacity，生产者经常被阻塞
+template <typename Queue>
+struct Single
+{
+  static void produce(Queue& queue, int n)
+  {
+    for (int j = 0; j < n; ++j)
+      queue.put(j);
+  }
+
+  static int64_t consume(Queue& queue)
+  {
+    int64_t sum = 0;
+    int x;
+    while ((x = queue.take()) >= 0)
+      sum += x;
+    return sum;
+  }
+};
+
+// putMany/takeMany，每次最多kBatch个
+struct Batched
+{
+  typedef base::BoundedMpmcQueue<int> Queue;
+
+  static void produce(Queue& queue, int n)
+  {
+    int items[kBatch];
+    for (int j = 0; j < n; j += kBatch)
+    {
+      int count = std::min(kBatch, n - j);
+      for (int k = 0; k < count; ++k)
+        items[k] = j + k;
+      queue.putMany(items, count);
+    }
+  }
+
+  static int64_t consume(Queue& queue)
+  {
+    int64_t sum = 0;
+    int items[kBatch];
+    int stops = 0;
+    while (stops == 0)
+    {
+      size_t n = queue.takeMany(items, kBatch);
+      for (size_t k = 0; k < n; ++k)
+      {
+        if (items[k] < 0)
+          ++stops;
+        else
+          sum += items[k];
+      }
+    }
+    // 每个消费者只能拿走一个结束标记，多拿的放回去
+    for (int i = 1; i < stops; ++i)
+      queue.put(-1);
+    return sum;
+  }
+};
+
+template <typename Policy, typename Queue>
+double bench(Queue& queue, int numThreads, int totalItems)
+{
+  const int itemsPerProducer = totalItems / numThreads;
+  base::CountDownLatch latch(1);
+  std::vector<std::unique_ptr<base::Thread>> producers;
+  std::vector<std::unique_ptr<base::Thread>> consumers;
+  std::vector<int64_t> sums(numThreads, 0);
+
+  for (int i = 0; i < numThreads; ++i)
+  {
+    consumers.emplace_back(new base::Thread([&queue, &sums, i] {
+      sums[i] = Policy::consume(queue);
+    }, "consumer"));
+    producers.emplace_back(new base::Thread([&queue, &latch, itemsPerProducer] {
+      latch.wait();
+      Policy::produce(queue, itemsPerProducer);
+    }, "producer"));
+  }
+  for (auto& thr : consumers)
+    thr->start();
+  for (auto& thr : producers)
+    thr->start();
+
+  base::Timestamp start(base::Timestamp::now());
+  latch.countDown();
+  for (auto& thr : producers)
+    thr->join();
+  for (int i = 0; i < numThreads; ++i)
+    queue.put(-1);
+  for (auto& thr : consumers)
+    thr->join();
+  double seconds = timeDifference(base::Timestamp::now(), start);
+
+  int64_t total = 0;
+  for (int64_t s : sums)
+    total += s;
+  int64_t expected = int64_t(itemsPerProducer) * (itemsPerProducer - 1) / 2 * numThreads;
+  if (total != expected)
+  {
+    printf("checksum mismatch: %ld != %ld\n", total, expected);
+    abort();
+  }
+  return itemsPerProducer * numThreads / seconds;
+}
+
+// usage: BoundBlockQueue_bench [items]
+int main(int argc, char* argv[])
+{
+  printf("pid=%d, tid=%d\n", ::getpid(), base::CurrentThread::tid());
+
+  int items = argc > 1 ? atoi(argv[1]) : 1000000;
+  printf("capacity = %d, batch = %d\n", kCapacity, kBatch);
+  printf("%8s %16s %16s %16s\n", "threads", "BoundedBlocking", "BoundedMpmc", "Mpmc batched");
+  for (int threads = 1; threads <= 32; threads *= 2)
+  {
+    base::BoundedBlockingQueue<int> locked(kCapacity);
+    base::BoundedMpmcQueue<int> lockFree(kCapacity);
+    base::BoundedMpmcQueue<int> batched(kCapacity);
+    double a = bench<Single<base::BoundedBlockingQueue<int>>>(locked, threads, items);
+    double b = bench<Single<base::BoundedMpmcQueue<int>>>(lockFree, threads, items);
+    double c = bench<Batched>(batched, threads, items);
+    printf("%5dx%-2d %13.2fM/s %13.2fM/s %13.2fM/s\n", threads, threads, a / 1e6, b / 1e6, c / 1e6);
+  }
+}
@@ -0,0 +1,94 @@
+#include "base/FileUtil.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using Miren::base::FileUtil::MmapAppendFile;
+
+namespace
+{
+  class MmapAppendFileTest : public ::testing::Test
+  {
+  protected:
+    void SetUp() override
+    {
+      char name[] = "/tmp/mmap_append_XXXXXX";
+      int fd = ::mkstemp(name);
+      ASSERT_GE(fd, 0);
+      ::close(fd);
+      file_ = name;
+    }
+
+    void TearDown() override
+    {
+      ::unlink(file_.c_str());
+    }
+
+    std::string content()
+    {
+      std::string result;
+      Miren::base::FileUtil::readFile(file_, 64 * 1024 * 1024, &result);
+      return result;
+    }
+
+    std::string file_;
+  };
+}
+
+// 写入跨越多个窗口，关闭后文件大小是实际写入的大小
+TEST_F(MmapAppendFileTest, crossesWindows)
+{
+  MmapAppendFile::Options options;
+  options.windowSize = 4096;
+  options.preallocateSize = 3 * 4096;
+  std::string expected;
+  {
+    MmapAppendFile file(file_, options);
+    for(int i = 0; i < 2000; ++i) {
+      std::string line = std::to_string(i) + std::string(static_cast<size_t>(i % 97), 'a') + "\n";
+      file.append(line.data(), line.size());
+      expected += line;
+    }
+    file.append(expected.data(), 10000);    //比窗口大的一次写入
+    expected.append(expected.data(), 10000);
+    file.flush();
+    EXPECT_EQ(file.writtenBytes(), static_cast<off_t>(expected.size()));
+
+    struct stat st;
+    ASSERT_EQ(::stat(file_.c_str(), &st), 0);
+    EXPECT_GE(st.st_size, static_cast<off_t>(expected.size()));    //预分配
+  }
+  EXPECT_EQ(content(), expected);
+}
+
+// 和AppendFile一样接着已有的内容写
+TEST_F(MmapAppendFileTest, appendsToExistingFile)
+{
+  {
+    MmapAppendFile file(file_);
+    file.append("hello ", 6);
+  }
+  {
+    MmapAppendFile file(file_);
+    file.append("world", 5);
+    EXPECT_EQ(file.writtenBytes(), 5);
+  }
+  EXPECT_EQ(content(), "hello world");
+}
+
+// 没有到同步间隔时flush不会fdatasync，关闭时同步最后一批
+TEST_F(MmapAppendFileTest, batchesSync)
+{
+  MmapAppendFile::Options options;
+  options.syncInterval = 60 * 1000;
+  MmapAppendFile file(file_, options);
+  for(int i = 0; i < 100; ++i) {
+    file.append("line\n", 5);
+    file.flush();
+  }
+  EXPECT_EQ(file.syncCount(), 0);
+}
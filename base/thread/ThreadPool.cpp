@@ -11,7 +11,8 @@ namespace Miren::base
         :mutex_(),
          notEmpty_(mutex_), notFull_(mutex_),
          name_(nameArg), maxQueueSize_(0),
-         running_(false)
+         running_(false),
+         lockFree_(false)
     {
 
     }
@@ -26,6 +27,9 @@ namespace Miren::base
     void ThreadPool::start(int numThreads) {
         assert(threads_.empty());
         running_ = true;
+        if(lockFree_ && numThreads > 0) {
+            lockFreeQueue_.reset(new BoundedMpmcQueue<Task>(maxQueueSize_ > 0 ? maxQueueSize_ : kDefaultLockFreeQueueSize));
+        }
         threads_.reserve(numThreads);
         for(int i=0;i<numThreads;i++){
             char id[32];
@@ -45,12 +49,19 @@ namespace Miren::base
             running_ = false;
             notEmpty_.notifyAll();  //通知所有等待在任务队列上的线程
         }
+        if(lockFreeQueue_) {
+            //唤醒阻塞在take()上的线程，它们拿到空任务后退出；队列满时也不会阻塞在这里
+            lockFreeQueue_->close();
+        }
         for(auto & uptr : threads_) {
             uptr->join();
         }
     }
 
     size_t ThreadPool::queueSize() const {
+        if(lockFreeQueue_) {
+            return lockFreeQueue_->size();
+        }
         MutexLockGuard lock(mutex_);
         return queue_.size();
     }
@@ -59,6 +70,9 @@ namespace Miren::base
         if(threads_.empty()) {  //如果发现线程池中的线程为空，则直接执行任务
             task();
         }
+        else if(lockFreeQueue_) {//无锁队列，满时先自旋再睡眠
+            lockFreeQueue_->put(std::move(task));
+        }
         else {//若池中有线程，则把任务添加到队列，并通知线程
             MutexLockGuard lock(mutex_);
             while (isFull()) {//当任务队列已满
@@ -71,6 +85,9 @@ namespace Miren::base
     }
 
     ThreadPool::Task ThreadPool::take() {
+        if(lockFreeQueue_) {
+            return lockFreeQueue_->take();
+        }
         MutexLockGuard lock(mutex_);    //任务队列需要保护
         while (queue_.empty() && running_) {    //等待队列不为空，即有任务
             notEmpty_.wait();
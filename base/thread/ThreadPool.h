@@ -6,6 +6,7 @@
 #define SERVER_THREADPOOL_H
 
 #include "base/Noncopyable.h"
+#include "base/BoundedMpmcQueue.h"
 #include "base/thread/Mutex.h"
 #include "base/thread/Condition.h"
 #include "base/thread/Thread.h"
@@ -28,6 +29,8 @@ namespace base
 
         void setMaxQueueSize(int maxSize) { maxQueueSize_ = maxSize; }
         void setThreadInitCallback(const Task& task) { threadInitCallback_ = task; }
+        // 使用无锁队列代替deque+mutex，start之前调用；队列大小为maxQueueSize，未设置时为kDefaultLockFreeQueueSize
+        void setLockFreeQueue(bool on) { lockFree_ = on; }
 
         void start(int numThreads);//启动固定的线程数目的线程池
         void stop();
@@ -52,6 +55,10 @@ namespace base
         std::deque<Task > queue_ GUARDED_BY(mutex_);    
         size_t maxQueueSize_;//最大队列大小，若达到最大队列，则需要等待线程（消费者）取出队列
         bool running_;
+        bool lockFree_;
+        std::unique_ptr<BoundedMpmcQueue<Task>> lockFreeQueue_;    //lockFree_时代替queue_
+
+        static const size_t kDefaultLockFreeQueueSize = 65536;
     };
 }
 }
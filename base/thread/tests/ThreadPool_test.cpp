@@ -0,0 +1,115 @@
+#include "base/BoundedMpmcQueue.h"
+#include "base/thread/CountDownLatch.h"
+#include "base/thread/ThreadPool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <unistd.h>
+
+using namespace Miren::base;
+
+namespace
+{
+  // 在另一个线程中执行f，超时说明卡住了，这时无法清理，直接退出
+  template<typename F>
+  void runWithTimeout(F f, int seconds)
+  {
+    std::packaged_task<void()> task(f);
+    std::future<void> done = task.get_future();
+    std::thread thr(std::move(task));
+    if(done.wait_for(std::chrono::seconds(seconds)) != std::future_status::ready) {
+      ADD_FAILURE() << "timed out after " << seconds << " s";
+      _exit(1);
+    }
+    thr.join();
+  }
+}
+
+// 队列关闭后阻塞在take上的线程被唤醒，拿到默认值
+TEST(BoundedMpmcQueueTest, closeWakesBlockedTake)
+{
+  BoundedMpmcQueue<int> queue(4);
+  runWithTimeout([&]() {
+    std::thread taker([&]() { EXPECT_EQ(queue.take(), 0); });
+    usleep(50 * 1000);
+    queue.close();
+    taker.join();
+  }, 5);
+}
+
+// 队列关闭后阻塞在put上的线程被唤醒，元素被丢弃，已有的元素仍然可以取出
+TEST(BoundedMpmcQueueTest, closeWakesBlockedPut)
+{
+  BoundedMpmcQueue<int> queue(2);
+  queue.put(1);
+  queue.put(2);
+  runWithTimeout([&]() {
+    std::thread putter([&]() { queue.put(3); });
+    usleep(50 * 1000);
+    queue.close();
+    putter.join();
+  }, 5);
+  EXPECT_EQ(queue.take(), 1);
+  EXPECT_EQ(queue.take(), 2);
+  EXPECT_EQ(queue.take(), 0);
+}
+
+// 无锁队列满的时候stop()，工作线程做完手上的任务就退出，stop()不能卡住
+TEST(ThreadPoolTest, stopWithFullLockFreeQueue)
+{
+  const int kThreads = 2;
+  const int kQueueSize = 4;
+  ThreadPool pool("full");
+  pool.setMaxQueueSize(kQueueSize);
+  pool.setLockFreeQueue(true);
+  pool.start(kThreads);
+
+  CountDownLatch started(kThreads);
+  CountDownLatch gate(1);
+  std::atomic<int> executed(0);
+  auto task = [&]() {
+    started.countDown();
+    gate.wait();
+    ++executed;
+  };
+  for(int i = 0; i < kThreads; ++i) {
+    pool.run(task);
+  }
+  started.wait();
+  for(int i = 0; i < kQueueSize; ++i) {
+    pool.run(task);
+  }
+  ASSERT_EQ(pool.queueSize(), static_cast<size_t>(kQueueSize));
+
+  runWithTimeout([&]() {
+    std::thread releaser([&]() {
+      usleep(50 * 1000);
+      gate.countDown();
+    });
+    pool.stop();
+    releaser.join();
+  }, 5);
+  EXPECT_GE(executed.load(), kThreads);
+  EXPECT_LE(executed.load(), kThreads + kQueueSize);
+}
+
+// 空闲的工作线程阻塞在take上，stop()要唤醒它们
+TEST(ThreadPoolTest, stopIdleLockFreePool)
+{
+  ThreadPool pool("idle");
+  pool.setLockFreeQueue(true);
+  pool.start(4);
+  std::atomic<int> executed(0);
+  for(int i = 0; i < 100; ++i) {
+    pool.run([&]() { ++executed; });
+  }
+  while(executed.load() < 100) {
+    usleep(1000);
+  }
+  runWithTimeout([&]() { pool.stop(); }, 5);
+  EXPECT_EQ(executed.load(), 100);
+}
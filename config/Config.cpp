@@ -1,77 +1,307 @@
 #include "config/Config.h"
+#include "base/log/Logging.h"
+
+#include <fstream>
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 namespace Miren
 {
 namespace config
 {
-    template<>
-    std::string Config::query(const char *query_str, const std::string &default_value) {
-        auto it = _map.find(query_str);
-        if(it == _map.end()){
-            return default_value;
+    namespace
+    {
+        // 所有Config对象共用，版本号不会重复，thread local的缓存只需要比较版本号
+        std::atomic<uint64_t> g_nextVersion(1);
+
+        struct SnapshotCache
+        {
+            uint64_t version = 0;
+            std::shared_ptr<const ConfigSnapshot> snapshot;
+        };
+        thread_local SnapshotCache t_cache;
+
+        // 编辑器保存文件时可能连续产生几个事件，等一会再读
+        const int kDebounceMilliSeconds = 50;
+
+        void listAllMember(const std::string& prefix, const nlohmann::json& node,
+                           std::unordered_map<std::string, const nlohmann::json*>& output)
+        {
+            if(prefix.size()) {
+                output[prefix] = &node;
+            }
+            if(node.is_object()) {
+                for(const auto& it : node.items()) {
+                    listAllMember(prefix.empty() ? it.key() : prefix + "." + it.key(), it.value(), output);
+                }
+            }
         }
-        nlohmann::json node = it->second;
-        if(node.type() == nlohmann::json::value_t::string){
-            std::string p = node.get<std::string>();
-            return p;
+
+        void splitPath(const std::string& file, std::string* dir, std::string* name)
+        {
+            size_t slash = file.rfind('/');
+            if(slash == std::string::npos) {
+                *dir = ".";
+                *name = file;
+            }
+            else {
+                *dir = slash == 0 ? "/" : file.substr(0, slash);
+                *name = file.substr(slash + 1);
+            }
         }
-        return default_value;
     }
 
-    template<>
-    int Config::query<int>(const char* query_str, const int &default_value){
-        auto it = _map.find(query_str);
-        if(it == _map.end()){
-            return default_value;
+    const nlohmann::json* ConfigSnapshot::find(const std::string& path) const
+    {
+        auto it = _tree->nodes.find(path);
+        return it == _tree->nodes.end() ? nullptr : it->second;
+    }
+
+    std::optional<ConfigSnapshot::Value> ConfigSnapshot::convert(const nlohmann::json& node, Kind kind)
+    {
+        switch(kind) {
+            case kBool:
+                if(node.is_boolean()) {
+                    return Value(node.get<bool>());
+                }
+                break;
+            case kInteger:
+                //非负整数在json中是number_unsigned
+                if(node.is_number_integer()) {
+                    return Value(node.get<int64_t>());
+                }
+                break;
+            case kDouble:
+                //和原来的query<double>一样只接受浮点数，整数1不会被当作1.0
+                if(node.is_number_float()) {
+                    return Value(node.get<double>());
+                }
+                break;
+            case kString:
+                if(node.is_string()) {
+                    return Value(node.get<std::string>());
+                }
+                break;
         }
-        auto node = it->second;
-        if(node.type() == nlohmann::json::value_t::number_integer){
-            const auto p = node.get<int>();
-            return p;
+        return std::nullopt;
+    }
+
+    Config& Config::getInstance()
+    {
+        static Config config(defaultConfigFile);
+        static bool checked = [] {
+            if(!config._opened) {
+                LOG_FATAL << "read " << defaultConfigFile << " file error";
+            }
+            return true;
+        }();
+        (void)checked;
+        return config;
+    }
+
+    Config::Config(const std::string& file)
+        : _file(file),
+          _opened(false),
+          _version(0),
+          _inotifyFd(-1),
+          _wakeupFd(-1)
+    {
+        std::shared_ptr<const ConfigSnapshot::Tree> tree = load(_file, &_opened);
+        if(!tree) {
+            tree = std::make_shared<ConfigSnapshot::Tree>();
         }
-        return default_value;
+        base::MutexLockGuard lock(_mutex);
+        publish(std::move(tree));
+    }
+
+    Config::~Config()
+    {
+        stopWatching();
     }
 
-    template<>
-    unsigned int Config::query<unsigned int>(const char* query_str, const unsigned int &default_value){
-        auto it = _map.find(query_str);
-        if(it == _map.end()){
-            return default_value;
+    std::shared_ptr<const ConfigSnapshot::Tree> Config::load(const std::string& file, bool* opened)
+    {
+        std::ifstream in(file);
+        *opened = in.is_open();
+        if(!in.is_open()) {
+            LOG_ERROR << "read " << file << " file error";
+            return nullptr;
+        }
+        auto tree = std::make_shared<ConfigSnapshot::Tree>();
+        try {
+            in >> tree->json;
+        }
+        catch (nlohmann::json::exception& e) {
+            LOG_ERROR << "parse " << file << " failed: " << e.what();
+            return nullptr;
         }
-        auto node = it->second;
-        if(node.type() == nlohmann::json::value_t::number_integer){
-            const auto p = node.get<unsigned int>();
-            return p;
+        if(tree->json.is_object()) {
+            listAllMember("", tree->json, tree->nodes);
         }
-        return default_value;
+        return tree;
     }
 
-    template<>
-    double Config::query<double>(const char* query_str, const double& default_value){
-        auto it = _map.find(query_str);
-        if(it == _map.end()){
-            return default_value;
+    std::shared_ptr<const ConfigSnapshot> Config::publish(std::shared_ptr<const ConfigSnapshot::Tree> tree)
+    {
+        auto snapshot = std::make_shared<ConfigSnapshot>();
+        snapshot->_version = g_nextVersion.fetch_add(1, std::memory_order_relaxed);
+        snapshot->_tree = std::move(tree);
+        snapshot->_slots.reserve(_slotDescs.size());
+        for(const SlotDesc& desc : _slotDescs) {
+            const nlohmann::json* node = snapshot->find(desc.path);
+            snapshot->_slots.push_back(node ? ConfigSnapshot::convert(*node, desc.kind) : std::nullopt);
         }
-        auto node = it->second;
-        if(node.type() == nlohmann::json::value_t::number_float){
-            const auto p = node.get<double>();
-            return p;
+
+        std::shared_ptr<const ConfigSnapshot> old = std::move(_current);
+        _current = std::move(snapshot);
+        _version.store(_current->version(), std::memory_order_release);
+        return old;
+    }
+
+    const ConfigSnapshot& Config::current() const
+    {
+        if(t_cache.version != _version.load(std::memory_order_acquire)) {
+            t_cache.snapshot = snapshot();
+            t_cache.version = t_cache.snapshot->version();
         }
-        return default_value;
+        return *t_cache.snapshot;
+    }
+
+    std::shared_ptr<const ConfigSnapshot> Config::snapshot() const
+    {
+        base::MutexLockGuard lock(_mutex);
+        return _current;
     }
 
-    template<>
-    bool Config::query<bool>(const char* query_str, const bool& default_value){
-        auto it = _map.find(query_str);
-        if(it == _map.end()){
-            return default_value;
+    bool Config::reload()
+    {
+        base::MutexLockGuard reloadLock(_reloadMutex);
+        bool opened;
+        std::shared_ptr<const ConfigSnapshot::Tree> tree = load(_file, &opened);
+        if(!tree) {
+            return false;
         }
-        auto node = it->second;
-        if(node.type() == nlohmann::json::value_t::boolean){
-            const auto p = node.get<bool>();
-            return p;
+
+        std::shared_ptr<const ConfigSnapshot> old;
+        std::shared_ptr<const ConfigSnapshot> now;
+        std::vector<Listener> listeners;
+        {
+            base::MutexLockGuard lock(_mutex);
+            old = publish(std::move(tree));
+            now = _current;
+            for(size_t i = 0; i < _listeners.size(); ++i) {
+                if(!_listeners[i].empty() && old->_slots[i] != now->_slots[i]) {
+                    listeners.insert(listeners.end(), _listeners[i].begin(), _listeners[i].end());
+                }
+            }
+        }
+        LOG_INFO << "config " << _file << " reloaded, version " << now->version();
+        for(const Listener& listener : listeners) {
+            listener(*now);
+        }
+        return true;
+    }
+
+    size_t Config::registerSlot(const std::string& path, ConfigSnapshot::Kind kind)
+    {
+        base::MutexLockGuard lock(_mutex);
+        _slotDescs.push_back(SlotDesc{path, kind});
+        _listeners.emplace_back();
+        publish(_current->_tree);
+        return _slotDescs.size() - 1;
+    }
+
+    void Config::addListener(size_t slot, Listener listener)
+    {
+        base::MutexLockGuard lock(_mutex);
+        _listeners[slot].push_back(std::move(listener));
+    }
+
+    // 监视目录而不是文件：编辑器和配置管理工具一般写临时文件再rename，监视文件会丢失后续的修改
+    // 在调用线程中添加监视，startWatching返回后的修改都不会漏掉
+    void Config::startWatching()
+    {
+        if(_watcher) {
+            return;
+        }
+        std::string dir, name;
+        splitPath(_file, &dir, &name);
+        _inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(_inotifyFd < 0) {
+            LOG_SYSERR << "inotify_init1 failed";
+            return;
+        }
+        if(::inotify_add_watch(_inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+            LOG_SYSERR << "inotify_add_watch " << dir << " failed";
+            ::close(_inotifyFd);
+            _inotifyFd = -1;
+            return;
+        }
+        _wakeupFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(_wakeupFd < 0) {
+            LOG_SYSERR << "Config eventfd failed";
+            ::close(_inotifyFd);
+            _inotifyFd = -1;
+            return;
+        }
+        _watcher.reset(new base::Thread(std::bind(&Config::watchLoop, this, name), "ConfigWatcher"));
+        _watcher->start();
+    }
+
+    void Config::stopWatching()
+    {
+        if(!_watcher) {
+            return;
+        }
+        uint64_t one = 1;
+        ssize_t n = ::write(_wakeupFd, &one, sizeof one);
+        (void)n;
+        _watcher->join();
+        _watcher.reset();
+        ::close(_wakeupFd);
+        ::close(_inotifyFd);
+        _wakeupFd = -1;
+        _inotifyFd = -1;
+    }
+
+    void Config::watchLoop(const std::string& name)
+    {
+        const int fd = _inotifyFd;
+        alignas(struct inotify_event) char buf[4096];
+        for(;;) {
+            struct pollfd fds[2] = { { fd, POLLIN, 0 }, { _wakeupFd, POLLIN, 0 } };
+            if(::poll(fds, 2, -1) < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                LOG_SYSERR << "Config poll failed";
+                break;
+            }
+            if(fds[1].revents & POLLIN) {
+                break;
+            }
+
+            bool changed = false;
+            ssize_t n;
+            while((n = ::read(fd, buf, sizeof buf)) > 0) {
+                for(char* p = buf; p < buf + n; ) {
+                    const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+                    if(event->len > 0 && name == event->name) {
+                        changed = true;
+                    }
+                    p += sizeof(struct inotify_event) + event->len;
+                }
+            }
+            if(changed) {
+                ::usleep(kDebounceMilliSeconds * 1000);
+                while(::read(fd, buf, sizeof buf) > 0) {
+                }
+                reload();
+            }
         }
-        return default_value;
     }
 }
 
@@ -1,73 +1,232 @@
 #pragma once
 
-#include <fstream>
-#include <list>
 #include "third_party/nlohmann/json.hpp"
-#include "base/log/Logging.h"
+#include "base/Noncopyable.h"
+#include "base/thread/Mutex.h"
+#include "base/thread/Thread.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+#include <vector>
 
 namespace Miren
 {
 namespace config
 {
-    static const char* defaultConfigFile = "/root/hxk/server/conf/config.json";
-    class Config
+    const char* const defaultConfigFile = "/root/hxk/server/conf/config.json";
+
+    /*
+    一次加载得到的配置，发布后不再修改，读的线程不需要加锁
+    节点按"a.b.c"的路径展开；已注册的ConfigValue在创建快照时就转换好类型，读取时不再查找路径和转换
+    */
+    class ConfigSnapshot
     {
     public:
-        static Config& getInstance() {
-            static Config config1;
-            return config1;
+        // 下标和Kind相同
+        using Value = std::variant<bool, int64_t, double, std::string>;
+        enum Kind
+        {
+            kBool,
+            kInteger,
+            kDouble,
+            kString,
+        };
+
+        uint64_t version() const { return _version; }
+
+        // 路径对应的节点，不存在时返回nullptr
+        const nlohmann::json* find(const std::string& path) const;
+
+        // 第index个ConfigValue的值，没有配置或者类型不对时返回nullptr
+        const Value* slot(size_t index) const
+        {
+            return index < _slots.size() && _slots[index] ? &*_slots[index] : nullptr;
         }
 
-        template<class T>
-        T query(const char* query_str, const T& default_value);
+        // 按kind转换节点，类型不对时返回空
+        static std::optional<Value> convert(const nlohmann::json& node, Kind kind);
+
     private:
-        Config()
+        friend class Config;
+
+        struct Tree
         {
-            std::ifstream in(defaultConfigFile);
-            if (!in.is_open()) {
-               LOG_FATAL << "read " << defaultConfigFile << " file error";
-                return;
-            }
-            try {
-                in >> _json;
-            }
-            catch (nlohmann::json::exception& e) {
-                in.close();
-                return;
-            }
+            nlohmann::json json;
+            std::unordered_map<std::string, const nlohmann::json*> nodes;
+        };
 
-            if(_json.type() != nlohmann::json::value_t::object ) {
-                return;
-            }
-            std::list<std::pair<std::string, nlohmann::json>> all_nodes;
-            listAllMember("", _json, all_nodes);
+        uint64_t _version = 0;
+        std::shared_ptr<const Tree> _tree;      //只注册新的ConfigValue时和上一个快照共用
+        std::vector<std::optional<Value>> _slots;
+    };
 
-            for(const auto& it : all_nodes) {
-                _map.insert({it.first, it.second});
-            }
+    template<typename T>
+    constexpr ConfigSnapshot::Kind kindOf()
+    {
+        if constexpr(std::is_same_v<T, bool>) {
+            return ConfigSnapshot::kBool;
+        }
+        else if constexpr(std::is_integral_v<T>) {
+            return ConfigSnapshot::kInteger;
+        }
+        else if constexpr(std::is_floating_point_v<T>) {
+            return ConfigSnapshot::kDouble;
+        }
+        else {
+            static_assert(std::is_same_v<T, std::string>, "config value must be bool, integer, floating point or std::string");
+            return ConfigSnapshot::kString;
+        }
+    }
+
+    template<typename T>
+    T valueAs(const ConfigSnapshot::Value& value)
+    {
+        if constexpr(std::is_same_v<T, bool>) {
+            return std::get<bool>(value);
+        }
+        else if constexpr(std::is_integral_v<T>) {
+            return static_cast<T>(std::get<int64_t>(value));
+        }
+        else if constexpr(std::is_floating_point_v<T>) {
+            return static_cast<T>(std::get<double>(value));
+        }
+        else {
+            return std::get<std::string>(value);
         }
+    }
+
+    /*
+    配置以不可变的快照发布(RCU)：reload时在后台解析出新快照，替换指针后旧快照由最后一个使用者释放
+    读的线程在thread local中缓存快照，只比较一次版本号，不加锁也不修改引用计数；版本变化后才加锁取一次新快照
+    e.g.
+        auto& config = config::Config::getInstance();
+        config.startWatching();     //文件修改后自动reload
+
+        static config::ConfigValue<int> threadNum("EventLoopThreadPool.threadNum", 4);
+        pool->setThreadNum(threadNum.get());
+
+        static config::ConfigValue<std::string> level("log.level", "INFO");
+        level.watch([](const std::string& v) { ... Logger::setLogLevel(...); });
+    */
+    class Config : base::NonCopyable
+    {
+    public:
+        // 配置变化时在reload的线程中调用，参数是新的快照
+        using Listener = std::function<void(const ConfigSnapshot&)>;
+
+        // 第一次调用时加载defaultConfigFile，文件打不开时LOG_FATAL
+        static Config& getInstance();
+
+        // 文件打不开或者解析失败时是空配置，之后可以reload
+        explicit Config(const std::string& file);
+        ~Config();
+
+        const std::string& file() const { return _file; }
 
-        void listAllMember(const std::string& prefix, nlohmann::json node,
-                           std::list<std::pair<std::string, nlohmann::json>>& output)
+        // 当前快照，在本线程下一次读配置之前一直有效
+        // 同一个线程交替读多个Config对象时每次都会走加锁的慢路径
+        const ConfigSnapshot& current() const;
+        // 需要长时间持有或者传给其他线程时使用
+        std::shared_ptr<const ConfigSnapshot> snapshot() const;
+
+        // 重新读取文件，通知值有变化的ConfigValue的监听者
+        // 文件打不开或者解析失败时保留原来的配置，返回false
+        bool reload();
+
+        // 在后台线程中用inotify监视文件所在的目录，文件被写入或替换(编辑器保存、mv)后自动reload
+        void startWatching();
+        void stopWatching();
+
+        // 每次都查找路径并转换，热点路径使用ConfigValue
+        template<class T>
+        T query(const char* query_str, const T& default_value)
         {
-            if(prefix.size()) {
-                output.push_back({prefix, node});
-            }
-            if(node.is_object()) {
-                for(const auto& it : node.items()) {
-                    listAllMember(prefix.empty() ? it.key() : prefix + "." + it.key(),
-                                  it.value(), output);
-                }
+            const nlohmann::json* node = current().find(query_str);
+            if(!node) {
+                return default_value;
             }
+            std::optional<ConfigSnapshot::Value> value = ConfigSnapshot::convert(*node, kindOf<T>());
+            return value ? valueAs<T>(*value) : default_value;
+        }
+
+        // ConfigValue使用：登记路径，返回它在快照中的下标
+        size_t registerSlot(const std::string& path, ConfigSnapshot::Kind kind);
+        void addListener(size_t slot, Listener listener);
+
+    private:
+        struct SlotDesc
+        {
+            std::string path;
+            ConfigSnapshot::Kind kind;
+        };
+
+        static std::shared_ptr<const ConfigSnapshot::Tree> load(const std::string& file, bool* opened);
+        // 用tree和所有已注册的路径创建新快照并发布，返回旧快照
+        std::shared_ptr<const ConfigSnapshot> publish(std::shared_ptr<const ConfigSnapshot::Tree> tree) REQUIRES(_mutex);
+        void watchLoop(const std::string& name);
+
+        const std::string _file;
+        bool _opened;                   //构造时文件是否能打开
+
+        mutable base::MutexLock _mutex;
+        std::shared_ptr<const ConfigSnapshot> _current GUARDED_BY(_mutex);
+        std::atomic<uint64_t> _version;  //_current的版本，读线程只比较它
+        std::vector<SlotDesc> _slotDescs GUARDED_BY(_mutex);
+        std::vector<std::vector<Listener>> _listeners GUARDED_BY(_mutex);
+
+        base::MutexLock _reloadMutex;   //reload串行执行，监听者按顺序收到通知
+
+        std::unique_ptr<base::Thread> _watcher;
+        int _inotifyFd;
+        int _wakeupFd;                  //通知监视线程退出
+    };
+
+    /*
+    类型化的配置项，路径在构造时解析一次，get()只读当前快照中已经转换好的值
+    没有配置或者类型不对时返回默认值；整数配置可以用任意整数类型读取
+    */
+    template<typename T>
+    class ConfigValue
+    {
+    public:
+        ConfigValue(const std::string& path, T defaultValue, Config& config = Config::getInstance())
+            : _config(config),
+              _defaultValue(std::move(defaultValue)),
+              _slot(config.registerSlot(path, kindOf<T>()))
+        {
+        }
+
+        T get() const
+        {
+            const ConfigSnapshot::Value* value = _config.current().slot(_slot);
+            return value ? valueAs<T>(*value) : _defaultValue;
+        }
+
+        // 值变化时(包括配置被删除，这时是默认值)在reload的线程中调用
+        void watch(std::function<void(const T&)> callback)
+        {
+            size_t slot = _slot;
+            T defaultValue = _defaultValue;
+            _config.addListener(_slot, [callback, slot, defaultValue](const ConfigSnapshot& snapshot) {
+                const ConfigSnapshot::Value* value = snapshot.slot(slot);
+                callback(value ? valueAs<T>(*value) : defaultValue);
+            });
         }
 
     private:
-        nlohmann::json _json;
-        std::unordered_map<std::string , nlohmann::json > _map;
+        Config& _config;
+        const T _defaultValue;
+        const size_t _slot;
     };
 
     template<typename T>
     const T GET_CONFIG(const char* str, const T& default_val) { return Config::getInstance().query<T>(str,default_val); }
 }
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,75 @@
+#include "config/Config.h"
+#include "base/Clock.h"
+
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace Miren::base;
+using namespace Miren::config;
+
+const int N = 1000000;
+
+// 多个线程同时读同一个配置项，比较每次查找路径和使用ConfigValue
+template<typename Func>
+void bench(const char* name, int threads, Func func)
+{
+  std::vector<std::thread> workers;
+  std::vector<int64_t> sums(threads);
+  int64_t start = Clock::monotonicNanos();
+  for (int t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&func, &sums, t] {
+      int64_t sum = 0;
+      for (int i = 0; i < N; ++i)
+        sum += func();
+      sums[t] = sum;
+    });
+  }
+  for (auto& worker : workers)
+    worker.join();
+  int64_t elapsed = Clock::monotonicNanos() - start;
+  printf("%-24s threads %2d  %8.2f ns/read  (%lld)\n", name, threads,
+         static_cast<double>(elapsed) / N, static_cast<long long>(sums[0]));
+}
+
+int main()
+{
+  char dir[] = "/tmp/config_bench_XXXXXX";
+  if (!::mkdtemp(dir))
+  {
+    perror("mkdtemp");
+    return 1;
+  }
+  std::string file = std::string(dir) + "/config.json";
+  std::ofstream(file) << R"({"EventLoopThreadPool": {"threadNum": 8}, "log": {"level": "INFO"}})";
+
+  Config config(file);
+  ConfigValue<int> threadNum("EventLoopThreadPool.threadNum", 4, config);
+
+  for (int threads : {1, 4, 8})
+  {
+    bench("query", threads, [&config] { return config.query<int>("EventLoopThreadPool.threadNum", 4); });
+    bench("ConfigValue::get", threads, [&threadNum] { return threadNum.get(); });
+  }
+
+  // reload的同时读，读的线程只在版本变化后取一次新快照
+  std::atomic<bool> done(false);
+  std::thread reloader([&config, &done] {
+    while (!done.load())
+    {
+      config.reload();
+      ::usleep(1000);
+    }
+  });
+  bench("ConfigValue::get+reload", 4, [&threadNum] { return threadNum.get(); });
+  done = true;
+  reloader.join();
+
+  ::unlink(file.c_str());
+  ::rmdir(dir);
+}
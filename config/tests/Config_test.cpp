@@ -0,0 +1,144 @@
+#include "config/Config.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using Miren::config::Config;
+using Miren::config::ConfigValue;
+
+namespace
+{
+  class ConfigTest : public ::testing::Test
+  {
+  protected:
+    void SetUp() override
+    {
+      char dir[] = "/tmp/config_test_XXXXXX";
+      ASSERT_TRUE(::mkdtemp(dir));
+      dir_ = dir;
+      file_ = dir_ + "/config.json";
+    }
+
+    void TearDown() override
+    {
+      ::unlink(file_.c_str());
+      ::rmdir(dir_.c_str());
+    }
+
+    // 先写临时文件再rename，和配置管理工具的做法相同
+    void write(const std::string& content)
+    {
+      std::string tmp = file_ + ".tmp";
+      std::ofstream(tmp) << content;
+      ASSERT_EQ(::rename(tmp.c_str(), file_.c_str()), 0);
+    }
+
+    std::string dir_;
+    std::string file_;
+  };
+}
+
+TEST_F(ConfigTest, typedValues)
+{
+  write(R"({"server": {"port": 9999, "ratio": 1, "scale": 2.5, "name": "miren", "https": {"enable": true}}})");
+  Config config(file_);
+
+  ConfigValue<int> port("server.port", 0, config);
+  ConfigValue<uint16_t> shortPort("server.port", 0, config);
+  ConfigValue<double> ratio("server.ratio", 0.5, config);
+  ConfigValue<double> scale("server.scale", 1.0, config);
+  ConfigValue<std::string> name("server.name", "", config);
+  ConfigValue<bool> https("server.https.enable", false, config);
+  ConfigValue<int> missing("server.missing", 42, config);
+  ConfigValue<int> wrongType("server.name", 7, config);
+
+  EXPECT_EQ(port.get(), 9999);
+  EXPECT_EQ(shortPort.get(), 9999);
+  EXPECT_EQ(ratio.get(), 0.5);    // 整数不是double
+  EXPECT_EQ(scale.get(), 2.5);
+  EXPECT_EQ(name.get(), "miren");
+  EXPECT_TRUE(https.get());
+  EXPECT_EQ(missing.get(), 42);
+  EXPECT_EQ(wrongType.get(), 7);
+
+  EXPECT_EQ(config.query<int>("server.port", 0), 9999);
+  EXPECT_EQ(config.query<std::string>("server.name", ""), "miren");
+  EXPECT_EQ(config.query<int>("nothing", -1), -1);
+  EXPECT_EQ(config.query<double>("server.scale", 0.0), 2.5);
+  EXPECT_EQ(config.query<double>("server.ratio", 0.0), 0.0);
+}
+
+TEST_F(ConfigTest, reloadKeepsOldSnapshotOnError)
+{
+  write(R"({"a": 1})");
+  Config config(file_);
+  ConfigValue<int> a("a", 0, config);
+  std::shared_ptr<const Miren::config::ConfigSnapshot> first = config.snapshot();
+
+  write(R"({"a": 2})");
+  EXPECT_TRUE(config.reload());
+  EXPECT_EQ(a.get(), 2);
+  // 旧快照仍然可以使用
+  EXPECT_EQ(first->find("a")->get<int>(), 1);
+
+  write(R"({"a": )");
+  EXPECT_FALSE(config.reload());
+  EXPECT_EQ(a.get(), 2);
+}
+
+TEST_F(ConfigTest, listenersOnlySeeChangedValues)
+{
+  write(R"({"pool": {"threadNum": 4}, "log": {"level": "INFO"}})");
+  Config config(file_);
+  ConfigValue<int> threadNum("pool.threadNum", 1, config);
+  ConfigValue<std::string> level("log.level", "WARN", config);
+
+  std::vector<int> threadNums;
+  std::vector<std::string> levels;
+  threadNum.watch([&](const int& n) { threadNums.push_back(n); });
+  level.watch([&](const std::string& v) { levels.push_back(v); });
+
+  write(R"({"pool": {"threadNum": 8}, "log": {"level": "INFO"}})");
+  config.reload();
+  write(R"({"pool": {"threadNum": 8}})");
+  config.reload();
+
+  EXPECT_EQ(threadNums, std::vector<int>({8}));
+  EXPECT_EQ(levels, std::vector<std::string>({"WARN"}));
+}
+
+TEST_F(ConfigTest, inotifyReload)
+{
+  // 监听者引用这些变量，先于config声明，ASSERT失败提前返回时~Config()先停止监视线程
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::atomic<int> seen(0);
+  write(R"({"timeout": 120})");
+  Config config(file_);
+  ConfigValue<int> timeout("timeout", 0, config);
+  timeout.watch([&](const int& v) {
+    std::lock_guard<std::mutex> lock(mutex);
+    seen = v;
+    cond.notify_all();
+  });
+  config.startWatching();
+
+  write(R"({"timeout": 30})");
+  {
+    // inotify事件没有到达时测试失败，而不是一直阻塞
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(cond.wait_for(lock, std::chrono::seconds(5), [&] { return seen.load() != 0; }))
+        << "no reload within 5 seconds";
+  }
+  EXPECT_EQ(seen.load(), 30);
+  EXPECT_EQ(timeout.get(), 30);
+  config.stopWatching();
+}
@@ -0,0 +1,74 @@
+#include "coro/FramePool.h"
+
+#include <new>
+
+using namespace Miren;
+using namespace Miren::coro;
+
+namespace
+{
+    // Header之后的协程帧需要max_align_t对齐
+    const size_t kHeaderSize = 16;
+}
+
+FramePool& FramePool::current()
+{
+    thread_local FramePool pool;
+    return pool;
+}
+
+FramePool::~FramePool()
+{
+    for (auto& list : freeLists_) {
+        for (void* block : list) {
+            ::operator delete(block);
+        }
+    }
+}
+
+size_t FramePool::cachedBlocks() const
+{
+    size_t n = 0;
+    for (const auto& list : freeLists_) {
+        n += list.size();
+    }
+    return n;
+}
+
+void* FramePool::allocate(size_t size)
+{
+    static_assert(sizeof(Header) <= kHeaderSize, "header too large");
+
+    FramePool& pool = current();
+    const size_t sizeClass = (size + kHeaderSize + kGranularity - 1) / kGranularity;
+
+    void* block = nullptr;
+    if (sizeClass < kNumClasses && !pool.freeLists_[sizeClass].empty()) {
+        block = pool.freeLists_[sizeClass].back();
+        pool.freeLists_[sizeClass].pop_back();
+    }
+    else {
+        block = ::operator new(sizeClass * kGranularity);
+        ++pool.allocations_;
+    }
+
+    Header* header = static_cast<Header*>(block);
+    header->owner = sizeClass < kNumClasses ? &pool : nullptr;
+    header->sizeClass = sizeClass;
+    return static_cast<char*>(block) + kHeaderSize;
+}
+
+void FramePool::deallocate(void* ptr)
+{
+    void* block = static_cast<char*>(ptr) - kHeaderSize;
+    Header* header = static_cast<Header*>(block);
+
+    // 只比较地址，不访问其他线程的内存池，那个线程可能已经退出了
+    FramePool& pool = current();
+    if (header->owner == &pool && pool.freeLists_[header->sizeClass].size() < kMaxCachedPerClass) {
+        pool.freeLists_[header->sizeClass].push_back(block);
+    }
+    else {
+        ::operator delete(block);
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace Miren
+{
+    namespace coro
+    {
+        /*
+        协程帧的内存池，每个线程一个(one loop per thread，也就是每个EventLoop一个)
+        按64字节分级缓存释放的协程帧，同一个handler反复创建的协程帧大小相同，
+        稳定运行后创建Task不再调用malloc
+        跨线程释放的帧直接归还给系统，不需要加锁
+        */
+        class FramePool : base::NonCopyable
+        {
+        public:
+            static void* allocate(size_t size);
+            static void deallocate(void* ptr);
+
+            // 当前线程的内存池
+            static FramePool& current();
+
+            ~FramePool();
+
+            size_t cachedBlocks() const;        //缓存的空闲块数
+            size_t allocations() const { return allocations_; }    //从系统分配的次数
+
+        private:
+            FramePool() = default;
+
+            struct Header
+            {
+                FramePool* owner;   //分配时所在线程的内存池，nullptr表示不缓存
+                size_t sizeClass;
+            };
+
+            static const size_t kGranularity = 64;
+            static const size_t kNumClasses = 64;        //最大缓存 4KB 的协程帧
+            static const size_t kMaxCachedPerClass = 1024;
+
+            std::vector<void*> freeLists_[kNumClasses];
+            size_t allocations_ = 0;
+        };
+
+    } // namespace coro
+
+} // namespace Miren
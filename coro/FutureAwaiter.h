@@ -0,0 +1,70 @@
+#pragma once
+
+#include "coro/Task.h"
+#include "future/Future.h"
+
+#include <atomic>
+
+namespace Miren
+{
+    namespace coro
+    {
+        namespace detail
+        {
+            /*
+            co_await Future<T>，结果就绪后在等待者所属的loop中恢复
+            Then回调可能在await_suspend返回之前就在其他线程执行，
+            用state_做一次握手，决定由谁恢复协程
+            */
+            template <typename T>
+            class FutureAwaiter
+            {
+            public:
+                explicit FutureAwaiter(Future<T>&& future) : future_(std::move(future)) {}
+
+                bool await_ready() const noexcept { return false; }
+
+                template <typename P>
+                bool await_suspend(std::coroutine_handle<P> h)
+                {
+                    net::EventLoop* loop = loopOf(h);
+                    future_.Then([this, h, loop](typename TryWrapper<T>::Type&& result) {
+                        result_ = std::move(result);
+                        if (state_.exchange(kReady, std::memory_order_acq_rel) == kSuspended) {
+                            resumeOn(loop, h);
+                        }
+                    });
+                    // 回调已经执行过，不挂起
+                    return state_.exchange(kSuspended, std::memory_order_acq_rel) != kReady;
+                }
+
+                T await_resume()
+                {
+                    if constexpr (std::is_void_v<T>) {
+                        result_.Check();
+                    }
+                    else {
+                        return std::move(result_).Value();
+                    }
+                }
+
+            private:
+                enum State { kInit, kSuspended, kReady };
+
+                Future<T> future_;
+                typename TryWrapper<T>::Type result_;
+                std::atomic<int> state_ {kInit};
+            };
+
+        } // namespace detail
+
+    } // namespace coro
+
+    // 通过ADL找到，Future在Miren命名空间
+    template <typename T>
+    coro::detail::FutureAwaiter<T> operator co_await(Future<T>&& future)
+    {
+        return coro::detail::FutureAwaiter<T>(std::move(future));
+    }
+
+} // namespace Miren
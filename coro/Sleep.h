@@ -0,0 +1,51 @@
+#pragma once
+
+#include "coro/Task.h"
+
+#include <cassert>
+#include <chrono>
+
+namespace Miren
+{
+    namespace coro
+    {
+        // 通过EventLoop::runAfter挂起一段时间，在loop的IO线程中恢复
+        class SleepAwaiter
+        {
+        public:
+            SleepAwaiter(net::EventLoop* loop, double seconds) : loop_(loop), seconds_(seconds) {}
+
+            bool await_ready() const noexcept { return seconds_ <= 0; }
+
+            template <typename P>
+            void await_suspend(std::coroutine_handle<P> h)
+            {
+                net::EventLoop* loop = loop_ ? loop_ : detail::loopOf(h);
+                assert(loop != nullptr);
+                loop->runAfter(seconds_, [h] { h.resume(); });
+            }
+
+            void await_resume() const noexcept {}
+
+        private:
+            net::EventLoop* loop_;
+            double seconds_;
+        };
+
+        // co_await coro::sleep(loop, 100ms);
+        template <typename Rep, typename Period>
+        SleepAwaiter sleep(net::EventLoop* loop, std::chrono::duration<Rep, Period> d)
+        {
+            return SleepAwaiter(loop, std::chrono::duration<double>(d).count());
+        }
+
+        // 在协程所属的loop中睡眠
+        template <typename Rep, typename Period>
+        SleepAwaiter sleep(std::chrono::duration<Rep, Period> d)
+        {
+            return SleepAwaiter(nullptr, std::chrono::duration<double>(d).count());
+        }
+
+    } // namespace coro
+
+} // namespace Miren
@@ -0,0 +1,18 @@
+#include "coro/Task.h"
+#include "base/log/Logging.h"
+
+using namespace Miren;
+using namespace Miren::coro;
+
+void detail::reportUnhandledException(std::exception_ptr eptr)
+{
+    try {
+        std::rethrow_exception(eptr);
+    }
+    catch (const std::exception& ex) {
+        LOG_ERROR << "coroutine exited with exception: " << ex.what();
+    }
+    catch (...) {
+        LOG_ERROR << "coroutine exited with unknown exception";
+    }
+}
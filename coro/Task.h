@@ -0,0 +1,241 @@
+#pragma once
+
+#include "coro/FramePool.h"
+#include "net/EventLoop.h"
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace Miren
+{
+    namespace coro
+    {
+        template <typename T = void>
+        class Task;
+
+        namespace detail
+        {
+            // detach的协程异常结束时记录日志，避免头文件依赖Logging.h
+            void reportUnhandledException(std::exception_ptr eptr);
+
+            struct PromiseBase
+            {
+                // 协程帧从所在线程的FramePool分配
+                static void* operator new(size_t size) { return FramePool::allocate(size); }
+                static void operator delete(void* ptr) { FramePool::deallocate(ptr); }
+
+                struct FinalAwaiter
+                {
+                    bool await_ready() const noexcept { return false; }
+
+                    template <typename Promise>
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+                    {
+                        PromiseBase& promise = h.promise();
+                        if (promise.detached_) {
+                            if (promise.exception_) {
+                                reportUnhandledException(promise.exception_);
+                            }
+                            h.destroy();
+                            return std::noop_coroutine();
+                        }
+
+                        std::coroutine_handle<> continuation = promise.continuation_;
+                        if (!continuation) {
+                            return std::noop_coroutine();
+                        }
+                        // 等待者属于另一个loop，回到它的IO线程恢复
+                        net::EventLoop* loop = promise.continuationLoop_;
+                        if (loop && !loop->isInLoopThread()) {
+                            loop->queueInLoop([continuation] { continuation.resume(); });
+                            return std::noop_coroutine();
+                        }
+                        return continuation;   //对称转移，不增加栈深度
+                    }
+
+                    void await_resume() const noexcept {}
+                };
+
+                std::suspend_always initial_suspend() const noexcept { return {}; }
+                FinalAwaiter final_suspend() const noexcept { return {}; }
+                void unhandled_exception() { exception_ = std::current_exception(); }
+
+                net::EventLoop* loop() const { return loop_; }
+
+                net::EventLoop* loop_ = net::EventLoop::getEventLoopOfCurrentThread(); //所属的loop
+                std::coroutine_handle<> continuation_;      //co_await这个Task的协程
+                net::EventLoop* continuationLoop_ = nullptr;
+                std::exception_ptr exception_;
+                bool detached_ = false;
+            };
+
+            template <typename T>
+            struct Promise : PromiseBase
+            {
+                Task<T> get_return_object() noexcept;
+
+                template <typename U>
+                void return_value(U&& value) { value_.emplace(std::forward<U>(value)); }
+
+                T result()
+                {
+                    if (exception_) {
+                        std::rethrow_exception(exception_);
+                    }
+                    return std::move(*value_);
+                }
+
+                std::optional<T> value_;
+            };
+
+            template <>
+            struct Promise<void> : PromiseBase
+            {
+                Task<void> get_return_object() noexcept;
+
+                void return_void() noexcept {}
+
+                void result()
+                {
+                    if (exception_) {
+                        std::rethrow_exception(exception_);
+                    }
+                }
+            };
+
+            // 协程所属的loop，不是Task的协程则取当前线程的loop
+            template <typename P>
+            net::EventLoop* loopOf(std::coroutine_handle<P> h)
+            {
+                if constexpr (std::is_base_of_v<PromiseBase, P>) {
+                    return h.promise().loop();
+                }
+                else {
+                    return net::EventLoop::getEventLoopOfCurrentThread();
+                }
+            }
+
+            // 在loop中恢复协程，已经在IO线程中则直接恢复
+            inline void resumeOn(net::EventLoop* loop, std::coroutine_handle<> h)
+            {
+                if (loop) {
+                    loop->runInLoop([h] { h.resume(); });
+                }
+                else {
+                    h.resume();
+                }
+            }
+
+        } // namespace detail
+
+        /*
+        惰性启动的协程，总是在创建它的EventLoop中恢复执行
+        e.g.
+            Task<std::string> readLine(TcpConnectionPtr conn) {
+                co_return co_await coro::readUntil(conn, "\r\n");
+            }
+            Task<void> session(TcpConnectionPtr conn) {
+                std::string line = co_await readLine(conn);
+                conn->send(line);
+            }
+            coro::spawn(conn->getLoop(), session(conn));
+        协程的参数会被拷贝进协程帧，不要以引用方式传递TcpConnectionPtr
+        */
+        template <typename T>
+        class [[nodiscard]] Task : base::NonCopyable
+        {
+        public:
+            using promise_type = detail::Promise<T>;
+            using Handle = std::coroutine_handle<promise_type>;
+
+            Task() noexcept = default;
+            explicit Task(Handle h) noexcept : handle_(h) {}
+            Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+            Task& operator=(Task&& other) noexcept
+            {
+                if (this != &other) {
+                    if (handle_) {
+                        handle_.destroy();
+                    }
+                    handle_ = std::exchange(other.handle_, nullptr);
+                }
+                return *this;
+            }
+            ~Task()
+            {
+                if (handle_) {
+                    handle_.destroy();
+                }
+            }
+
+            bool valid() const { return static_cast<bool>(handle_); }
+            bool done() const { return handle_ && handle_.done(); }
+
+            // 交出协程帧的所有权
+            Handle release() noexcept { return std::exchange(handle_, nullptr); }
+
+            class Awaiter
+            {
+            public:
+                explicit Awaiter(Handle h) noexcept : handle_(h) {}
+
+                bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+
+                template <typename P>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<P> awaiting) noexcept
+                {
+                    promise_type& promise = handle_.promise();
+                    promise.continuation_ = awaiting;
+                    promise.continuationLoop_ = detail::loopOf(awaiting);
+                    if (!promise.loop_) {
+                        promise.loop_ = promise.continuationLoop_;
+                    }
+                    return handle_;   //启动子协程
+                }
+
+                T await_resume() { return handle_.promise().result(); }
+
+            private:
+                Handle handle_;
+            };
+
+            Awaiter operator co_await() && noexcept { return Awaiter(handle_); }
+            Awaiter operator co_await() & noexcept { return Awaiter(handle_); }
+
+        private:
+            Handle handle_;
+        };
+
+        namespace detail
+        {
+            template <typename T>
+            Task<T> Promise<T>::get_return_object() noexcept
+            {
+                return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+            }
+
+            inline Task<void> Promise<void>::get_return_object() noexcept
+            {
+                return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+            }
+        } // namespace detail
+
+        // 在loop中启动task，不等待结果，协程结束后自动释放，未捕获的异常记录日志
+        // 可以跨线程调用
+        inline void spawn(net::EventLoop* loop, Task<void>&& task)
+        {
+            auto h = task.release();
+            if (!h) {
+                return;
+            }
+            h.promise().loop_ = loop;
+            h.promise().detached_ = true;
+            loop->runInLoop([h] { h.resume(); });
+        }
+
+    } // namespace coro
+
+} // namespace Miren
@@ -0,0 +1,125 @@
+#include "coro/TcpStream.h"
+#include "net/Buffer.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace Miren;
+using namespace Miren::net;
+using namespace Miren::coro;
+
+namespace
+{
+    const char kContextName[] = "coro";
+
+    std::shared_ptr<detail::ReadState> stateOf(const TcpConnectionPtr& conn)
+    {
+        if (!conn->hasContext(kContextName)) {
+            return nullptr;
+        }
+        return std::any_cast<std::shared_ptr<detail::ReadState>>(conn->getContext(kContextName));
+    }
+}
+
+ReadAwaiter::ReadAwaiter(TcpConnectionPtr conn, size_t n)
+    : conn_(std::move(conn)),
+      n_(n)
+{
+}
+
+ReadAwaiter::ReadAwaiter(TcpConnectionPtr conn, std::string delim)
+    : conn_(std::move(conn)),
+      n_(0),
+      delim_(std::move(delim))
+{
+}
+
+bool ReadAwaiter::tryRead()
+{
+    Buffer* buf = conn_->inputBuffer();
+    if (delim_.empty()) {
+        if (buf->readableBytes() >= n_) {
+            result_ = buf->retrieveAsString(n_);
+            done_ = true;
+        }
+    }
+    else {
+        const char* end = buf->find(buf->peek(), delim_.data(), delim_.size());
+        if (end) {
+            result_.assign(buf->peek(), end);
+            buf->retrieveUntil(end + delim_.size());
+            done_ = true;
+        }
+    }
+    return done_;
+}
+
+bool ReadAwaiter::await_ready()
+{
+    conn_->getLoop()->assertInLoopThread();
+    state_ = stateOf(conn_);
+    if (!state_) {
+        attach(conn_);
+        state_ = stateOf(conn_);
+    }
+    return tryRead() || state_->closed || conn_->disconnected();
+}
+
+void ReadAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    assert(state_->pending == nullptr);
+    handle_ = h;
+    state_->pending = this;
+}
+
+std::string ReadAwaiter::await_resume()
+{
+    if (!done_) {
+        throw ConnectionClosed();
+    }
+    return std::move(result_);
+}
+
+void coro::attach(const TcpConnectionPtr& conn)
+{
+    conn->setContext(kContextName, std::make_shared<detail::ReadState>());
+}
+
+void coro::detach(const TcpConnectionPtr& conn)
+{
+    auto state = stateOf(conn);
+    if (!state) {
+        return;
+    }
+    // 保留context，之后的read直接抛出ConnectionClosed
+    state->closed = true;
+    if (ReadAwaiter* pending = std::exchange(state->pending, nullptr)) {
+        pending->handle_.resume();
+    }
+}
+
+void coro::onMessage(const TcpConnectionPtr& conn, Buffer* buf, base::Timestamp receiveTime)
+{
+    auto state = stateOf(conn);
+    if (state && state->pending && state->pending->tryRead()) {
+        ReadAwaiter* pending = std::exchange(state->pending, nullptr);
+        pending->handle_.resume();
+    }
+}
+
+void coro::serve(TcpServer* server, ConnectionHandler handler)
+{
+    server->setConnectionCallback([handler](const TcpConnectionPtr& conn) {
+        if (conn->connected()) {
+            attach(conn);
+            // 在连接所属的IO线程中创建协程帧，协程也总在这个线程中恢复
+            spawn(conn->getLoop(), handler(conn));
+        }
+        else {
+            detach(conn);
+        }
+    });
+    server->setMessageCallback(&coro::onMessage);
+}
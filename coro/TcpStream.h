@@ -0,0 +1,93 @@
+#pragma once
+
+#include "coro/Task.h"
+#include "net/Callbacks.h"
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace Miren
+{
+    namespace net
+    {
+        class TcpServer;
+    }
+
+    namespace coro
+    {
+        // 等待读的时候连接断开
+        class ConnectionClosed : public std::runtime_error
+        {
+        public:
+            ConnectionClosed() : std::runtime_error("connection closed") {}
+        };
+
+        class ReadAwaiter;
+
+        namespace detail
+        {
+            // 保存在TcpConnection的context中，记录正在等待数据的协程
+            struct ReadState
+            {
+                ReadAwaiter* pending = nullptr;
+                bool closed = false;
+            };
+        }
+
+        /*
+        从TcpConnection的inputBuffer读取数据，inputBuffer中的数据已经满足条件时不挂起
+        同一个连接同时只能有一个协程在读
+        */
+        class ReadAwaiter
+        {
+        public:
+            ReadAwaiter(net::TcpConnectionPtr conn, size_t n);
+            ReadAwaiter(net::TcpConnectionPtr conn, std::string delim);
+
+            bool await_ready();
+            void await_suspend(std::coroutine_handle<> h);
+            std::string await_resume();
+
+        private:
+            friend void onMessage(const net::TcpConnectionPtr&, net::Buffer*, base::Timestamp);
+            friend void detach(const net::TcpConnectionPtr& conn);
+
+            bool tryRead(); //从inputBuffer中取出数据，成功返回true
+
+            net::TcpConnectionPtr conn_;
+            size_t n_;
+            std::string delim_;
+            std::string result_;
+            bool done_ = false;
+            std::shared_ptr<detail::ReadState> state_;
+            std::coroutine_handle<> handle_;
+        };
+
+        // 读取恰好n个字节
+        inline ReadAwaiter read(net::TcpConnectionPtr conn, size_t n) { return ReadAwaiter(std::move(conn), n); }
+        // 读取到delim为止，返回的数据不包括delim
+        inline ReadAwaiter readUntil(net::TcpConnectionPtr conn, std::string delim) { return ReadAwaiter(std::move(conn), std::move(delim)); }
+
+        /*
+        连接建立/断开时调用attach/detach，并把onMessage设为MessageCallback，read/readUntil才能被唤醒
+        serve把这些都设置好，每个新连接在它的IO线程中启动一个handler协程
+        e.g.
+            coro::serve(&server, [](TcpConnectionPtr conn) -> coro::Task<> {
+                for (;;) {
+                    std::string line = co_await coro::readUntil(conn, "\r\n");
+                    conn->send(line + "\r\n");
+                }
+            });
+        */
+        void attach(const net::TcpConnectionPtr& conn);
+        void detach(const net::TcpConnectionPtr& conn);
+        void onMessage(const net::TcpConnectionPtr& conn, net::Buffer* buf, base::Timestamp receiveTime);
+
+        using ConnectionHandler = std::function<Task<void>(net::TcpConnectionPtr)>;
+        void serve(net::TcpServer* server, ConnectionHandler handler);
+
+    } // namespace coro
+
+} // namespace Miren
@@ -0,0 +1,163 @@
+#include "coro/Task.h"
+#include "coro/FutureAwaiter.h"
+#include "coro/Sleep.h"
+#include "coro/TcpStream.h"
+#include "future/WorkStealingPool.h"
+#include "net/EventLoop.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+#include "base/Timestamp.h"
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+
+using namespace Miren;
+using namespace Miren::net;
+using namespace std::chrono_literals;
+
+namespace {
+
+// 协程的参数会拷贝进协程帧，测试中都用自由函数而不是带捕获的lambda
+
+coro::Task<int> add(int a, int b) {
+    co_return a + b;
+}
+
+coro::Task<int> sum(int n) {
+    int s = 0;
+    for (int i = 0; i < n; ++i)
+        s += co_await add(i, 1);
+    co_return s;
+}
+
+coro::Task<void> runSum(int n, int* result) {
+    *result = co_await sum(n);
+}
+
+coro::Task<int> fail() {
+    throw std::runtime_error("boom");
+    co_return 0;
+}
+
+coro::Task<void> catchFail(bool* caught) {
+    try {
+        co_await fail();
+    } catch (const std::runtime_error& ) {
+        *caught = true;
+    }
+}
+
+coro::Task<void> awaitFuture(EventLoop* loop, WorkStealingPool* pool, int* result, bool* inLoop) {
+    int a = co_await pool->Execute([]() { return 20; });
+    *inLoop = loop->isInLoopThread();
+    co_await pool->Execute([]() {});
+    int b = co_await MakeReadyFuture(22);
+    *result = a + b;
+    loop->quit();
+}
+
+coro::Task<void> sleepFor(EventLoop* loop, double* elapsed) {
+    base::Timestamp start = base::Timestamp::now();
+    co_await coro::sleep(50ms);
+    *elapsed = base::timeDifference(base::Timestamp::now(), start);
+    loop->quit();
+}
+
+coro::Task<void> counter(int* count) {
+    co_await add(1, 1);
+    ++*count;
+}
+
+coro::Task<void> echoSession(TcpConnectionPtr conn) {
+    std::string line = co_await coro::readUntil(conn, "\r\n");
+    std::string body = co_await coro::read(conn, 5);
+    conn->send(line + ":" + body);
+    try {
+        co_await coro::read(conn, 1);
+    } catch (const coro::ConnectionClosed& ) {
+        conn->getLoop()->quit();
+    }
+}
+
+} // end namespace
+
+// 在loop线程中spawn会立即执行，直到第一次真正挂起
+TEST(coro, nested_tasks) {
+    EventLoop loop;
+    int result = 0;
+    coro::spawn(&loop, runSum(100, &result));
+    EXPECT_EQ(result, 5050);
+}
+
+TEST(coro, exception) {
+    EventLoop loop;
+    bool caught = false;
+    coro::spawn(&loop, catchFail(&caught));
+    EXPECT_TRUE(caught);
+}
+
+TEST(coro, await_future) {
+    EventLoop loop;
+    WorkStealingPool pool;
+    pool.SetNumOfThreads(2);
+
+    int result = 0;
+    bool inLoop = false;
+    coro::spawn(&loop, awaitFuture(&loop, &pool, &result, &inLoop));
+    loop.loop();
+    pool.JoinAll();
+
+    EXPECT_EQ(result, 42);
+    EXPECT_TRUE(inLoop);
+}
+
+TEST(coro, sleep) {
+    EventLoop loop;
+    double elapsed = 0;
+    coro::spawn(&loop, sleepFor(&loop, &elapsed));
+    loop.loop();
+    EXPECT_GE(elapsed, 0.045);
+}
+
+TEST(coro, frame_pool_reuse) {
+    EventLoop loop;
+    int count = 0;
+    coro::spawn(&loop, counter(&count));
+
+    // 第一轮之后，协程帧都从缓存中分配
+    size_t before = coro::FramePool::current().allocations();
+    for (int i = 0; i < 1000; ++i)
+        coro::spawn(&loop, counter(&count));
+
+    EXPECT_EQ(count, 1001);
+    EXPECT_EQ(coro::FramePool::current().allocations(), before);
+}
+
+TEST(coro, tcp_read) {
+    EventLoop loop;
+    InetAddress addr(29981, true);
+    TcpServer server(&loop, addr, "CoroServer");
+    coro::serve(&server, echoSession);
+    server.start();
+
+    std::string reply;
+    TcpClient client(&loop, addr, "CoroClient");
+    client.setConnectionCallback([](const TcpConnectionPtr& conn) {
+        if (conn->connected()) {
+            // 分两次发送，第二次的数据在协程挂起之后到达
+            conn->send("hello\r\nwor");
+            conn->getLoop()->runAfter(0.02, [conn]() { conn->send("ld"); });
+        }
+    });
+    client.setMessageCallback([&](const TcpConnectionPtr& conn, Buffer* buf, base::Timestamp) {
+        reply += buf->retrieveAllAsString();
+        if (reply.size() >= 11)
+            conn->shutdown();
+    });
+    client.connect();
+    loop.loop();
+
+    EXPECT_EQ(reply, "hello:world");
+}
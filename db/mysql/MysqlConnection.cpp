@@ -58,10 +58,89 @@ namespace SqlConn
 
     MySqlConnection::~MySqlConnection()
     {
+        for (auto &entry : stmtLru) ReleaseCommand(entry.second);
         if (mysql == nullptr) return;
         mysql_close(mysql);
     }
 
+    void MySqlConnection::SetStatementCacheSize(size_t size)
+    {
+        stmtCacheSize = size;
+        while (stmtLru.size() > stmtCacheSize)
+        {
+            stmtIndex.erase(stmtLru.back().first);
+            ReleaseCommand(stmtLru.back().second);
+            stmtLru.pop_back();
+        }
+    }
+
+    // cache hit: move to the front and reuse the prepared handle; miss: prepare and evict the least recently used.
+    // nullptr means the caller prepares a private command (cache disabled or the cached one is still being read)
+    MySqlCommand *MySqlConnection::AcquireCommand(const std::string &query)
+    {
+        if (stmtCacheSize == 0) return nullptr;
+
+        auto it = stmtIndex.find(query);
+        if (it != stmtIndex.end())
+        {
+            MySqlCommand *cmd = it->second->second;
+            if (cmd->lease != nullptr) return nullptr;
+            stmtLru.splice(stmtLru.begin(), stmtLru, it->second);
+            cmd->Reset();
+            return cmd;
+        }
+
+        MySqlCommand *cmd = CreateCommand(query);
+        stmtLru.emplace_front(query, cmd);
+        stmtIndex.emplace(query, stmtLru.begin());
+        if (stmtLru.size() > stmtCacheSize)
+        {
+            stmtIndex.erase(stmtLru.back().first);
+            ReleaseCommand(stmtLru.back().second);
+            stmtLru.pop_back();
+        }
+        return cmd;
+    }
+
+    MySqlDataReader *MySqlConnection::ExecuteCommand(MySqlCommand *cmd, bool owned)
+    {
+        MySqlDataReader *rd = nullptr;
+        try
+        {
+            rd = cmd->ExecuteReader();
+        }
+        catch (...)
+        {
+            if (owned) delete cmd;
+            throw;
+        }
+        if (owned)
+        {
+            rd->rdCmd = cmd;
+        }
+        else
+        {
+            rd->leasedCmd = cmd;
+            cmd->lease = rd;
+        }
+        return rd;
+    }
+
+    // a command dropped from the cache while a reader still iterates it is handed over to that reader
+    void MySqlConnection::ReleaseCommand(MySqlCommand *cmd)
+    {
+        if (cmd->lease != nullptr)
+        {
+            cmd->lease->leasedCmd = nullptr;
+            cmd->lease->rdCmd = cmd;
+            cmd->lease = nullptr;
+        }
+        else
+        {
+            delete cmd;
+        }
+    }
+
     size_t MySqlConnection::ExecuteNonQuery(const std::string &query)
     {
         if (mysql_query(mysql, query.c_str()))
@@ -90,10 +169,10 @@ namespace SqlConn
 
     MySqlDataReader *MySqlConnection::ExecuteReader(const std::string & query)
     {
-        MySqlCommand *cmd = CreateCommand(query);
-        MySqlDataReader *rd = cmd->ExecuteReader();
-        rd->rdCmd = cmd;
-        return rd;
+        MySqlCommand *cmd = AcquireCommand(query);
+        bool owned = cmd == nullptr;
+        if (owned) cmd = CreateCommand(query);
+        return ExecuteCommand(cmd, owned);
     }
 
     void MySqlConnection::ChangeDatabase(const std::string &db)
@@ -141,6 +220,17 @@ namespace SqlConn
         }
     }
 
+    // forget the previous call's parameter types and results, keep the prepared handle and buffers
+    void MySqlCommand::Reset()
+    {
+        mysql_stmt_free_result(smnt);
+        for (uint32_t pos = 0; pos < paramCount; pos++)
+        {
+            bindings[pos].buffer_type = MySqlDbType::Unspecified;
+            bindings[pos].is_null = false;
+        }
+    }
+
     // bind
     void MySqlCommand::BindParam(uint32_t pos, MySqlDbType type)
     {
@@ -288,6 +378,7 @@ namespace SqlConn
             delete[] results;
         }
         if (rdCmd != nullptr) delete rdCmd;
+        if (leasedCmd != nullptr) leasedCmd->lease = nullptr;
     }
 
     bool MySqlDataReader::Read()
@@ -13,8 +13,11 @@ Author:
 #include <mysql/mysql.h>
 #include <string>
 #include <map>
+#include <list>
 #include <vector>
+#include <chrono>
 #include <stdexcept>
+#include <unordered_map>
 #include "db/mysql/TmDateTime.h"
 #include "db/mysql/MysqlConnConfig.h"
 
@@ -230,7 +233,8 @@ namespace SqlConn
 
     protected:
         MySqlDataReader(MYSQL_STMT *ismnt);
-        MySqlCommand *rdCmd = nullptr;
+        MySqlCommand *rdCmd = nullptr;          // owned command, deleted with the reader
+        MySqlCommand *leasedCmd = nullptr;      // command from the connection's statement cache
     public:
         ~MySqlDataReader();
         bool Read();
@@ -291,13 +295,16 @@ namespace SqlConn
     class MySqlCommand
     {
         friend class MySqlConnection;
+        friend class MySqlDataReader;
 
         MYSQL_STMT *smnt = nullptr;
         MYSQL_BIND *paramBind = nullptr;		// input
         DataStore *bindings;					// real data
         uint32_t paramCount;
+        MySqlDataReader *lease = nullptr;       // reader currently iterating a cached command
         MySqlCommand(const MySqlCommand&) {}
         void Execute();
+        void Reset();
 
         template<typename T>
         MySqlDbType Typ2My() const
@@ -432,9 +439,20 @@ namespace SqlConn
     /////////////////////////////////////////////////////////////////////////
     class MySqlConnection
     {
+        typedef std::list<std::pair<std::string, MySqlCommand*>> StatementList;
+
         MySqlConnection(const MySqlConnection&) {}
         MYSQL *mysql = nullptr;
-        clock_t aliveTime;    //记录进入空闲状态后的起始时间点
+        std::chrono::steady_clock::time_point aliveTime;    //记录进入空闲状态后的起始时间点
+
+        // prepared statement LRU cache, most recently used at the front
+        size_t stmtCacheSize = 64;
+        StatementList stmtLru;
+        std::unordered_map<std::string, StatementList::iterator> stmtIndex;
+
+        MySqlCommand *AcquireCommand(const std::string &query);
+        MySqlDataReader *ExecuteCommand(MySqlCommand *cmd, bool owned);
+        void ReleaseCommand(MySqlCommand *cmd);
     public:
 
         MySqlConnection();
@@ -447,14 +465,24 @@ namespace SqlConn
 
         virtual void Close() { throw std::runtime_error("Close is not supported"); }
 
-        void refreshAliveTime() { aliveTime = clock(); }
-        clock_t getAliveTime() const { return clock() - aliveTime; }   // 返回存活的时间
+        void refreshAliveTime() { aliveTime = std::chrono::steady_clock::now(); }
+        // 返回进入空闲状态后经过的毫秒数
+        int64_t getAliveTime() const
+        {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - aliveTime).count();
+        }
 
         inline void Ping()
         {
             if (mysql_ping(mysql)) throw std::runtime_error("mysql_ping");
         }
 
+        // Parameterized ExecuteReader/ExecuteNonQuery reuse prepared statements from an LRU cache keyed by
+        // the query text; 0 disables the cache. A reader holding a cached statement must be deleted before
+        // the same query runs again on this connection, otherwise that call prepares a private copy.
+        void SetStatementCacheSize(size_t size);
+        size_t CachedStatements() const { return stmtLru.size(); }
+
         MySqlCommand *CreateCommand(const std::string &query) { return new MySqlCommand(mysql, query.c_str()); }
 
         size_t ExecuteNonQuery(const std::string &query);
@@ -462,10 +490,21 @@ namespace SqlConn
         template<typename... Targs>
         size_t ExecuteNonQuery(const std::string &query, Targs&& ... Fargs)
         {
-            MySqlCommand *cmd = CreateCommand(query);
-            cmd->BindParams(Fargs...);
-            size_t affRws = cmd->ExecuteNonQuery();
-            delete cmd;
+            MySqlCommand *cmd = AcquireCommand(query);
+            bool owned = cmd == nullptr;
+            if (owned) cmd = CreateCommand(query);
+            size_t affRws = 0;
+            try
+            {
+                cmd->BindParams(Fargs...);
+                affRws = cmd->ExecuteNonQuery();
+            }
+            catch (...)
+            {
+                if (owned) delete cmd;
+                throw;
+            }
+            if (owned) delete cmd;
             return affRws;
         }
 
@@ -474,11 +513,19 @@ namespace SqlConn
         template<typename... Targs>
         MySqlDataReader *ExecuteReader(const std::string &query, Targs&& ... Fargs)
         {
-            MySqlCommand *cmd = CreateCommand(query);
-            cmd->BindParams(Fargs...);
-            MySqlDataReader *rd = cmd->ExecuteReader();
-            rd->rdCmd = cmd;
-            return rd;
+            MySqlCommand *cmd = AcquireCommand(query);
+            bool owned = cmd == nullptr;
+            if (owned) cmd = CreateCommand(query);
+            try
+            {
+                cmd->BindParams(Fargs...);
+            }
+            catch (...)
+            {
+                if (owned) delete cmd;
+                throw;
+            }
+            return ExecuteCommand(cmd, owned);
         }
 
         virtual void ChangeDatabase(const std::string &dbname);
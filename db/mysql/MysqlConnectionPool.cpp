@@ -1,33 +1,69 @@
 #include "db/mysql/MysqlConnectionPool.h"
-#include<thread>
+#include "base/log/Logging.h"
+#include "base/thread/CurrentThread.h"
+#include "net/EventLoop.h"
+
+#include <chrono>
+#include <functional>
 
 namespace SqlConn
 {
 
 MysqlConnConfig MysqlConnectionPool::_config;
 
-//构造函数私有化，单例
-MysqlConnectionPool::MysqlConnectionPool()
+// idle只由所属线程访问，队尾是最近归还的连接
+struct MysqlConnectionPool::Shard
+{
+    int owner = 0;
+    Miren::net::EventLoop* loop = nullptr;
+    int64_t lastScan = 0;                       //没有EventLoop的线程上次检查的时间(ms)
+    std::vector<MySqlConnection*> idle;
+    std::atomic<bool> closed{false};            //所属线程已经退出
+
+    std::mutex mutex;                           //保护returned
+    std::vector<MySqlConnection*> returned;     //在其他线程归还的连接
+    std::atomic<bool> hasReturned{false};
+};
+
+namespace
 {
-  //创建初始数量的连接
-  for(int i = 0; i < _initSize; ++i)
-  {
-    MySqlConnection* p = new MySqlConnection();
-    // 刷新连接的起始空闲时间
-    p->refreshAliveTime();
-    _connectionQue.push(p);
-    _connectionCnt++;
-  }
 
-  //启动一个新的线程，作为连接的生产者,成员方法作为一个单独的线程函数必须绑定this指针
-  std::thread produce(std::bind(&MysqlConnectionPool::produceConnectionTask,this));
-  //分离线程，设为守护线程角色
-  produce.detach();
+int64_t nowMillis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-  // 启动一个新的定时线程，扫描超过maxIdleTime时间的空闲连接，进行回收
-  std::thread scanner(std::bind(&MysqlConnectionPool::scannerConnectionTask,this));
-  scanner.detach();
+// 线程退出时关闭本线程分片中的连接
+struct ShardHolder
+{
+    std::shared_ptr<MysqlConnectionPool::Shard> shard;
+    std::function<void (MysqlConnectionPool::Shard*)> close;
+
+    ~ShardHolder()
+    {
+        if(shard) {
+            close(shard.get());
+            mysql_thread_end();
+        }
+    }
+};
+
+thread_local ShardHolder t_shard;
 
+}
+
+//构造函数私有化，单例
+MysqlConnectionPool::MysqlConnectionPool()
+    : _maxIdleConnections(8),
+      _minIdleConnections(1),
+      _maxIdleTime(60),
+      _pingInterval(30),
+      _statementCacheSize(64),
+      _connectionCnt(0)
+{
+    //多个线程调用mysql_init之前必须先初始化客户端库
+    mysql_library_init(0, nullptr, nullptr);
 }
 
  //获取连接池对象实例
@@ -37,102 +73,179 @@ MysqlConnectionPool* MysqlConnectionPool::getConnectionPool()
     return &pool;
 }
 
-//从连接池中获取一个可用空闲连接
-std::shared_ptr<MySqlConnection>MysqlConnectionPool::getConnection()
+MysqlConnectionPool::Shard* MysqlConnectionPool::currentShard()
 {
-    std::unique_lock<std::mutex> lock(_queueMutex);
-    if(_connectionQue.empty())
-    {
-        //若队列为空，则阻塞等待
-        if(std::cv_status::timeout == _cv.wait_for(lock, std::chrono::milliseconds(_connectionTimeOut)))
+    if(t_shard.shard) {
+        return t_shard.shard.get();
+    }
+
+    std::shared_ptr<Shard> shard = std::make_shared<Shard>();
+    shard->owner = Miren::base::CurrentThread::tid();
+    shard->loop = Miren::net::EventLoop::getEventLoopOfCurrentThread();
+    shard->lastScan = nowMillis();
+    t_shard.shard = shard;
+    t_shard.close = [this](Shard* s) {
+        s->closed.store(true, std::memory_order_release);
+        std::vector<MySqlConnection*> conns;
+        conns.swap(s->idle);
         {
-            //若阻塞等待达到最大获取连接时间，仍未获取连接则返回空指针
-            if(_connectionQue.empty())
-            {
-                // LOG("获取空闲连接超时...获取连接失败！");
-                return nullptr;
-            }
+            std::lock_guard<std::mutex> lock(s->mutex);
+            conns.insert(conns.end(), s->returned.begin(), s->returned.end());
+            s->returned.clear();
+        }
+        for(MySqlConnection* conn : conns) {
+            delete conn;
         }
+        _connectionCnt -= static_cast<int>(conns.size());
+    };
+
+    // 健康检查和空闲回收由所在的EventLoop定时驱动，不再需要单独的扫描线程
+    if(shard->loop != nullptr) {
+        std::weak_ptr<Shard> weak(shard);
+        shard->loop->runEvery(static_cast<double>(_pingInterval.load()), [this, weak]() {
+            std::shared_ptr<Shard> s = weak.lock();
+            if(s && !s->closed.load(std::memory_order_acquire)) {
+                scanShard(s.get());
+            }
+        });
     }
+    return shard.get();
+}
 
-    //阻塞途中被唤醒或队列不为空，则直接获取连接
-
-    //shared_ptr智能指针析构时，会调用connection析构函数，故需要在这里自定义一下shared_ptr的资源释放方式
-    std::shared_ptr<MySqlConnection> sp(_connectionQue.front(),
-                              [&](MySqlConnection *ptcon)
-                              {
-                                std::unique_lock<std::mutex> lock_m(_queueMutex);
-                                // 刷新连接的起始空闲时间
-                                ptcon->refreshAliveTime();
-                                _connectionQue.push(ptcon);
-                              });
+MySqlConnection* MysqlConnectionPool::createConnection()
+{
+    MySqlConnection* conn = new MySqlConnection();
+    if(!conn->connect(_config)) {
+        LOG_ERROR << "MysqlConnectionPool connect to " << _config.ip << ":" << _config.port
+                  << "/" << _config.dbname << " failed";
+        delete conn;
+        return nullptr;
+    }
+    conn->SetStatementCacheSize(_statementCacheSize.load(std::memory_order_relaxed));
+    _connectionCnt++;
+    return conn;
+}
 
-    _connectionQue.pop();
-    //消费完连接以后，通知生产者线程检查一下，若队列为空，赶紧生产
-    _cv.notify_all();
+//从连接池中获取一个可用空闲连接
+std::shared_ptr<MySqlConnection> MysqlConnectionPool::getConnection()
+{
+    Shard* shard = currentShard();
+    if(shard->hasReturned.load(std::memory_order_acquire)) {
+        drainReturned(shard);
+    }
+    if(shard->loop == nullptr && nowMillis() - shard->lastScan > _pingInterval * 1000LL) {
+        scanShard(shard);
+    }
 
-    return sp;
+    MySqlConnection* conn = nullptr;
+    while(conn == nullptr && !shard->idle.empty()) {
+        conn = shard->idle.back();
+        shard->idle.pop_back();
+        //空闲较久的连接可能已经被服务器断开，使用前先确认
+        if(conn->getAliveTime() > _pingInterval * 1000LL) {
+            try {
+                conn->Ping();
+            }
+            catch(const std::exception&) {
+                delete conn;
+                _connectionCnt--;
+                conn = nullptr;
+            }
+        }
+    }
+    if(conn == nullptr) {
+        conn = createConnection();
+        if(conn == nullptr) {
+            return nullptr;
+        }
+    }
 
+    //shared_ptr智能指针析构时，会调用connection析构函数，故需要在这里自定义一下shared_ptr的资源释放方式
+    std::shared_ptr<Shard> owner = t_shard.shard;
+    return std::shared_ptr<MySqlConnection>(conn, [this, owner](MySqlConnection* ptcon) {
+        release(owner, ptcon);
+    });
 }
 
-//运行在独立线程中，专门负责生产新连接
-void MysqlConnectionPool::produceConnectionTask()
+void MysqlConnectionPool::release(const std::shared_ptr<Shard>& shard, MySqlConnection* conn)
 {
-  while(1)
-  {
-    std::unique_lock<std::mutex> lock(_queueMutex);
-
-    while(!_connectionQue.empty())
-    {
-        //若队列不为空阻塞,并释放锁
-        _cv.wait(lock);
+    // 刷新连接的起始空闲时间
+    conn->refreshAliveTime();
+    if(Miren::base::CurrentThread::tid() == shard->owner) {
+        if(!shard->closed.load(std::memory_order_acquire)
+           && shard->idle.size() < _maxIdleConnections.load(std::memory_order_relaxed)) {
+            shard->idle.push_back(conn);
+            return;
+        }
+    }
+    else {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        if(!shard->closed.load(std::memory_order_acquire)) {
+            shard->returned.push_back(conn);
+            shard->hasReturned.store(true, std::memory_order_release);
+            return;
+        }
     }
+    delete conn;
+    _connectionCnt--;
+}
 
-    //连接数量没有达到上限，则继续创建
-    if (_connectionCnt < _maxSize)
+void MysqlConnectionPool::drainReturned(Shard* shard)
+{
+    std::vector<MySqlConnection*> returned;
     {
-      MySqlConnection *p = new MySqlConnection();
-      // 刷新连接的起始空闲时间
-      p->refreshAliveTime();
-      _connectionQue.push(p);
-      _connectionCnt++;
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        returned.swap(shard->returned);
+        shard->hasReturned.store(false, std::memory_order_relaxed);
+    }
+    for(MySqlConnection* conn : returned) {
+        if(shard->idle.size() < _maxIdleConnections.load(std::memory_order_relaxed)) {
+            shard->idle.push_back(conn);
+        }
+        else {
+            delete conn;
+            _connectionCnt--;
+        }
     }
-
-    //通知消费者线程，可以连接
-    _cv.notify_all();
-  }
 }
 
 // 扫描超过maxIdleTime时间的空闲连接，进行回收
-void MysqlConnectionPool::scannerConnectionTask()
+void MysqlConnectionPool::scanShard(Shard* shard)
 {
-  while(1)
-  {
-    // 模拟定时效果
-    std::this_thread::sleep_for(std::chrono::seconds(_maxIdleTime));
-
-    //扫描整个队列，释放多余连接
-    std::unique_lock<std::mutex>lock(_queueMutex);
-    while(_connectionCnt > _initSize)
-    {
-        //获取队首连接
-        MySqlConnection *p = _connectionQue.front();
-        if(p->getAliveTime() > (_maxIdleTime*1000))
-        {
-          _connectionQue.pop();
-          _connectionCnt--;
-          // 释放连接，调用~MySqlConnection()
-          delete p;
+    shard->lastScan = nowMillis();
+    if(shard->hasReturned.load(std::memory_order_acquire)) {
+        drainReturned(shard);
+    }
+
+    const int64_t maxIdle = _maxIdleTime * 1000LL;
+    const int64_t pingAfter = _pingInterval * 1000LL;
+    const size_t minIdle = _minIdleConnections.load(std::memory_order_relaxed);
+    std::vector<MySqlConnection*> kept;
+    kept.reserve(shard->idle.size());
+    //队头是最早归还的连接
+    for(size_t i = 0; i < shard->idle.size(); ++i) {
+        MySqlConnection* conn = shard->idle[i];
+        size_t remaining = shard->idle.size() - i;
+        bool drop = conn->getAliveTime() > maxIdle && kept.size() + remaining > minIdle;
+        if(!drop && conn->getAliveTime() > pingAfter) {
+            try {
+                conn->Ping();
+            }
+            catch(const std::exception&) {
+                LOG_WARN << "MysqlConnectionPool drop broken connection";
+                drop = true;
+            }
         }
-        else
-        {
-          //队头元素未超时，则其余都不会超时
-          break;
+        if(drop) {
+            delete conn;
+            _connectionCnt--;
+        }
+        else {
+            kept.push_back(conn);
         }
     }
-  }
+    shard->idle.swap(kept);
 }
 
 
 } // namespace SqlConn
-
@@ -3,12 +3,10 @@
 #include "db/mysql/MysqlConnection.h"
 #include "db/mysql/MysqlConnConfig.h"
 #include <string>
-#include <queue>
+#include <vector>
 #include <mutex>
 #include <atomic>
 #include <memory>
-#include <functional>
-#include <condition_variable>
 
 
 namespace SqlConn
@@ -17,6 +15,19 @@ namespace SqlConn
 /*
 实现数据库连接池功能模块
 懒汉模式构造单例
+1、每个线程(一般是一个EventLoop线程)有自己的分片，借出和归还都在本线程完成时不加锁
+   连接在别的线程归还时放进分片的归还队列，由所属线程下次借出或者定时任务收回
+2、所属线程有EventLoop时在loop上注册定时任务，ping空闲较久的连接，关闭超过maxIdleTime的多余连接；
+   没有EventLoop的线程在借出连接时顺带完成这些检查
+3、连接在借出时已经连上_config指定的数据库，连接失败返回空指针
+4、连接缓存prepared statement，见MySqlConnection::SetStatementCacheSize
+e.g.
+    SqlConn::MysqlConnectionPool::_config = SqlConn::MysqlConnConfig("127.0.0.1", 3306, "chat", "root", "root");
+    std::shared_ptr<SqlConn::MySqlConnection> conn = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if(conn) {
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(conn->ExecuteReader("select name from user where id = ?", id));
+    }
+借出的连接和从它得到的MySqlDataReader只在借出的线程中使用
 */
 class MysqlConnectionPool
 {
@@ -24,29 +35,37 @@ public:
     //获取连接池对象实例
     static MysqlConnectionPool* getConnectionPool();
 
-    //从连接池中获取一个可用空闲连接
+    //从当前线程的分片中获取一个可用空闲连接，没有则新建
     std::shared_ptr<MySqlConnection> getConnection();
 
+    //以下参数在第一次getConnection之前设置
+    void setMaxIdleConnections(size_t n) { _maxIdleConnections = n; }   //每个分片最多保留的空闲连接
+    void setMinIdleConnections(size_t n) { _minIdleConnections = n; }   //每个分片空闲回收时至少保留的连接
+    void setMaxIdleTime(int seconds) { _maxIdleTime = seconds; }
+    void setPingInterval(int seconds) { _pingInterval = seconds; }
+    void setStatementCacheSize(size_t n) { _statementCacheSize = n; }
+
+    int createdConnections() const { return _connectionCnt.load(std::memory_order_relaxed); }
+
+    struct Shard;   //一个线程的空闲连接
+
 private:
     //构造函数私有化，单例
     MysqlConnectionPool();
 
-    //运行在独立线程中，专门负责生产新连接
-    void produceConnectionTask();
-
-    // 扫描超过maxIdleTime时间的空闲连接，进行回收
-    void scannerConnectionTask();
-
-    int _initSize;//连接池的初始连接量
-    int _maxSize;//连接池的最大连接量
-    int _maxIdleTime;//连接池的最大空闲时间
-    int _connectionTimeOut;//连接池获取连接的超时时间
-    
+    Shard* currentShard();
+    MySqlConnection* createConnection();
+    void release(const std::shared_ptr<Shard>& shard, MySqlConnection* conn);
+    void drainReturned(Shard* shard);
+    // 扫描分片的空闲连接：ping空闲超过pingInterval的，回收超过maxIdleTime的多余连接
+    void scanShard(Shard* shard);
 
-    std::queue<MySqlConnection*> _connectionQue;//存储mysql连接的队列
-    std::mutex _queueMutex;//维护连接队列的线程安全互斥锁
+    std::atomic<size_t> _maxIdleConnections;
+    std::atomic<size_t> _minIdleConnections;
+    std::atomic<int> _maxIdleTime;//连接池的最大空闲时间(秒)
+    std::atomic<int> _pingInterval;//空闲超过这个时间(秒)的连接在使用前先ping
+    std::atomic<size_t> _statementCacheSize;
     std::atomic_int _connectionCnt;//记录所创建的connection连接的总数量
-    std::condition_variable _cv;//用于线程间通信(生产者、消费者)的条件变量
 public:
     static MysqlConnConfig _config;
 };
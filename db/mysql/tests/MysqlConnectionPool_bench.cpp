@@ -0,0 +1,105 @@
+// 64个线程同时从连接池借出连接并执行同一条带参数的查询，统计借出和查询的延迟分布
+// 分别在prepared statement缓存打开和关闭时运行，对比每次查询重新prepare的代价
+// 用法: MysqlConnectionPool_bench [queries per thread] [host port user password dbname]
+
+#include "db/mysql/MysqlConnectionPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+  const int kThreads = 64;
+
+  int64_t nowNanos()
+  {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  void printPercentiles(const char* name, std::vector<int64_t>& samples)
+  {
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double p) {
+      return static_cast<double>(samples[static_cast<size_t>(p * static_cast<double>(samples.size() - 1))]) / 1000.0;
+    };
+    printf("  %-8s p50 %9.2f us  p99 %9.2f us  max %9.2f us\n", name, at(0.5), at(0.99), at(1.0));
+  }
+
+  void runRound(int queries, size_t statementCacheSize)
+  {
+    SqlConn::MysqlConnectionPool* pool = SqlConn::MysqlConnectionPool::getConnectionPool();
+    pool->setStatementCacheSize(statementCacheSize);
+
+    std::vector<std::vector<int64_t>> acquire(kThreads), query(kThreads);
+    std::vector<int> errors(kThreads, 0);
+    std::vector<std::thread> threads;
+    int64_t start = nowNanos();
+    for(int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([t, queries, pool, &acquire, &query, &errors]() {
+        acquire[t].reserve(static_cast<size_t>(queries));
+        query[t].reserve(static_cast<size_t>(queries));
+        for(int i = 0; i < queries; ++i) {
+          int64_t t0 = nowNanos();
+          std::shared_ptr<SqlConn::MySqlConnection> conn = pool->getConnection();
+          int64_t t1 = nowNanos();
+          if(!conn) {
+            ++errors[t];
+            continue;
+          }
+          try {
+            std::unique_ptr<SqlConn::MySqlDataReader> rd(conn->ExecuteReader("select ? + 1", i));
+            while(rd->Read()) {
+            }
+          }
+          catch(const std::exception&) {
+            ++errors[t];
+          }
+          int64_t t2 = nowNanos();
+          acquire[t].push_back(t1 - t0);
+          query[t].push_back(t2 - t1);
+        }
+      });
+    }
+    for(std::thread& thread : threads) {
+      thread.join();
+    }
+    double seconds = static_cast<double>(nowNanos() - start) / 1e9;
+
+    std::vector<int64_t> acquireAll, queryAll;
+    int errorCount = 0;
+    for(int t = 0; t < kThreads; ++t) {
+      acquireAll.insert(acquireAll.end(), acquire[t].begin(), acquire[t].end());
+      queryAll.insert(queryAll.end(), query[t].begin(), query[t].end());
+      errorCount += errors[t];
+    }
+    printf("statement cache %zu: %.0f queries/s, %d errors, %d connections\n",
+           statementCacheSize, static_cast<double>(queryAll.size()) / seconds, errorCount, pool->createdConnections());
+    if(!acquireAll.empty()) {
+      printPercentiles("acquire", acquireAll);
+      printPercentiles("query", queryAll);
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int queries = argc > 1 ? atoi(argv[1]) : 2000;
+  if(argc > 6) {
+    SqlConn::MysqlConnectionPool::_config = SqlConn::MysqlConnConfig(
+      argv[2], static_cast<unsigned short>(atoi(argv[3])), argv[6], argv[4], argv[5]);
+  }
+  else {
+    SqlConn::MysqlConnectionPool::_config = SqlConn::MysqlConnConfig("127.0.0.1", 3306, "chat", "root", "root");
+  }
+
+  printf("%d threads x %d queries\n", kThreads, queries);
+  // 每轮的线程都是新建的，各自的分片在线程退出时关闭连接
+  runRound(queries, 64);
+  runRound(queries, 0);
+}
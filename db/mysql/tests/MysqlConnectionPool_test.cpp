@@ -38,8 +38,7 @@ void usePoolFun1(int datasize)
     for (int i = 0; i < datasize; ++i)
     { 
         std::shared_ptr<SqlConn::MySqlConnection> sp = cp->getConnection();
-        sp->connect(SqlConn::MysqlConnectionPool::_config);
-        sp->ExecuteReader(sql);
+        sp->ExecuteNonQuery(sql);
     }
     auto end1 = std::chrono::high_resolution_clock::now();
 
@@ -184,6 +183,8 @@ void usePoolFun2(int datasize)
 
 int main()
 {   
+    SqlConn::MysqlConnectionPool::_config = SqlConn::MysqlConnConfig("127.0.0.1", 3306, "chat", "root", "root");
+
     //使用单线程测试数据量 1000、5000、10000
     noPoolFun1(1000);
     noPoolFun1(5000);
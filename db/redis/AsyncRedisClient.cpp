@@ -0,0 +1,228 @@
+#include "db/redis/AsyncRedisClient.h"
+
+#include "base/log/Logging.h"
+#include "net/EventLoop.h"
+
+#include <stdexcept>
+
+using namespace Miren;
+using namespace Miren::net;
+
+namespace RedisConn
+{
+    namespace
+    {
+        void fail(Promise<RedisReply>& promise, const char* reason)
+        {
+            promise.SetException(std::make_exception_ptr(std::runtime_error(reason)));
+        }
+    }
+
+    AsyncRedisClient::AsyncRedisClient(EventLoop* loop, const InetAddress& serverAddr, const std::string& name)
+        : loop_(loop),
+          client_(loop, serverAddr, name),
+          flushScheduled_(false),
+          connected_(false),
+          resp3_(false),
+          subscriptions_(0),
+          alive_(std::make_shared<bool>(true))
+    {
+        client_.setConnectionCallback(std::bind(&AsyncRedisClient::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&AsyncRedisClient::onMessage, this,
+                                             std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    }
+
+    AsyncRedisClient::~AsyncRedisClient()
+    {
+        loop_->assertInLoopThread();
+        failAll("redis client destroyed");
+    }
+
+    void AsyncRedisClient::connect()
+    {
+        client_.connect();
+    }
+
+    void AsyncRedisClient::disconnect()
+    {
+        client_.disconnect();
+    }
+
+    Future<RedisReply> AsyncRedisClient::command(std::initializer_list<std::string_view> args)
+    {
+        return submit(args.begin(), args.size(), kNormal);
+    }
+
+    Future<RedisReply> AsyncRedisClient::command(const std::vector<std::string>& args)
+    {
+        std::vector<std::string_view> views(args.begin(), args.end());
+        return submit(views.data(), views.size(), kNormal);
+    }
+
+    Future<RedisReply> AsyncRedisClient::submit(std::initializer_list<std::string_view> args, Kind kind)
+    {
+        return submit(args.begin(), args.size(), kind);
+    }
+
+    // loop线程中直接编码进output_；其他线程先编码成字符串，再交给loop线程
+    Future<RedisReply> AsyncRedisClient::submit(const std::string_view* args, size_t count, Kind kind)
+    {
+        Promise<RedisReply> promise;
+        Future<RedisReply> future = promise.GetFuture();
+        if(loop_->isInLoopThread()) {
+            if(!conn_) {
+                fail(promise, "redis not connected");
+                return future;
+            }
+            appendCommand(&output_, args, count);
+            enqueue(std::move(promise), kind);
+        }
+        else {
+            std::string encoded;
+            appendCommand(&encoded, args, count);
+            std::weak_ptr<bool> alive(alive_);
+            loop_->runInLoop([this, alive, encoded = std::move(encoded), promise, kind]() mutable {
+                if(!alive.lock()) {
+                    fail(promise, "redis client destroyed");
+                }
+                else if(!conn_) {
+                    fail(promise, "redis not connected");
+                }
+                else {
+                    output_.append(encoded.data(), encoded.size());
+                    enqueue(std::move(promise), kind);
+                }
+            });
+        }
+        return future;
+    }
+
+    // 本轮事件循环结束时一次发出，期间的命令(包括回复的回调里发出的)都在同一次send中
+    void AsyncRedisClient::enqueue(Promise<RedisReply> promise, Kind kind)
+    {
+        pending_.push_back(Pending{std::move(promise), kind});
+        if(!flushScheduled_) {
+            flushScheduled_ = true;
+            std::weak_ptr<bool> alive(alive_);
+            loop_->queueInLoop([this, alive]() {
+                if(alive.lock()) {
+                    flush();
+                }
+            });
+            // 事件回调中排队的任务本轮就会执行；在loop()之外(例如loop开始之前)发出的命令需要唤醒poll
+            if(!loop_->eventHandling()) {
+                loop_->wakeup();
+            }
+        }
+    }
+
+    void AsyncRedisClient::flush()
+    {
+        flushScheduled_ = false;
+        if(conn_ && output_.readableBytes() > 0) {
+            conn_->send(&output_);
+        }
+    }
+
+    void AsyncRedisClient::onConnection(const TcpConnectionPtr& conn)
+    {
+        LOG_INFO << "AsyncRedisClient " << conn->peerAddr().toIpPort() << " is "
+                 << (conn->connected() ? "UP" : "DOWN");
+        if(conn->connected()) {
+            conn->setTcpNoDelay(true);
+            conn_ = conn;
+            subscriptions_ = 0;
+            if(resp3_) {
+                appendCommand(&output_, {"HELLO", "3"});
+                enqueue(Promise<RedisReply>(), kInternal);
+            }
+            connected_.store(true, std::memory_order_release);
+        }
+        else {
+            connected_.store(false, std::memory_order_release);
+            conn_.reset();
+            failAll("redis connection closed");
+        }
+        if(connectionCallback_) {
+            connectionCallback_(conn->connected());
+        }
+    }
+
+    void AsyncRedisClient::onMessage(const TcpConnectionPtr& conn, Buffer* buf, base::Timestamp)
+    {
+        size_t consumed = 0;
+        RespParser::Result result;
+        while((result = parser_.parse(buf->peek(), buf->readableBytes(), &consumed)) == RespParser::kComplete) {
+            buf->retrieve(consumed);
+            onReply(parser_.takeReply());
+        }
+        buf->retrieve(consumed);
+        if(result == RespParser::kProtocolError) {
+            LOG_ERROR << "AsyncRedisClient protocol error from " << conn->peerAddr().toIpPort();
+            buf->retrieveAll();
+            conn->forceClose();
+        }
+    }
+
+    void AsyncRedisClient::onReply(RedisReply&& reply)
+    {
+        if(onPubSub(reply)) {
+            return;
+        }
+        if(pending_.empty()) {
+            LOG_WARN << "AsyncRedisClient unexpected reply, type " << reply.type;
+            return;
+        }
+        Promise<RedisReply> promise = std::move(pending_.front().promise);
+        pending_.pop_front();
+        promise.SetValue(std::move(reply));
+    }
+
+    // RESP3的push和订阅状态下RESP2的数组是pub/sub消息或者订阅确认，不对应普通命令
+    bool AsyncRedisClient::onPubSub(RedisReply& reply)
+    {
+        bool expectConfirm = !pending_.empty() && pending_.front().kind == kSubscribe;
+        if(!reply.isAggregate() || !(reply.type == RedisReply::kPush || subscriptions_ > 0 || expectConfirm)) {
+            return false;
+        }
+
+        std::vector<RedisReply>& e = reply.elements;
+        if((reply.headIs("message") || reply.headIs("smessage")) && e.size() >= 3) {
+            if(messageCallback_) {
+                messageCallback_(e[1].str, e[2].str);
+            }
+            return true;
+        }
+        if(reply.headIs("pmessage") && e.size() >= 4) {
+            if(messageCallback_) {
+                messageCallback_(e[2].str, e[3].str);
+            }
+            return true;
+        }
+        if(reply.headIs("subscribe") || reply.headIs("unsubscribe")
+           || reply.headIs("psubscribe") || reply.headIs("punsubscribe")) {
+            if(e.size() >= 3) {
+                subscriptions_ = e[2].integer;
+            }
+            if(expectConfirm) {
+                Promise<RedisReply> promise = std::move(pending_.front().promise);
+                pending_.pop_front();
+                promise.SetValue(std::move(reply));
+            }
+            return true;
+        }
+        // 其他push(例如客户端缓存的失效通知)忽略
+        return reply.type == RedisReply::kPush;
+    }
+
+    void AsyncRedisClient::failAll(const char* reason)
+    {
+        std::deque<Pending> pending;
+        pending.swap(pending_);
+        output_.retrieveAll();
+        parser_.reset();
+        for(Pending& p : pending) {
+            fail(p.promise, reason);
+        }
+    }
+}
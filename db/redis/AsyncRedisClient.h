@@ -0,0 +1,110 @@
+#pragma once
+
+#include "db/redis/RespParser.h"
+#include "future/Future.h"
+#include "net/Buffer.h"
+#include "net/TcpClient.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+
+namespace RedisConn
+{
+    /*
+    基于net::TcpClient的非阻塞Redis客户端，不占用IO线程等待回复
+    1、命令返回Future<RedisReply>，回复在loop线程中完成，Then的回调也在loop线程中执行
+       Redis返回的错误(-ERR ...)是isError()的回复，连接断开或者没有连接时Future以异常结束
+    2、同一轮事件循环中发出的命令合并成一次send(自动pipeline)，回复按发送顺序对应
+    3、pub/sub消息通过MessageCallback在loop线程中回调；RESP2下订阅后这个连接只能再发订阅相关的命令和PING
+    e.g.
+        AsyncRedisClient redis(loop, net::InetAddress("127.0.0.1", 6379));
+        redis.setConnectionCallback([&](bool connected) {
+            if(connected) {
+                redis.set("user:1", "miren");
+                redis.get("user:1").Then([](RedisReply&& reply) { ... });
+            }
+        });
+        redis.connect();
+    command系列函数可以跨线程调用；客户端必须在loop线程中析构
+    */
+    class AsyncRedisClient : Miren::base::NonCopyable
+    {
+    public:
+        typedef std::function<void (const std::string& channel, const std::string& message)> MessageCallback;
+        typedef std::function<void (bool connected)> ConnectionCallback;
+
+        AsyncRedisClient(Miren::net::EventLoop* loop, const Miren::net::InetAddress& serverAddr,
+                         const std::string& name = "AsyncRedisClient");
+        ~AsyncRedisClient();
+
+        void connect();
+        void disconnect();
+        bool connected() const { return connected_.load(std::memory_order_acquire); }
+        void enableRetry() { client_.enableRetry(); }
+        // 连接建立后先发送HELLO 3切换到RESP3，pub/sub消息以push类型到达，订阅后仍然可以执行普通命令
+        void setResp3(bool on) { resp3_ = on; }
+
+        // 在loop线程中回调
+        void setConnectionCallback(ConnectionCallback cb) { connectionCallback_ = std::move(cb); }
+        void setMessageCallback(MessageCallback cb) { messageCallback_ = std::move(cb); }
+
+        Miren::Future<RedisReply> command(std::initializer_list<std::string_view> args);
+        Miren::Future<RedisReply> command(const std::vector<std::string>& args);
+
+        Miren::Future<RedisReply> get(std::string_view key) { return command({"GET", key}); }
+        Miren::Future<RedisReply> set(std::string_view key, std::string_view value) { return command({"SET", key, value}); }
+        Miren::Future<RedisReply> del(std::string_view key) { return command({"DEL", key}); }
+        Miren::Future<RedisReply> publish(std::string_view channel, std::string_view message)
+        {
+            return command({"PUBLISH", channel, message});
+        }
+
+        // 一次订阅一个通道，Future在收到订阅确认后完成
+        Miren::Future<RedisReply> subscribe(std::string_view channel) { return submit({"SUBSCRIBE", channel}, kSubscribe); }
+        Miren::Future<RedisReply> unsubscribe(std::string_view channel) { return submit({"UNSUBSCRIBE", channel}, kSubscribe); }
+        Miren::Future<RedisReply> psubscribe(std::string_view pattern) { return submit({"PSUBSCRIBE", pattern}, kSubscribe); }
+        Miren::Future<RedisReply> punsubscribe(std::string_view pattern) { return submit({"PUNSUBSCRIBE", pattern}, kSubscribe); }
+
+        size_t pendingCount() const { return pending_.size(); }    //等待回复的命令个数，只能在loop线程中调用
+
+    private:
+        enum Kind
+        {
+            kNormal,
+            kSubscribe,     //回复是订阅确认
+            kInternal,      //HELLO，没有人等待
+        };
+
+        struct Pending
+        {
+            Miren::Promise<RedisReply> promise;
+            Kind kind;
+        };
+
+        Miren::Future<RedisReply> submit(std::initializer_list<std::string_view> args, Kind kind);
+        Miren::Future<RedisReply> submit(const std::string_view* args, size_t count, Kind kind);
+        void enqueue(Miren::Promise<RedisReply> promise, Kind kind);
+        void flush();
+        void onConnection(const Miren::net::TcpConnectionPtr& conn);
+        void onMessage(const Miren::net::TcpConnectionPtr& conn, Miren::net::Buffer* buf, Miren::base::Timestamp);
+        void onReply(RedisReply&& reply);
+        bool onPubSub(RedisReply& reply);
+        void failAll(const char* reason);
+
+        Miren::net::EventLoop* loop_;
+        Miren::net::TcpClient client_;
+        Miren::net::TcpConnectionPtr conn_;
+        RespParser parser_;
+        Miren::net::Buffer output_;         //还没有发出的命令
+        std::deque<Pending> pending_;       //已经写入output_、等待回复的命令，和回复一一对应
+        bool flushScheduled_;
+        std::atomic<bool> connected_;
+        bool resp3_;
+        int64_t subscriptions_;             //服务器确认的订阅数，RESP2下大于0时连接处于订阅状态
+        MessageCallback messageCallback_;
+        ConnectionCallback connectionCallback_;
+        std::shared_ptr<bool> alive_;       //排队中的任务在客户端析构后不再执行
+    };
+}
@@ -36,6 +36,7 @@ namespace RedisConn
     }
 
     bool RedisPubSub::publish(int channel, const std::string& message) {
+        std::lock_guard<std::mutex> lock(publishMutex_);
         redisReply* reply = (redisReply*) redisCommand(publishContext_, "PUBLISH %d %s", channel, message.c_str());
         if(reply == nullptr) {
             LOG_ERROR << "publish " << message << " failed!";
@@ -45,6 +46,28 @@ namespace RedisConn
         return true;
     }
 
+    bool RedisPubSub::publish(const std::vector<int>& channels, const std::string& message) {
+        std::lock_guard<std::mutex> lock(publishMutex_);
+        for(int channel : channels) {
+            if(REDIS_ERR == redisAppendCommand(publishContext_, "PUBLISH %d %b", channel, message.data(), message.size())) {
+                LOG_ERROR << "publish to " << channels.size() << " channels failed!";
+                return false;
+            }
+        }
+        //第一次redisGetReply把缓存的命令全部写出
+        bool ok = true;
+        for(size_t i = 0; i < channels.size(); ++i) {
+            redisReply* reply = nullptr;
+            if(REDIS_OK != redisGetReply(publishContext_, (void**)&reply)) {
+                LOG_ERROR << "publish to " << channels.size() << " channels failed!";
+                return false;
+            }
+            ok = ok && reply->type != REDIS_REPLY_ERROR;
+            freeReplyObject(reply);
+        }
+        return ok;
+    }
+
     //subscribe命令本身会造成线程阻塞，等待通道里面发生消息，这里只做订阅通道，不接收通道消息
     //通道消息的接收专门在observer_channel_message函数中独立线程中运行
     //只负责发送命令，不阻塞接收redis server响应消息，否则和notifyMsg线程抢占响应资源
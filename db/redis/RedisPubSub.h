@@ -2,6 +2,8 @@
 
 #include <hiredis/hiredis.h>
 #include <string>
+#include <vector>
+#include <mutex>
 #include <functional>
 
 #include "db/redis/RedisConn.h"
@@ -20,6 +22,9 @@ namespace RedisConn
         //向redis指定的通道channel发布消息
         bool publish(int channel, const std::string& message);
 
+        //向多个通道发布同一条消息，命令一次写出(pipeline)，再依次读取回复
+        bool publish(const std::vector<int>& channels, const std::string& message);
+
         //向redis指定通道订阅消息
         bool subscribe(int channel);
 
@@ -33,8 +38,9 @@ namespace RedisConn
         void initNotifyHandler(std::function<void(int, std::string)> fn);
 
     private:
-        //负责publish消息
+        //负责publish消息，可能在多个IO线程中使用
         redisContext* publishContext_;
+        std::mutex publishMutex_;
         //负责subscribe消息
         redisContext* subscribeContext_;
         //回调操作，收到订阅的消息，给service层上报
@@ -0,0 +1,246 @@
+#include "db/redis/RespParser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+
+namespace RedisConn
+{
+    namespace
+    {
+        const size_t kMaxReserve = 1024;     //聚合类预留的元素个数上限，防止伪造的长度一次申请大量内存
+
+        const char* findCRLF(const char* data, size_t len)
+        {
+            const char* end = data + len;
+            const char* p = data;
+            while(p < end) {
+                p = static_cast<const char*>(::memchr(p, '\r', static_cast<size_t>(end - p)));
+                if(p == nullptr || p + 1 >= end) {
+                    return nullptr;
+                }
+                if(p[1] == '\n') {
+                    return p;
+                }
+                ++p;
+            }
+            return nullptr;
+        }
+
+        bool parseInteger(const char* begin, const char* end, int64_t* value)
+        {
+            auto result = std::from_chars(begin, end, *value);
+            return result.ec == std::errc() && result.ptr == end && begin != end;
+        }
+
+        bool parseDouble(const char* begin, const char* end, double* value)
+        {
+            // strtod需要'\0'结尾，"inf"、"-inf"和"nan"也由它处理
+            std::string text(begin, end);
+            char* stop = nullptr;
+            *value = ::strtod(text.c_str(), &stop);
+            return !text.empty() && stop == text.c_str() + text.size();
+        }
+    }
+
+    bool RedisReply::headIs(std::string_view name) const
+    {
+        if(!isAggregate() || elements.empty()) {
+            return false;
+        }
+        const RedisReply& head = elements[0];
+        if(head.type != kString && head.type != kStatus) {
+            return false;
+        }
+        return head.str.size() == name.size() && ::strncasecmp(head.str.data(), name.data(), name.size()) == 0;
+    }
+
+    RespParser::RespParser()
+        : done_(false)
+    {
+    }
+
+    void RespParser::reset()
+    {
+        root_ = RedisReply();
+        stack_.clear();
+        done_ = false;
+    }
+
+    RedisReply RespParser::takeReply()
+    {
+        RedisReply reply = std::move(root_);
+        reset();
+        return reply;
+    }
+
+    RespParser::Result RespParser::parse(const char* data, size_t len, size_t* consumed)
+    {
+        if(done_) {
+            reset();        //上一个回复没有取走
+        }
+        size_t pos = 0;
+        while(true) {
+            RedisReply element;
+            size_t used = 0;
+            int64_t count = -1;
+            Result result = parseElement(data + pos, len - pos, &element, &used, &count);
+            if(result != kComplete) {
+                if(result == kProtocolError) {
+                    reset();
+                }
+                *consumed = pos;
+                return result;
+            }
+            pos += used;
+
+            RedisReply* node;
+            if(stack_.empty()) {
+                root_ = std::move(element);
+                node = &root_;
+            }
+            else {
+                // 父节点在这个元素完成之前不会再追加，node不会因为扩容失效
+                std::vector<RedisReply>& elements = stack_.back().reply->elements;
+                elements.push_back(std::move(element));
+                node = &elements.back();
+            }
+
+            if(count > 0) {
+                node->elements.reserve(std::min(static_cast<size_t>(count), kMaxReserve));
+                stack_.push_back(Frame{node, static_cast<size_t>(count)});
+                continue;
+            }
+
+            // 叶子或者空的聚合：逐层向上，父节点的元素齐了父节点也就完成了
+            // 完成的属性从父节点删除(顶层的清空root_)，父节点还在等下一个元素
+            bool attribute = node->type == RedisReply::kAttribute;
+            while(true) {
+                if(attribute) {
+                    if(stack_.empty()) {
+                        root_ = RedisReply();
+                    }
+                    else {
+                        stack_.back().reply->elements.pop_back();
+                    }
+                    break;
+                }
+                if(stack_.empty()) {
+                    done_ = true;
+                    *consumed = pos;
+                    return kComplete;
+                }
+                if(--stack_.back().remaining != 0) {
+                    break;
+                }
+                attribute = stack_.back().reply->type == RedisReply::kAttribute;
+                stack_.pop_back();
+            }
+        }
+    }
+
+    RespParser::Result RespParser::parseElement(const char* data, size_t len, RedisReply* reply, size_t* used, int64_t* count)
+    {
+        const char* crlf = len > 0 ? findCRLF(data, len) : nullptr;
+        if(crlf == nullptr) {
+            return kIncomplete;
+        }
+        const char* line = data + 1;
+        const size_t headerLen = static_cast<size_t>(crlf - data) + 2;
+        const char type = data[0];
+        *used = headerLen;
+
+        switch(type) {
+        case '+':
+            reply->type = RedisReply::kStatus;
+            reply->str.assign(line, crlf);
+            return kComplete;
+        case '-':
+            reply->type = RedisReply::kError;
+            reply->str.assign(line, crlf);
+            return kComplete;
+        case '(':
+            reply->type = RedisReply::kBigNumber;
+            reply->str.assign(line, crlf);
+            return kComplete;
+        case ':':
+            reply->type = RedisReply::kInteger;
+            return parseInteger(line, crlf, &reply->integer) ? kComplete : kProtocolError;
+        case ',':
+            reply->type = RedisReply::kDouble;
+            return parseDouble(line, crlf, &reply->dbl) ? kComplete : kProtocolError;
+        case '#':
+            if(crlf - line != 1 || (*line != 't' && *line != 'f')) {
+                return kProtocolError;
+            }
+            reply->type = RedisReply::kBool;
+            reply->integer = *line == 't';
+            return kComplete;
+        case '_':
+            reply->type = RedisReply::kNil;
+            return kComplete;
+        case '$':
+        case '!':
+        case '=': {
+            int64_t n;
+            if(!parseInteger(line, crlf, &n)) {
+                return kProtocolError;
+            }
+            if(n == -1 && type == '$') {
+                reply->type = RedisReply::kNil;
+                return kComplete;
+            }
+            if(n < 0) {
+                return kProtocolError;
+            }
+            size_t size = static_cast<size_t>(n);
+            if(len - headerLen < size + 2) {
+                return kIncomplete;
+            }
+            const char* body = data + headerLen;
+            if(body[size] != '\r' || body[size + 1] != '\n') {
+                return kProtocolError;
+            }
+            *used = headerLen + size + 2;
+            if(type == '=') {
+                // 去掉"txt:"格式前缀
+                if(size < 4) {
+                    return kProtocolError;
+                }
+                body += 4;
+                size -= 4;
+            }
+            reply->type = type == '$' ? RedisReply::kString : type == '!' ? RedisReply::kError : RedisReply::kVerbatim;
+            reply->str.assign(body, size);
+            return kComplete;
+        }
+        case '*':
+        case '~':
+        case '>':
+        case '%':
+        case '|': {
+            int64_t n;
+            if(!parseInteger(line, crlf, &n)) {
+                return kProtocolError;
+            }
+            if(n == -1 && type == '*') {
+                reply->type = RedisReply::kNil;
+                return kComplete;
+            }
+            if(n < 0 || n > (INT64_MAX / 2)) {
+                return kProtocolError;
+            }
+            reply->type = type == '*' ? RedisReply::kArray
+                        : type == '~' ? RedisReply::kSet
+                        : type == '>' ? RedisReply::kPush
+                        : type == '%' ? RedisReply::kMap : RedisReply::kAttribute;
+            *count = type == '%' || type == '|' ? n * 2 : n;
+            return kComplete;
+        }
+        default:
+            return kProtocolError;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "base/FastFormat.h"
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+namespace RedisConn
+{
+    /*
+    RESP2/RESP3的一个回复
+    字符串类(status/error/bulk/verbatim/big number)放在str，integer和boolean放在integer，double放在dbl
+    聚合类(array/set/push/map)放在elements，map按k1,v1,k2,v2...平铺
+    */
+    struct RedisReply
+    {
+        enum Type
+        {
+            kNil,
+            kStatus,
+            kError,
+            kString,
+            kInteger,
+            kDouble,
+            kBool,
+            kBigNumber,
+            kVerbatim,
+            kArray,
+            kMap,
+            kSet,
+            kPush,
+            kAttribute,     //只在解析时使用，RESP3的属性解析完后丢弃，不会出现在回复中
+        };
+
+        Type type = kNil;
+        std::string str;
+        int64_t integer = 0;
+        double dbl = 0;
+        std::vector<RedisReply> elements;
+
+        bool isNil() const { return type == kNil; }
+        bool isError() const { return type == kError; }
+        bool isAggregate() const { return type == kArray || type == kMap || type == kSet || type == kPush; }
+        // 聚合类的第一个元素是否为字符串name(忽略大小写)，用于识别pub/sub消息
+        bool headIs(std::string_view name) const;
+    };
+
+    /*
+    增量的RESP解析器，数据可以分多次到达
+    每次parse只消费完整的元素，聚合类已经解析出的元素保留在解析器中，下次从中断处继续，不重新扫描
+    RESP3的属性(|)可以出现在任何元素之前，解析完后丢弃，不计入父节点的元素个数
+    e.g.
+        size_t consumed = 0;
+        while(parser.parse(buf->peek(), buf->readableBytes(), &consumed) == RespParser::kComplete) {
+            buf->retrieve(consumed);
+            handle(parser.takeReply());
+        }
+        buf->retrieve(consumed);
+    */
+    class RespParser
+    {
+    public:
+        enum Result
+        {
+            kComplete,          //解析出一个完整的回复，用takeReply取走
+            kIncomplete,        //需要更多数据
+            kProtocolError,     //不是合法的RESP，连接应该关闭
+        };
+
+        RespParser();
+
+        Result parse(const char* data, size_t len, size_t* consumed);
+        RedisReply takeReply();
+        void reset();
+
+    private:
+        struct Frame
+        {
+            RedisReply* reply;
+            size_t remaining;
+        };
+
+        // 解析一个元素的头部(和bulk的内容)，聚合类通过count返回还需要的子元素个数
+        Result parseElement(const char* data, size_t len, RedisReply* reply, size_t* used, int64_t* count);
+
+        RedisReply root_;
+        std::vector<Frame> stack_;
+        bool done_;
+    };
+
+    // 把命令编码成RESP的bulk数组追加到out，out需要append(const char*, size_t)，net::Buffer和std::string都可以
+    template<class Output>
+    void appendCommand(Output* out, const std::string_view* args, size_t count)
+    {
+        char num[Miren::base::FastFormat::kMaxIntegerLength];
+        out->append("*", 1);
+        out->append(num, Miren::base::FastFormat::formatUnsigned(num, count));
+        out->append("\r\n", 2);
+        for(size_t i = 0; i < count; ++i) {
+            out->append("$", 1);
+            out->append(num, Miren::base::FastFormat::formatUnsigned(num, args[i].size()));
+            out->append("\r\n", 2);
+            out->append(args[i].data(), args[i].size());
+            out->append("\r\n", 2);
+        }
+    }
+
+    template<class Output>
+    void appendCommand(Output* out, std::initializer_list<std::string_view> args)
+    {
+        appendCommand(out, args.begin(), args.size());
+    }
+}
@@ -0,0 +1,236 @@
+#include "db/redis/AsyncRedisClient.h"
+#include "db/redis/tests/RespStubServer.h"
+#include "base/log/Logging.h"
+#include "net/EventLoop.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <unistd.h>
+
+using namespace Miren;
+using namespace RedisConn;
+
+namespace
+{
+  uint16_t testPort()
+  {
+    return static_cast<uint16_t>(20000 + ::getpid() % 20000);
+  }
+
+  // 一次喂一个字节，直到解析出完整的回复
+  RespParser::Result feedByBytes(RespParser* parser, const std::string& data, RedisReply* reply)
+  {
+    std::string pending;
+    for(char c : data) {
+      pending.push_back(c);
+      size_t consumed = 0;
+      RespParser::Result result = parser->parse(pending.data(), pending.size(), &consumed);
+      pending.erase(0, consumed);
+      if(result != RespParser::kIncomplete) {
+        if(result == RespParser::kComplete) {
+          *reply = parser->takeReply();
+        }
+        return result;
+      }
+    }
+    return RespParser::kIncomplete;
+  }
+}
+
+// 嵌套的聚合类分成单个字节到达
+TEST(RespParserTest, parsesIncrementally)
+{
+  RespParser parser;
+  RedisReply reply;
+  ASSERT_EQ(feedByBytes(&parser, "*4\r\n$3\r\nfoo\r\n%1\r\n+k\r\n:-5\r\n*-1\r\n*0\r\n", &reply), RespParser::kComplete);
+  ASSERT_EQ(reply.type, RedisReply::kArray);
+  ASSERT_EQ(reply.elements.size(), 4u);
+  EXPECT_EQ(reply.elements[0].str, "foo");
+  ASSERT_EQ(reply.elements[1].type, RedisReply::kMap);
+  ASSERT_EQ(reply.elements[1].elements.size(), 2u);
+  EXPECT_EQ(reply.elements[1].elements[0].str, "k");
+  EXPECT_EQ(reply.elements[1].elements[1].integer, -5);
+  EXPECT_TRUE(reply.elements[2].isNil());
+  EXPECT_EQ(reply.elements[3].type, RedisReply::kArray);
+  EXPECT_TRUE(reply.elements[3].elements.empty());
+}
+
+TEST(RespParserTest, parsesResp3Types)
+{
+  const char data[] = ",3.5\r\n#t\r\n_\r\n=8\r\ntxt:abcd\r\n(12345678901234567890\r\n!3\r\nbad\r\n>2\r\n+a\r\n$1\r\nb\r\n";
+  RespParser parser;
+  size_t offset = 0;
+  std::vector<RedisReply> replies;
+  size_t consumed = 0;
+  while(parser.parse(data + offset, sizeof data - 1 - offset, &consumed) == RespParser::kComplete) {
+    offset += consumed;
+    replies.push_back(parser.takeReply());
+  }
+  ASSERT_EQ(replies.size(), 7u);
+  EXPECT_DOUBLE_EQ(replies[0].dbl, 3.5);
+  EXPECT_EQ(replies[1].type, RedisReply::kBool);
+  EXPECT_EQ(replies[1].integer, 1);
+  EXPECT_TRUE(replies[2].isNil());
+  EXPECT_EQ(replies[3].type, RedisReply::kVerbatim);
+  EXPECT_EQ(replies[3].str, "abcd");
+  EXPECT_EQ(replies[4].type, RedisReply::kBigNumber);
+  EXPECT_TRUE(replies[5].isError());
+  EXPECT_EQ(replies[5].str, "bad");
+  EXPECT_EQ(replies[6].type, RedisReply::kPush);
+  EXPECT_TRUE(replies[6].headIs("A"));
+}
+
+// 属性在顶层回复和聚合的元素之前，值也可以是聚合，解析后丢弃
+TEST(RespParserTest, skipsAttributes)
+{
+  RespParser parser;
+  RedisReply reply;
+  ASSERT_EQ(feedByBytes(&parser, "|1\r\n+key-popularity\r\n%1\r\n$1\r\na\r\n,0.19\r\n"
+                                 "*2\r\n:2039123\r\n|1\r\n+ttl\r\n:3600\r\n:9543892\r\n", &reply),
+            RespParser::kComplete);
+  ASSERT_EQ(reply.type, RedisReply::kArray);
+  ASSERT_EQ(reply.elements.size(), 2u);
+  EXPECT_EQ(reply.elements[0].integer, 2039123);
+  EXPECT_EQ(reply.elements[1].integer, 9543892);
+
+  // 空属性和属性之后的下一个回复在同一块数据中
+  const char data[] = "|0\r\n+OK\r\n|1\r\n+a\r\n|1\r\n+b\r\n+c\r\n+d\r\n:1\r\n";
+  size_t offset = 0;
+  size_t consumed = 0;
+  std::vector<RedisReply> replies;
+  while(parser.parse(data + offset, sizeof data - 1 - offset, &consumed) == RespParser::kComplete) {
+    offset += consumed;
+    replies.push_back(parser.takeReply());
+  }
+  EXPECT_EQ(offset, sizeof data - 1);
+  ASSERT_EQ(replies.size(), 2u);
+  EXPECT_EQ(replies[0].type, RedisReply::kStatus);
+  EXPECT_EQ(replies[0].str, "OK");
+  EXPECT_EQ(replies[1].type, RedisReply::kInteger);
+  EXPECT_EQ(replies[1].integer, 1);
+}
+
+TEST(RespParserTest, rejectsGarbage)
+{
+  RespParser parser;
+  size_t consumed = 0;
+  EXPECT_EQ(parser.parse("?x\r\n", 4, &consumed), RespParser::kProtocolError);
+  EXPECT_EQ(parser.parse(":12a\r\n", 6, &consumed), RespParser::kProtocolError);
+  EXPECT_EQ(parser.parse("$3\r\nabcd\r\n", 10, &consumed), RespParser::kProtocolError);
+}
+
+TEST(RespParserTest, encodesCommands)
+{
+  std::string out;
+  appendCommand(&out, {"SET", "key", ""});
+  EXPECT_EQ(out, "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$0\r\n\r\n");
+}
+
+// 回调中发出1000个INCR，同一轮循环里合并发送，回复按顺序对应
+TEST(AsyncRedisClientTest, pipelinesCommands)
+{
+  RespStubServer server(testPort());
+  net::EventLoop loop;
+  AsyncRedisClient redis(&loop, server.address());
+  const int kCount = 1000;
+  int completed = 0;
+  bool ordered = true;
+  std::string value;
+  bool errorReply = false;
+
+  redis.setConnectionCallback([&](bool connected) {
+    if(!connected) {
+      return;
+    }
+    redis.set("text", "hello");
+    redis.get("text").Then([&](RedisReply&& reply) { value = reply.str; });
+    redis.command({"INCR", "text"}).Then([&](RedisReply&& reply) { errorReply = reply.isError(); });
+    for(int i = 1; i <= kCount; ++i) {
+      redis.command({"INCR", "counter"}).Then([&, i](RedisReply&& reply) {
+        ordered = ordered && reply.integer == i;
+        if(++completed == kCount) {
+          loop.quit();
+        }
+      });
+    }
+    EXPECT_EQ(redis.pendingCount(), static_cast<size_t>(kCount + 3));
+  });
+  loop.runAfter(5.0, [&]() { loop.quit(); });
+  redis.connect();
+  loop.loop();
+
+  EXPECT_EQ(completed, kCount);
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(value, "hello");
+  EXPECT_TRUE(errorReply);
+  redis.disconnect();
+}
+
+// 订阅的消息通过MessageCallback在loop线程中到达，RESP2和RESP3都支持
+TEST(AsyncRedisClientTest, deliversPubSub)
+{
+  for(bool resp3 : {false, true}) {
+    RespStubServer server(testPort());
+    net::EventLoop loop;
+    AsyncRedisClient subscriber(&loop, server.address());
+    AsyncRedisClient publisher(&loop, server.address());
+    subscriber.setResp3(resp3);
+    std::vector<std::string> messages;
+    bool pingAfterSubscribe = false;
+
+    subscriber.setMessageCallback([&](const std::string& channel, const std::string& message) {
+      messages.push_back(channel + ":" + message);
+      if(messages.size() == 2) {
+        loop.quit();
+      }
+    });
+    subscriber.setConnectionCallback([&](bool connected) {
+      if(!connected) {
+        return;
+      }
+      subscriber.subscribe("news").Then([&](RedisReply&& reply) {
+        EXPECT_TRUE(reply.headIs("subscribe"));
+        // RESP2订阅状态下redis回复["pong", ""]，RESP3下是普通的+PONG
+        subscriber.command({"PING"}).Then([&, resp3](RedisReply&& pong) {
+          pingAfterSubscribe = resp3 ? pong.str == "PONG"
+                                     : pong.headIs("pong") && pong.elements.size() == 2 && pong.elements[1].str.empty();
+        });
+        publisher.connect();
+      });
+    });
+    publisher.setConnectionCallback([&](bool connected) {
+      if(connected) {
+        publisher.publish("news", "first");
+        publisher.publish("other", "ignored");
+        publisher.publish("news", "second");
+      }
+    });
+    loop.runAfter(5.0, [&]() { loop.quit(); });
+    subscriber.connect();
+    loop.loop();
+
+    ASSERT_EQ(messages.size(), 2u) << "resp3 " << resp3;
+    EXPECT_EQ(messages[0], "news:first");
+    EXPECT_EQ(messages[1], "news:second");
+    EXPECT_TRUE(pingAfterSubscribe);
+    subscriber.disconnect();
+    publisher.disconnect();
+  }
+}
+
+// 没有连接时命令立即以异常结束，连接断开时未完成的命令也是
+TEST(AsyncRedisClientTest, failsWithoutConnection)
+{
+  net::EventLoop loop;
+  AsyncRedisClient redis(&loop, net::InetAddress(testPort(), true));
+  Try<RedisReply> result = redis.get("key").Wait();
+  EXPECT_TRUE(result.HasException());
+}
+
+int main(int argc, char** argv)
+{
+  log::Logger::setLogLevel(log::Logger::WARN);
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
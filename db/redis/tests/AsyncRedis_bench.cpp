@@ -0,0 +1,89 @@
+// AsyncRedisClient在不同pipeline深度下的吞吐：始终保持depth个命令在途，一个回复到达就补发一个
+// 用法: AsyncRedis_bench [requests] [host port]   不给地址时使用进程内的RespStubServer
+
+#include "db/redis/AsyncRedisClient.h"
+#include "db/redis/tests/RespStubServer.h"
+#include "base/Clock.h"
+#include "base/log/Logging.h"
+#include "net/EventLoop.h"
+
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace Miren;
+using namespace RedisConn;
+
+namespace
+{
+  struct Round
+  {
+    int depth = 0;
+    int total = 0;
+    int sent = 0;
+    int done = 0;
+    int errors = 0;
+    int64_t start = 0;
+  };
+
+  void issue(AsyncRedisClient* redis, net::EventLoop* loop, Round* round)
+  {
+    ++round->sent;
+    redis->set("bench:key", "0123456789abcdef").Then([redis, loop, round](Try<RedisReply>&& reply) {
+      if(reply.HasException() || reply.Value().isError()) {
+        ++round->errors;
+      }
+      if(++round->done == round->total) {
+        loop->quit();
+      }
+      else if(round->sent < round->total) {
+        issue(redis, loop, round);
+      }
+    });
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  const int requests = argc > 1 ? atoi(argv[1]) : 200000;
+  log::Logger::setLogLevel(log::Logger::WARN);
+
+  std::unique_ptr<RespStubServer> stub;
+  net::InetAddress address;
+  if(argc > 3) {
+    address = net::InetAddress(argv[2], static_cast<uint16_t>(atoi(argv[3])));
+  }
+  else {
+    stub.reset(new RespStubServer(static_cast<uint16_t>(20000 + ::getpid() % 20000)));
+    address = stub->address();
+  }
+
+  net::EventLoop loop;
+  AsyncRedisClient redis(&loop, address);
+  redis.setConnectionCallback([&loop](bool) { loop.quit(); });
+  redis.connect();
+  loop.loop();
+  if(!redis.connected()) {
+    fprintf(stderr, "cannot connect to %s\n", address.toIpPort().c_str());
+    return 1;
+  }
+
+  printf("%-8s %12s %10s\n", "depth", "ops/s", "us/op");
+  for(int depth : {1, 4, 16, 64, 256}) {
+    Round round;
+    round.depth = depth;
+    round.total = requests;
+    round.start = base::Clock::monotonicNanos();
+    loop.runInLoop([&]() {
+      for(int i = 0; i < depth && round.sent < round.total; ++i) {
+        issue(&redis, &loop, &round);
+      }
+    });
+    loop.loop();
+    double seconds = static_cast<double>(base::Clock::monotonicNanos() - round.start) / 1e9;
+    printf("%-8d %12.0f %10.2f%s\n", depth, round.done / seconds, seconds * 1e6 / round.done,
+           round.errors ? "  (errors)" : "");
+  }
+  redis.disconnect();
+}
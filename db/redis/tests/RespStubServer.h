@@ -0,0 +1,216 @@
+#pragma once
+
+// 进程内的RESP服务器，供AsyncRedisClient的测试和压测使用，不需要真实的redis-server
+// 只实现了PING ECHO SET GET DEL INCR HELLO SUBSCRIBE UNSUBSCRIBE PUBLISH，数据放在内存中
+
+#include "db/redis/RespParser.h"
+#include "base/thread/CountDownLatch.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include "net/TcpServer.h"
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+class RespStubServer : Miren::base::NonCopyable
+{
+public:
+  explicit RespStubServer(uint16_t port)
+    : address_(port, true),
+      loop_(thread_.startLoop())
+  {
+    Miren::base::CountDownLatch latch(1);
+    loop_->runInLoop([this, &latch]() {
+      server_.reset(new Miren::net::TcpServer(loop_, address_, "RespStubServer"));
+      server_->setConnectionCallback([this](const Miren::net::TcpConnectionPtr& conn) { onConnection(conn); });
+      server_->setMessageCallback([this](const Miren::net::TcpConnectionPtr& conn, Miren::net::Buffer* buf,
+                                         Miren::base::Timestamp) { onMessage(conn, buf); });
+      server_->start();
+      latch.countDown();
+    });
+    latch.wait();
+  }
+
+  ~RespStubServer()
+  {
+    Miren::base::CountDownLatch latch(1);
+    loop_->runInLoop([this, &latch]() {
+      sessions_.clear();
+      server_.reset();
+      latch.countDown();
+    });
+    latch.wait();
+  }
+
+  const Miren::net::InetAddress& address() const { return address_; }
+
+private:
+  struct Session
+  {
+    RedisConn::RespParser parser;
+    bool resp3 = false;
+    std::set<std::string> channels;
+  };
+
+  void onConnection(const Miren::net::TcpConnectionPtr& conn)
+  {
+    if(conn->connected()) {
+      conn->setTcpNoDelay(true);
+      sessions_[conn] = std::make_shared<Session>();
+    }
+    else {
+      sessions_.erase(conn);
+    }
+  }
+
+  void onMessage(const Miren::net::TcpConnectionPtr& conn, Miren::net::Buffer* buf)
+  {
+    auto it = sessions_.find(conn);
+    if(it == sessions_.end()) {
+      return;
+    }
+    std::shared_ptr<Session> session = it->second;
+    Miren::net::Buffer output;
+    size_t consumed = 0;
+    RedisConn::RespParser::Result result;
+    while((result = session->parser.parse(buf->peek(), buf->readableBytes(), &consumed))
+          == RedisConn::RespParser::kComplete) {
+      buf->retrieve(consumed);
+      execute(*session, session->parser.takeReply(), &output);
+    }
+    buf->retrieve(consumed);
+    if(result == RedisConn::RespParser::kProtocolError) {
+      conn->forceClose();
+      return;
+    }
+    if(output.readableBytes() > 0) {
+      conn->send(&output);
+    }
+  }
+
+  static void status(Miren::net::Buffer* out, const std::string& s) { out->append("+" + s + "\r\n"); }
+  static void error(Miren::net::Buffer* out, const std::string& s) { out->append("-" + s + "\r\n"); }
+  static void integer(Miren::net::Buffer* out, int64_t n) { out->append(":" + std::to_string(n) + "\r\n"); }
+  static void bulk(Miren::net::Buffer* out, const std::string& s)
+  {
+    out->append("$" + std::to_string(s.size()) + "\r\n" + s + "\r\n");
+  }
+  static void nil(const Session& session, Miren::net::Buffer* out) { out->append(session.resp3 ? "_\r\n" : "$-1\r\n"); }
+  // 订阅确认和消息：RESP3是push，RESP2是数组
+  static void pubsub(const Session& session, Miren::net::Buffer* out, const char* kind, const std::string& channel)
+  {
+    out->append(std::string(session.resp3 ? ">" : "*") + "3\r\n");
+    bulk(out, kind);
+    bulk(out, channel);
+  }
+
+  void execute(Session& session, const RedisConn::RedisReply& request, Miren::net::Buffer* out)
+  {
+    if(request.type != RedisConn::RedisReply::kArray || request.elements.empty()) {
+      error(out, "ERR protocol error");
+      return;
+    }
+    const std::vector<RedisConn::RedisReply>& args = request.elements;
+    std::string cmd = args[0].str;
+    std::transform(cmd.begin(), cmd.end(), cmd.begin(), ::toupper);
+
+    if(cmd == "PING") {
+      // 和redis一样，RESP2订阅状态下回复数组["pong", 参数]
+      if(!session.resp3 && !session.channels.empty()) {
+        out->append("*2\r\n");
+        bulk(out, "pong");
+        bulk(out, args.size() > 1 ? args[1].str : "");
+      }
+      else {
+        status(out, "PONG");
+      }
+    }
+    else if(cmd == "ECHO" && args.size() == 2) {
+      bulk(out, args[1].str);
+    }
+    else if(cmd == "HELLO") {
+      session.resp3 = args.size() > 1 && args[1].str == "3";
+      out->append(session.resp3 ? "%1\r\n" : "*2\r\n");
+      bulk(out, "server");
+      bulk(out, "stub");
+    }
+    else if(cmd == "SET" && args.size() == 3) {
+      data_[args[1].str] = args[2].str;
+      status(out, "OK");
+    }
+    else if(cmd == "GET" && args.size() == 2) {
+      auto it = data_.find(args[1].str);
+      if(it == data_.end()) {
+        nil(session, out);
+      }
+      else {
+        bulk(out, it->second);
+      }
+    }
+    else if(cmd == "DEL" && args.size() >= 2) {
+      int64_t n = 0;
+      for(size_t i = 1; i < args.size(); ++i) {
+        n += static_cast<int64_t>(data_.erase(args[i].str));
+      }
+      integer(out, n);
+    }
+    else if(cmd == "INCR" && args.size() == 2) {
+      std::string& value = data_[args[1].str];
+      char* end = nullptr;
+      long long n = value.empty() ? 0 : ::strtoll(value.c_str(), &end, 10);
+      if(end != nullptr && *end != '\0') {
+        error(out, "ERR value is not an integer or out of range");
+        return;
+      }
+      value = std::to_string(n + 1);
+      integer(out, n + 1);
+    }
+    else if((cmd == "SUBSCRIBE" || cmd == "UNSUBSCRIBE") && args.size() >= 2) {
+      bool subscribe = cmd == "SUBSCRIBE";
+      for(size_t i = 1; i < args.size(); ++i) {
+        if(subscribe) {
+          session.channels.insert(args[i].str);
+        }
+        else {
+          session.channels.erase(args[i].str);
+        }
+        pubsub(session, out, subscribe ? "subscribe" : "unsubscribe", args[i].str);
+        integer(out, static_cast<int64_t>(session.channels.size()));
+      }
+    }
+    else if(cmd == "PUBLISH" && args.size() == 3) {
+      int64_t receivers = 0;
+      for(auto& entry : sessions_) {
+        const Session& peer = *entry.second;
+        if(peer.channels.count(args[1].str) == 0) {
+          continue;
+        }
+        ++receivers;
+        Miren::net::Buffer message;
+        pubsub(peer, &message, "message", args[1].str);
+        // pubsub写了3个元素的头部和前两个元素，最后是消息内容
+        bulk(&message, args[2].str);
+        if(&peer == &session) {
+          out->append(message.peek(), message.readableBytes());
+        }
+        else {
+          entry.first->send(&message);
+        }
+      }
+      integer(out, receivers);
+    }
+    else {
+      error(out, "ERR unknown command '" + cmd + "'");
+    }
+  }
+
+  Miren::net::InetAddress address_;
+  Miren::net::EventLoopThread thread_;
+  Miren::net::EventLoop* loop_;
+  std::unique_ptr<Miren::net::TcpServer> server_;
+  std::map<Miren::net::TcpConnectionPtr, std::shared_ptr<Session>> sessions_;
+  std::map<std::string, std::string> data_;
+};
@@ -3,6 +3,7 @@
 //
 #include "example/chat/server/ChatServer.h"
 #include "example/chat/service/ChatService.h"
+#include "db/mysql/MysqlConnectionPool.h"
 #include <iostream>
 #include <signal.h>
 
@@ -38,6 +39,8 @@ int main(int argc, char const *argv[])
 //        exit(-1);
 //    }
     addSignal(SIGINT);
+    // 各个model从连接池的当前线程分片中取连接，在启动IO线程之前设置
+    SqlConn::MysqlConnectionPool::_config = SqlConn::MysqlConnConfig("127.0.0.1", 3306, "chat", "root", "root");
     Miren::net::EventLoop lp;
     int port = 6000;
             //atoi(argv[1]);
@@ -3,37 +3,30 @@
 //
 
 #include "example/chat/control/FriendModel.h"
-#include "db/mysql/MysqlConnection.h"
+#include "db/mysql/MysqlConnectionPool.h"
 #include "third_party/nlohmann/json.hpp"
 
-#include <cstring>
+#include <memory>
 
 bool FriendModel::insert(int id, int fid) {
-    char sql[1024];
-    sprintf(sql, "select id from user where id=%d", fid);
-
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        SqlConn::MySqlDataReader* rd = mysql.ExecuteReader(sql);
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader("select id from user where id = ?", fid));
         if(rd!= nullptr && rd->Read()) {
-            ::memset(sql, 0, sizeof sql);
-            sprintf(sql, "insert into friend(userid, friendid) values(%d, %d)", id, fid);
-            return mysql.ExecuteNonQuery(sql);
+            return mysql->ExecuteNonQuery("insert into friend(userid, friendid) values(?, ?)", id, fid);
         }
     }
     return false;
 }
 
 void FriendModel::query(int userId, std::vector<std::string> &result) {
-    char sql[1024];
-    sprintf(sql, "select a.id, a.name, a.state from user a inner join friend b on b.friendid = a.id where b.userid=%d", userId);
     //查询userid的好友信息
-
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        SqlConn::MySqlDataReader* rd = mysql.ExecuteReader(sql);
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader(
+            "select a.id, a.name, a.state from user a inner join friend b on b.friendid = a.id where b.userid = ?", userId));
         if(rd != nullptr) {
             nlohmann::json js;
             while(rd->Read()) {
@@ -48,9 +41,8 @@ void FriendModel::query(int userId, std::vector<std::string> &result) {
         }
 
         // 还需要再查一次，把userID作为friendID查
-        ::memset(sql, 0, sizeof sql);
-        sprintf(sql, "select a.id, a.name, a.state from user a inner join friend b on b.userid = a.id where b.friendid = %d", userId);
-        rd = mysql.ExecuteReader(sql);
+        rd.reset(mysql->ExecuteReader(
+            "select a.id, a.name, a.state from user a inner join friend b on b.userid = a.id where b.friendid = ?", userId));
 
 
         if(rd!= nullptr) {
@@ -68,4 +60,24 @@ void FriendModel::query(int userId, std::vector<std::string> &result) {
 
         }
     }
+}
+
+void FriendModel::query(int userId, std::vector<User> &friends) {
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (!mysql)
+    {
+        return;
+    }
+    // 好友关系是双向的，两个方向在一条语句中查出
+    std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader(
+        "select a.id, a.name, a.state from user a inner join friend b on b.friendid = a.id where b.userid = ? "
+        "union all "
+        "select a.id, a.name, a.state from user a inner join friend b on b.userid = a.id where b.friendid = ?",
+        userId, userId));
+    while(rd->Read()) {
+        int id;
+        std::string name, state;
+        rd->GetValues(id, name, state);
+        friends.emplace_back(id, name, "", state);
+    }
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #ifndef WEBSERVER_FRIENDMODEL_H
 #define WEBSERVER_FRIENDMODEL_H
 
+#include "example/chat/model/User.h"
 #include <vector>
 #include <string>
 
@@ -15,6 +16,8 @@ public:
 
     //返回自身id对应的好友列表
     void query(int userId, std::vector<std::string>& result);
+    //好友的id、名字和状态，由ChatService缓存
+    void query(int userId, std::vector<User>& friends);
 };
 
 
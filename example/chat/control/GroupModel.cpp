@@ -3,21 +3,20 @@
 //
 
 #include "example/chat/control/GroupModel.h"
-#include "db/mysql/MysqlConnection.h"
-#include <cstring>
+#include "db/mysql/MysqlConnectionPool.h"
+#include <memory>
+#include <unordered_map>
 #pragma GCC diagnostic ignored "-Wshadow"
 //创建群组
 bool GroupModel::createGroup(Group &group) {
-    char sql[1024] = {0};
-    sprintf(sql, "insert into allgroup(groupname, groupdesc) values('%s', '%s')",
-            group.getGName().c_str(), group.getGName().c_str());
-
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        if (mysql.ExecuteNonQuery(sql))
+        if (mysql->ExecuteNonQuery("insert into allgroup(groupname, groupdesc) values(?, ?)",
+                                   group.getGName(), group.getGName()))
         {
-            SqlConn::MySqlDataReader* rd = mysql.ExecuteReader("select id from allgroup where groupname= ? and groupdesc = ?", group.getGName(), group.getGName());
+            std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader(
+                "select id from allgroup where groupname= ? and groupdesc = ?", group.getGName(), group.getGName()));
             while(rd->Read()) {
                 int id;
                 rd->GetValues(id);
@@ -30,34 +29,25 @@ bool GroupModel::createGroup(Group &group) {
 }
 
 bool GroupModel::addUser(int userId, int groupId, const std::string &role) {
-    // 1.组装sql语句
-    char sql[1024] = {0};
-    // 检查groupId的合法性
-    sprintf(sql, "select id from allgroup where id = %d", groupId);
-
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        SqlConn::MySqlDataReader* rd = mysql.ExecuteReader(sql);
+        // 检查groupId的合法性
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader("select id from allgroup where id = ?", groupId));
         if(rd && rd->Read()) {
-            ::memset(sql, 0, sizeof sql);
-            sprintf(sql, "insert into groupuser values(%d, %d, '%s')",
-                    groupId, userId, role.c_str());
-            return mysql.ExecuteNonQuery(sql) > 0;
+            return mysql->ExecuteNonQuery("insert into groupuser values(?, ?, ?)", groupId, userId, role) > 0;
         }
     }
     return false;
 }
 
 Group GroupModel::query(int groupId) {
-    // 1.组装sql语句
-    char sql[1024] = {0};
-    sprintf(sql, "select id, groupname, groupdesc from allgroup where id = %d", groupId);
     Group group;
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        SqlConn::MySqlDataReader* rd = mysql.ExecuteReader(sql);
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader(
+            "select id, groupname, groupdesc from allgroup where id = ?", groupId));
         while(rd->Read()) {
             int id;
             std::string name;
@@ -78,58 +68,52 @@ void GroupModel::queryUserAllGroup(int userid ,std::vector<Group>& groups) {
     1. 先根据userid在groupuser表中查询出该用户所属的群组信息
     2. 在根据群组信息，查询属于该群组的所有用户的userid，并且和user表进行多表联合查询，查出用户的详细信息
     */
-    char sql[1024] = {0};
-    sprintf(sql, "select a.id,a.groupname,a.groupdesc from allgroup a inner join groupuser b on a.id = b.groupid where b.userid=%d",
-            userid);
-
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (!mysql)
     {
-        SqlConn::MySqlDataReader* rd = mysql.ExecuteReader(sql);
-        while(rd->Read()) {
-            Group group;
-            int id;
-            std::string name;
-            std::string desc;
-            rd->GetValues(id, name, desc);
-            group.setID(id);
-            group.setGName(name);
-            group.setGDesc(desc);
-            groups.push_back(std::move(group));
-        }
+        return;
     }
 
-    for(Group& g: groups) {
-        memset(sql, 0, sizeof sql);
-        sprintf(sql, "select a.id, a.name, a.state, b.grouprole from user a inner join groupuser b on b.userid = a.id where b.groupid = %d", g.getID());
-        SqlConn::MySqlDataReader* rd = mysql.ExecuteReader(sql);
-        if(rd!= nullptr) {
-            while(rd->Read()) {
-                int id;
-                std::string name;
-                std::string state;
-                std::string role;
-                rd->GetValues(id, name, state, role);
-                GroupUser groupUser;
-                groupUser.setId(id);
-                groupUser.setName(name);
-                groupUser.setState(state);
-                groupUser.setRole(role);
-                g.getUsers().push_back(groupUser);
-            }
+    // 群组信息和成员在同一条联合查询中取出，不再每个群组再查一次成员
+    std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader(
+        "select a.id, a.groupname, a.groupdesc, u.id, u.name, u.state, m.grouprole from groupuser b "
+        "inner join allgroup a on a.id = b.groupid "
+        "inner join groupuser m on m.groupid = a.id "
+        "inner join user u on u.id = m.userid "
+        "where b.userid = ? order by a.id",
+        userid));
+    std::unordered_map<int, size_t> index;
+    while(rd->Read()) {
+        int gid;
+        std::string gname;
+        std::string gdesc;
+        int id;
+        std::string name;
+        std::string state;
+        std::string role;
+        rd->GetValues(gid, gname, gdesc, id, name, state, role);
+        auto it = index.find(gid);
+        if(it == index.end()) {
+            it = index.emplace(gid, groups.size()).first;
+            groups.emplace_back(gid, gname, gdesc);
         }
+        GroupUser groupUser;
+        groupUser.setId(id);
+        groupUser.setName(name);
+        groupUser.setState(state);
+        groupUser.setRole(role);
+        groups[it->second].getUsers().push_back(groupUser);
     }
 }
 
 
 //获取一个组内的所有成员的id
 bool GroupModel::queryOneGroup(int userid, int groupid, std::vector<int>& userIds) {
-    char sql[1024];
-    sprintf(sql, "select userid from groupuser where groupid = %d and userid != %d", groupid, userid);
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        SqlConn::MySqlDataReader* rd = mysql.ExecuteReader(sql);
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader(
+            "select userid from groupuser where groupid = ? and userid != ?", groupid, userid));
 
         if(rd) {
             while (rd->Read()) {
@@ -145,15 +129,12 @@ bool GroupModel::queryOneGroup(int userid, int groupid, std::vector<int>& userId
 
 //获取一个组内所有成员的信息
 bool GroupModel::queryOneGroup(int usrid, int gID, std::vector<GroupUser> &usrVec) {
-    // 组装sql语句
-    char sql[1024];
-    sprintf(sql, "select a.id, a.name, a.state, b.grouprole from user a \
-            inner join groupuser b on b.userid = a.id where b.groupid = %d",
-            gID);
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        SqlConn::MySqlDataReader* rd = mysql.ExecuteReader(sql);
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader(
+            "select a.id, a.name, a.state, b.grouprole from user a inner join groupuser b on b.userid = a.id where b.groupid = ?",
+            gID));
         if (rd != nullptr)
         {
             while (rd->Read())
@@ -175,17 +156,30 @@ bool GroupModel::queryOneGroup(int usrid, int gID, std::vector<GroupUser> &usrVe
 }
 
 
+//获取一个组内所有成员的id
+bool GroupModel::queryMembers(int groupId, std::vector<int> &userIds) {
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
+    {
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader("select userid from groupuser where groupid = ?", groupId));
+        while (rd->Read()) {
+            int id;
+            rd->GetValues(id);
+            userIds.push_back(id);
+        }
+        return true;
+    }
+    return false;
+}
+
+
 // 检查gid是否为服务器拥有的群
 bool GroupModel::checkGroup(int gID)
 {
-    // 组装sql语句
-    char sql[1024];
-    sprintf(sql, "select id from allgroup where id = %d", gID);
-
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        SqlConn::MySqlDataReader* rd = mysql.ExecuteReader(sql);
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader("select id from allgroup where id = ?", gID));
         if (rd != nullptr && rd->Read())
         {
             return true;
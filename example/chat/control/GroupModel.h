@@ -21,5 +21,8 @@ public:
     bool queryOneGroup(int userid, int groupid, std::vector<int>& userIds);
     bool queryOneGroup(int usrid, int gID, std::vector<GroupUser> &usrVec);
 
+    // 群组的全部成员id，群聊时由ChatCache缓存
+    bool queryMembers(int groupId, std::vector<int>& userIds);
+
     bool checkGroup(int gId);
 };
@@ -3,38 +3,62 @@
 //
 
 #include "example/chat/control/OfflineMsgModel.h"
-#include "db/mysql/MysqlConnection.h"
+#include "db/mysql/MysqlConnectionPool.h"
+#include <algorithm>
+#include <memory>
 
 // 存储用户的离线消息
 bool OfflineMsgModel::insert(const int usrID, const std::string &msg)
 {
-    // 1. 组装sql语句
-    char sql[1024] = {0};
-    sprintf(sql, "insert into offlinemessage(userid, message) values(%d, '%s')",usrID, msg.c_str());
-
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        // 插入数据
-        if (mysql.ExecuteNonQuery(sql))
+        // 插入数据，消息内容作为参数绑定，不再拼接进sql
+        if (mysql->ExecuteNonQuery("insert into offlinemessage(userid, message) values(?, ?)", usrID, msg))
         {
             return true;
         }
     }
     return false;
 }
+// 每批最多kBatch行，一条语句一次往返
+bool OfflineMsgModel::insert(const std::vector<int> &usrIDs, const std::string &msg)
+{
+    const size_t kBatch = 256;
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (!mysql)
+    {
+        return false;
+    }
+    for (size_t begin = 0; begin < usrIDs.size(); begin += kBatch)
+    {
+        size_t count = std::min(kBatch, usrIDs.size() - begin);
+        std::string sql = "insert into offlinemessage(userid, message) values(?, ?)";
+        for (size_t i = 1; i < count; ++i)
+        {
+            sql += ",(?, ?)";
+        }
+
+        std::unique_ptr<SqlConn::MySqlCommand> cmd(mysql->CreateCommand(sql));
+        for (size_t i = 0; i < count; ++i)
+        {
+            cmd->SetValue(static_cast<uint32_t>(2 * i), usrIDs[begin + i]);
+            cmd->SetValue(static_cast<uint32_t>(2 * i + 1), msg);
+        }
+        if (cmd->ExecuteNonQuery() == 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
 // 删除用户的离线消息
 bool OfflineMsgModel::remove(const int usrID)
 {
-    // 1. 组装sql语句
-    char sql[1024] = {0};
-    sprintf(sql, "delete from offlinemessage where userid = %d",usrID);
-
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        // 插入数据
-        if (mysql.ExecuteNonQuery(sql))
+        if (mysql->ExecuteNonQuery("delete from offlinemessage where userid = ?", usrID))
         {
             return true;
         }
@@ -44,16 +68,11 @@ bool OfflineMsgModel::remove(const int usrID)
 // 将数据库的离线消息输出到一个队列中去
 bool OfflineMsgModel::query(const int usrID, std::vector<std::string> &vec)
 {
-    // 组装sql语句
-    char sql[1024];
-    sprintf(sql, "select message from offlinemessage where userid = %d", usrID);
-
-    // 创建MySQL对象操作MySQL数据库
     bool ret = false;
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        SqlConn::MySqlDataReader* rd = mysql.ExecuteReader(sql);
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader("select message from offlinemessage where userid = ?", usrID));
         if (rd != nullptr)
         {
             while(rd->Read()) {
@@ -8,6 +8,8 @@ class OfflineMsgModel {
 public:
     // 存储用户的离线消息
     bool insert(const int usrID, const std::string &msg);
+    // 同一条消息存给多个用户，多行insert，每批一条语句
+    bool insert(const std::vector<int> &usrIDs, const std::string &msg);
     // 删除用户的离线消息
     bool remove(const int usrID);
     // 将数据库的离线消息输出到一个队列中去
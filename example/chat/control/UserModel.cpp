@@ -3,23 +3,20 @@
 //
 
 #include "example/chat/control/UserModel.h"
-#include "db/mysql/MysqlConnection.h"
+#include "db/mysql/MysqlConnectionPool.h"
+#include <algorithm>
+#include <memory>
 #pragma GCC diagnostic ignored "-Wshadow"
 bool UserModel::insert(User& user) {
-    // 1.组装sql语句
-    char sql[1024] = {0};
-    sprintf(sql, "insert into user(name, password, state) values('%s', '%s', '%s')",
-            user.getName().c_str(), user.getPassword().c_str(), user.getState().c_str());
-
-
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        if (mysql.ExecuteNonQuery(sql))
+        if (mysql->ExecuteNonQuery("insert into user(name, password, state) values(?, ?, ?)",
+                                   user.getName(), user.getPassword(), user.getState()))
         {
             // 获取插入成功的用户数据生成的主键id
             int id = -1;
-            SqlConn::MySqlDataReader *rd = mysql.ExecuteReader("select id from user where name = ?", user.getName());
+            std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader("select id from user where name = ?", user.getName()));
             while (rd->Read())
             {
                 rd->GetValues(id);
@@ -35,14 +32,10 @@ bool UserModel::insert(User& user) {
 
 User UserModel::query(int id)
 {
-// 1.组装sql语句
-    char sql[1024] = {0};
-    sprintf(sql, "select * from user where id = %d", id);
-
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        SqlConn::MySqlDataReader* rd = mysql.ExecuteReader(sql);
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(mysql->ExecuteReader("select * from user where id = ?", id));
         while(rd->Read()) {
             int id;
             std::string name;
@@ -58,14 +51,10 @@ User UserModel::query(int id)
 
 bool UserModel::updateState(User& user)
 {
-// 1.组装sql语句
-    char sql[1024] = {0};
-    sprintf(sql, "update user set state = '%s' where id = %d", user.getState().c_str(), user.getId());
-
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        if (mysql.ExecuteNonQuery(sql))
+        if (mysql->ExecuteNonQuery("update user set state = ? where id = ?", user.getState(), user.getId()))
         {
             return true;
         }
@@ -73,14 +62,75 @@ bool UserModel::updateState(User& user)
     return false;
 }
 
-bool UserModel::offlineAll()
+bool UserModel::updateState(const std::vector<int>& ids, const std::string& state)
 {
-    char sql[1024] = "update user set state = 'offline' where state = 'online'";
+    const size_t kBatch = 256;
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (!mysql)
+    {
+        return false;
+    }
+    for (size_t begin = 0; begin < ids.size(); begin += kBatch)
+    {
+        size_t count = std::min(kBatch, ids.size() - begin);
+        std::string sql = "update user set state = ? where id in (?";
+        for (size_t i = 1; i < count; ++i)
+        {
+            sql += ",?";
+        }
+        sql += ")";
+
+        std::unique_ptr<SqlConn::MySqlCommand> cmd(mysql->CreateCommand(sql));
+        cmd->SetValue(0, state);
+        for (size_t i = 0; i < count; ++i)
+        {
+            cmd->SetValue(static_cast<uint32_t>(i + 1), ids[begin + i]);
+        }
+        cmd->ExecuteNonQuery();
+    }
+    return true;
+}
 
-    SqlConn::MySqlConnection mysql;
-    if (mysql.connect("127.0.0.1", "root", "root", "chat"))
+bool UserModel::offlineAll()
+{
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (mysql)
     {
-        return mysql.ExecuteNonQuery(sql);
+        return mysql->ExecuteNonQuery("update user set state = 'offline' where state = 'online'");
     }
     return false;
+}
+
+bool UserModel::queryOnline(const std::vector<int>& ids, std::vector<int>& online)
+{
+    const size_t kBatch = 256;
+    std::shared_ptr<SqlConn::MySqlConnection> mysql = SqlConn::MysqlConnectionPool::getConnectionPool()->getConnection();
+    if (!mysql)
+    {
+        return false;
+    }
+    for (size_t begin = 0; begin < ids.size(); begin += kBatch)
+    {
+        size_t count = std::min(kBatch, ids.size() - begin);
+        std::string sql = "select id from user where state = 'online' and id in (?";
+        for (size_t i = 1; i < count; ++i)
+        {
+            sql += ",?";
+        }
+        sql += ")";
+
+        std::unique_ptr<SqlConn::MySqlCommand> cmd(mysql->CreateCommand(sql));
+        for (size_t i = 0; i < count; ++i)
+        {
+            cmd->SetValue(static_cast<uint32_t>(i), ids[begin + i]);
+        }
+        std::unique_ptr<SqlConn::MySqlDataReader> rd(cmd->ExecuteReader());
+        while (rd->Read())
+        {
+            int id;
+            rd->GetValues(id);
+            online.push_back(id);
+        }
+    }
+    return true;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "example/chat/model/User.h"
+#include <vector>
 
 //User表增删改查类
 
@@ -15,7 +16,12 @@ public:
 
     //更新User的数据登录状态
     bool updateState(User& user);
+    //批量更新，每批一条语句，由StateWriter调用
+    bool updateState(const std::vector<int>& ids, const std::string& state);
 
     //服务器宕机，下线所有用户
     bool offlineAll();
+
+    //批量查询ids中在线的用户，每批一条语句
+    bool queryOnline(const std::vector<int>& ids, std::vector<int>& online);
 };
\ No newline at end of file
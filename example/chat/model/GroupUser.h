@@ -9,7 +9,7 @@ public:
         _role = role;
     }
 
-    const std::string getRole() {
+    const std::string getRole() const {
         return _role;
     }
 
@@ -15,10 +15,10 @@ public:
     void setPassword(const std::string & password) { _password = password; }
     void setState(const std::string &state) { _state = state; }
 
-    const int getId() { return _id; }
-    const std::string getName() { return _name; }
-    const std::string getPassword() { return _password; }
-    const std::string getState() { return _state; }
+    const int getId() const { return _id; }
+    const std::string getName() const { return _name; }
+    const std::string getPassword() const { return _password; }
+    const std::string getState() const { return _state; }
 
 private:
     int _id;
@@ -52,8 +52,21 @@ const std::string GROUP_MEMS = "group_members";
 const std::string TIME = "current_time";
 const std::string OFF_MSG = "offlinemsg";
 
+// 登录成功后记录在TcpConnection的context中，连接关闭时据此从UserRegistry删除
+const std::string USER_CONTEXT = "chat.userId";
+// 连接使用的编码，见ChatCodec
+const std::string CODEC_CONTEXT = "chat.protocol";
+
+// 用户id从1开始，0号redis通道用来在服务器之间同步ChatCache的失效
+const int CACHE_CHANNEL = 0;
+const std::string CACHE_GROUP = "group";
+const std::string CACHE_USER = "user";         // 在线状态
+const std::string CACHE_USERS = "users";       // 一批用户的在线状态(服务器关闭)
+const std::string CACHE_PROFILE = "profile";   // 用户资料(注册)
+const std::string CACHE_FRIEND = "friend";     // 好友列表
+
 // 获取系统时间（聊天信息需要添加时间信息）
-std::string getCurrentTime()
+inline std::string getCurrentTime()
 {
     myClock::time_point rightNow = myClock::now();
     std::time_t tt = myClock::to_time_t(rightNow);
@@ -31,6 +31,21 @@ void ChatServer::onConnection(const Miren::net::TcpConnectionPtr &connection) {
 
 void ChatServer::onMessage(const Miren::net::TcpConnectionPtr &connection, Miren::net::Buffer *buffer,
                            Miren::base::Timestamp stamp) {
+    if(ChatCodec::negotiate(connection, buffer) == ChatCodec::kBinary) {
+        ChatCodec::Header header;
+        std::string frame;
+        bool error = false;
+        while(ChatCodec::nextFrame(buffer, &header, &frame, &error)) {
+            ChatService::getInstance()->onFrame(connection, header, std::move(frame), stamp);
+        }
+        if(error) {
+            LOG_ERROR << connection->name() << " invalid frame length";
+            buffer->retrieveAll();
+            connection->shutdown();
+        }
+        return;
+    }
+
     std::string msg = buffer->retrieveAllAsString();
     LOG_INFO << connection->name() << " recived " << msg
              << " | at time: " << stamp.toFormattedString();
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/*
+读穿透缓存，用于数据库中很少变化的数据(用户资料、好友列表、群信息)
+1、每个表有自己的过期时间；查不到的key也缓存一段较短的时间(负缓存)，避免不存在的id反复查询数据库
+2、同一个key同时只有一个线程调用loader，其他线程等待它的结果(single flight)，
+   大量用户同时登录时每个key只查询一次数据库；loader抛出的异常会传给所有等待的线程
+3、加载期间key被invalidate时，加载的结果返回给等待的线程，但不写入缓存
+数据变化时由业务调用invalidate，其他服务器通过redis的缓存通道通知(见ChatService::redisNotifyHandler)
+*/
+template <typename Key, typename Value>
+class CacheTable : Miren::base::NonCopyable
+{
+public:
+    typedef std::shared_ptr<const Value> ValuePtr;
+    //返回false表示数据不存在
+    typedef std::function<bool (const Key&, Value*)> Loader;
+
+    struct Stats
+    {
+        size_t hits = 0;            //包括负缓存
+        size_t loads = 0;           //调用loader的次数
+        size_t coalesced = 0;       //等待其他线程加载的次数
+    };
+
+    CacheTable(Loader loader, int ttlMs, int negativeTtlMs)
+        : _loader(std::move(loader)),
+          _ttlMs(ttlMs),
+          _negativeTtlMs(negativeTtlMs) {
+    }
+
+    //不存在时返回空指针
+    ValuePtr get(const Key& key) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        int64_t now = nowMillis();
+        auto it = _entries.find(key);
+        if(it != _entries.end() && it->second.expire > now) {
+            ++_stats.hits;
+            return it->second.value;
+        }
+
+        auto flying = _flights.find(key);
+        if(flying != _flights.end()) {
+            std::shared_ptr<Flight> flight = flying->second;
+            ++_stats.coalesced;
+            _loaded.wait(lock, [&flight]() { return flight->done; });
+            if(flight->error) {
+                std::rethrow_exception(flight->error);
+            }
+            return flight->value;
+        }
+
+        std::shared_ptr<Flight> flight = std::make_shared<Flight>();
+        _flights[key] = flight;
+        ++_stats.loads;
+        lock.unlock();
+
+        Value value;
+        try {
+            if(_loader(key, &value)) {
+                flight->value = std::make_shared<const Value>(std::move(value));
+            }
+        }
+        catch(...) {
+            flight->error = std::current_exception();
+        }
+
+        lock.lock();
+        flight->done = true;
+        _flights.erase(key);
+        if(!flight->error && !flight->stale) {
+            store(key, flight->value, nowMillis());
+        }
+        lock.unlock();
+        _loaded.notify_all();
+
+        if(flight->error) {
+            std::rethrow_exception(flight->error);
+        }
+        return flight->value;
+    }
+
+    //只查缓存，不加载；第二个参数表示是否命中(包括负缓存)
+    ValuePtr peek(const Key& key, bool* found) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _entries.find(key);
+        *found = it != _entries.end() && it->second.expire > nowMillis();
+        return *found ? it->second.value : ValuePtr();
+    }
+
+    void put(const Key& key, Value value) {
+        ValuePtr ptr = std::make_shared<const Value>(std::move(value));
+        std::lock_guard<std::mutex> lock(_mutex);
+        markStale(key);
+        store(key, std::move(ptr), nowMillis());
+    }
+
+    void invalidate(const Key& key) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        markStale(key);
+        _entries.erase(key);
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(auto& flight : _flights) {
+            flight.second->stale = true;
+        }
+        _entries.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _entries.size();
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _stats;
+    }
+
+private:
+    struct Entry
+    {
+        ValuePtr value;             //空指针是负缓存
+        int64_t expire;
+    };
+
+    struct Flight
+    {
+        bool done = false;
+        bool stale = false;
+        ValuePtr value;
+        std::exception_ptr error;
+    };
+
+    static const size_t kSweepInterval = 1024;
+
+    static int64_t nowMillis() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void markStale(const Key& key) {
+        auto flying = _flights.find(key);
+        if(flying != _flights.end()) {
+            flying->second->stale = true;
+        }
+    }
+
+    //每写入kSweepInterval次清理一次过期的项
+    void store(const Key& key, ValuePtr value, int64_t now) {
+        if(++_stores % kSweepInterval == 0) {
+            for(auto it = _entries.begin(); it != _entries.end(); ) {
+                it = it->second.expire <= now ? _entries.erase(it) : std::next(it);
+            }
+        }
+        int64_t ttl = value ? _ttlMs : _negativeTtlMs;
+        _entries[key] = Entry{std::move(value), now + ttl};
+    }
+
+    const Loader _loader;
+    const int _ttlMs;
+    const int _negativeTtlMs;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _loaded;
+    std::unordered_map<Key, Entry> _entries;
+    std::unordered_map<Key, std::shared_ptr<Flight>> _flights;
+    size_t _stores = 0;
+    Stats _stats;
+};
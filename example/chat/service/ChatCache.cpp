@@ -0,0 +1,57 @@
+#include "example/chat/service/ChatCache.h"
+
+ChatCache::MemberList ChatCache::groupMembers(int groupId) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _groups.find(groupId);
+    return it == _groups.end() ? MemberList() : it->second;
+}
+
+ChatCache::MemberList ChatCache::setGroupMembers(int groupId, std::vector<int> members) {
+    MemberList list = std::make_shared<const std::vector<int>>(std::move(members));
+    std::lock_guard<std::mutex> lock(_mutex);
+    _groups[groupId] = list;
+    return list;
+}
+
+void ChatCache::invalidateGroup(int groupId) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _groups.erase(groupId);
+}
+
+void ChatCache::setPresence(int userId, bool online) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _presence[userId] = online;
+}
+
+bool ChatCache::presence(int userId, bool *online) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto it = _presence.find(userId);
+    if(it == _presence.end()) {
+        return false;
+    }
+    *online = it->second;
+    return true;
+}
+
+void ChatCache::partitionPresence(const std::vector<int> &ids, std::vector<int> *online,
+                                  std::vector<int> *offline, std::vector<int> *unknown) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(int id : ids) {
+        auto it = _presence.find(id);
+        if(it == _presence.end()) {
+            unknown->push_back(id);
+        }
+        else if(it->second) {
+            online->push_back(id);
+        }
+        else {
+            offline->push_back(id);
+        }
+    }
+}
+
+void ChatCache::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _groups.clear();
+    _presence.clear();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+//群成员和用户在线状态的内存缓存，群聊时不再逐个成员查询数据库
+//缓存项不过期，由业务在变化时失效/更新：本服务器上的登录、下线、加群直接更新，
+//其他服务器上的变化通过redis的缓存通道通知(见ChatService::redisNotifyHandler)
+class ChatCache
+{
+public:
+    typedef std::shared_ptr<const std::vector<int>> MemberList;
+
+    //没有缓存时返回空指针
+    MemberList groupMembers(int groupId) const;
+    MemberList setGroupMembers(int groupId, std::vector<int> members);
+    void invalidateGroup(int groupId);
+
+    void setPresence(int userId, bool online);
+    //没有缓存时返回false
+    bool presence(int userId, bool* online) const;
+    //一次加锁把ids分成已知在线、已知离线和没有缓存三组
+    void partitionPresence(const std::vector<int>& ids, std::vector<int>* online,
+                           std::vector<int>* offline, std::vector<int>* unknown) const;
+
+    void clear();
+
+private:
+    mutable std::mutex _mutex;
+    std::unordered_map<int, MemberList> _groups;
+    std::unordered_map<int, bool> _presence;
+};
@@ -0,0 +1,151 @@
+#include "example/chat/service/ChatCodec.h"
+#include "example/chat/public.h"
+#include "net/sockets/Endian.h"
+#include <string.h>
+
+namespace
+{
+    int32_t readInt32(const char* p) {
+        int32_t be32 = 0;
+        ::memcpy(&be32, p, sizeof be32);
+        return Miren::net::sockets::networkToHost32(be32);
+    }
+
+    //帧头中to对应的字段，0表示没有
+    const std::string* routeField(int msgid) {
+        if(msgid == ONE_CHAT) {
+            return &FRIEND_ID;
+        }
+        if(msgid == GROUP_CHAT) {
+            return &GROUP_ID;
+        }
+        return nullptr;
+    }
+
+    //用户id和群id都从1开始，0表示消息中没有这个字段
+    int takeInt(nlohmann::json& js, const std::string& key) {
+        auto it = js.find(key);
+        if(it == js.end() || !it->is_number_integer()) {
+            return 0;
+        }
+        int value = it->get<int>();
+        js.erase(it);
+        return value;
+    }
+}
+
+const size_t ChatCodec::kHeaderLen;
+const size_t ChatCodec::kMaxFrameLen;
+
+ChatCodec::Protocol ChatCodec::negotiate(const Miren::net::TcpConnectionPtr &conn, const Miren::net::Buffer *buf) {
+    if(conn->hasContext(CODEC_CONTEXT)) {
+        return std::any_cast<Protocol>(conn->getContext(CODEC_CONTEXT));
+    }
+    Protocol protocol = buf->readableBytes() > 0 && buf->peek()[0] == '\0' ? kBinary : kJson;
+    conn->setContext(CODEC_CONTEXT, protocol);
+    return protocol;
+}
+
+ChatCodec::Protocol ChatCodec::protocolOf(const Miren::net::TcpConnectionPtr &conn) {
+    if(conn->hasContext(CODEC_CONTEXT)) {
+        return std::any_cast<Protocol>(conn->getContext(CODEC_CONTEXT));
+    }
+    return kJson;
+}
+
+bool ChatCodec::nextFrame(Miren::net::Buffer *buf, Header *header, std::string *frame, bool *error) {
+    if(buf->readableBytes() < sizeof(int32_t)) {
+        return false;
+    }
+    int32_t len = buf->peekInt32();
+    if(len < static_cast<int32_t>(kHeaderLen - sizeof(int32_t)) || len > static_cast<int32_t>(kMaxFrameLen)) {
+        *error = true;
+        return false;
+    }
+    size_t total = sizeof(int32_t) + static_cast<size_t>(len);
+    if(buf->readableBytes() < total) {
+        return false;
+    }
+    const char* p = buf->peek();
+    header->msgid = static_cast<uint8_t>(p[4]);
+    header->id = readInt32(p + 5);
+    header->to = readInt32(p + 9);
+    frame->assign(p, total);
+    buf->retrieve(total);
+    return true;
+}
+
+std::string ChatCodec::encodeFrame(const nlohmann::json &js) {
+    if(!js.is_object()) {
+        return std::string();
+    }
+    nlohmann::json body = js;
+    int msgid = takeInt(body, MSG_ID);
+    int id = takeInt(body, ID);
+    const std::string* field = routeField(msgid);
+    int to = field ? takeInt(body, *field) : 0;
+    std::vector<uint8_t> packed = nlohmann::json::to_msgpack(body);
+
+    Miren::net::Buffer buf;
+    buf.appendInt8(static_cast<int8_t>(msgid));
+    buf.appendInt32(id);
+    buf.appendInt32(to);
+    buf.append(reinterpret_cast<const char*>(packed.data()), packed.size());
+    buf.prependInt32(static_cast<int32_t>(buf.readableBytes()));
+    return buf.retrieveAllAsString();
+}
+
+nlohmann::json ChatCodec::decodeFrame(const std::string &frame) {
+    if(frame.size() < kHeaderLen) {
+        return nlohmann::json(nlohmann::json::value_t::discarded);
+    }
+    nlohmann::json js = nlohmann::json::from_msgpack(frame.begin() + kHeaderLen, frame.end(), true, false);
+    if(!js.is_object()) {
+        return nlohmann::json(nlohmann::json::value_t::discarded);
+    }
+    int msgid = static_cast<uint8_t>(frame[4]);
+    int id = readInt32(frame.data() + 5);
+    int to = readInt32(frame.data() + 9);
+    js[MSG_ID] = msgid;
+    if(id != 0) {
+        js[ID] = id;
+    }
+    const std::string* field = routeField(msgid);
+    if(field && to != 0) {
+        js[*field] = to;
+    }
+    return js;
+}
+
+void ChatCodec::send(const Miren::net::TcpConnectionPtr &conn, const nlohmann::json &js) {
+    conn->send(protocolOf(conn) == kBinary ? encodeFrame(js) : js.dump());
+}
+
+ChatMessage::ChatMessage(nlohmann::json js)
+    : _js(std::move(js)) {
+}
+
+ChatMessage::ChatMessage(ChatCodec::Protocol protocol, std::string encoded)
+    : _js(nlohmann::json::value_t::discarded) {
+    (protocol == ChatCodec::kBinary ? _frame : _text) = std::move(encoded);
+}
+
+const nlohmann::json &ChatMessage::json() const {
+    if(_js.is_discarded()) {
+        _js = _frame.empty() ? nlohmann::json::parse(_text, nullptr, false) : ChatCodec::decodeFrame(_frame);
+    }
+    return _js;
+}
+
+const std::string &ChatMessage::encoded(ChatCodec::Protocol protocol) const {
+    if(protocol == ChatCodec::kBinary) {
+        if(_frame.empty()) {
+            _frame = ChatCodec::encodeFrame(json());
+        }
+        return _frame;
+    }
+    if(_text.empty()) {
+        _text = json().dump();
+    }
+    return _text;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "net/Buffer.h"
+#include "net/TcpConnection.h"
+#include "third_party/nlohmann/json.hpp"
+#include <memory>
+#include <string>
+
+/*
+聊天协议的两种编码，按连接协商：
+1、json：原来的格式，一次读到的数据就是一个json对象
+2、二进制帧：帧头是路由需要的字段，服务器转发ONE_CHAT和GROUP_CHAT时只读帧头，帧原样发给二进制客户端
+   其余字段是MessagePack编码，只在需要json的时候(json接收者、离线消息、其他服务器)解码一次
+   struct ChatFrame __attribute__ ((__packed__))
+   {
+     int32_t  len;        // 之后的字节数，网络字节序
+     int8_t   msgid;      // CHAT_STATUS
+     int32_t  id;         // 发送者
+     int32_t  to;         // ONE_CHAT是friendid，GROUP_CHAT是groupid，其他消息是0
+     char     body[len-9];// 去掉以上字段的json对象的MessagePack编码
+   }
+连接上第一次收到数据时按第一个字节确定：帧长度不超过kMaxFrameLen，二进制帧的第一个字节总是0，json以'{'开头
+*/
+class ChatCodec
+{
+public:
+    enum Protocol {
+        kJson = 0,
+        kBinary,
+    };
+
+    struct Header
+    {
+        int msgid;
+        int id;
+        int to;
+    };
+
+    static const size_t kHeaderLen = 13;
+    static const size_t kMaxFrameLen = 1024 * 1024;
+
+    //第一次调用时确定并记录在连接的context中，之后直接返回，必须在连接所属的loop线程调用
+    static Protocol negotiate(const Miren::net::TcpConnectionPtr& conn, const Miren::net::Buffer* buf);
+    static Protocol protocolOf(const Miren::net::TcpConnectionPtr& conn);
+
+    //取出buf中的一个完整帧(包括帧头)，数据不够时返回false；长度非法时返回false并设置*error
+    static bool nextFrame(Miren::net::Buffer* buf, Header* header, std::string* frame, bool* error);
+
+    static std::string encodeFrame(const nlohmann::json& js);
+    static nlohmann::json decodeFrame(const std::string& frame);
+
+    //按连接的协议编码后发送
+    static void send(const Miren::net::TcpConnectionPtr& conn, const nlohmann::json& js);
+};
+
+/*
+服务器投递的一条消息，两种编码都在第一次用到时生成，之后所有接收者共享
+只在创建它的线程中调用，投递给loop线程的是已经生成的字符串
+*/
+class ChatMessage
+{
+public:
+    explicit ChatMessage(nlohmann::json js);
+    //收到的一种编码
+    ChatMessage(ChatCodec::Protocol protocol, std::string encoded);
+
+    const std::string& encoded(ChatCodec::Protocol protocol) const;
+    const std::string& text() const { return encoded(ChatCodec::kJson); }
+    const nlohmann::json& json() const;
+
+private:
+    mutable nlohmann::json _js;     //discarded表示还没有解码
+    mutable std::string _text;
+    mutable std::string _frame;
+};
+
+typedef std::shared_ptr<const ChatMessage> ChatMessagePtr;
@@ -3,13 +3,35 @@
 //
 
 #include "example/chat/service/ChatService.h"
+#include "example/chat/service/GroupFanOut.h"
 #include "example/chat/public.h"
 #include "base/log/Logging.h"
+#include <algorithm>
 
 #pragma GCC diagnostic ignored "-Wshadow"
 
 using namespace std::placeholders;
-ChatService::ChatService() {
+ChatService::ChatService()
+    : _userCache([this](const int& id, User* user) {
+                     *user = _userModel.query(id);
+                     return user->getId() != -1;
+                 }, 60 * 1000, 5 * 1000),
+      _friendCache([this](const int& id, std::vector<User>* friends) {
+                       _friendModel.query(id, *friends);
+                       return true;
+                   }, 30 * 1000, 30 * 1000),
+      _groupCache([this](const int& id, Group* group) {
+                      *group = _groupModel.query(id);
+                      return group->getID() != -1;
+                  }, 60 * 1000, 5 * 1000),
+      _stateWriter([this](const std::vector<int>& ids, bool online) {
+                       try {
+                           _userModel.updateState(ids, online ? "online" : "offline");
+                       }
+                       catch(const std::exception& e) {
+                           LOG_ERROR << "update " << ids.size() << " user states failed: " << e.what();
+                       }
+                   }) {
     _msgHandlerMap.insert({LOG_IN, std::bind(&ChatService::login, this, _1, _2, _3)});
     _msgHandlerMap.insert({REG, std::bind(&ChatService::regis, this, _1, _2, _3)});
     _msgHandlerMap.insert({ONE_CHAT, std::bind(&ChatService::oneChat, this, _1, _2, _3)});
@@ -21,7 +43,9 @@ ChatService::ChatService() {
 
     if(_redisModel.init("127.0.0.1", 6379)) {
         _redisModel.initNotifyHandler(std::bind(&ChatService::redisNotifyHandler, this, _1, _2));
+        _redisModel.subscribe(CACHE_CHANNEL);
     }
+    _stateWriter.start();
 }
 
 ChatService *ChatService::getInstance() {
@@ -41,6 +65,25 @@ msgHandler ChatService::getHandler(int msgId) {
     }
 }
 
+void ChatService::onFrame(const Miren::net::TcpConnectionPtr &connection, const ChatCodec::Header &header,
+                          std::string frame, Miren::base::Timestamp stamp) {
+    //聊天消息只按帧头转发，不解码
+    if(header.msgid == ONE_CHAT) {
+        deliverOne(header.to, std::make_shared<const ChatMessage>(ChatCodec::kBinary, std::move(frame)));
+        return;
+    }
+    if(header.msgid == GROUP_CHAT) {
+        deliverGroup(header.id, header.to, std::make_shared<const ChatMessage>(ChatCodec::kBinary, std::move(frame)));
+        return;
+    }
+    nlohmann::json js = ChatCodec::decodeFrame(frame);
+    if(js.is_discarded()) {
+        LOG_ERROR << connection->name() << " invalid frame, msgid: " << header.msgid;
+        return;
+    }
+    getHandler(header.msgid)(connection, js, stamp);
+}
+
 void ChatService::login(const Miren::net::TcpConnectionPtr &connection, nlohmann::json &js,
                         Miren::base::Timestamp stamp) {
     /*
@@ -53,7 +96,7 @@ void ChatService::login(const Miren::net::TcpConnectionPtr &connection, nlohmann
     int id = js[ID].get<int>();
     std::string password = js[PWD];
     //查询用户是否存在
-    User user = _userModel.query(id);
+    User user = loadUser(id);
 
     //创建返回消息json
     nlohmann::json response;
@@ -69,7 +112,7 @@ void ChatService::login(const Miren::net::TcpConnectionPtr &connection, nlohmann
             response[ERRNO] = 2;
             response[MSG] = "incorrect password!";
         }
-        else if(user.getState() == "online") {  //已经登录
+        else if(isOnline(id)) {  //已经登录
             response[ERRNO] = 3;
             response[MSG] = "already online! can not login again!";
         }
@@ -79,13 +122,13 @@ void ChatService::login(const Miren::net::TcpConnectionPtr &connection, nlohmann
             response[ID] = user.getId();
             response[NAME] = user.getName();
 
-            user.setState("online");    //更细数据库用户的状态
-            _userModel.updateState(user);
+            //更新用户的状态，数据库由StateWriter批量写入
+            _stateWriter.update(user.getId(), true);
+            presenceChanged(user.getId(), true);
 
-            {   //添加连接
-                std::unique_lock<std::mutex> lock(_connMtx);
-                _userConnMap.insert({user.getId(), connection});
-            }
+            //添加连接
+            _users.add(user.getId(), connection, ChatCodec::protocolOf(connection));
+            connection->setContext(USER_CONTEXT, user.getId());
 
             //拉取离线消息
             std::vector<std::string> offmsg;
@@ -98,10 +141,17 @@ void ChatService::login(const Miren::net::TcpConnectionPtr &connection, nlohmann
             }
 
             //显示自己的好友
-            std::vector<std::string > friends;
-            _friendModel.query(user.getId(), friends);
+            std::vector<User> friends = loadFriends(user.getId());
             if(!friends.empty()) {
-                response[FRIEND_LIST] = friends;
+                std::vector<std::string> friendInfos;
+                for(User& f : friends) {
+                    nlohmann::json fInfo;
+                    fInfo[ID] = f.getId();
+                    fInfo[NAME] = f.getName();
+                    fInfo[STATE] = f.getState();
+                    friendInfos.push_back(fInfo.dump());
+                }
+                response[FRIEND_LIST] = friendInfos;
             }
 
             //拉取群
@@ -136,30 +186,25 @@ void ChatService::login(const Miren::net::TcpConnectionPtr &connection, nlohmann
             //服务器推送
             //当客户端登录成功后，应该告知当前用户的所有好友，“我以上线”
             std::string tt = getCurrentTime();
-            {
-                std::unique_lock<std::mutex> lock(_connMtx);
-                for(auto& f:friends) {
-                    nlohmann::json fInfo = nlohmann::json::parse(f);
-                    int id = fInfo[ID].get<int>();
-
-                    //推送的消息
-                    nlohmann::json pushMsg;
-                    pushMsg[MSG_ID] = FRIEND_ONLINE;
-                    pushMsg[ID] = user.getId();
-                    pushMsg[TIME] = tt;
-                    if(_userConnMap.count(id)) {
-                        _userConnMap[id]->send(pushMsg.dump());
-                    }//此服务器上没有这个好友的socket，需要判断是否在其他服务器上
-                    else if(_userModel.query(id).getState() == "online") {
-                        //用户在线，将消息发送到消息队列上
-                        _redisModel.publish(id, pushMsg.dump());
-                    }
+            for(User& f : friends) {
+                int id = f.getId();
+
+                //推送的消息
+                nlohmann::json pushMsg;
+                pushMsg[MSG_ID] = FRIEND_ONLINE;
+                pushMsg[ID] = user.getId();
+                pushMsg[TIME] = tt;
+                ChatMessagePtr push = std::make_shared<const ChatMessage>(std::move(pushMsg));
+                //此服务器上没有这个好友的socket，需要判断是否在其他服务器上
+                if(!_users.send(id, push) && f.getState() == "online") {
+                    //用户在线，将消息发送到消息队列上
+                    _redisModel.publish(id, push->text());
                 }
             }
         }
     }
     //向客户端发送登录状态
-    connection->send(response.dump()+"\n");
+    ChatCodec::send(connection, response);
 }
 
 void ChatService::regis(const Miren::net::TcpConnectionPtr &connection, nlohmann::json &js,
@@ -178,37 +223,49 @@ void ChatService::regis(const Miren::net::TcpConnectionPtr &connection, nlohmann
         //注册成功，向客户端发送注册成功消息
         response[ERRNO] = 0;
         response[ID] = user.getId();
+        //清除这个id的负缓存
+        _userCache.invalidate(user.getId());
+        cacheChanged(CACHE_PROFILE, user.getId());
     }
     else {
         response[ERRNO] = -1;
     }
-    connection->send(response.dump() + "\n");
+    ChatCodec::send(connection, response);
 }
 
 //客户端断开连接，服务端不会收到json，业务层面不会做到对客户端异常退出的检测
 //TcpConnection会感知到，
 void ChatService::clientCloseException(const Miren::net::TcpConnectionPtr &connection) {
-    User user;
-    {
-        std::unique_lock<std::mutex> lock(_connMtx);
-        for(auto& it : _userConnMap) {
-            if(it.second == connection) {
-                user.setId(it.first);
-                break;
-            }
-        }
+    //登录时记录了用户id，不再遍历整个在线表
+    if(!connection->hasContext(USER_CONTEXT)) {
+        return;
     }
-    if(user.getId()!=-1) {
-        {
-            std::unique_lock<std::mutex> lock(_connMtx);
-            _userConnMap.erase(user.getId());
-        }
-        _userModel.updateState(user);
+    User user;
+    user.setId(std::any_cast<int>(connection->getContext(USER_CONTEXT)));
+    connection->deleteContext(USER_CONTEXT);
+    //用户已经在别的连接上重新登录时不修改状态
+    if(_users.remove(user.getId(), connection)) {
+        _stateWriter.update(user.getId(), false);
+        presenceChanged(user.getId(), false);
     }
 }
 
 //处理服务器宕机
 void ChatService::serverCloseException() {
+    //先写入积累的状态，避免之后覆盖offlineAll
+    _stateWriter.flush();
+    //其他服务器的ChatCache只通过CACHE_CHANNEL更新在线状态，不通知的话它们会一直认为这些用户在线，
+    //把消息发布到redis上丢掉，而不是存为离线消息。所有用户放在一条通知里
+    std::vector<int> ids = _users.userIds();
+    if(!ids.empty()) {
+        for(int id : ids) {
+            _cache.setPresence(id, false);
+        }
+        nlohmann::json notify;
+        notify[CACHE_USERS] = ids;
+        notify[STATE] = "offline";
+        _redisModel.publish(CACHE_CHANNEL, notify.dump());
+    }
     _userModel.offlineAll();
 }
 
@@ -229,24 +286,21 @@ void ChatService::oneChat(const Miren::net::TcpConnectionPtr &connection, nlohma
 消息发送方 -----> 服务器 -----> 消息接收方
  */
     int destId = js[FRIEND_ID].get<int>();
-    {
-        std::unique_lock<std::mutex> lock(_connMtx);
-        auto iter = _userConnMap.find(destId);
-        if(iter!=_userConnMap.end()) {
-            LOG_INFO << "接收方在线";
-            iter->second->send(js.dump());
-            return;
-        }
+    deliverOne(destId, std::make_shared<const ChatMessage>(std::move(js)));
+}
+
+void ChatService::deliverOne(int destId, const ChatMessagePtr &message) {
+    if(_users.send(destId, message)) {
+        return;
     }
     //当前客户在其他服务器上，把消息发送到redis
-    if(_userModel.query(destId).getState() == "online") {
-        _redisModel.publish(destId, js.dump());
+    if(isOnline(destId)) {
+        _redisModel.publish(destId, message->text());
     }
     else {
-        _offlineMsgModel.insert(destId, js.dump());
+        _offlineMsgModel.insert(destId, message->text());
         LOG_INFO << "离线消息保存完毕";
     }
-
 }
 
 /**
@@ -270,18 +324,22 @@ void ChatService::addFriend(const Miren::net::TcpConnectionPtr &connection, nloh
     if(_friendModel.insert(id, friendId)) {
         response[ERRNO] = 0;
         response[MSG] = "add friend successed!";
+        _friendCache.invalidate(id);
+        _friendCache.invalidate(friendId);
+        cacheChanged(CACHE_FRIEND, id);
+        cacheChanged(CACHE_FRIEND, friendId);
 
         //返回添加的好友的user信息
-        User friendInfo = _userModel.query(friendId);
+        User friendInfo = loadUser(friendId);
         response[ID] = friendInfo.getId();
         response[NAME] = friendInfo.getName();
-        response[STATE] = friendInfo.getState();
+        response[STATE] = isOnline(friendId) ? "online" : "offline";
     }
     else {
         response[ERRNO] = -1;
         response[MSG] = "add friend failed!";
     }
-    connection->send(response.dump());
+    ChatCodec::send(connection, response);
 }
 
 void ChatService::createGroup(const Miren::net::TcpConnectionPtr &connection, nlohmann::json &js,
@@ -297,6 +355,7 @@ void ChatService::createGroup(const Miren::net::TcpConnectionPtr &connection, nl
 
     if(_groupModel.createGroup(group)) {
         _groupModel.addUser(usrId, group.getID(), "creator");
+        groupChanged(group.getID());
         response[GROUP_ID] = group.getID();
         response[GROUP_NAME] = group.getGName();
         response[GROUP_DESC] = group.getGDesc();
@@ -307,7 +366,7 @@ void ChatService::createGroup(const Miren::net::TcpConnectionPtr &connection, nl
         response[MSG] = "create group failed!";
         response[ERRNO] = -1;
     }
-    connection->send(response.dump());
+    ChatCodec::send(connection, response);
 }
 
 //添加用户至群组
@@ -319,8 +378,10 @@ void ChatService::addToGroup(const Miren::net::TcpConnectionPtr &connection, nlo
     nlohmann::json response;
     response[MSG_ID] = ADD_TO_GROUP_ACK;
     response[TIME] = getCurrentTime();
-    Group group = _groupModel.query(groupId);
+    CacheTable<int, Group>::ValuePtr cached = _groupCache.get(groupId);
+    Group group = cached ? *cached : Group();
     if(_groupModel.addUser(userId, groupId, "normal") && group.getID() != -1) {
+        groupChanged(groupId);
 
         response[GROUP_ID] = groupId;
         response[GROUP_NAME] = group.getGName();
@@ -347,33 +408,49 @@ void ChatService::addToGroup(const Miren::net::TcpConnectionPtr &connection, nlo
         response[ERRNO] = -1;
     }
 
-    connection->send(response.dump());
+    ChatCodec::send(connection, response);
 }
 
 void ChatService::groupChat(const Miren::net::TcpConnectionPtr &connection, nlohmann::json &js,
                             Miren::base::Timestamp stamp) {
     int userId = js[ID].get<int>();
     int groupId = js[GROUP_ID].get<int>();
+    deliverGroup(userId, groupId, std::make_shared<const ChatMessage>(std::move(js)));
+}
 
-    std::string msg = js[MSG].get<std::string>();
-
-    std::vector<int> groupMem;
-
-    if(_groupModel.queryOneGroup(userId, groupId, groupMem)) {
-        std::unique_lock<std::mutex> lock(_connMtx);
+void ChatService::deliverGroup(int userId, int groupId, const ChatMessagePtr &message) {
+    ChatCache::MemberList members = groupMembers(groupId);
+    if(!members) {
+        return;
+    }
 
-        for(int memid : groupMem) {
-            if(_userConnMap.count(memid)) {
-                _userConnMap[memid]->send(js.dump());
-            }
-            else if(_userModel.query(memid).getState() == "online") {
-                _redisModel.publish(memid, js.dump());
-            }
-            else {
-                _offlineMsgModel.insert(memid, js.dump());
+    //本服务器上的成员按EventLoop分批投递，其余成员留给redis或者离线消息
+    GroupFanOut local;
+    std::vector<int> others;
+    _users.collect(*members, userId, &local, &others);
+    local.dispatch(message);
+
+    //在线状态先查缓存，没有缓存的成员一次批量查询
+    std::vector<int> online, offline, unknown;
+    _cache.partitionPresence(others, &online, &offline, &unknown);
+    if(!unknown.empty()) {
+        std::vector<int> found;
+        if(_userModel.queryOnline(unknown, found)) {
+            std::sort(found.begin(), found.end());
+            for(int memid : unknown) {
+                bool isOnline = std::binary_search(found.begin(), found.end(), memid);
+                _cache.setPresence(memid, isOnline);
+                (isOnline ? online : offline).push_back(memid);
             }
         }
     }
+
+    if(!online.empty()) {
+        _redisModel.publish(online, message->text());
+    }
+    if(!offline.empty()) {
+        _offlineMsgModel.insert(offline, message->text());
+    }
 }
 
 
@@ -382,49 +459,145 @@ void ChatService::logout(const Miren::net::TcpConnectionPtr &connection, nlohman
     User user;
     user.setId(js[ID].get<int>());
     user.setState("offline");
-    //删除操作，上锁
-    {
-        std::unique_lock<std::mutex> lock(_connMtx);
-        _userConnMap.erase(user.getId());
+    _users.remove(user.getId(), connection);
+    if(connection->hasContext(USER_CONTEXT)) {
+        connection->deleteContext(USER_CONTEXT);
     }
     //修改数据库
-    _userModel.updateState(user);
+    _stateWriter.update(user.getId(), false);
+    presenceChanged(user.getId(), false);
     //redis取消订阅
     _redisModel.unsubscribe(user.getId());
 
     //服务器向该用户所有好友推送，此用户已下线
-    std::vector<std::string> fvec;
-    _friendModel.query(user.getId(), fvec);
-    if(!fvec.empty()) {
-        {
-            std::unique_lock<std::mutex> lock(_connMtx);
-            std::string tt = getCurrentTime();
+    std::vector<User> friends = loadFriends(user.getId());
+    if(!friends.empty()) {
+        std::string tt = getCurrentTime();
+
+        for(User& f : friends) {
+            int id = f.getId();
+
+            nlohmann::json pushMsg;
+            pushMsg[MSG_ID] = FRIEND_OFFLINE;
+            pushMsg[ID]  = user.getId();
+            pushMsg[TIME] = tt;
+            ChatMessagePtr push = std::make_shared<const ChatMessage>(std::move(pushMsg));
+            if(!_users.send(id, push) && f.getState() == "online") {
+                _redisModel.publish(id, push->text());
+            }
+        }
+    }
+}
 
-            for(std::string& str : fvec) {
-                nlohmann::json finfo = nlohmann::json::parse(str);
-                int id = finfo[ID].get<int>();
 
-                nlohmann::json pushMsg;
-                pushMsg[MSG_ID] = FRIEND_OFFLINE;
-                pushMsg[ID]  = user.getId();
-                pushMsg[TIME] = tt;
-                if(_userConnMap.count(id)) {
-                    _userConnMap[id]->send(pushMsg.dump());
-                }
-                else if(_userModel.query(id).getState() == "online") {
-                    _redisModel.publish(id, pushMsg.dump());
-                }
+ChatCache::MemberList ChatService::groupMembers(int groupId) {
+    ChatCache::MemberList members = _cache.groupMembers(groupId);
+    if(!members) {
+        std::vector<int> ids;
+        if(_groupModel.queryMembers(groupId, ids)) {
+            members = _cache.setGroupMembers(groupId, std::move(ids));
+        }
+    }
+    return members;
+}
+
+void ChatService::groupChanged(int groupId) {
+    _cache.invalidateGroup(groupId);
+    _groupCache.invalidate(groupId);
+    cacheChanged(CACHE_GROUP, groupId);
+}
+
+void ChatService::cacheChanged(const std::string &kind, int id) {
+    nlohmann::json notify;
+    notify[kind] = id;
+    _redisModel.publish(CACHE_CHANNEL, notify.dump());
+}
+
+User ChatService::loadUser(int userId) {
+    CacheTable<int, User>::ValuePtr user = _userCache.get(userId);
+    return user ? *user : User();
+}
+
+bool ChatService::isOnline(int userId) {
+    bool online = false;
+    if(_cache.presence(userId, &online)) {
+        return online;
+    }
+    std::vector<int> found;
+    if(!_userModel.queryOnline({userId}, found)) {
+        return false;
+    }
+    online = !found.empty();
+    _cache.setPresence(userId, online);
+    return online;
+}
+
+std::vector<User> ChatService::loadFriends(int userId) {
+    CacheTable<int, std::vector<User>>::ValuePtr cached = _friendCache.get(userId);
+    if(!cached) {
+        return std::vector<User>();
+    }
+    //缓存中的状态是加载时数据库中的，可能已经变化，和群聊一样先查ChatCache，没有缓存的一次批量查询
+    std::vector<int> ids, online, offline, unknown;
+    for(const User& f : *cached) {
+        ids.push_back(f.getId());
+    }
+    _cache.partitionPresence(ids, &online, &offline, &unknown);
+    if(!unknown.empty()) {
+        std::vector<int> found;
+        if(_userModel.queryOnline(unknown, found)) {
+            std::sort(found.begin(), found.end());
+            for(int id : unknown) {
+                bool isOnline = std::binary_search(found.begin(), found.end(), id);
+                _cache.setPresence(id, isOnline);
+                (isOnline ? online : offline).push_back(id);
             }
         }
     }
+    std::sort(online.begin(), online.end());
+
+    std::vector<User> friends(*cached);
+    for(User& f : friends) {
+        f.setState(std::binary_search(online.begin(), online.end(), f.getId()) ? "online" : "offline");
+    }
+    return friends;
 }
 
+void ChatService::presenceChanged(int userId, bool online) {
+    _cache.setPresence(userId, online);
+    nlohmann::json notify;
+    notify[CACHE_USER] = userId;
+    notify[STATE] = online ? "online" : "offline";
+    _redisModel.publish(CACHE_CHANNEL, notify.dump());
+}
 
 void ChatService::redisNotifyHandler(int id, std::string msg) {
-    std::unique_lock<std::mutex> lock(_connMtx);
-    auto iter = _userConnMap.find(id);
-    if(iter!=_userConnMap.end()) {
-        iter->second->send(msg);
+    //其他服务器(也包括自己)发来的缓存失效通知
+    if(id == CACHE_CHANNEL) {
+        nlohmann::json notify = nlohmann::json::parse(msg, nullptr, false);
+        if(notify.contains(CACHE_GROUP)) {
+            _cache.invalidateGroup(notify[CACHE_GROUP].get<int>());
+            _groupCache.invalidate(notify[CACHE_GROUP].get<int>());
+        }
+        else if(notify.contains(CACHE_USER)) {
+            _cache.setPresence(notify[CACHE_USER].get<int>(), notify[STATE] == "online");
+        }
+        else if(notify.contains(CACHE_USERS)) {
+            bool online = notify[STATE] == "online";
+            for(const auto& user : notify[CACHE_USERS]) {
+                _cache.setPresence(user.get<int>(), online);
+            }
+        }
+        else if(notify.contains(CACHE_PROFILE)) {
+            _userCache.invalidate(notify[CACHE_PROFILE].get<int>());
+        }
+        else if(notify.contains(CACHE_FRIEND)) {
+            _friendCache.invalidate(notify[CACHE_FRIEND].get<int>());
+        }
+        return;
+    }
+
+    if(_users.send(id, std::make_shared<const ChatMessage>(ChatCodec::kJson, msg))) {
         return;
     }
     _offlineMsgModel.insert(id, msg);
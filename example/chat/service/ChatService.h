@@ -13,6 +13,11 @@
 #include "example/chat/control/OfflineMsgModel.h"
 #include "example/chat/control/FriendModel.h"
 #include "example/chat/control/GroupModel.h"
+#include "example/chat/service/CacheTable.h"
+#include "example/chat/service/ChatCache.h"
+#include "example/chat/service/ChatCodec.h"
+#include "example/chat/service/StateWriter.h"
+#include "example/chat/service/UserRegistry.h"
 #include <functional>
 #include <mutex>
 
@@ -26,6 +31,9 @@ public:
     static ChatService* getInstance();
     //暴露给chatServer接口，用int整型匹配对应的处理函数
     msgHandler getHandler(int msgId);
+    //二进制客户端的一帧
+    void onFrame(const Miren::net::TcpConnectionPtr& connection, const ChatCodec::Header& header,
+                 std::string frame, Miren::base::Timestamp stamp);
 
     //登录
     void login(const Miren::net::TcpConnectionPtr& connection, nlohmann::json& js, Miren::base::Timestamp stamp);
@@ -55,9 +63,8 @@ private:
 
     std::unordered_map<int, msgHandler > _msgHandlerMap;
 
-    std::unordered_map<int, Miren::net::TcpConnectionPtr > _userConnMap;
-
-    std::mutex _connMtx;
+    //本服务器上在线的用户，查找不加锁
+    UserRegistry _users;
 
     UserModel _userModel;
 
@@ -69,6 +76,34 @@ private:
 
     RedisConn::RedisPubSub _redisModel;
 
+    //群成员和在线状态，群聊时使用
+    ChatCache _cache;
+
+    //读穿透缓存，登录和聊天不再每次查询数据库
+    CacheTable<int, User> _userCache;
+    CacheTable<int, std::vector<User>> _friendCache;
+    CacheTable<int, Group> _groupCache;
+
+    //在线状态延迟批量写入数据库
+    StateWriter _stateWriter;
+
+    //不存在时返回id为-1的User
+    User loadUser(int userId);
+    //在线状态先查ChatCache，没有缓存时查询数据库并缓存
+    bool isOnline(int userId);
+    //好友列表的状态以ChatCache为准
+    std::vector<User> loadFriends(int userId);
+
+    //缓存未命中时从数据库加载群成员
+    ChatCache::MemberList groupMembers(int groupId);
+    //json和二进制消息共用的投递，消息原样转发
+    void deliverOne(int destId, const ChatMessagePtr& message);
+    void deliverGroup(int userId, int groupId, const ChatMessagePtr& message);
+    //更新本地缓存，并通知其他服务器
+    void groupChanged(int groupId);
+    void presenceChanged(int userId, bool online);
+    void cacheChanged(const std::string& kind, int id);
+
     //订阅频道有更新，获取消息
     void redisNotifyHandler(int ,std::string);
 };
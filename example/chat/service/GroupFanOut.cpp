@@ -0,0 +1,41 @@
+#include "example/chat/service/GroupFanOut.h"
+#include "net/EventLoop.h"
+#include <memory>
+
+void GroupFanOut::add(const Miren::net::TcpConnectionPtr &conn, ChatCodec::Protocol protocol) {
+    Miren::net::EventLoop* loop = conn->getLoop();
+    ++_count;
+    for(auto& batch : _batches) {
+        if(batch.first == loop) {
+            batch.second.emplace_back(conn, protocol);
+            return;
+        }
+    }
+    _batches.emplace_back(loop, Batch{{conn, protocol}});
+}
+
+void GroupFanOut::dispatch(const ChatMessagePtr &message) {
+    if(_batches.empty()) {
+        return;
+    }
+    //在当前线程生成用到的编码，loop线程只读
+    const std::string* encoded[2] = {nullptr, nullptr};
+    for(auto& batch : _batches) {
+        for(auto& member : batch.second) {
+            if(encoded[member.second] == nullptr) {
+                encoded[member.second] = &message->encoded(member.second);
+            }
+        }
+    }
+    for(auto& batch : _batches) {
+        //连接由任务持有，投递前断开的连接send时直接忽略
+        batch.first->queueInLoop([members = std::move(batch.second), message, json = encoded[ChatCodec::kJson],
+                                  binary = encoded[ChatCodec::kBinary]]() {
+            for(auto& member : members) {
+                member.first->send(*(member.second == ChatCodec::kBinary ? binary : json));
+            }
+        });
+    }
+    _batches.clear();
+    _count = 0;
+}
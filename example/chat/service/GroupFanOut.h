@@ -0,0 +1,29 @@
+#pragma once
+
+#include "example/chat/service/ChatCodec.h"
+#include "net/TcpConnection.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+//群消息在本服务器上的投递
+//接收者按所属的EventLoop分组，每个loop只投递一次任务，任务里依次发送给该loop上的所有接收者，
+//所有任务共享同一份消息，每种协议的编码只生成一次，不再为每个接收者复制一次字符串、唤醒一次loop
+class GroupFanOut
+{
+public:
+    void add(const Miren::net::TcpConnectionPtr& conn, ChatCodec::Protocol protocol = ChatCodec::kJson);
+
+    //投递后清空，可以继续复用
+    void dispatch(const ChatMessagePtr& message);
+
+    size_t size() const { return _count; }
+    size_t loopCount() const { return _batches.size(); }
+
+private:
+    typedef std::vector<std::pair<Miren::net::TcpConnectionPtr, ChatCodec::Protocol>> Batch;
+
+    //一般只有几个IO线程，线性查找即可
+    std::vector<std::pair<Miren::net::EventLoop*, Batch>> _batches;
+    size_t _count = 0;
+};
@@ -0,0 +1,77 @@
+#include "example/chat/service/StateWriter.h"
+#include "net/EventLoop.h"
+
+StateWriter::StateWriter(Flusher flusher, double interval, size_t maxPending)
+    : _flusher(std::move(flusher)),
+      _interval(interval),
+      _maxPending(maxPending) {
+}
+
+StateWriter::~StateWriter() {
+    _thread.reset();
+    flush();
+}
+
+void StateWriter::start() {
+    _thread.reset(new Miren::net::EventLoopThread(Miren::net::EventLoopThread::ThreadInitCallback(), "StateWriter"));
+    _loop = _thread->startLoop();
+    _loop->runEvery(_interval, [this]() { flush(); });
+}
+
+void StateWriter::update(int userId, bool online) {
+    bool flushNow = false;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending[userId] = online;
+        if(_pending.size() >= _maxPending && !_flushQueued) {
+            _flushQueued = true;
+            flushNow = true;
+        }
+    }
+    if(!flushNow) {
+        return;
+    }
+    if(_loop != nullptr) {
+        _loop->queueInLoop([this]() { flush(); });
+    }
+    else {
+        flush();
+    }
+}
+
+void StateWriter::flush() {
+    std::lock_guard<std::mutex> order(_flushMutex);
+    std::unordered_map<int, bool> pending;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        pending.swap(_pending);
+        _flushQueued = false;
+    }
+    if(pending.empty()) {
+        return;
+    }
+
+    std::vector<int> online, offline;
+    for(auto& item : pending) {
+        (item.second ? online : offline).push_back(item.first);
+    }
+    if(!online.empty()) {
+        _flusher(online, true);
+    }
+    if(!offline.empty()) {
+        _flusher(offline, false);
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _batches += (online.empty() ? 0 : 1) + (offline.empty() ? 0 : 1);
+}
+
+size_t StateWriter::pending() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _pending.size();
+}
+
+size_t StateWriter::batches() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _batches;
+}
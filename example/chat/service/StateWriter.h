@@ -0,0 +1,51 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "net/EventLoopThread.h"
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/*
+用户在线状态的延迟批量写入
+登录、下线只记录在内存中，同一个用户多次变化只保留最后一次，
+后台的EventLoop每隔interval秒(或者积累了maxPending个用户时)按状态分组一次写入数据库
+本服务器和其他服务器读在线状态时先查ChatCache(由redis通道同步)，数据库最多落后interval秒
+*/
+class StateWriter : Miren::base::NonCopyable
+{
+public:
+    //同一批的用户状态相同
+    typedef std::function<void (const std::vector<int>& userIds, bool online)> Flusher;
+
+    explicit StateWriter(Flusher flusher, double interval = 0.1, size_t maxPending = 256);
+    //写入剩余的状态
+    ~StateWriter();
+
+    //启动后台线程，没有启动时积累满maxPending个用户在调用update的线程写入
+    void start();
+
+    void update(int userId, bool online);
+    //在当前线程立即写入，和后台线程的写入按顺序进行
+    void flush();
+
+    size_t pending() const;
+    size_t batches() const;
+
+private:
+    const Flusher _flusher;
+    const double _interval;
+    const size_t _maxPending;
+
+    mutable std::mutex _mutex;
+    std::unordered_map<int, bool> _pending;
+    bool _flushQueued = false;
+    size_t _batches = 0;
+
+    std::mutex _flushMutex;     //保证先取出的状态先写入
+
+    Miren::net::EventLoop* _loop = nullptr;
+    std::unique_ptr<Miren::net::EventLoopThread> _thread;   //最先析构，停止后台写入
+};
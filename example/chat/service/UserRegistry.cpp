@@ -0,0 +1,184 @@
+#include "example/chat/service/UserRegistry.h"
+#include "example/chat/service/GroupFanOut.h"
+#include "net/EventLoop.h"
+
+namespace
+{
+    std::atomic<uint64_t> g_nextId{1};
+    //所有用户表共用，版本号不会重复
+    std::atomic<uint64_t> g_nextVersion{1};
+
+    struct SnapshotCache
+    {
+        uint64_t owner = 0;
+        std::vector<std::pair<uint64_t, std::shared_ptr<const void>>> shards;
+    };
+    //同一个线程交替读多个用户表时每次都会走加锁的慢路径
+    thread_local SnapshotCache t_cache;
+}
+
+UserRegistry::UserRegistry(size_t shardCount)
+    : _id(g_nextId.fetch_add(1, std::memory_order_relaxed)),
+      _shardCount(shardCount == 0 ? 1 : shardCount),
+      _shards(new Shard[_shardCount]),
+      _outboxes(new Outbox[kMaxLoops]) {
+    for(size_t i = 0; i < _shardCount; ++i) {
+        publish(_shards[i], std::make_shared<const Map>());
+    }
+}
+
+UserRegistry::~UserRegistry() = default;
+
+void UserRegistry::publish(Shard &shard, std::shared_ptr<const Map> map) {
+    shard.current = std::move(map);
+    shard.version.store(g_nextVersion.fetch_add(1, std::memory_order_relaxed), std::memory_order_release);
+}
+
+const UserRegistry::Map &UserRegistry::snapshot(size_t index) const {
+    SnapshotCache& cache = t_cache;
+    if(cache.owner != _id) {
+        cache.owner = _id;
+        cache.shards.assign(_shardCount, {0, nullptr});
+    }
+    auto& slot = cache.shards[index];
+    Shard& shard = _shards[index];
+    if(slot.first != shard.version.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        slot.second = shard.current;
+        slot.first = shard.version.load(std::memory_order_relaxed);
+    }
+    return *static_cast<const Map*>(slot.second.get());
+}
+
+void UserRegistry::add(int userId, const Miren::net::TcpConnectionPtr &conn, ChatCodec::Protocol protocol) {
+    Shard& shard = shardOf(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    std::shared_ptr<Map> map = std::make_shared<Map>(*shard.current);
+    (*map)[userId] = Entry{conn, protocol};
+    publish(shard, std::move(map));
+}
+
+bool UserRegistry::remove(int userId, const Miren::net::TcpConnectionPtr &conn) {
+    Shard& shard = shardOf(userId);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.current->find(userId);
+    if(it == shard.current->end()) {
+        return false;
+    }
+    Miren::net::TcpConnectionPtr registered = it->second.conn.lock();
+    if(registered && registered != conn) {
+        return false;
+    }
+    std::shared_ptr<Map> map = std::make_shared<Map>(*shard.current);
+    map->erase(userId);
+    publish(shard, std::move(map));
+    return true;
+}
+
+Miren::net::TcpConnectionPtr UserRegistry::lookup(int userId, ChatCodec::Protocol *protocol) const {
+    const Map& map = snapshot(static_cast<size_t>(userId) % _shardCount);
+    auto it = map.find(userId);
+    if(it == map.end()) {
+        return Miren::net::TcpConnectionPtr();
+    }
+    *protocol = it->second.protocol;
+    return it->second.conn.lock();
+}
+
+Miren::net::TcpConnectionPtr UserRegistry::find(int userId) const {
+    ChatCodec::Protocol protocol = ChatCodec::kJson;
+    return lookup(userId, &protocol);
+}
+
+size_t UserRegistry::size() const {
+    size_t n = 0;
+    for(size_t i = 0; i < _shardCount; ++i) {
+        n += snapshot(i).size();
+    }
+    return n;
+}
+
+std::vector<int> UserRegistry::userIds() const {
+    std::vector<int> ids;
+    for(size_t i = 0; i < _shardCount; ++i) {
+        for(const auto& item : snapshot(i)) {
+            ids.push_back(item.first);
+        }
+    }
+    return ids;
+}
+
+bool UserRegistry::send(int userId, const ChatMessagePtr &message) {
+    ChatCodec::Protocol protocol = ChatCodec::kJson;
+    Miren::net::TcpConnectionPtr conn = lookup(userId, &protocol);
+    if(!conn) {
+        return false;
+    }
+    //在当前线程编码，loop线程只读
+    const std::string& encoded = message->encoded(protocol);
+    Miren::net::EventLoop* loop = conn->getLoop();
+    Outbox* outbox = loop->isInLoopThread() ? nullptr : outboxOf(loop);
+    if(outbox == nullptr) {
+        conn->send(encoded);
+        return true;
+    }
+
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(outbox->mutex);
+        outbox->pending.push_back(Pending{std::move(conn), message, &encoded});
+        schedule = !outbox->scheduled;
+        outbox->scheduled = true;
+    }
+    if(schedule) {
+        loop->queueInLoop([outbox]() { flush(outbox); });
+    }
+    return true;
+}
+
+void UserRegistry::collect(const std::vector<int> &userIds, int except, GroupFanOut *fanOut,
+                           std::vector<int> *absent) const {
+    for(int userId : userIds) {
+        if(userId == except) {
+            continue;
+        }
+        ChatCodec::Protocol protocol = ChatCodec::kJson;
+        Miren::net::TcpConnectionPtr conn = lookup(userId, &protocol);
+        if(conn) {
+            fanOut->add(conn, protocol);
+        }
+        else {
+            absent->push_back(userId);
+        }
+    }
+}
+
+//loop在第一次投递时占用一个发件箱；超过kMaxLoops个loop时返回nullptr，直接send
+UserRegistry::Outbox *UserRegistry::outboxOf(Miren::net::EventLoop *loop) {
+    for(size_t i = 0; i < kMaxLoops; ++i) {
+        Miren::net::EventLoop* owner = _outboxes[i].loop.load(std::memory_order_acquire);
+        if(owner == loop) {
+            return &_outboxes[i];
+        }
+        if(owner == nullptr) {
+            Miren::net::EventLoop* expected = nullptr;
+            if(_outboxes[i].loop.compare_exchange_strong(expected, loop, std::memory_order_acq_rel)
+               || expected == loop) {
+                return &_outboxes[i];
+            }
+        }
+    }
+    return nullptr;
+}
+
+void UserRegistry::flush(Outbox *outbox) {
+    std::vector<Pending> pending;
+    {
+        std::lock_guard<std::mutex> lock(outbox->mutex);
+        pending.swap(outbox->pending);
+        outbox->scheduled = false;
+    }
+    for(Pending& item : pending) {
+        item.conn->send(*item.encoded);
+    }
+}
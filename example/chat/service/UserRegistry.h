@@ -0,0 +1,97 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "example/chat/service/ChatCodec.h"
+#include "net/TcpConnection.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class GroupFanOut;
+
+/*
+在线用户表：用户id -> 连接，连接所属的EventLoop就是投递的目标
+1、按用户id分片，每个分片是写时复制的不可变表(RCU)，和config::Config的快照一样：
+   读的线程在thread local中缓存各分片的快照，版本号没变时直接查找，不加锁也不修改引用计数；
+   登录、下线只在对应的分片加锁复制一次
+2、表中保存weak_ptr，旧快照不会延长连接的生命期，查到已经析构的连接等同于不在线
+   连接关闭时(TcpServer的ConnectionCallback)调用remove(userId, conn)，只删除仍然指向这个连接的项，
+   同一个用户在新连接上重新登录不受旧连接关闭的影响
+3、send把消息放进连接所属loop的发件箱，发件箱为空时才向loop投递一次任务，
+   loop线程在一个任务中发送期间积累的所有消息
+4、每个用户记录登录连接使用的协议，发送时取消息对应的编码，同一条消息的每种编码只生成一次
+用户表必须比所有IO线程的EventLoop活得长
+*/
+class UserRegistry : Miren::base::NonCopyable
+{
+public:
+    explicit UserRegistry(size_t shardCount = 256);
+    ~UserRegistry();
+
+    //同一个用户重复登录时指向新的连接
+    void add(int userId, const Miren::net::TcpConnectionPtr& conn, ChatCodec::Protocol protocol = ChatCodec::kJson);
+    //只有表中的连接是conn(或者已经析构)时才删除，返回是否删除
+    bool remove(int userId, const Miren::net::TcpConnectionPtr& conn);
+
+    //不加锁
+    Miren::net::TcpConnectionPtr find(int userId) const;
+    size_t size() const;
+    //本服务器上登录的所有用户id
+    std::vector<int> userIds() const;
+
+    //用户在本服务器上在线时投递到所属loop，返回false表示不在线
+    bool send(int userId, const ChatMessagePtr& message);
+    bool send(int userId, nlohmann::json message) { return send(userId, std::make_shared<const ChatMessage>(std::move(message))); }
+
+    //群聊：本服务器上在线的成员加入fanOut，其余的放进absent，跳过except
+    void collect(const std::vector<int>& userIds, int except, GroupFanOut* fanOut, std::vector<int>* absent) const;
+
+private:
+    struct Entry
+    {
+        std::weak_ptr<Miren::net::TcpConnection> conn;
+        ChatCodec::Protocol protocol;
+    };
+    typedef std::unordered_map<int, Entry> Map;
+
+    struct Pending
+    {
+        Miren::net::TcpConnectionPtr conn;
+        ChatMessagePtr message;         //持有encoded
+        const std::string* encoded;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::shared_ptr<const Map> current;     //mutex保护
+        std::atomic<uint64_t> version{0};       //current的版本，读线程只比较它
+    };
+
+    struct Outbox
+    {
+        std::atomic<Miren::net::EventLoop*> loop{nullptr};
+        std::mutex mutex;
+        std::vector<Pending> pending;
+        bool scheduled = false;
+    };
+
+    static const size_t kMaxLoops = 64;
+
+    Shard& shardOf(int userId) const { return _shards[static_cast<size_t>(userId) % _shardCount]; }
+    const Map& snapshot(size_t index) const;
+    //返回连接已经析构或者不在线时为空
+    Miren::net::TcpConnectionPtr lookup(int userId, ChatCodec::Protocol* protocol) const;
+    void publish(Shard& shard, std::shared_ptr<const Map> map);
+    Outbox* outboxOf(Miren::net::EventLoop* loop);
+    static void flush(Outbox* outbox);
+
+    const uint64_t _id;                     //区分thread local缓存属于哪个用户表
+    const size_t _shardCount;
+    std::unique_ptr<Shard[]> _shards;
+    std::unique_ptr<Outbox[]> _outboxes;    //每个loop一个，按需占用，不会释放
+};
@@ -0,0 +1,160 @@
+// 服务器转发一条单聊消息的编解码开销：json(解析后再dump) vs 二进制帧(只读帧头，原样转发)
+// 以及二进制和json客户端互发时的转换，和发给2000个群成员时每个成员dump一次 vs 共享一次编码
+// 用法: ChatCodec_bench [messages]
+
+#include "example/chat/service/ChatCodec.h"
+#include "example/chat/public.h"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+  const int kGroupMembers = 2000;
+
+  int64_t nowMicros()
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  nlohmann::json makeChat(int i)
+  {
+    nlohmann::json js;
+    js[MSG_ID] = ONE_CHAT;
+    js[ID] = 10001 + i % 100;
+    js[NAME] = "zhang san";
+    js[FRIEND_ID] = 20001 + i % 1000;
+    js[MSG] = "are we still meeting at the usual place tonight?";
+    js[TIME] = "Mon Oct 19 10:00:00 2026";
+    return js;
+  }
+
+  //原来的实现：一次读到的数据是一条json
+  size_t jsonRoute(const std::vector<std::string>& inbound)
+  {
+    size_t bytes = 0;
+    for(const std::string& text : inbound) {
+      nlohmann::json js = nlohmann::json::parse(text);
+      if(js[FRIEND_ID].get<int>() == 0) {
+        abort();
+      }
+      bytes += js.dump().size();
+    }
+    return bytes;
+  }
+
+  //ChatServer::onMessage和ChatService::onFrame：切出帧，按帧头转发给二进制接收者
+  size_t binaryRoute(Miren::net::Buffer* buf, ChatCodec::Protocol receiver)
+  {
+    size_t bytes = 0;
+    ChatCodec::Header header;
+    std::string frame;
+    bool error = false;
+    while(ChatCodec::nextFrame(buf, &header, &frame, &error)) {
+      if(header.to == 0) {
+        abort();
+      }
+      ChatMessage message(ChatCodec::kBinary, std::move(frame));
+      bytes += message.encoded(receiver).size();
+    }
+    if(error) {
+      abort();
+    }
+    return bytes;
+  }
+
+  void report(const char* name, int messages, int64_t micros, size_t bytes)
+  {
+    printf("%-24s %12.0f %14.1f\n", name, 1e6 * messages / static_cast<double>(micros),
+           static_cast<double>(bytes) / messages);
+  }
+
+  void oneChat(int messages)
+  {
+    std::vector<std::string> texts;
+    std::string frames;
+    size_t textBytes = 0;
+    for(int i = 0; i < messages; ++i) {
+      nlohmann::json js = makeChat(i);
+      texts.push_back(js.dump());
+      textBytes += texts.back().size();
+      frames += ChatCodec::encodeFrame(js);
+      if(i == 0 && ChatCodec::decodeFrame(frames) != js) {
+        fprintf(stderr, "frame round trip mismatch\n");
+        abort();
+      }
+    }
+    printf("one chat: json %zu bytes, frame %zu bytes per message\n",
+           textBytes / static_cast<size_t>(messages), frames.size() / static_cast<size_t>(messages));
+    printf("%-24s %12s %14s\n", "path", "msgs/s", "bytes out/msg");
+
+    int64_t start = nowMicros();
+    size_t bytes = jsonRoute(texts);
+    report("json -> json", messages, nowMicros() - start, bytes);
+
+    ChatCodec::Protocol receivers[] = {ChatCodec::kBinary, ChatCodec::kJson};
+    const char* names[] = {"binary -> binary", "binary -> json"};
+    for(int r = 0; r < 2; ++r) {
+      Miren::net::Buffer buf;
+      buf.append(frames);
+      start = nowMicros();
+      bytes = binaryRoute(&buf, receivers[r]);
+      report(names[r], messages, nowMicros() - start, bytes);
+    }
+
+    start = nowMicros();
+    bytes = 0;
+    for(const std::string& text : texts) {
+      ChatMessage message(ChatCodec::kJson, text);
+      bytes += message.encoded(ChatCodec::kBinary).size();
+    }
+    report("json -> binary", messages, nowMicros() - start, bytes);
+  }
+
+  //一条群消息发给kGroupMembers个成员，一半是json客户端
+  void groupChat(int messages)
+  {
+    nlohmann::json js = makeChat(0);
+    js[MSG_ID] = GROUP_CHAT;
+    js.erase(FRIEND_ID);
+    js[GROUP_ID] = 1;
+    int rounds = messages / kGroupMembers > 0 ? messages / kGroupMembers : 1;
+
+    int64_t start = nowMicros();
+    size_t bytes = 0;
+    for(int r = 0; r < rounds; ++r) {
+      for(int m = 0; m < kGroupMembers; ++m) {
+        bytes += js.dump().size();
+      }
+    }
+    int64_t perMember = nowMicros() - start;
+
+    std::string frame = ChatCodec::encodeFrame(js);
+    start = nowMicros();
+    for(int r = 0; r < rounds; ++r) {
+      ChatMessagePtr message = std::make_shared<const ChatMessage>(ChatCodec::kBinary, frame);
+      const std::string& binary = message->encoded(ChatCodec::kBinary);
+      const std::string& json = message->encoded(ChatCodec::kJson);
+      for(int m = 0; m < kGroupMembers; ++m) {
+        bytes += (m % 2 ? binary : json).size();
+      }
+    }
+    int64_t shared = nowMicros() - start;
+    printf("group chat to %d members: dump per member %.1f us, shared encodings %.1f us per message\n",
+           kGroupMembers, static_cast<double>(perMember) / rounds, static_cast<double>(shared) / rounds);
+    if(bytes == 0) {
+      abort();
+    }
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int messages = argc > 1 ? atoi(argv[1]) : 200000;
+  oneChat(messages);
+  groupChat(messages);
+}
@@ -0,0 +1,162 @@
+#include "example/chat/service/ChatCodec.h"
+#include "example/chat/public.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using Miren::net::Buffer;
+
+namespace
+{
+  nlohmann::json makeOneChat()
+  {
+    nlohmann::json js;
+    js[MSG_ID] = ONE_CHAT;
+    js[ID] = 10001;
+    js[NAME] = "zhang san";
+    js[FRIEND_ID] = 20002;
+    js[MSG] = "hello 你好";
+    js[TIME] = "2024-03-16 10:00:00";
+    return js;
+  }
+
+  nlohmann::json makeGroupChat()
+  {
+    nlohmann::json js;
+    js[MSG_ID] = GROUP_CHAT;
+    js[ID] = 10001;
+    js[GROUP_ID] = 7;
+    js[MSG] = "to everyone";
+    return js;
+  }
+}
+
+// 路由字段进帧头，其余字段进MessagePack，解码后和原来的json相同
+TEST(ChatCodecTest, roundTripsOneChat)
+{
+  nlohmann::json js = makeOneChat();
+  std::string frame = ChatCodec::encodeFrame(js);
+  ASSERT_GT(frame.size(), ChatCodec::kHeaderLen);
+  EXPECT_EQ(frame[0], '\0');    // 协商靠第一个字节区分
+
+  Buffer buf;
+  buf.append(frame);
+  ChatCodec::Header header;
+  std::string got;
+  bool error = false;
+  ASSERT_TRUE(ChatCodec::nextFrame(&buf, &header, &got, &error));
+  EXPECT_FALSE(error);
+  EXPECT_EQ(header.msgid, ONE_CHAT);
+  EXPECT_EQ(header.id, 10001);
+  EXPECT_EQ(header.to, 20002);
+  EXPECT_EQ(got, frame);
+  EXPECT_EQ(buf.readableBytes(), 0u);
+  EXPECT_EQ(ChatCodec::decodeFrame(got), js);
+}
+
+TEST(ChatCodecTest, roundTripsGroupChatAndUnroutedMessages)
+{
+  nlohmann::json group = makeGroupChat();
+  nlohmann::json login;
+  login[MSG_ID] = LOG_IN;
+  login[ID] = 10001;
+  login[PWD] = "123456";
+  // FRIEND_ID在非ONE_CHAT消息中不是路由字段，留在body中
+  login[FRIEND_ID] = 3;
+
+  Buffer buf;
+  buf.append(ChatCodec::encodeFrame(group));
+  buf.append(ChatCodec::encodeFrame(login));
+
+  ChatCodec::Header header;
+  std::string frame;
+  bool error = false;
+  ASSERT_TRUE(ChatCodec::nextFrame(&buf, &header, &frame, &error));
+  EXPECT_EQ(header.msgid, GROUP_CHAT);
+  EXPECT_EQ(header.to, 7);
+  EXPECT_EQ(ChatCodec::decodeFrame(frame), group);
+
+  ASSERT_TRUE(ChatCodec::nextFrame(&buf, &header, &frame, &error));
+  EXPECT_EQ(header.msgid, LOG_IN);
+  EXPECT_EQ(header.to, 0);
+  EXPECT_EQ(ChatCodec::decodeFrame(frame), login);
+  EXPECT_FALSE(error);
+  EXPECT_EQ(buf.readableBytes(), 0u);
+}
+
+// 数据不够一帧时不消费，补齐后取出
+TEST(ChatCodecTest, waitsForTruncatedFrames)
+{
+  std::string frame = ChatCodec::encodeFrame(makeOneChat());
+  ChatCodec::Header header;
+  std::string got;
+  bool error = false;
+
+  Buffer buf;
+  buf.append(frame.data(), 3);
+  EXPECT_FALSE(ChatCodec::nextFrame(&buf, &header, &got, &error));
+  EXPECT_FALSE(error);
+  buf.append(frame.data() + 3, frame.size() - 4);
+  EXPECT_FALSE(ChatCodec::nextFrame(&buf, &header, &got, &error));
+  EXPECT_FALSE(error);
+  EXPECT_EQ(buf.readableBytes(), frame.size() - 1);
+  buf.append(frame.data() + frame.size() - 1, 1);
+  ASSERT_TRUE(ChatCodec::nextFrame(&buf, &header, &got, &error));
+  EXPECT_EQ(got, frame);
+
+  // 帧本身被截断：帧头不完整或者body不是完整的MessagePack对象
+  EXPECT_TRUE(ChatCodec::decodeFrame(frame.substr(0, ChatCodec::kHeaderLen - 1)).is_discarded());
+  EXPECT_TRUE(ChatCodec::decodeFrame(frame.substr(0, frame.size() - 1)).is_discarded());
+}
+
+// 长度超过kMaxFrameLen或者装不下帧头是协议错误
+TEST(ChatCodecTest, rejectsBadLengths)
+{
+  ChatCodec::Header header;
+  std::string got;
+
+  Buffer oversized;
+  oversized.appendInt32(static_cast<int32_t>(ChatCodec::kMaxFrameLen + 1));
+  oversized.append(std::string(64, 'x'));
+  bool error = false;
+  EXPECT_FALSE(ChatCodec::nextFrame(&oversized, &header, &got, &error));
+  EXPECT_TRUE(error);
+
+  Buffer negative;
+  negative.appendInt32(-1);
+  error = false;
+  EXPECT_FALSE(ChatCodec::nextFrame(&negative, &header, &got, &error));
+  EXPECT_TRUE(error);
+
+  Buffer tooShort;
+  tooShort.appendInt32(static_cast<int32_t>(ChatCodec::kHeaderLen - sizeof(int32_t) - 1));
+  tooShort.append(std::string(16, '\0'));
+  error = false;
+  EXPECT_FALSE(ChatCodec::nextFrame(&tooShort, &header, &got, &error));
+  EXPECT_TRUE(error);
+
+  // 正好kMaxFrameLen是合法的
+  Buffer largest;
+  largest.appendInt32(static_cast<int32_t>(ChatCodec::kMaxFrameLen));
+  error = false;
+  EXPECT_FALSE(ChatCodec::nextFrame(&largest, &header, &got, &error));
+  EXPECT_FALSE(error);
+}
+
+// 同一条消息从json或者二进制帧收到，两种编码和解码结果都相同
+TEST(ChatCodecTest, jsonAndBinaryAreEquivalent)
+{
+  for(const nlohmann::json& js : {makeOneChat(), makeGroupChat()}) {
+    ChatMessage fromJson(ChatCodec::kJson, js.dump());
+    ChatMessage fromFrame(ChatCodec::kBinary, ChatCodec::encodeFrame(js));
+    ChatMessage fromObject(js);
+
+    EXPECT_EQ(fromJson.json(), js);
+    EXPECT_EQ(fromFrame.json(), js);
+    EXPECT_EQ(fromJson.encoded(ChatCodec::kBinary), fromFrame.encoded(ChatCodec::kBinary));
+    EXPECT_EQ(fromObject.encoded(ChatCodec::kBinary), fromFrame.encoded(ChatCodec::kBinary));
+    EXPECT_EQ(nlohmann::json::parse(fromFrame.text()), js);
+    EXPECT_EQ(fromObject.text(), fromJson.text());
+  }
+}
@@ -0,0 +1,202 @@
+// 5000人群组的一条群消息：逐个成员投递 vs 按EventLoop分批投递
+// 本地成员是socketpair上的TcpConnection，分布在4个IO线程；其余成员的在线状态来自ChatCache
+// 只测服务器内的扇出，redis和mysql的批量操作替换成计数(它们把N次往返变成N/批量大小次)
+// 用法: GroupChat_bench [rounds] [local members]
+
+#include "example/chat/service/ChatCache.h"
+#include "example/chat/service/GroupFanOut.h"
+#include "example/chat/service/UserRegistry.h"
+#include "base/thread/CountDownLatch.h"
+#include "base/log/Logging.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include "third_party/nlohmann/json.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace Miren;
+
+namespace
+{
+  const int kMembers = 5000;
+  const int kLoops = 4;
+
+  int64_t nowMicros()
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  struct Fixture
+  {
+    std::vector<std::unique_ptr<net::EventLoopThread>> threads;
+    std::vector<net::EventLoop*> loops;
+    std::unordered_map<int, net::TcpConnectionPtr> userConnMap;
+    std::mutex connMtx;
+    UserRegistry users;
+    std::vector<int> peers;
+    std::vector<int> members;
+    ChatCache cache;
+    size_t published = 0;
+    size_t stored = 0;
+  };
+
+  void setUp(Fixture* f, int localMembers)
+  {
+    for(int i = 0; i < kLoops; ++i) {
+      f->threads.emplace_back(new net::EventLoopThread);
+      f->loops.push_back(f->threads.back()->startLoop());
+    }
+    for(int id = 1; id <= kMembers; ++id) {
+      f->members.push_back(id);
+      if(id <= localMembers) {
+        int fds[2];
+        if(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0) {
+          perror("socketpair");
+          exit(1);
+        }
+        net::EventLoop* loop = f->loops[static_cast<size_t>(id % kLoops)];
+        net::TcpConnectionPtr conn = std::make_shared<net::TcpConnection>(
+          loop, "member" + std::to_string(id), fds[0], net::InetAddress(), net::InetAddress());
+        conn->setConnectionCallback([](const net::TcpConnectionPtr&) {});
+        conn->setMessageCallback([](const net::TcpConnectionPtr&, net::Buffer* buf, base::Timestamp) { buf->retrieveAll(); });
+        loop->runInLoop([conn]() { conn->connectEstablished(); });
+        f->userConnMap[id] = conn;
+        f->users.add(id, conn);
+        f->peers.push_back(fds[1]);
+      }
+      else {
+        //其余成员一半在别的服务器上在线，一半离线
+        f->cache.setPresence(id, id % 2 == 0);
+      }
+    }
+    f->cache.setGroupMembers(1, f->members);
+  }
+
+  void tearDown(Fixture* f)
+  {
+    base::CountDownLatch latch(static_cast<int>(f->userConnMap.size()));
+    for(auto& entry : f->userConnMap) {
+      net::TcpConnectionPtr conn = entry.second;
+      conn->getLoop()->runInLoop([conn, &latch]() {
+        conn->connectDestroyed();
+        latch.countDown();
+      });
+    }
+    latch.wait();
+    f->userConnMap.clear();
+    for(int fd : f->peers) {
+      ::close(fd);
+    }
+  }
+
+  //所有loop执行完之前排队的任务
+  void barrier(Fixture* f)
+  {
+    base::CountDownLatch latch(kLoops);
+    for(net::EventLoop* loop : f->loops) {
+      loop->queueInLoop([&latch]() { latch.countDown(); });
+    }
+    latch.wait();
+  }
+
+  void drainPeers(Fixture* f)
+  {
+    char buf[65536];
+    for(int fd : f->peers) {
+      while(::read(fd, buf, sizeof buf) > 0) {
+      }
+    }
+  }
+
+  //原来的实现：持锁逐个成员处理，每个本地成员一次跨线程send(复制一次消息)，每个非本地成员一次状态查询和一次redis/mysql操作
+  void perMember(Fixture* f, nlohmann::json& js)
+  {
+    std::unique_lock<std::mutex> lock(f->connMtx);
+    for(int memid : f->members) {
+      if(memid == 1) {
+        continue;
+      }
+      auto it = f->userConnMap.find(memid);
+      if(it != f->userConnMap.end()) {
+        it->second->send(js.dump());
+        continue;
+      }
+      std::vector<int> one{memid}, online, offline, unknown;
+      f->cache.partitionPresence(one, &online, &offline, &unknown);
+      js.dump();
+      (online.empty() ? f->stored : f->published) += 1;
+    }
+  }
+
+  //ChatService::groupChat的实现
+  void batched(Fixture* f, nlohmann::json& js)
+  {
+    ChatCache::MemberList members = f->cache.groupMembers(1);
+    ChatMessagePtr payload = std::make_shared<const ChatMessage>(js);
+    GroupFanOut local;
+    std::vector<int> others;
+    f->users.collect(*members, 1, &local, &others);
+    local.dispatch(payload);
+    std::vector<int> online, offline, unknown;
+    f->cache.partitionPresence(others, &online, &offline, &unknown);
+    payload->text();
+    f->published += online.empty() ? 0 : 1;
+    f->stored += offline.empty() ? 0 : 1;
+  }
+
+  void run(const char* name, Fixture* f, int rounds, void (*fanOut)(Fixture*, nlohmann::json&))
+  {
+    nlohmann::json js;
+    js["msgid"] = 12;
+    js["id"] = 1;
+    js["groupid"] = 1;
+    js["message"] = "hello everyone in this rather large group";
+    js["current_time"] = "Mon Oct 19 10:00:00 2026";
+
+    f->published = f->stored = 0;
+    int64_t total = 0;
+    int64_t dispatch = 0;
+    for(int i = 0; i < rounds; ++i) {
+      int64_t start = nowMicros();
+      fanOut(f, js);
+      int64_t queued = nowMicros();
+      barrier(f);
+      int64_t done = nowMicros();
+      dispatch += queued - start;
+      total += done - start;
+      drainPeers(f);
+    }
+    printf("%-12s %10.1f %12.1f %10.0f %12zu %12zu\n", name,
+           static_cast<double>(dispatch) / rounds, static_cast<double>(total) / rounds,
+           1e6 * rounds / static_cast<double>(total), f->published / static_cast<size_t>(rounds),
+           f->stored / static_cast<size_t>(rounds));
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int rounds = argc > 1 ? atoi(argv[1]) : 200;
+  int localMembers = argc > 2 ? atoi(argv[2]) : 2000;
+  log::Logger::setLogLevel(log::Logger::WARN);
+
+  Fixture fixture;
+  setUp(&fixture, localMembers);
+  barrier(&fixture);
+
+  printf("%d members, %d local on %d loops, %d rounds\n", kMembers, localMembers, kLoops, rounds);
+  printf("%-12s %10s %12s %10s %12s %12s\n", "mode", "queue us", "deliver us", "msgs/s", "publishes", "inserts");
+  run("per-member", &fixture, rounds, perMember);
+  run("batched", &fixture, rounds, batched);
+
+  tearDown(&fixture);
+}
@@ -0,0 +1,250 @@
+// 登录风暴和单聊时每条消息的数据库查询次数：每次查询数据库 vs CacheTable + ChatCache + StateWriter
+// 数据库换成计数的桩，每次查询睡眠kLatencyUs模拟往返，多个线程同时登录同一批用户
+// 两种实现分别照搬ChatService::login/deliverOne改动前后的查询方式
+// 用法: ModelCache_bench [chat messages] [threads]
+
+#include "example/chat/service/CacheTable.h"
+#include "example/chat/service/ChatCache.h"
+#include "example/chat/service/StateWriter.h"
+#include "example/chat/model/User.h"
+#include "base/log/Logging.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+  const int kUsers = 2000;
+  const int kFriends = 20;
+  const int kLatencyUs = 100;
+
+  //数据库的桩：user表的state和好友关系
+  class StubDb
+  {
+  public:
+    StubDb() : _online(kUsers, false) {}
+
+    bool queryUser(int id, User* user)
+    {
+      roundTrip();
+      if(id < 0 || id >= kUsers) {
+        return false;
+      }
+      std::lock_guard<std::mutex> lock(_mutex);
+      *user = User(id, "user" + std::to_string(id), "pwd", _online[static_cast<size_t>(id)] ? "online" : "offline");
+      return true;
+    }
+
+    //原来的FriendModel::query是两条语句
+    void queryFriends(int id, std::vector<User>* friends, int statements)
+    {
+      for(int i = 0; i < statements; ++i) {
+        roundTrip();
+      }
+      std::lock_guard<std::mutex> lock(_mutex);
+      for(int k = 1; k <= kFriends; ++k) {
+        int f = (id + k * 97) % kUsers;
+        friends->emplace_back(f, "user" + std::to_string(f), "", _online[static_cast<size_t>(f)] ? "online" : "offline");
+      }
+    }
+
+    void queryOnline(const std::vector<int>& ids, std::vector<int>* online)
+    {
+      roundTrip();
+      std::lock_guard<std::mutex> lock(_mutex);
+      for(int id : ids) {
+        if(_online[static_cast<size_t>(id)]) {
+          online->push_back(id);
+        }
+      }
+    }
+
+    void updateState(const std::vector<int>& ids, bool online)
+    {
+      roundTrip();
+      std::lock_guard<std::mutex> lock(_mutex);
+      for(int id : ids) {
+        _online[static_cast<size_t>(id)] = online;
+      }
+    }
+
+    void reset()
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _online.assign(kUsers, false);
+      _queries = 0;
+    }
+
+    size_t queries() const { return _queries.load(); }
+
+  private:
+    void roundTrip()
+    {
+      ++_queries;
+      std::this_thread::sleep_for(std::chrono::microseconds(kLatencyUs));
+    }
+
+    std::mutex _mutex;
+    std::vector<bool> _online;
+    std::atomic<size_t> _queries{0};
+  };
+
+  StubDb g_db;
+
+  int64_t nowMicros()
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  //改动前：查用户、同步写状态、查好友、每个不在本机的好友查一次状态
+  struct Direct
+  {
+    void login(int id)
+    {
+      User user;
+      if(!g_db.queryUser(id, &user) || user.getState() == "online") {
+        return;
+      }
+      g_db.updateState({id}, true);
+      std::vector<User> friends;
+      g_db.queryFriends(id, &friends, 2);
+      for(User& f : friends) {
+        User state;
+        g_db.queryUser(f.getId(), &state);
+      }
+    }
+
+    void chat(int destId)
+    {
+      User user;
+      g_db.queryUser(destId, &user);
+    }
+  };
+
+  //改动后：ChatService::loadUser/isOnline/loadFriends和StateWriter
+  struct Cached
+  {
+    Cached()
+      : users([](const int& id, User* user) { return g_db.queryUser(id, user); }, 60 * 1000, 5 * 1000),
+        friends([](const int& id, std::vector<User>* list) {
+                  g_db.queryFriends(id, list, 1);
+                  return true;
+                }, 30 * 1000, 30 * 1000),
+        writer([](const std::vector<int>& ids, bool online) { g_db.updateState(ids, online); })
+    {
+      writer.start();
+    }
+
+    bool isOnline(int id)
+    {
+      bool online = false;
+      if(presence.presence(id, &online)) {
+        return online;
+      }
+      std::vector<int> found;
+      g_db.queryOnline({id}, &found);
+      online = !found.empty();
+      presence.setPresence(id, online);
+      return online;
+    }
+
+    void login(int id)
+    {
+      CacheTable<int, User>::ValuePtr user = users.get(id);
+      if(!user || isOnline(id)) {
+        return;
+      }
+      writer.update(id, true);
+      presence.setPresence(id, true);
+      //ChatService::loadFriends：好友的状态先查ChatCache，没有缓存的一次批量查询
+      CacheTable<int, std::vector<User>>::ValuePtr list = friends.get(id);
+      std::vector<int> ids, online, offline, unknown;
+      for(const User& f : *list) {
+        ids.push_back(f.getId());
+      }
+      presence.partitionPresence(ids, &online, &offline, &unknown);
+      if(!unknown.empty()) {
+        std::vector<int> found;
+        g_db.queryOnline(unknown, &found);
+        std::sort(found.begin(), found.end());
+        for(int f : unknown) {
+          presence.setPresence(f, std::binary_search(found.begin(), found.end(), f));
+        }
+      }
+    }
+
+    void chat(int destId)
+    {
+      isOnline(destId);
+    }
+
+    CacheTable<int, User> users;
+    CacheTable<int, std::vector<User>> friends;
+    ChatCache presence;
+    StateWriter writer;
+  };
+
+  template <typename Impl>
+  void run(const char* name, Impl* impl, int threads, int messages)
+  {
+    g_db.reset();
+    //每个用户被所有线程同时登录，模拟服务器重启后客户端一起重连
+    int64_t start = nowMicros();
+    std::vector<std::thread> workers;
+    for(int t = 0; t < threads; ++t) {
+      workers.emplace_back([impl]() {
+        for(int id = 0; id < kUsers; ++id) {
+          impl->login(id);
+        }
+      });
+    }
+    for(std::thread& worker : workers) {
+      worker.join();
+    }
+    int64_t loginTime = nowMicros() - start;
+    size_t loginQueries = g_db.queries();
+
+    start = nowMicros();
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> user(0, kUsers - 1);
+    for(int i = 0; i < messages; ++i) {
+      impl->chat(user(rng));
+    }
+    int64_t chatTime = nowMicros() - start;
+    size_t chatQueries = g_db.queries() - loginQueries;
+
+    printf("%-8s %14.2f %12.1f %14.3f %12.2f\n", name,
+           static_cast<double>(loginQueries) / kUsers, static_cast<double>(loginTime) / 1000.0,
+           static_cast<double>(chatQueries) / messages, static_cast<double>(chatTime) / messages);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int messages = argc > 1 ? atoi(argv[1]) : 20000;
+  int threads = argc > 2 ? atoi(argv[2]) : 8;
+  Miren::log::Logger::setLogLevel(Miren::log::Logger::WARN);
+
+  printf("%d users x %d friends, %d threads logging in, %d chat messages, %d us per query\n",
+         kUsers, kFriends, threads, messages, kLatencyUs);
+  printf("%-8s %14s %12s %14s %12s\n", "mode", "queries/user", "storm ms", "queries/msg", "us/msg");
+
+  Direct direct;
+  run("direct", &direct, threads, messages);
+
+  Cached cached;
+  run("cached", &cached, threads, messages);
+  cached.writer.flush();
+  CacheTable<int, User>::Stats stats = cached.users.stats();
+  printf("user cache: %zu loads, %zu coalesced, %zu hits; state writes in %zu batches\n",
+         stats.loads, stats.coalesced, stats.hits, cached.writer.batches());
+}
@@ -0,0 +1,199 @@
+// 10万在线用户的单聊投递：全局锁+unordered_map+逐条跨线程send vs UserRegistry
+// 用户复用在1000个socketpair连接上，连接两端都是TcpConnection，分布在4个IO线程，接收端读空并计数
+// 多个生产者线程(模拟处理消息的线程)向随机用户发消息，统计查找和投递的吞吐
+// 用法: UserRegistry_bench [messages per producer] [producers]
+
+#include "example/chat/service/UserRegistry.h"
+#include "base/thread/CountDownLatch.h"
+#include "base/log/Logging.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+using namespace Miren;
+
+namespace
+{
+  const int kUsers = 100000;
+  const int kConnections = 1000;
+  const int kLoops = 4;
+  const std::string kMessage(120, 'x');
+
+  int64_t nowMicros()
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  struct Fixture
+  {
+    std::vector<std::unique_ptr<net::EventLoopThread>> threads;
+    std::vector<net::EventLoop*> loops;
+    std::vector<net::TcpConnectionPtr> conns;     //服务器一侧
+    std::vector<net::TcpConnectionPtr> peers;     //客户端一侧
+    std::atomic<int64_t> received{0};
+
+    //原来的ChatService::_userConnMap
+    std::unordered_map<int, net::TcpConnectionPtr> userConnMap;
+    std::mutex connMtx;
+
+    UserRegistry registry;
+  };
+
+  net::TcpConnectionPtr makeConnection(Fixture* f, net::EventLoop* loop, const std::string& name, int fd)
+  {
+    net::TcpConnectionPtr conn = std::make_shared<net::TcpConnection>(loop, name, fd, net::InetAddress(), net::InetAddress());
+    conn->setConnectionCallback([](const net::TcpConnectionPtr&) {});
+    conn->setMessageCallback([f](const net::TcpConnectionPtr&, net::Buffer* buf, base::Timestamp) {
+      f->received += static_cast<int64_t>(buf->readableBytes());
+      buf->retrieveAll();
+    });
+    loop->runInLoop([conn]() { conn->connectEstablished(); });
+    return conn;
+  }
+
+  void setUp(Fixture* f)
+  {
+    for(int i = 0; i < kLoops; ++i) {
+      f->threads.emplace_back(new net::EventLoopThread);
+      f->loops.push_back(f->threads.back()->startLoop());
+    }
+    for(int i = 0; i < kConnections; ++i) {
+      int fds[2];
+      if(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0) {
+        perror("socketpair");
+        exit(1);
+      }
+      net::EventLoop* loop = f->loops[static_cast<size_t>(i % kLoops)];
+      f->conns.push_back(makeConnection(f, loop, "conn" + std::to_string(i), fds[0]));
+      f->peers.push_back(makeConnection(f, loop, "peer" + std::to_string(i), fds[1]));
+    }
+    int64_t start = nowMicros();
+    for(int id = 0; id < kUsers; ++id) {
+      const net::TcpConnectionPtr& conn = f->conns[static_cast<size_t>(id % kConnections)];
+      f->userConnMap[id] = conn;
+      f->registry.add(id, conn);
+    }
+    printf("%d users on %d connections, registry login %.2f us/user\n", kUsers, kConnections,
+           static_cast<double>(nowMicros() - start) / kUsers);
+  }
+
+  void tearDown(Fixture* f)
+  {
+    base::CountDownLatch latch(2 * kConnections);
+    for(auto* side : {&f->conns, &f->peers}) {
+      for(net::TcpConnectionPtr& conn : *side) {
+        conn->getLoop()->runInLoop([conn, &latch]() {
+          conn->connectDestroyed();
+          latch.countDown();
+        });
+      }
+    }
+    latch.wait();
+    f->conns.clear();
+    f->peers.clear();
+    f->userConnMap.clear();
+  }
+
+  //所有loop执行完之前排队的任务
+  void barrier(Fixture* f)
+  {
+    base::CountDownLatch latch(kLoops);
+    for(net::EventLoop* loop : f->loops) {
+      loop->queueInLoop([&latch]() { latch.countDown(); });
+    }
+    latch.wait();
+  }
+
+  void lockedSend(Fixture* f, int userId)
+  {
+    std::unique_lock<std::mutex> lock(f->connMtx);
+    auto it = f->userConnMap.find(userId);
+    if(it != f->userConnMap.end()) {
+      it->second->send(kMessage);
+    }
+  }
+
+  void registrySend(Fixture* f, int userId)
+  {
+    static const ChatMessagePtr message = std::make_shared<const ChatMessage>(ChatCodec::kJson, kMessage);
+    f->registry.send(userId, message);
+  }
+
+  void lockedFind(Fixture* f, int userId)
+  {
+    std::unique_lock<std::mutex> lock(f->connMtx);
+    auto it = f->userConnMap.find(userId);
+    if(it == f->userConnMap.end()) {
+      abort();
+    }
+  }
+
+  void registryFind(Fixture* f, int userId)
+  {
+    if(!f->registry.find(userId)) {
+      abort();
+    }
+  }
+
+  void run(const char* name, Fixture* f, int producers, int messages, bool deliver, void (*op)(Fixture*, int))
+  {
+    f->received = 0;
+    std::vector<std::thread> threads;
+    int64_t start = nowMicros();
+    for(int p = 0; p < producers; ++p) {
+      threads.emplace_back([f, p, messages, op]() {
+        std::mt19937 rng(static_cast<unsigned>(p + 1));
+        std::uniform_int_distribution<int> user(0, kUsers - 1);
+        for(int i = 0; i < messages; ++i) {
+          op(f, user(rng));
+        }
+      });
+    }
+    for(std::thread& thread : threads) {
+      thread.join();
+    }
+    int64_t queued = nowMicros();
+    if(deliver) {
+      const int64_t expected = static_cast<int64_t>(producers) * messages * static_cast<int64_t>(kMessage.size());
+      while(f->received.load() < expected) {
+        barrier(f);
+      }
+    }
+    int64_t done = nowMicros();
+    double total = static_cast<double>(producers) * messages;
+    printf("%-16s %12.0f %12.0f\n", name, total * 1e6 / static_cast<double>(queued - start),
+           total * 1e6 / static_cast<double>(done - start));
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int messages = argc > 1 ? atoi(argv[1]) : 200000;
+  int producers = argc > 2 ? atoi(argv[2]) : 4;
+  log::Logger::setLogLevel(log::Logger::WARN);
+
+  Fixture fixture;
+  setUp(&fixture);
+  barrier(&fixture);
+
+  printf("%d producers x %d messages of %zu bytes, %d loops\n", producers, messages, kMessage.size(), kLoops);
+  printf("%-16s %12s %12s\n", "mode", "queued/s", "delivered/s");
+  run("locked find", &fixture, producers, messages, false, lockedFind);
+  run("registry find", &fixture, producers, messages, false, registryFind);
+  run("locked send", &fixture, producers, messages, true, lockedSend);
+  run("registry send", &fixture, producers, messages, true, registrySend);
+
+  tearDown(&fixture);
+}
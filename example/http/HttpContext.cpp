@@ -1,4 +1,5 @@
 #include "net/Buffer.h"
+#include "net/Scan.h"
 #include "example/http/HttpContext.h"
 
 namespace Miren
@@ -90,6 +91,12 @@ bool HttpContext::parseRequest(Buffer* buf, base::Timestamp receiveTime)
         const char* colon = std::find(buf->peek(), crlf, ':');  //查找:(请求头形式： 字段名: 具体值)
         if (colon != crlf)
         {
+          if (!scan::isToken(buf->peek(), colon))  //字段名必须是token，不能有空格等字符
+          {
+            ok = false;
+            hasMore = false;
+            break;
+          }
           request_.addHeader(buf->peek(), colon, crlf);  //找到添加头部，加到map容器 
         }
         else
@@ -1,5 +1,6 @@
 #include "example/http/HttpResponse.h"
 #include "net/Buffer.h"
+#include "base/FastFormat.h"
 
 #include <stdio.h>
 
@@ -25,8 +26,9 @@ void HttpResponse::appendToBuffer(Buffer* output) const
   else
   {
       //继续保持连接
-    snprintf(buf, sizeof buf, "Content-Length: %zd\r\n", body_.size());  //目标文档的长度
-    output->append(buf);
+    output->append("Content-Length: ");  //目标文档的长度
+    output->append(buf, base::FastFormat::formatUnsigned(buf, body_.size()));
+    output->append("\r\n");
     output->append("Connection: Keep-Alive\r\n");   //处理完之后仍然保持连接
   }
 
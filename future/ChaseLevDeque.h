@@ -0,0 +1,156 @@
+#ifndef BERT_CHASELEVDEQUE_H
+#define BERT_CHASELEVDEQUE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+///@file ChaseLevDeque.h
+///@brief Dynamic circular work-stealing deque (Chase & Lev, SPAA'05),
+/// with the C11 memory orderings from Le et al. (PPoPP'13).
+///
+/// Only the owner thread may call Push/Pop, which work on the bottom end.
+/// Any thread may call Steal, which takes from the top end.
+/// T must be trivially copyable, usually a pointer.
+namespace Miren {
+
+template <typename T>
+class ChaseLevDeque {
+public:
+    explicit
+    ChaseLevDeque(size_t capacity = 1024) :
+        top_(0),
+        bottom_(0),
+        array_(new Array(_RoundUp(capacity))) {
+        garbage_.emplace_back(array_.load(std::memory_order_relaxed));
+    }
+
+    ChaseLevDeque(const ChaseLevDeque& ) = delete;
+    void operator=(const ChaseLevDeque& ) = delete;
+
+    ///@brief Owner only: push x to the bottom end.
+    void Push(T x) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Array* a = array_.load(std::memory_order_relaxed);
+        if (b - t > static_cast<int64_t>(a->Capacity()) - 1) {
+            a = _Grow(a, t, b);
+        }
+
+        a->Put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(b + 1, std::memory_order_relaxed);
+    }
+
+    ///@brief Owner only: pop from the bottom end (LIFO).
+    ///@return false if the deque is empty.
+    bool Pop(T& x) {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* a = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // empty
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        x = a->Get(b);
+        if (t == b) {
+            // the last one, race against thieves
+            bool won = top_.compare_exchange_strong(t, t + 1,
+                                                    std::memory_order_seq_cst,
+                                                    std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        return true;
+    }
+
+    ///@brief Any thread: steal from the top end (FIFO).
+    ///@return false if the deque is empty or lost the race.
+    bool Steal(T& x) {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b)
+            return false;
+
+        // consume is promoted to acquire by every compiler anyway
+        Array* a = array_.load(std::memory_order_acquire);
+        x = a->Get(t);
+        return top_.compare_exchange_strong(t, t + 1,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed);
+    }
+
+    ///@brief Approximate size, for stats and idle checks only.
+    size_t Size() const {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? static_cast<size_t>(b - t) : 0;
+    }
+
+    bool Empty() const {
+        return Size() == 0;
+    }
+
+private:
+    class Array {
+    public:
+        explicit
+        Array(size_t capacity) :
+            mask_(capacity - 1),
+            slots_(new std::atomic<T>[capacity]) {
+        }
+
+        size_t Capacity() const {
+            return mask_ + 1;
+        }
+
+        T Get(int64_t i) const {
+            return slots_[static_cast<size_t>(i) & mask_].load(std::memory_order_relaxed);
+        }
+
+        void Put(int64_t i, T x) {
+            slots_[static_cast<size_t>(i) & mask_].store(x, std::memory_order_relaxed);
+        }
+
+    private:
+        const size_t mask_;
+        std::unique_ptr<std::atomic<T>[]> slots_;
+    };
+
+    Array* _Grow(Array* old, int64_t t, int64_t b) {
+        Array* a = new Array(old->Capacity() * 2);
+        for (int64_t i = t; i < b; ++i)
+            a->Put(i, old->Get(i));
+
+        // Thieves may still read the old array, keep it until destruction.
+        garbage_.emplace_back(a);
+        array_.store(a, std::memory_order_release);
+        return a;
+    }
+
+    static size_t _RoundUp(size_t n) {
+        size_t cap = 2;
+        while (cap < n)
+            cap <<= 1;
+        return cap;
+    }
+
+    // top_ is hammered by thieves, bottom_ by the owner
+    alignas(64) std::atomic<int64_t> top_;
+    alignas(64) std::atomic<int64_t> bottom_;
+    alignas(64) std::atomic<Array*> array_;
+    std::vector<std::unique_ptr<Array>> garbage_;
+};
+
+} // end namespace Miren
+
+#endif
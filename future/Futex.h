@@ -0,0 +1,53 @@
+#ifndef BERT_FUTEX_H
+#define BERT_FUTEX_H
+
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+///@file Futex.h
+///@brief Thin wrappers of the linux futex syscall on a 32-bit atomic word.
+namespace Miren {
+
+namespace internal {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+              "futex needs a plain 32-bit word");
+
+///@brief Block while *addr == expected, or until timeout.
+///@return false only if timed out, true if woken, value changed or interrupted.
+inline bool FutexWait(std::atomic<uint32_t>* addr, uint32_t expected,
+                      std::chrono::nanoseconds timeout) {
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeout.count() / 1000000000);
+    ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+
+    long rc = ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr),
+                        FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+    return !(rc == -1 && errno == ETIMEDOUT);
+}
+
+///@brief Block while *addr == expected.
+inline void FutexWait(std::atomic<uint32_t>* addr, uint32_t expected) {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr),
+              FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+}
+
+///@brief Wake up to n threads blocked on addr.
+inline void FutexWake(std::atomic<uint32_t>* addr, int n = INT_MAX) {
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr),
+              FUTEX_WAKE_PRIVATE, n, nullptr, nullptr, 0);
+}
+
+} // end namespace internal
+
+} // end namespace Miren
+
+#endif
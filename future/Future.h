@@ -2,14 +2,21 @@
 #define BERT_FUTURE_H
 
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
 #include <functional>
 #include <type_traits>
-#include <condition_variable>
 
 #include "future/Try.h"
 #include "future/Helper.h"
+#include "future/Futex.h"
 #include "future/Scheduler.h"
+#include "future/SmallFunction.h"
 
 #pragma GCC diagnostic ignored "-Wshadow"
 #pragma GCC diagnostic ignored "-Wpessimizing-move"
@@ -28,6 +35,19 @@ enum class Progress {
 
 using TimeoutCallback = std::function<void ()>;
 
+/*
+ * The shared state is lock free:
+ *
+ * progress_ decides who wins among SetValue/SetException/timeout, by CAS.
+ * The winner writes value_ and then publishes it by setting kHasResult.
+ *
+ * Then() writes the single continuation slot then_ and sets kHasCallback.
+ * Whoever of the two sets its bit second sees the other's bit, and runs
+ * the continuation, so it runs exactly once and never needs a lock.
+ *
+ * Wait() sets kHasWaiter and sleeps on the futex of flags_, so a
+ * producer only issues FUTEX_WAKE if someone really blocks.
+ */
 template <typename T>
 struct State {
     static_assert(std::is_same<T, void>::value ||
@@ -35,24 +55,73 @@ struct State {
                   std::is_move_constructible<T>(),
                   "must be copyable or movable or void");
 
+    using ValueType = typename TryWrapper<T>::Type;
+    using Callback = SmallFunction<void (ValueType&& )>;
+
+    static constexpr uint32_t kHasResult = 1 << 0;
+    static constexpr uint32_t kHasCallback = 1 << 1;
+    static constexpr uint32_t kHasWaiter = 1 << 2;
+
     State() :
         progress_(Progress::None),
+        flags_ {0},
         retrieved_ {false} {
     }
 
-    std::mutex thenLock_;
-
-    using ValueType = typename TryWrapper<T>::Type;
     ValueType value_;
-    std::function<void (ValueType&& )> then_;
-    Progress progress_;
+    Callback then_;
+    std::atomic<Progress> progress_;
+    std::atomic<uint32_t> flags_;
 
-    std::function<void (TimeoutCallback&& )> onTimeout_;
+    SmallFunction<void (TimeoutCallback&& )> onTimeout_;
     std::atomic<bool> retrieved_;
 
     bool IsRoot() const {
         return !onTimeout_;
     }
+
+    bool HasResult() const {
+        return flags_.load(std::memory_order_acquire) & kHasResult;
+    }
+
+    // Only one producer can win the right to write value_.
+    // A non-root future may still be done after it's timeout.
+    bool TryComplete(bool allowAfterTimeout) {
+        Progress expect = Progress::None;
+        if (progress_.compare_exchange_strong(expect, Progress::Done, std::memory_order_acq_rel))
+            return true;
+
+        return allowAfterTimeout && expect == Progress::Timeout &&
+               progress_.compare_exchange_strong(expect, Progress::Done, std::memory_order_acq_rel);
+    }
+
+    bool TryTimeout() {
+        Progress expect = Progress::None;
+        return progress_.compare_exchange_strong(expect, Progress::Timeout, std::memory_order_acq_rel);
+    }
+
+    // Called by the winner of TryComplete after value_ is written
+    void Publish() {
+        uint32_t old = flags_.fetch_or(kHasResult, std::memory_order_acq_rel);
+        if (old & kHasWaiter)
+            FutexWake(&flags_);
+        if (old & kHasCallback)
+            then_(std::move(value_));
+    }
+
+    // If result is already there, cb is called in this thread
+    void SetCallback(Callback&& cb) {
+        if (flags_.load(std::memory_order_acquire) & kHasResult) {
+            // fast path, no need to store it
+            cb(std::move(value_));
+            return;
+        }
+
+        then_ = std::move(cb);
+        uint32_t old = flags_.fetch_or(kHasCallback, std::memory_order_acq_rel);
+        if (old & kHasResult)
+            then_(std::move(value_));
+    }
 };
 
 } // end namespace internal
@@ -79,55 +148,33 @@ public:
     Promise& operator= (Promise&& pm) = default;
 
     void SetException(std::exception_ptr exp) {
-        std::unique_lock<std::mutex> guard(state_->thenLock_);
-        bool isRoot = state_->IsRoot();
-        if (isRoot && state_->progress_ != Progress::None)
+        if (!state_->TryComplete(!state_->IsRoot()))
             return;
 
-        state_->progress_ = Progress::Done;
         state_->value_ = typename State<T>::ValueType(std::move(exp));
-        guard.unlock();
-
-        if (state_->then_)
-            state_->then_(std::move(state_->value_));
+        state_->Publish();
     }
 
     template <typename SHIT = T>
     typename std::enable_if<!std::is_void<SHIT>::value, void>::type
     SetValue(SHIT&& t) {
-        // If ThenImp is running, here will wait for the lock.
-        // After set then_, ThenImp will release lock.
-        // And this func got lock, definitely will call then_.
-        std::unique_lock<std::mutex> guard(state_->thenLock_);
-        bool isRoot = state_->IsRoot();
-        if (isRoot && state_->progress_ != Progress::None)
+        // If ThenImp is running concurrently, exactly one of us
+        // will see the other's flag and call then_.
+        if (!state_->TryComplete(!state_->IsRoot()))
             return;
 
-        state_->progress_ = Progress::Done;
         state_->value_ = std::forward<SHIT>(t);
-
-        guard.unlock();
-
-        // When reach here, state_ is determined, so mutex is useless
-        // If the ThenImp function run, it'll see the Done state and
-        // call user func there, not assign to then_.
-        if (state_->then_)
-            state_->then_(std::move(state_->value_));
+        state_->Publish();
     }
 
     template <typename SHIT = T>
     typename std::enable_if<std::is_void<SHIT>::value, void>::type
     SetValue() {
-        std::unique_lock<std::mutex> guard(state_->thenLock_);
-        if (state_->progress_ != Progress::None)
+        if (!state_->TryComplete(false))
             return;
 
-        state_->progress_ = Progress::Done;
         state_->value_ = Try<void>();
-
-        guard.unlock();
-        if (state_->then_)
-            state_->then_(std::move(state_->value_));
+        state_->Publish();
     }
 
     Future<T> GetFuture() {
@@ -140,7 +187,7 @@ public:
     }
 
     bool IsReady() const {
-        return state_->progress_ != Progress::None;
+        return state_->progress_.load(std::memory_order_acquire) != Progress::None;
     }
 
 private:
@@ -180,50 +227,43 @@ public:
     // PAY ATTENTION to deadlock: Wait thread must NOT be same as promise thread!!!
     typename State<T>::ValueType
     Wait(const std::chrono::milliseconds& timeout = std::chrono::milliseconds(24*3600*1000)) {
-
-        std::unique_lock<std::mutex> guard(state_->thenLock_);
-        switch (state_->progress_) {
-            case Progress::None:
-                break;
-
+        switch (state_->progress_.load(std::memory_order_acquire)) {
             case Progress::Timeout:
                 throw std::runtime_error("Future timeout");
 
-            case Progress::Done:
-                state_->progress_ = Progress::Retrieved;
-                return std::move(state_->value_);
+            case Progress::Retrieved:
+                throw std::runtime_error("Future already retrieved");
 
             default:
-                throw std::runtime_error("Future already retrieved");
+                break;
+        }
+
+        // kHasWaiter may already be set by an earlier timed out Wait or by another waiter
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        uint32_t flags = state_->flags_.load(std::memory_order_acquire);
+        while (!(flags & State<T>::kHasResult)) {
+            if (!(flags & State<T>::kHasWaiter)) {
+                // announce we'll sleep, then re-check the result bit
+                flags = state_->flags_.fetch_or(State<T>::kHasWaiter, std::memory_order_acq_rel) |
+                        State<T>::kHasWaiter;
+                continue;
+            }
+
+            auto left = deadline - std::chrono::steady_clock::now();
+            if (left <= std::chrono::steady_clock::duration::zero()) {
+                if (!state_->HasResult())
+                    throw std::runtime_error("Future wait_for timeout");
+                break;
+            }
+
+            FutexWait(&state_->flags_, flags,
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(left));
+            flags = state_->flags_.load(std::memory_order_acquire);
         }
-        guard.unlock();
-
-        auto cond(std::make_shared<std::condition_variable>());
-        auto mutex(std::make_shared<std::mutex>());
-        bool ready = false;
-        typename State<T>::ValueType value;
-
-        this->Then([&value, &ready,
-                    wcond = std::weak_ptr<std::condition_variable>(cond),
-                    wmutex = std::weak_ptr<std::mutex>(mutex)](typename State<T>::ValueType&& v)
-                   {
-                       auto cond = wcond.lock();
-                       auto mutex = wmutex.lock();
-                       if (!cond || !mutex) return;
-
-                       std::unique_lock<std::mutex> guard(*mutex);
-                       value = std::move(v);
-                       ready = true;
-                       cond->notify_one();
-                   });
-
-        std::unique_lock<std::mutex> waiter(*mutex);
-        bool success = cond->wait_for(waiter, timeout, [&ready]() { return ready; } );
-        if (success)
-            return std::move(value);
-        else
-            throw std::runtime_error("Future wait_for timeout");
-     }
+
+        state_->progress_.store(Progress::Retrieved, std::memory_order_release);
+        return std::move(state_->value_);
+    }
 
     // T is of type Future<InnerType>
     template <typename SHIT = T>
@@ -236,10 +276,9 @@ public:
         Promise<InnerType> prom;
         Future<InnerType> fut = prom.GetFuture();
 
-        std::unique_lock<std::mutex> guard(state_->thenLock_);
-        if (state_->progress_ == Progress::Timeout) {
+        if (state_->progress_.load(std::memory_order_acquire) == Progress::Timeout) {
             throw std::runtime_error("Wrong state : Timeout");
-        } else if (state_->progress_ == Progress::Done) {
+        } else if (state_->HasResult()) {
             try {
                 auto innerFuture = std::move(state_->value_);
                 return std::move(innerFuture.Value());
@@ -294,72 +333,34 @@ public:
 
         using FuncType = typename std::decay<F>::type;
 
-        std::unique_lock<std::mutex> guard(state_->thenLock_);
-        if (state_->progress_ == Progress::Timeout) {
+        if (state_->progress_.load(std::memory_order_acquire) == Progress::Timeout)
             throw std::runtime_error("Wrong state : Timeout");
-        } else if (state_->progress_ == Progress::Done) {
-            typename TryWrapper<T>::Type t;
-            try {
-                t = std::move(state_->value_);
-            } catch(const std::exception& e) {
-                t = (typename TryWrapper<T>::Type)(std::current_exception());
-            }
 
-            guard.unlock();
+        // 1. set pm's timeout callback, if this future is not done yet
+        if (!state_->HasResult())
+            nextFuture._SetOnTimeout(_MakeTimeoutPropagator());
 
+        // 2. set this future's then callback, it's called at once if
+        // this future is already done.
+        _SetCallback([sched,
+                     func = std::forward<FuncType>(f),
+                     prom = std::move(pm)](typename TryWrapper<T>::Type&& t) mutable {
             if (sched) {
-                sched->Schedule([t = std::move(t),
-                                 f = std::forward<FuncType>(f),
-                                 pm = std::move(pm)]() mutable {
-                                     auto result = WrapWithTry(f, std::move(t));
-                                     pm.SetValue(std::move(result));
-                                 });
+                sched->Schedule([func = std::move(func),
+                                 t = std::move(t),
+                                 prom = std::move(prom)]() mutable {
+                                     // run callback, T can be void, thanks to folly
+                                     auto result = WrapWithTry(func, std::move(t));
+                                     // set next future's result
+                                     prom.SetValue(std::move(result));
+                              });
             } else {
-                auto result = WrapWithTry(f, std::move(t));
-                pm.SetValue(std::move(result));
+                // run callback, T can be void, thanks to folly Try<>
+                auto result = WrapWithTry(func, std::move(t));
+                // set next future's result
+                prom.SetValue(std::move(result));
             }
-        } else {
-            // 1. set pm's timeout callback
-            nextFuture._SetOnTimeout([weak_parent = std::weak_ptr<State<T>>(state_)](TimeoutCallback&& cb) {
-                auto parent = weak_parent.lock();
-                if (!parent)
-                    return;
-
-                {
-                    std::unique_lock<std::mutex> guard(parent->thenLock_);
-                    // if parent future is Done, let it go down
-                    if (parent->progress_ != Progress::None)
-                        return;
-
-                    parent->progress_ = Progress::Timeout;
-                }
-
-                if (!parent->IsRoot())
-                    parent->onTimeout_(std::move(cb)); // propogate to the root
-                else
-                    cb();
-            });
-            // 2. set this future's then callback
-            _SetCallback([sched,
-                         func = std::forward<FuncType>(f),
-                         prom = std::move(pm)](typename TryWrapper<T>::Type&& t) mutable {
-                if (sched) {
-                    sched->Schedule([func = std::move(func),
-                                     t = std::move(t),
-                                     prom = std::move(prom)]() mutable {
-                                         // run callback, T can be void, thanks to folly
-                                         auto result = WrapWithTry(func, std::move(t));
-                                         // set next future's result
-                                         prom.SetValue(std::move(result));
-                                  });
-                } else {
-                    // run callback, T can be void, thanks to folly Try<>
-                    auto result = WrapWithTry(func, std::move(t));
-                    // set next future's result
-                    prom.SetValue(std::move(result));
-                }
-            });
-        }
+        });
 
         return std::move(nextFuture);
     }
@@ -377,122 +378,44 @@ public:
 
         using FuncType = typename std::decay<F>::type;
 
-        std::unique_lock<std::mutex> guard(state_->thenLock_);
-        if (state_->progress_ == Progress::Timeout) {
+        if (state_->progress_.load(std::memory_order_acquire) == Progress::Timeout)
             throw std::runtime_error("Wrong state : Timeout");
-        } else if (state_->progress_ == Progress::Done) {
-            typename TryWrapper<T>::Type t;
-            try {
-                t = std::move(state_->value_);
-            } catch(const std::exception& e) {
-                t = decltype(t)(std::current_exception());
-            }
 
-            guard.unlock();
+        // 1. set pm's timeout callback, if this future is not done yet
+        if (!state_->HasResult())
+            nextFuture._SetOnTimeout(_MakeTimeoutPropagator());
+
+        // 2. set this future's then callback
+        _SetCallback([sched = sched,
+                     func = std::forward<FuncType>(f),
+                     prom = std::move(pm)](typename TryWrapper<T>::Type&& t) mutable {
 
-            auto cb = [res = std::move(t),
-                       f = std::forward<FuncType>(f),
-                       prom = std::move(pm)]() mutable {
+            auto cb = [func = std::move(func), t = std::move(t), prom = std::move(prom)]() mutable {
                 // because func return another future: innerFuture, when innerFuture is done, nextFuture can be done
-                decltype(f(res.template Get<Args>()...)) innerFuture;
-                if (res.HasException()) {
-                    innerFuture = f(typename TryWrapper<typename std::decay<Args...>::type>::Type(res.Exception()).template Get<Args>()...);
+                decltype(func(t.template Get<Args>()...)) innerFuture;
+                if (t.HasException()) {
+                    innerFuture = func(typename TryWrapper<typename std::decay<Args...>::type>::Type(t.Exception()).template Get<Args>()...);
                 } else {
-                    innerFuture = f(res.template Get<Args>()...);
+                    innerFuture = func(t.template Get<Args>()...);
                 }
 
                 if (!innerFuture.valid()) {
                     return;
                 }
 
-                std::unique_lock<std::mutex> guard(innerFuture.state_->thenLock_);
-                if (innerFuture.state_->progress_ == Progress::Timeout) {
+                if (innerFuture.state_->progress_.load(std::memory_order_acquire) == Progress::Timeout)
                     throw std::runtime_error("Wrong state : Timeout");
-                } else if (innerFuture.state_->progress_ == Progress::Done) {
-                    typename TryWrapper<FReturnType>::Type t;
-                    try {
-                        t = std::move(innerFuture.state_->value_);
-                    } catch(const std::exception& e) {
-                        t = decltype(t)(std::current_exception());
-                    }
 
-                    guard.unlock();
+                innerFuture._SetCallback([prom = std::move(prom)](typename TryWrapper<FReturnType>::Type&& t) mutable {
                     prom.SetValue(std::move(t));
-                } else {
-                    innerFuture._SetCallback([prom = std::move(prom)](typename TryWrapper<FReturnType>::Type&& t) mutable {
-                        prom.SetValue(std::move(t));
-                    });
-                }
+                });
             };
 
             if (sched)
                 sched->Schedule(std::move(cb));
             else
                 cb();
-        } else {
-            // 1. set pm's timeout callback
-            nextFuture._SetOnTimeout([weak_parent = std::weak_ptr<State<T>>(state_)](TimeoutCallback&& cb) {
-                auto parent = weak_parent.lock();
-                if (!parent)
-                    return;
-
-                {
-                    std::unique_lock<std::mutex> guard(parent->thenLock_);
-                    if (parent->progress_ != Progress::None)
-                        return;
-
-                    parent->progress_ = Progress::Timeout;
-                }
-
-                if (!parent->IsRoot())
-                    parent->onTimeout_(std::move(cb)); // propogate to the root
-                else
-                    cb();
-
-            });
-            // 2. set this future's then callback
-            _SetCallback([sched = sched,
-                         func = std::forward<FuncType>(f),
-                         prom = std::move(pm)](typename TryWrapper<T>::Type&& t) mutable {
-
-                auto cb = [func = std::move(func), t = std::move(t), prom = std::move(prom)]() mutable {
-                    // because func return another future: innerFuture, when innerFuture is done, nextFuture can be done
-                    decltype(func(t.template Get<Args>()...)) innerFuture;
-                    if (t.HasException()) {
-                        innerFuture = func(typename TryWrapper<typename std::decay<Args...>::type>::Type(t.Exception()).template Get<Args>()...);
-                    } else {
-                        innerFuture = func(t.template Get<Args>()...);
-                    }
-
-                    if (!innerFuture.valid()) {
-                        return;
-                    }
-                    std::unique_lock<std::mutex> guard(innerFuture.state_->thenLock_);
-                    if (innerFuture.state_->progress_ == Progress::Timeout) {
-                        throw std::runtime_error("Wrong state : Timeout");
-                    } else if (innerFuture.state_->progress_ == Progress::Done) {
-                        typename TryWrapper<FReturnType>::Type t;
-                        try {
-                            t = std::move(innerFuture.state_->value_);
-                        } catch(const std::exception& e) {
-                            t = decltype(t)(std::current_exception());
-                        }
-
-                        guard.unlock();
-                        prom.SetValue(std::move(t));
-                    } else {
-                        innerFuture._SetCallback([prom = std::move(prom)](typename TryWrapper<FReturnType>::Type&& t) mutable {
-                            prom.SetValue(std::move(t));
-                        });
-                    }
-                };
-
-                if (sched)
-                    sched->Schedule(std::move(cb));
-                else
-                    cb();
-            });
-        }
+        });
 
         return std::move(nextFuture);
     }
@@ -523,14 +446,8 @@ public:
                    TimeoutCallback f,
                    Scheduler* scheduler) {
         scheduler->ScheduleLater(duration, [state = state_, cb = std::move(f)]() mutable {
-            {
-                std::unique_lock<std::mutex> guard(state->thenLock_);
-
-                if (state->progress_ != Progress::None)
-                    return;
-
-                state->progress_ = Progress::Timeout;
-            }
+            if (!state->TryTimeout())
+                return;
 
             if (!state->IsRoot())
                 state->onTimeout_(std::move(cb)); // propogate to the root future
@@ -540,14 +457,31 @@ public:
     }
 
 private:
-    void _SetCallback(std::function<void (typename TryWrapper<T>::Type&& )>&& func) {
-        state_->then_ = std::move(func);
+    void _SetCallback(typename State<T>::Callback&& func) {
+        state_->SetCallback(std::move(func));
     }
 
-    void _SetOnTimeout(std::function<void (TimeoutCallback&& )>&& func) {
+    void _SetOnTimeout(SmallFunction<void (TimeoutCallback&& )>&& func) {
         state_->onTimeout_ = std::move(func);
     }
 
+    // Timeout of the next future is propogated up to the root
+    auto _MakeTimeoutPropagator() const {
+        return [weak_parent = std::weak_ptr<State<T>>(state_)](TimeoutCallback&& cb) {
+            auto parent = weak_parent.lock();
+            if (!parent)
+                return;
+
+            // if parent future is Done, let it go down
+            if (!parent->TryTimeout())
+                return;
+
+            if (!parent->IsRoot())
+                parent->onTimeout_(std::move(cb)); // propogate to the root
+            else
+                cb();
+        };
+    }
 
     std::shared_ptr<State<T>> state_;
 };
@@ -588,6 +522,82 @@ inline Future<T2> MakeExceptionFuture(std::exception_ptr&& eptr) {
 }
 
 
+namespace internal {
+
+// Contexts shared by the iterator and the variadic versions of When*.
+// Result slots are preallocated, every future writes its own slot, so
+// no lock is taken per element.
+
+template <typename TryT>
+struct AllContext {
+    explicit
+    AllContext(size_t n) : results(n) {}
+
+    template <typename FT>
+    static void Attach(const std::shared_ptr<AllContext>& ctx, size_t i, FT& fut) {
+        fut.Then([ctx, i](TryT&& t) {
+            ctx->results[i] = std::move(t);
+            if (ctx->collected.fetch_add(1, std::memory_order_acq_rel) + 1 == ctx->results.size())
+                ctx->pm.SetValue(std::move(ctx->results));
+        });
+    }
+
+    Promise<std::vector<TryT>> pm;
+    std::vector<TryT> results;
+    std::atomic<size_t> collected {0};
+};
+
+template <typename TryT>
+struct AnyContext {
+    template <typename FT>
+    static void Attach(const std::shared_ptr<AnyContext>& ctx, size_t i, FT& fut) {
+        fut.Then([ctx, i](TryT&& t) {
+            if (!ctx->done.exchange(true, std::memory_order_acq_rel))
+                ctx->pm.SetValue(std::make_pair(i, std::move(t)));
+        });
+    }
+
+    Promise<std::pair<size_t, TryT>> pm;
+    std::atomic<bool> done {false};
+};
+
+template <typename TryT>
+struct NContext {
+    explicit
+    NContext(size_t needs) : results(needs) {}
+
+    template <typename FT>
+    static void Attach(const std::shared_ptr<NContext>& ctx, size_t i, FT& fut) {
+        fut.Then([ctx, i](TryT&& t) {
+            // claim a slot in arrival order, late comers are dropped
+            const size_t slot = ctx->claimed.fetch_add(1, std::memory_order_relaxed);
+            if (slot >= ctx->results.size())
+                return;
+
+            ctx->results[slot] = std::make_pair(i, std::move(t));
+            if (ctx->filled.fetch_add(1, std::memory_order_acq_rel) + 1 == ctx->results.size())
+                ctx->pm.SetValue(std::move(ctx->results));
+        });
+    }
+
+    Promise<std::vector<std::pair<size_t, TryT>>> pm;
+    std::vector<std::pair<size_t, TryT>> results;
+    std::atomic<size_t> claimed {0};
+    std::atomic<size_t> filled {0};
+};
+
+template <typename FT, typename... FTs>
+struct SameInnerType {
+    using Inner = typename std::decay<FT>::type::InnerType;
+    static constexpr bool value =
+        std::conjunction<std::is_same<Inner, typename std::decay<FTs>::type::InnerType>...>::value;
+};
+
+template <typename FT>
+using EnableIfFuture = typename std::enable_if<IsFuture<typename std::decay<FT>::type>::value>::type;
+
+} // end namespace internal
+
 // When All
 template <typename... FT>
 typename CollectAllVariadicContext<typename std::decay<FT>::type::InnerType...>::FutureType
@@ -610,29 +620,9 @@ WhenAll(InputIterator first, InputIterator last) {
     if (first == last)
         return MakeReadyFuture(std::vector<TryT>());
 
-    struct AllContext {
-        AllContext(int n) : results(n) {}
-        ~AllContext() {
-            // I think this line is useless.
-            // pm.SetValue(std::move(results));
-        }
-
-        Promise<std::vector<TryT>> pm;
-        std::vector<TryT> results;
-        std::atomic<size_t> collected{0};
-    };
-
-    auto ctx = std::make_shared<AllContext>(std::distance(first, last));
-
-    for (size_t i = 0; first != last; ++first, ++i) {
-        first->Then([ctx, i](TryT&& t) {
-            ctx->results[i] = std::move(t);
-            if (ctx->results.size() - 1 ==
-                    std::atomic_fetch_add (&ctx->collected, std::size_t(1))) {
-                ctx->pm.SetValue(std::move(ctx->results));
-            }
-        });
-    }
+    auto ctx = std::make_shared<AllContext<TryT>>(std::distance(first, last));
+    for (size_t i = 0; first != last; ++first, ++i)
+        AllContext<TryT>::Attach(ctx, i, *first);
 
     return ctx->pm.GetFuture();
 }
@@ -650,20 +640,26 @@ WhenAny(InputIterator first, InputIterator last) {
         return MakeReadyFuture(std::make_pair(size_t(0), TryT()));
     }
 
-    struct AnyContext {
-        AnyContext() {};
-        Promise<std::pair<size_t, TryT>> pm;
-        std::atomic<bool> done{false};
-    };
+    auto ctx = std::make_shared<AnyContext<TryT>>();
+    for (size_t i = 0; first != last; ++first, ++i)
+        AnyContext<TryT>::Attach(ctx, i, *first);
 
-    auto ctx = std::make_shared<AnyContext>();
-    for (size_t i = 0; first != last; ++first, ++i) {
-        first->Then([ctx, i](TryT&& t) {
-            if (!ctx->done.exchange(true)) {
-                ctx->pm.SetValue(std::make_pair(i, std::move(t)));
-            }
-        });
-    }
+    return ctx->pm.GetFuture();
+}
+
+// When Any, variadic version, futures must have the same inner type
+template <typename FT, typename... FTs, typename = EnableIfFuture<FT>>
+Future<
+      std::pair<size_t, typename TryWrapper<typename std::decay<FT>::type::InnerType>::Type>
+      >
+WhenAny(FT&& head, FTs&&... tail) {
+    static_assert(SameInnerType<FT, FTs...>::value, "WhenAny needs futures of same type");
+    using TryT = typename TryWrapper<typename std::decay<FT>::type::InnerType>::Type;
+
+    auto ctx = std::make_shared<AnyContext<TryT>>();
+    size_t i = 0;
+    AnyContext<TryT>::Attach(ctx, i++, head);
+    (AnyContext<TryT>::Attach(ctx, i++, tail), ...);
 
     return ctx->pm.GetFuture();
 }
@@ -685,32 +681,32 @@ WhenN(size_t N, InputIterator first, InputIterator last) {
         return MakeReadyFuture(std::vector<std::pair<size_t, TryT>>());
     }
 
-    struct NContext {
-        NContext(size_t _needs) : needs(_needs) {}
-        Promise<std::vector<std::pair<size_t, TryT>>> pm;
+    auto ctx = std::make_shared<NContext<TryT>>(needCollect);
+    for (size_t i = 0; first != last; ++first, ++i)
+        NContext<TryT>::Attach(ctx, i, *first);
 
-        std::mutex mutex;
-        std::vector<std::pair<size_t, TryT>> results;
-        const size_t needs;
-        bool done {false};
-    };
+    return ctx->pm.GetFuture();
+}
 
-    auto ctx = std::make_shared<NContext>(needCollect);
-    for (size_t i = 0; first != last; ++first, ++i) {
-        first->Then([ctx, i](TryT&& t) {
-            std::unique_lock<std::mutex> guard(ctx->mutex);
-            if (ctx->done)
-                return;
+// When N, variadic version, futures must have the same inner type
+template <typename FT, typename... FTs, typename = EnableIfFuture<FT>>
+Future<
+     std::vector<std::pair<size_t, typename TryWrapper<typename std::decay<FT>::type::InnerType>::Type>>
+      >
+WhenN(size_t N, FT&& head, FTs&&... tail) {
+    static_assert(SameInnerType<FT, FTs...>::value, "WhenN needs futures of same type");
+    using TryT = typename TryWrapper<typename std::decay<FT>::type::InnerType>::Type;
 
-            ctx->results.push_back(std::make_pair(i, std::move(t)));
-            if (ctx->needs == ctx->results.size()) {
-                ctx->done = true;
-                guard.unlock();
-                ctx->pm.SetValue(std::move(ctx->results));
-            }
-        });
+    const size_t needCollect = std::min<size_t>(1 + sizeof...(FTs), N);
+    if (needCollect == 0) {
+        return MakeReadyFuture(std::vector<std::pair<size_t, TryT>>());
     }
 
+    auto ctx = std::make_shared<NContext<TryT>>(needCollect);
+    size_t i = 0;
+    NContext<TryT>::Attach(ctx, i++, head);
+    (NContext<TryT>::Attach(ctx, i++, tail), ...);
+
     return ctx->pm.GetFuture();
 }
 
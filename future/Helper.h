@@ -23,7 +23,7 @@
 #include <tuple>
 #include <vector>
 #include <memory>
-#include <mutex>
+#include <atomic>
 
 namespace Miren {
 
@@ -145,14 +145,13 @@ struct CollectAllVariadicContext {
     void operator= (const CollectAllVariadicContext& ) = delete;
 
     // 设置部分结果的方法，通过索引I设置对应的结果值，并在所有结果收集完成后设置最终的Promise
+    // Every future owns its own slot of the tuple, no lock is needed,
+    // the last one arrived publishes the tuple.
     template <typename T, size_t I>
     inline void SetPartialResult(typename TryWrapper<T>::Type&& t) {
-        std::unique_lock<std::mutex> guard(mutex);
-
         std::get<I>(results) = std::move(t);
-        collects.push_back(I);
-        if (collects.size() == std::tuple_size<decltype(results)>::value) {
-            guard.unlock();
+        if (collected.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+                std::tuple_size<decltype(results)>::value) {
             pm.SetValue(std::move(results));
         }
     }
@@ -161,11 +160,10 @@ struct CollectAllVariadicContext {
 #define _TRYELEM_ typename TryWrapper<ELEM>::Type...
     // Promise用于存储收集到的所有结果
     Promise<std::tuple<_TRYELEM_>> pm;
-    std::mutex mutex;
     // 存储每个异步操作的结果。
     std::tuple<_TRYELEM_> results;
-    // 记录已收集结果的索引
-    std::vector<size_t> collects;
+    // 已收集结果的个数
+    std::atomic<size_t> collected {0};
     // 返回类型为包含所有结果的Future。
     typedef Future<std::tuple<_TRYELEM_>>FutureType;
 #undef _TRYELEM_
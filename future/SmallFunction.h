@@ -0,0 +1,145 @@
+#ifndef BERT_SMALLFUNCTION_H
+#define BERT_SMALLFUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+///@file SmallFunction.h
+///@brief A move-only std::function replacement with inline storage.
+///
+/// Callables up to N bytes are stored in place, bigger ones on heap.
+/// Unlike std::function, lambdas with move-only captures are allowed,
+/// so a Promise can be moved into a continuation instead of copied.
+namespace Miren {
+
+namespace internal {
+
+template <typename Sig, size_t N = 64>
+class SmallFunction;
+
+template <typename R, typename... Args, size_t N>
+class SmallFunction<R (Args...), N> {
+public:
+    SmallFunction() noexcept = default;
+
+    SmallFunction(std::nullptr_t) noexcept {
+    }
+
+    template <typename F,
+              typename D = typename std::decay<F>::type,
+              typename = typename std::enable_if<!std::is_same<D, SmallFunction>::value>::type>
+    SmallFunction(F&& f) {
+        _Init<D>(std::forward<F>(f), std::integral_constant<bool, kFitsInline<D>>());
+    }
+
+    SmallFunction(SmallFunction&& other) noexcept {
+        _MoveFrom(other);
+    }
+
+    SmallFunction& operator= (SmallFunction&& other) noexcept {
+        if (this != &other) {
+            _Reset();
+            _MoveFrom(other);
+        }
+        return *this;
+    }
+
+    SmallFunction& operator= (std::nullptr_t) noexcept {
+        _Reset();
+        return *this;
+    }
+
+    SmallFunction(const SmallFunction& ) = delete;
+    void operator= (const SmallFunction& ) = delete;
+
+    ~SmallFunction() {
+        _Reset();
+    }
+
+    explicit operator bool() const noexcept {
+        return ops_ != nullptr;
+    }
+
+    R operator()(Args... args) {
+        return ops_->invoke(&storage_, std::forward<Args>(args)...);
+    }
+
+private:
+    struct Ops {
+        R (*invoke)(void* self, Args&&... args);
+        void (*move)(void* dst, void* src) noexcept;
+        void (*destroy)(void* self) noexcept;
+    };
+
+    template <typename F>
+    static constexpr bool kFitsInline = sizeof(F) <= N &&
+                                        alignof(F) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible<F>::value;
+
+    template <typename F>
+    struct InlineOps {
+        static R Invoke(void* self, Args&&... args) {
+            return (*static_cast<F*>(self))(std::forward<Args>(args)...);
+        }
+        static void Move(void* dst, void* src) noexcept {
+            new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+        static void Destroy(void* self) noexcept {
+            static_cast<F*>(self)->~F();
+        }
+        static constexpr Ops kOps = {&Invoke, &Move, &Destroy};
+    };
+
+    template <typename F>
+    struct HeapOps {
+        static R Invoke(void* self, Args&&... args) {
+            return (**static_cast<F**>(self))(std::forward<Args>(args)...);
+        }
+        static void Move(void* dst, void* src) noexcept {
+            *static_cast<F**>(dst) = *static_cast<F**>(src);
+        }
+        static void Destroy(void* self) noexcept {
+            delete *static_cast<F**>(self);
+        }
+        static constexpr Ops kOps = {&Invoke, &Move, &Destroy};
+    };
+
+    template <typename F, typename G>
+    void _Init(G&& f, std::true_type /* inline */) {
+        new (&storage_) F(std::forward<G>(f));
+        ops_ = &InlineOps<F>::kOps;
+    }
+
+    template <typename F, typename G>
+    void _Init(G&& f, std::false_type /* heap */) {
+        *reinterpret_cast<F**>(&storage_) = new F(std::forward<G>(f));
+        ops_ = &HeapOps<F>::kOps;
+    }
+
+    void _MoveFrom(SmallFunction& other) noexcept {
+        if (other.ops_) {
+            other.ops_->move(&storage_, &other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    void _Reset() noexcept {
+        if (ops_) {
+            ops_->destroy(&storage_);
+            ops_ = nullptr;
+        }
+    }
+
+    typename std::aligned_storage<N, alignof(std::max_align_t)>::type storage_;
+    const Ops* ops_ {nullptr};
+};
+
+} // end namespace internal
+
+} // end namespace Miren
+
+#endif
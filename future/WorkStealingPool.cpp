@@ -0,0 +1,250 @@
+#include <cassert>
+#include <algorithm>
+#include "future/WorkStealingPool.h"
+
+namespace Miren {
+
+namespace {
+
+// The pool and worker index of current thread, so that
+// tasks submitted from inside a worker go to its own deque.
+thread_local WorkStealingPool* t_pool = nullptr;
+thread_local size_t t_index = 0;
+
+inline uint32_t XorShift(uint32_t& seed) {
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+} // end anonymous namespace
+
+std::thread::id WorkStealingPool::s_mainThread;
+
+WorkStealingPool::WorkStealingPool() {
+    // init main thread id
+    s_mainThread = std::this_thread::get_id();
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    JoinAll();
+
+    // JoinAll is a no-op in other threads, or never started
+    for (auto& w : workers_) {
+        Task* task = nullptr;
+        while (w->deque.Pop(task))
+            delete task;
+    }
+    for (Task* task : injection_)
+        delete task;
+}
+
+void WorkStealingPool::SetNumOfThreads(int n) {
+    assert(n >= 0 && n <= kMaxThreads);
+    numThreads_ = n;
+}
+
+void WorkStealingPool::_StartIfNeeded() {
+    if (started_.load(std::memory_order_acquire))
+        return;
+
+    std::unique_lock<std::mutex> guard(mutex_);
+    if (started_.load(std::memory_order_relaxed) || shutdown_)
+        return;
+
+    assert(workers_.empty());
+
+    // Create all deques before any thread may steal from them
+    for (int i = 0; i < numThreads_; i++)
+        workers_.emplace_back(new Worker());
+
+    for (size_t i = 0; i < workers_.size(); i++)
+        workers_[i]->thread = std::thread([this, i]() { this->_WorkerRoutine(i); });
+
+    started_.store(true, std::memory_order_release);
+}
+
+void WorkStealingPool::_Submit(Task&& f) {
+    _StartIfNeeded();
+
+    Task* task = new Task(std::move(f));
+    if (t_pool == this) {
+        // Only the owner pushes to its deque, no lock needed
+        workers_[t_index]->deque.Push(task);
+    } else {
+        std::unique_lock<std::mutex> guard(mutex_);
+        injection_.push_back(task);
+        injectionSize_.store(injection_.size(), std::memory_order_relaxed);
+    }
+
+    // Pairs with the fence in _WorkerRoutine: either we see the
+    // sleeper, or the sleeper sees our task.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle_.load(std::memory_order_relaxed) > 0)
+        _WakeOne();
+}
+
+void WorkStealingPool::_WakeOne() {
+    // Take the lock so the notify can't slip between a sleeper's
+    // last check and its wait.
+    std::unique_lock<std::mutex> guard(mutex_);
+    cond_.notify_one();
+}
+
+void WorkStealingPool::Schedule(std::function<void()> f) {
+    // Continuations are accepted even while joining: workers drain
+    // everything before exit, and leftovers are freed by destructor.
+    _Submit(std::move(f));
+}
+
+void WorkStealingPool::ScheduleLater(std::chrono::milliseconds duration, std::function<void()> f) {
+    if (shutdown_.load(std::memory_order_acquire))
+        return;
+
+    _StartIfNeeded();
+
+    std::unique_lock<std::mutex> guard(mutex_);
+    timers_.push_back(DelayedTask{std::chrono::steady_clock::now() + duration, std::move(f)});
+    std::push_heap(timers_.begin(), timers_.end());
+    // A sleeper may need to shorten its wait
+    cond_.notify_one();
+}
+
+void WorkStealingPool::_RunDueTimers() {
+    // called with mutex_ held
+    auto now = std::chrono::steady_clock::now();
+    while (!timers_.empty() && timers_.front().when <= now) {
+        std::pop_heap(timers_.begin(), timers_.end());
+        injection_.push_back(new Task(std::move(timers_.back().task)));
+        timers_.pop_back();
+    }
+    injectionSize_.store(injection_.size(), std::memory_order_relaxed);
+}
+
+void WorkStealingPool::JoinAll() {
+    if (s_mainThread != std::this_thread::get_id())
+        return;
+
+    {
+        std::unique_lock<std::mutex> guard(mutex_);
+        if (shutdown_)
+            return;
+
+        shutdown_ = true;
+        timers_.clear();
+        cond_.notify_all();
+    }
+
+    for (auto& w : workers_) {
+        if (w->thread.joinable())
+            w->thread.join();
+    }
+}
+
+WorkStealingPool::Task* WorkStealingPool::_StealFromOthers(size_t index, uint32_t& seed) {
+    const size_t n = workers_.size();
+    if (n <= 1)
+        return nullptr;
+
+    // Random victim to spread thieves, then walk around
+    const size_t start = XorShift(seed) % n;
+    for (size_t i = 0; i < n; i++) {
+        size_t victim = (start + i) % n;
+        if (victim == index)
+            continue;
+
+        Task* task = nullptr;
+        if (workers_[victim]->deque.Steal(task))
+            return task;
+    }
+
+    return nullptr;
+}
+
+WorkStealingPool::Task* WorkStealingPool::_FindTask(size_t index, uint32_t& seed) {
+    Task* task = nullptr;
+    if (workers_[index]->deque.Pop(task))
+        return task;
+
+    if (injectionSize_.load(std::memory_order_relaxed) > 0) {
+        std::unique_lock<std::mutex> guard(mutex_);
+        if (!injection_.empty()) {
+            task = injection_.front();
+            injection_.pop_front();
+            injectionSize_.store(injection_.size(), std::memory_order_relaxed);
+            return task;
+        }
+    }
+
+    return _StealFromOthers(index, seed);
+}
+
+bool WorkStealingPool::_HasWork() const {
+    if (!injection_.empty())
+        return true;
+
+    for (const auto& w : workers_) {
+        if (!w->deque.Empty())
+            return true;
+    }
+
+    return false;
+}
+
+void WorkStealingPool::_WorkerRoutine(size_t index) {
+    t_pool = this;
+    t_index = index;
+    uint32_t seed = static_cast<uint32_t>(index * 2654435761u + 1);
+
+    while (true) {
+        Task* task = _FindTask(index, seed);
+
+        for (int spin = 0; !task && spin < kSpinRounds; ++spin) {
+            std::this_thread::yield();
+            task = _FindTask(index, seed);
+        }
+
+        if (task) {
+            (*task)();
+            delete task;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(mutex_);
+        _RunDueTimers();
+
+        idle_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!_HasWork()) {
+            if (shutdown_) {
+                idle_.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+
+            if (timers_.empty())
+                cond_.wait(guard);
+            else
+                cond_.wait_until(guard, timers_.front().when);
+        }
+
+        idle_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+size_t WorkStealingPool::WorkerThreads() const {
+    std::unique_lock<std::mutex> guard(mutex_);
+    return workers_.size();
+}
+
+size_t WorkStealingPool::Tasks() const {
+    std::unique_lock<std::mutex> guard(mutex_);
+    size_t n = injection_.size();
+    for (const auto& w : workers_)
+        n += w->deque.Size();
+
+    return n;
+}
+
+} // end namespace Miren
@@ -0,0 +1,179 @@
+#ifndef BERT_WORKSTEALINGPOOL_H
+#define BERT_WORKSTEALINGPOOL_H
+
+#include <deque>
+#include <thread>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <condition_variable>
+#include "future/Future.h"
+#include "future/ChaseLevDeque.h"
+
+///@file WorkStealingPool.h
+///@brief A work-stealing ThreadPool with the same Future interface.
+///
+/// Every worker owns a Chase-Lev deque. Tasks submitted from inside a
+/// worker (e.g. fork/join subtasks, or Then continuations scheduled on
+/// this pool) are pushed to that worker's deque without any lock, and
+/// popped LIFO for cache locality. Idle workers steal FIFO from others.
+/// Tasks submitted from outside go to a shared injection queue.
+///
+/// Usage is the same as ThreadPool:
+///@code
+/// pool.Execute(your_heavy_work, some_args)
+///     .Then(&pool, process_heavy_work_result)
+///@endcode
+namespace Miren {
+
+///@brief Work-stealing thread pool, also usable as a Scheduler.
+class WorkStealingPool final : public Scheduler {
+public:
+    WorkStealingPool();
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool& ) = delete;
+    void operator=(const WorkStealingPool& ) = delete;
+
+    ///@brief Execute work in this pool
+    ///@return A future, you can register callback on it
+    ///when f is done or timeout.
+    ///
+    /// If called from a worker of this pool, f goes to that
+    /// worker's local deque, otherwise to the injection queue.
+    ///
+    /// F returns non-void
+    template <typename F, typename... Args,
+              typename = typename std::enable_if<!std::is_void<typename std::result_of<F (Args...)>::type>::value, void>::type,
+              typename Dummy = void>
+    auto Execute(F&& f, Args&&... args) -> Future<typename std::result_of<F (Args...)>::type>;
+
+    ///@brief Execute work in this pool
+    ///
+    /// F returns void
+    template <typename F, typename... Args,
+              typename = typename std::enable_if<std::is_void<typename std::result_of<F (Args...)>::type>::value, void>::type>
+    auto Execute(F&& f, Args&&... args) -> Future<void>;
+
+    ///@brief Scheduler interface, lets Then(&pool, f) run f on a worker
+    void Schedule(std::function<void()> f) override;
+
+    ///@brief Scheduler interface, f is run by a worker after duration
+    void ScheduleLater(std::chrono::milliseconds duration, std::function<void()> f) override;
+
+    ///@brief Stop thread pool and wait all threads terminate
+    ///
+    /// Queued tasks are still executed before workers exit.
+    void JoinAll();
+
+    ///@brief Set number of threads
+    ///
+    /// Num of threads is fixed after start thread pool
+    /// Default value is 1
+    void SetNumOfThreads(int );
+
+    // ---- below are for unittest ----
+    // num of workers
+    size_t WorkerThreads() const;
+    // num of waiting tasks, approximate while running
+    size_t Tasks() const;
+
+private:
+    using Task = std::function<void ()>;
+
+    struct Worker {
+        Worker() : deque(256) { }
+
+        ChaseLevDeque<Task*> deque;
+        std::thread thread;
+    };
+
+    struct DelayedTask {
+        std::chrono::steady_clock::time_point when;
+        Task task;
+
+        bool operator<(const DelayedTask& other) const {
+            return when > other.when; // min heap
+        }
+    };
+
+    void _Submit(Task&& task);
+    void _WorkerRoutine(size_t index);
+    void _StartIfNeeded();
+    Task* _FindTask(size_t index, uint32_t& seed);
+    Task* _StealFromOthers(size_t index, uint32_t& seed);
+    bool _HasWork() const;
+    void _WakeOne();
+    void _RunDueTimers();
+
+    int numThreads_ {1};
+    std::atomic<bool> started_ {false};
+    std::atomic<bool> shutdown_ {false};
+    std::vector<std::unique_ptr<Worker>> workers_;
+
+    // guards injection_, timers_, startup and sleeping
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    std::deque<Task*> injection_;
+    std::atomic<size_t> injectionSize_ {0};
+    std::vector<DelayedTask> timers_;
+    std::atomic<int> idle_ {0};
+
+    static const int kMaxThreads = 512;
+    static const int kSpinRounds = 64;
+    static std::thread::id s_mainThread;
+};
+
+
+// if F return something
+template <typename F, typename... Args, typename, typename >
+auto WorkStealingPool::Execute(F&& f, Args&&... args) -> Future<typename std::result_of<F (Args...)>::type> {
+    using resultType = typename std::result_of<F (Args...)>::type;
+
+    if (shutdown_.load(std::memory_order_acquire))
+        throw std::runtime_error("execute on closed thread pool");
+
+    Promise<resultType> promise;
+    auto future = promise.GetFuture();
+
+    auto func = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+    _Submit([t = std::move(func), pm = std::move(promise)]() mutable {
+        try {
+            pm.SetValue(Try<resultType>(t()));
+        } catch(...) {
+            pm.SetException(std::current_exception());
+        }
+    });
+
+    return future;
+}
+
+// F return void
+template <typename F, typename... Args, typename >
+auto WorkStealingPool::Execute(F&& f, Args&&... args) -> Future<void> {
+    using resultType = typename std::result_of<F (Args...)>::type;
+    static_assert(std::is_void<resultType>::value, "must be void");
+
+    if (shutdown_.load(std::memory_order_acquire))
+        return MakeReadyFuture();
+
+    Promise<resultType> promise;
+    auto future = promise.GetFuture();
+
+    auto func = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
+    _Submit([t = std::move(func), pm = std::move(promise)]() mutable {
+        try {
+            t();
+            pm.SetValue();
+        } catch(...) {
+            pm.SetException(std::current_exception());
+        }
+    });
+
+    return future;
+}
+
+} // end namespace Miren
+
+#endif
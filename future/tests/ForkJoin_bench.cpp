@@ -0,0 +1,129 @@
+#include "future/ThreadPool.h"
+#include "future/WorkStealingPool.h"
+#include "future/Future.h"
+
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <vector>
+#include <stdio.h>
+
+///@file ForkJoin_bench.cpp
+///@brief Fork/join workloads on ThreadPool vs WorkStealingPool.
+///
+/// Subtasks are spawned from inside workers, so ThreadPool pushes all
+/// of them through its single locked deque while WorkStealingPool
+/// keeps them on the spawning worker's local deque.
+using namespace Miren;
+
+namespace {
+
+const int kThreads[] = {1, 2, 4, 8};
+
+long SerialFib(int n) {
+    return n < 2 ? n : SerialFib(n - 1) + SerialFib(n - 2);
+}
+
+// Shared by all tasks of one run, finished when pending drops to 0
+struct Join {
+    std::atomic<long> result {0};
+    std::atomic<long> pending {1};
+    Promise<void> done;
+
+    void Finish(long value) {
+        result.fetch_add(value, std::memory_order_relaxed);
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            done.SetValue();
+    }
+};
+
+template <typename Pool>
+void Fib(Pool* pool, Join* join, int n, int cutoff) {
+    if (n <= cutoff) {
+        join->Finish(SerialFib(n));
+        return;
+    }
+
+    join->pending.fetch_add(2, std::memory_order_relaxed);
+    pool->Execute([=]() { Fib(pool, join, n - 1, cutoff); });
+    pool->Execute([=]() { Fib(pool, join, n - 2, cutoff); });
+    join->Finish(0);
+}
+
+template <typename Pool>
+void Reduce(Pool* pool, Join* join, const std::vector<long>* data,
+            size_t begin, size_t end, size_t grain) {
+    if (end - begin <= grain) {
+        join->Finish(std::accumulate(data->begin() + begin, data->begin() + end, 0L));
+        return;
+    }
+
+    size_t mid = begin + (end - begin) / 2;
+    join->pending.fetch_add(2, std::memory_order_relaxed);
+    pool->Execute([=]() { Reduce(pool, join, data, begin, mid, grain); });
+    pool->Execute([=]() { Reduce(pool, join, data, mid, end, grain); });
+    join->Finish(0);
+}
+
+template <typename Pool, typename F>
+double Run(int threads, F&& root, long& result) {
+    Pool pool;
+    pool.SetNumOfThreads(threads);
+    // warm up, start workers
+    pool.Execute([]() {}).Wait();
+
+    Join join;
+    auto fut = join.done.GetFuture();
+
+    auto start = std::chrono::steady_clock::now();
+    pool.Execute([&]() { root(&pool, &join); });
+    fut.Wait();
+    auto end = std::chrono::steady_clock::now();
+
+    result = join.result.load();
+    pool.JoinAll();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+template <typename Pool>
+void BenchFib(const char* name, int threads, int n, int cutoff) {
+    long result = 0;
+    double ms = Run<Pool>(threads, [=](Pool* pool, Join* join) {
+        Fib(pool, join, n, cutoff);
+    }, result);
+
+    printf("fib(%d) cutoff=%d %-16s threads=%d %10.2f ms result=%ld\n",
+           n, cutoff, name, threads, ms, result);
+}
+
+template <typename Pool>
+void BenchReduce(const char* name, int threads, const std::vector<long>& data, size_t grain) {
+    long result = 0;
+    double ms = Run<Pool>(threads, [&data, grain](Pool* pool, Join* join) {
+        Reduce(pool, join, &data, 0, data.size(), grain);
+    }, result);
+
+    printf("reduce(%zu) grain=%zu %-16s threads=%d %10.2f ms result=%ld\n",
+           data.size(), grain, name, threads, ms, result);
+}
+
+} // end anonymous namespace
+
+int main(int argc, char* argv[]) {
+    const int n = argc > 1 ? atoi(argv[1]) : 30;
+    const int cutoff = argc > 2 ? atoi(argv[2]) : 12;
+
+    for (int threads : kThreads) {
+        BenchFib<ThreadPool>("ThreadPool", threads, n, cutoff);
+        BenchFib<WorkStealingPool>("WorkStealingPool", threads, n, cutoff);
+    }
+
+    std::vector<long> data(1 << 24);
+    std::iota(data.begin(), data.end(), 0L);
+    for (int threads : kThreads) {
+        BenchReduce<ThreadPool>("ThreadPool", threads, data, 4096);
+        BenchReduce<WorkStealingPool>("WorkStealingPool", threads, data, 4096);
+    }
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include "future/Future.h"
+
+#include <chrono>
+#include <stdio.h>
+
+///@file FutureChain_bench.cpp
+///@brief Cost of one Then() hop, by chain depth.
+///
+/// lazy:  the whole chain is attached before the promise is set,
+///        so every hop goes through the stored continuation.
+/// eager: the promise is set first, every Then() runs inline.
+using namespace Miren;
+
+namespace {
+
+const int kDepths[] = {1, 2, 4, 8, 10, 16, 32, 64};
+const int kTotalHops = 4000000;
+
+Future<int> Chain(Future<int>&& head, int depth) {
+    Future<int> fut = std::move(head);
+    for (int i = 0; i < depth; i++)
+        fut = fut.Then([](int v) { return v + 1; });
+
+    return fut;
+}
+
+double BenchLazy(int depth) {
+    const int iterations = kTotalHops / depth;
+    long sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        Promise<int> pm;
+        auto fut = Chain(pm.GetFuture(), depth);
+        pm.SetValue(i);
+        sum += fut.Wait();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (sum == 0)
+        printf("impossible\n");
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double(iterations) * depth);
+}
+
+double BenchEager(int depth) {
+    const int iterations = kTotalHops / depth;
+    long sum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        auto fut = Chain(MakeReadyFuture(i), depth);
+        sum += fut.Wait();
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if (sum == 0)
+        printf("impossible\n");
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double(iterations) * depth);
+}
+
+} // end anonymous namespace
+
+int main() {
+    printf("%6s %14s %14s\n", "depth", "lazy ns/hop", "eager ns/hop");
+    for (int depth : kDepths)
+        printf("%6d %14.1f %14.1f\n", depth, BenchLazy(depth), BenchEager(depth));
+
+    return 0;
+}
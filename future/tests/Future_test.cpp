@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+
+#include "future/Future.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+
+using namespace Miren;
+
+TEST(future, then_before_set) {
+  Promise<int> pm;
+  auto fut = pm.GetFuture()
+                 .Then([](int v) { return v + 1; })
+                 .Then([](int v) { return v * 2; });
+  pm.SetValue(20);
+  EXPECT_EQ(fut.Wait(), 42);
+}
+
+TEST(future, then_after_set) {
+  auto fut = MakeReadyFuture(20)
+                 .Then([](int v) { return v + 1; })
+                 .Then([](int v) { return v * 2; });
+  EXPECT_EQ(fut.Wait(), 42);
+}
+
+TEST(future, exception_propagates) {
+  Promise<int> pm;
+  auto fut = pm.GetFuture()
+                 .Then([](int v) -> int { throw std::runtime_error("bad"); })
+                 .Then([](Try<int>&& t) { return t.HasException() ? -1 : 1; });
+  pm.SetValue(1);
+  EXPECT_EQ(fut.Wait(), -1);
+}
+
+TEST(future, set_once) {
+  Promise<int> pm;
+  auto fut = pm.GetFuture();
+  pm.SetValue(1);
+  pm.SetValue(2);
+  EXPECT_EQ(fut.Wait(), 1);
+  ASSERT_THROW(fut.Wait(), std::runtime_error);
+}
+
+TEST(future, wait_cross_thread) {
+  Promise<int> pm;
+  auto fut = pm.GetFuture();
+  std::thread t([pm]() mutable {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    pm.SetValue(42);
+  });
+  EXPECT_EQ(fut.Wait(), 42);
+  t.join();
+}
+
+TEST(future, wait_timeout) {
+  Promise<int> pm;
+  auto fut = pm.GetFuture();
+  ASSERT_THROW(fut.Wait(std::chrono::milliseconds(20)), std::runtime_error);
+}
+
+// the second timed Wait finds kHasWaiter set by the first one and must still wait its own timeout
+TEST(future, wait_timeout_twice) {
+  Promise<int> pm;
+  auto fut = pm.GetFuture();
+  ASSERT_THROW(fut.Wait(std::chrono::milliseconds(20)), std::runtime_error);
+
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_THROW(fut.Wait(std::chrono::milliseconds(50)), std::runtime_error);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+
+  std::thread t([pm]() mutable {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    pm.SetValue(42);
+  });
+  EXPECT_EQ(fut.Wait(std::chrono::milliseconds(5000)), 42);
+  t.join();
+}
+
+TEST(future, race_set_and_then) {
+  for (int i = 0; i < 1000; i++) {
+    Promise<int> pm;
+    auto head = pm.GetFuture();
+    std::thread t([pm]() mutable { pm.SetValue(1); });
+    auto fut = head.Then([](int v) { return v + 1; });
+    EXPECT_EQ(fut.Wait(), 2);
+    t.join();
+  }
+}
+
+TEST(future, when_all_variadic) {
+  Promise<int> p1;
+  Promise<std::string> p2;
+  auto fut = WhenAll(p1.GetFuture(), p2.GetFuture());
+  p2.SetValue(std::string("hello"));
+  p1.SetValue(42);
+
+  auto results = fut.Wait().Value();
+  EXPECT_EQ(std::get<0>(results).Value(), 42);
+  EXPECT_EQ(std::get<1>(results).Value(), "hello");
+}
+
+TEST(future, when_any_variadic) {
+  Promise<int> p1, p2, p3;
+  auto fut = WhenAny(p1.GetFuture(), p2.GetFuture(), p3.GetFuture());
+  p2.SetValue(2);
+  p1.SetValue(1);
+
+  auto first = fut.Wait().Value();
+  EXPECT_EQ(first.first, 1u);
+  EXPECT_EQ(first.second.Value(), 2);
+}
+
+TEST(future, when_n) {
+  std::vector<Promise<int>> pms(5);
+  std::vector<Future<int>> futs;
+  for (auto& pm : pms)
+    futs.push_back(pm.GetFuture());
+
+  auto fut = WhenN(3, futs.begin(), futs.end());
+  pms[4].SetValue(4);
+  pms[0].SetValue(0);
+  ASSERT_THROW(fut.Wait(std::chrono::milliseconds(10)), std::runtime_error);
+
+  pms[2].SetValue(2);
+  pms[1].SetValue(1);
+  auto results = fut.Wait().Value();
+  ASSERT_EQ(results.size(), 3u);
+  EXPECT_EQ(results[0].first, 4u);
+  EXPECT_EQ(results[1].first, 0u);
+  EXPECT_EQ(results[2].first, 2u);
+}
+
+TEST(future, when_n_variadic) {
+  Promise<int> p1, p2, p3;
+  auto fut = WhenN(2, p1.GetFuture(), p2.GetFuture(), p3.GetFuture());
+  p3.SetValue(3);
+  p1.SetValue(1);
+  p2.SetValue(2);
+
+  auto results = fut.Wait().Value();
+  ASSERT_EQ(results.size(), 2u);
+  EXPECT_EQ(results[0].first, 2u);
+  EXPECT_EQ(results[1].first, 0u);
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+
+#include "future/WorkStealingPool.h"
+#include "future/Future.h"
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+using Miren::WorkStealingPool;
+
+static const int kMaxThreads = 4;
+
+class WorkStealingPoolTest : public testing::Test {
+ public:
+  WorkStealingPoolTest() = default;
+
+  void SetUp() override { pool_.SetNumOfThreads(kMaxThreads); }
+  void TearDown() override { pool_.JoinAll(); }
+
+  int ShortTask() { return 42; }
+
+  // spawns children from inside a worker, they go to its local deque
+  void Spawn(int depth, std::atomic<int>& count) {
+    count++;
+    if (depth == 0)
+      return;
+    pool_.Execute(&WorkStealingPoolTest::Spawn, this, depth - 1, std::ref(count));
+    pool_.Execute(&WorkStealingPoolTest::Spawn, this, depth - 1, std::ref(count));
+  }
+
+  WorkStealingPool pool_;
+};
+
+TEST_F(WorkStealingPoolTest, empty_test) {
+  // threads are lazy create
+  EXPECT_EQ(pool_.WorkerThreads(), 0);
+  EXPECT_EQ(pool_.Tasks(), 0);
+}
+
+TEST_F(WorkStealingPoolTest, exec_task_test) {
+  auto future = pool_.Execute(&WorkStealingPoolTest::ShortTask, this);
+  EXPECT_EQ(future.Wait(), 42);
+
+  EXPECT_EQ(pool_.WorkerThreads(), kMaxThreads);
+}
+
+TEST_F(WorkStealingPoolTest, nested_spawn_test) {
+  std::atomic<int> count {0};
+  pool_.Execute(&WorkStealingPoolTest::Spawn, this, 12, std::ref(count));
+
+  const int expect = (1 << 13) - 1;
+  for (int i = 0; i < 500 && count.load() != expect; i++)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  EXPECT_EQ(count.load(), expect);
+  EXPECT_EQ(pool_.Tasks(), 0);
+}
+
+TEST_F(WorkStealingPoolTest, then_on_pool_test) {
+  auto future = pool_.Execute(&WorkStealingPoolTest::ShortTask, this)
+                    .Then(&pool_, [](int v) { return v + 1; })
+                    .Then(&pool_, [](int v) { return v * 2; });
+  EXPECT_EQ(future.Wait(), 86);
+}
+
+TEST_F(WorkStealingPoolTest, schedule_later_test) {
+  using namespace std::chrono;
+
+  Miren::Promise<void> pm;
+  auto future = pm.GetFuture();
+  auto start = steady_clock::now();
+  pool_.ScheduleLater(milliseconds(100), [&pm]() { pm.SetValue(); });
+  future.Wait();
+
+  auto usedMs = duration_cast<milliseconds>(steady_clock::now() - start);
+  EXPECT_GE(usedMs.count(), 100);
+}
+
+TEST_F(WorkStealingPoolTest, join_test) {
+  auto fut = pool_.Execute(&WorkStealingPoolTest::ShortTask, this);
+  pool_.JoinAll();
+
+  // can still get task result.
+  EXPECT_EQ(fut.Wait(), 42);
+
+  ASSERT_THROW(pool_.Execute(&WorkStealingPoolTest::ShortTask, this),
+               std::runtime_error);
+}
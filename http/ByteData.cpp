@@ -5,6 +5,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <assert.h>
+#include <new>
 
 namespace Miren {
 namespace http {
@@ -14,7 +15,7 @@ void ByteData::addDataZeroCopy(const base::StringPiece& data) {
 }
 
 void ByteData::addDataZeroCopy(const void *data, size_t size) {
-    DataPacket* dp = new DataPacket();
+    DataPacket* dp = newPacket();
     dp->copy_ = false;
     dp->zero_copy_data_ = (char*)data;
     dp->size_ += size;
@@ -26,7 +27,7 @@ void ByteData::addDataCopy(const base::StringPiece &data) {
 }
 
 void ByteData::addDataCopy(const void *data, size_t size) {
-    DataPacket* dp = new DataPacket();
+    DataPacket* dp = newPacket();
     dp->copy_ = true;
     dp->copy_data_ = new net::Buffer(size * 2);
     dp->copy_data_->append((const char*)data, size);
@@ -46,7 +47,7 @@ void ByteData::addFile(const std::string &filepath) {
     assert(fd > 0);
     struct stat st;
     fstat(fd, &st);
-    DataPacket* dp = new DataPacket();
+    DataPacket* dp = newPacket();
     dp->fd_ = fd;
     dp->copy_ = false;
     dp->size_ += st.st_size;
@@ -57,7 +58,7 @@ void ByteData::addFile(const std::string &filepath) {
 
 void ByteData::addFile(int fd, size_t size) {
     assert(fd > 0);
-    DataPacket* dp = new DataPacket();
+    DataPacket* dp = newPacket();
     dp->fd_ = fd;
     dp->copy_ = false;
     dp->size_ += size;
@@ -66,11 +67,45 @@ void ByteData::addFile(int fd, size_t size) {
     datas_.push_back(dp);
 }
 
+DataPacket* ByteData::newPacket() {
+    return new (resource_->allocate(sizeof(DataPacket), alignof(DataPacket))) DataPacket();
+}
+
+void ByteData::deletePacket(DataPacket* data) {
+    data->~DataPacket();
+    resource_->deallocate(data, sizeof(DataPacket), alignof(DataPacket));
+}
+
+ByteData* ByteData::keep(ByteData* data) {
+    data->copyDataIfNeed();
+    if(data->resource_->is_equal(*std::pmr::new_delete_resource())) {
+        return data;
+    }
+    // 拷贝后的Buffer、mmap的文件已经在堆上，只需要把数据段的所有权转给新对象
+    ByteData* heap = new ByteData();
+    heap->datas_.reserve(data->datas_.size());
+    for(DataPacket* dp : data->datas_) {
+        DataPacket* moved = heap->newPacket();
+        *moved = *dp;
+        dp->copy_ = false;
+        dp->copy_data_ = nullptr;
+        dp->fd_ = -1;
+        heap->datas_.push_back(moved);
+    }
+    heap->current_index_ = data->current_index_;
+    heap->offset_ = data->offset_;
+    delete data;
+    return heap;
+}
+
 ssize_t ByteData::writev(int fd) {
     if(!remain()) return 0;
-    std::vector<struct iovec> iovs;
-    for(int i = (int)current_index_; i < datas_.size(); ++i) {
-        struct iovec iov;
+    // 栈上的数组，超过的部分下次再写
+    static const int kMaxIovecs = 64;
+    struct iovec iovs[kMaxIovecs];
+    int count = 0;
+    for(int i = (int)current_index_; i < datas_.size() && count < kMaxIovecs; ++i) {
+        struct iovec& iov = iovs[count++];
         DataPacket* data = datas_[i];
         if(i == (int)current_index_) {
             iov.iov_base = (void*)(data->data() + offset_);
@@ -79,10 +114,9 @@ ssize_t ByteData::writev(int fd) {
             iov.iov_base = (void*)data->data();
             iov.iov_len = data->size_;
         }
-        iovs.push_back(iov);
     }
 
-    ssize_t n = net::sockets::writev(fd, (struct iovec*)(&*iovs.begin()), (int)iovs.size());
+    ssize_t n = net::sockets::writev(fd, iovs, count);
     if(n > 0) {
         offset_ += n;
         modifyIndexAndOffset();
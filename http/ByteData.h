@@ -1,5 +1,6 @@
 #pragma once
 #include "net/Buffer.h"
+#include <memory_resource>
 #include <vector>
 #include <unistd.h>
 #include <sys/mman.h>
@@ -51,16 +52,25 @@ public:
 
 class ByteData {
 private:
-    std::vector<DataPacket*> datas_;
+    std::pmr::memory_resource* resource_;
+    std::pmr::vector<DataPacket*> datas_;
     size_t current_index_ = 0;
     ssize_t offset_ = 0;
     
     void modifyIndexAndOffset();
+    DataPacket* newPacket();
+    void deletePacket(DataPacket* data);
     
 public:
+    //数据段和数组从resource分配；HttpSession在IO线程中传入EventLoop的Arena，这时只能在本次请求中发送
+    explicit ByteData(std::pmr::memory_resource* resource = std::pmr::new_delete_resource())
+        : resource_(resource), datas_(resource) {}
     ~ByteData() {
-        for(DataPacket* data : datas_) delete data;
+        for(DataPacket* data : datas_) deletePacket(data);
     }
+
+    //没有一次发完、要放进发送队列时调用：拷贝零拷贝的数据，数据段不在堆上时换成一个堆上的ByteData(会delete data)
+    static ByteData* keep(ByteData* data);
     
     //内部不拷贝，注意不要提前释放数据，如果一次性没有发完的数据需要手动调用CopyDataIfNeed方法对数据进行缓存
     void addDataZeroCopy(const base::StringPiece& data);
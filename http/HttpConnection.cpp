@@ -365,7 +365,7 @@ namespace Miren
             
 
             if(!faultError && !flag && data != nullptr && data->remain()) {
-                data->copyDataIfNeed();
+                data = ByteData::keep(data);
                 send_datas_.push(data);
                 // if(oldLen + remaining >= highWarkMark_
                 //     && oldLen < highWarkMark_
@@ -87,6 +87,7 @@ void HttpServer::onMessage(const HttpConnectionPtr& conn,
     data->addDataZeroCopy(res);
     conn->send(data);
     conn->shutdown();
+    return;
   }
   LOG_INFO  << "parse success";
   httpSession->handleParsedMessage();
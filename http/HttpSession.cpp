@@ -5,6 +5,7 @@
 #include <sys/stat.h>
 #include <algorithm>
 #include "base/log/Logging.h"
+#include "net/EventLoop.h"
 
 namespace Miren {
 namespace http {
@@ -27,28 +28,34 @@ bool HttpSession::parse(Miren::net::Buffer* buf, Miren::base::Timestamp receivet
 
 bool HttpSession::handleMessage(Miren::net::Buffer* buf, Miren::base::Timestamp receivetime,  bool* flag) 
 {
-    HttpParser http_request_parser_;
-    size_t offset = 0;
-    size_t s = http_request_parser_.execute(buf->peek(), buf->readableBytes(), &offset);
-    LOG_INFO << s;
-    if(http_request_parser_.isPause()) {
-        *flag = true;
-        return false;
-    }
-    if(!http_request_parser_.isComplete()) {
-        return false;
+    net::EventLoop* loop = connection_->getLoop();
+    arena_ = loop->isInLoopThread() ? &loop->arena() : nullptr;
+    bool complete = false;
+    {
+        HttpParser http_request_parser_(HTTP_REQUEST, resource());
+        size_t offset = 0;
+        size_t s = http_request_parser_.execute(buf->peek(), buf->readableBytes(), &offset);
+        LOG_INFO << s;
+        if(http_request_parser_.isPause()) {
+            *flag = true;
+        }
+        else if(http_request_parser_.isComplete()) {
+            buf->retrieve(offset);
+            http_request_ = std::move(http_request_parser_.request());
+            http_request_->init();
+            complete = true;
+        }
     }
-    else {
-        buf->retrieve(offset);
-        http_request_ = std::move(http_request_parser_.request());
-        http_request_->init();
-        return true;
+    if(!complete) {
+        // 不完整的请求随解析器析构了，Arena不留到下一次
+        finishRequest();
     }
+    return complete;
 }
 
 void HttpSession::handleParsedMessage() {
-    auto headers = http_request_->getHeaders();
-    
+    const auto& headers = http_request_->getHeaders();
+
     auto iter = headers.find("connection");
     HttpVersion version = http_request_->getVersion();
     if(version == HttpVersion::HTTP_1_0) {
@@ -64,33 +71,47 @@ void HttpSession::handleParsedMessage() {
     if(requestCallback_) {
         requestCallback_(shared_from_this());
     }
+    finishRequest();
+}
 
+std::pmr::memory_resource* HttpSession::resource() const {
+    return arena_ ? static_cast<std::pmr::memory_resource*>(arena_) : std::pmr::get_default_resource();
+}
+
+// 回调结束后请求、响应和已经发出的数据都不再使用，Arena整体回收给下一个请求
+void HttpSession::finishRequest() {
+    http_request_.reset();
+    http_response_.reset();
+    if(arena_) {
+        arena_->reset();
+        arena_ = nullptr;
+    }
 }
 
 void HttpSession::sendString(const llhttp_status& code, const std::string& data) {
-    http_response_.reset(new HttpResponse(http_request_->getVersion(), http_request_->isClose()));
+    http_response_.reset(new HttpResponse(http_request_->getVersion(), http_request_->isClose(), resource()));
     http_response_->setStatusCode(code);
 
     http_response_->setHeader("Content-Type", HttpContentType2Str.at(HttpContentType::TXT));
     // http_response_->setBody(data);
-    http_response_->setHeader("content-length", std::to_string(data.size()));
-    std::string header = http_response_->headerToString();
-    ByteData* bdata = new ByteData();
+    http_response_->setContentLength(data.size());
+    std::pmr::string header(resource());
+    http_response_->appendHeader(&header);
+    ByteData* bdata = new ByteData(resource());
     bdata->addDataZeroCopy(header);
     bdata->addDataZeroCopy(data);
 
     send(bdata);
-    LOG_INFO << bdata->remain();
 }
 
 void HttpSession::sendJson(const llhttp_status& code, const std::string& data) {
-    http_response_.reset(new HttpResponse(http_request_->getVersion(), http_request_->isClose()));
+    http_response_.reset(new HttpResponse(http_request_->getVersion(), http_request_->isClose(), resource()));
 
     http_response_->setStatusCode(code);
     http_response_->setHeader("Content-Type", HttpContentType2Str.at(HttpContentType::JSON));
     http_response_->setBody(data);
  
-    ByteData* bdata = new ByteData();
+    ByteData* bdata = new ByteData(resource());
     std::string tmp = http_response_->toString();
     bdata->addDataZeroCopy(tmp);
     send(bdata);
@@ -115,7 +136,7 @@ void HttpSession::sendFile(const llhttp_status& code, const std::string& filepat
         cotent_filetype = iter->second;
     }
 
-    http_response_.reset(new HttpResponse(http_request_->getVersion(), http_request_->isClose()));
+    http_response_.reset(new HttpResponse(http_request_->getVersion(), http_request_->isClose(), resource()));
 
     http_response_->setStatusCode(code);
     http_response_->setHeader("Content-Type", cotent_filetype);
@@ -125,9 +146,9 @@ void HttpSession::sendFile(const llhttp_status& code, const std::string& filepat
     assert(fd > 0);
     struct stat st;
     fstat(fd, &st);
-    http_response_->setHeader("Content-Length", std::to_string(st.st_size));
+    http_response_->setContentLength(st.st_size);
     std::string header = http_response_->headerToString();
-    ByteData* bdata = new ByteData();
+    ByteData* bdata = new ByteData(resource());
     bdata->addDataZeroCopy(header);
     bdata->addFile(fd, st.st_size);
     send(bdata);
@@ -135,7 +156,7 @@ void HttpSession::sendFile(const llhttp_status& code, const std::string& filepat
 
 void HttpSession::sendMultipart(const llhttp_status& code, const std::vector<MultipartPart*>& parts) 
 {
-    http_response_.reset(new HttpResponse(http_request_->getVersion(), http_request_->isClose()));
+    http_response_.reset(new HttpResponse(http_request_->getVersion(), http_request_->isClose(), resource()));
 
     std::string boundary = generateBoundary(16);
     http_response_->setStatusCode(code);
@@ -149,13 +170,13 @@ void HttpSession::sendMultipart(const llhttp_status& code, const std::vector<Mul
         totalsize += begin_boundary.size() + part->headerToString().size() + part->size();
     }
     totalsize += end_boundary.size() - 2;
-    http_response_->setHeader("Content-Length", std::to_string(totalsize));
+    http_response_->setContentLength(totalsize);
     
     
     std::string header = http_response_->headerToString();
     LOG_INFO << header;
     header.pop_back(); header.pop_back();       // 删除"\r\n"
-    ByteData* bdata = new ByteData();
+    ByteData* bdata = new ByteData(resource());
     bdata->addDataZeroCopy(header);
     
     for(MultipartPart* part : parts) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "base/Arena.h"
 #include "base/Timestamp.h"
 #include "base/Copyable.h"
 #include "http/HttpConnection.h"
@@ -20,6 +21,8 @@ public:
     HttpSession(std::shared_ptr<HttpConnection> conn, RequestCallback cb);
 
     ~HttpSession();
+    // 在IO线程中处理时请求和响应从EventLoop的Arena分配，handleParsedMessage返回时一起释放
+    // 只能在RequestCallback中使用，需要保留的内容要拷贝出去
     std::unique_ptr<HttpRequest>& getRequest() { return http_request_; }
     std::unique_ptr<HttpResponse>& getResponse() { return http_response_; }
 
@@ -42,7 +45,10 @@ private:
     std::unique_ptr<HttpRequest> http_request_;
     std::unique_ptr<HttpResponse> http_response_;
     bool need_close_ = true;
+    base::Arena* arena_ = nullptr;      //本次请求使用的Arena，不在IO线程时为空
     bool handleMessage(Miren::net::Buffer* buf, Miren::base::Timestamp receivetime, bool* flag);
+    std::pmr::memory_resource* resource() const;
+    void finishRequest();
 public:
     void handleParsedMessage();
     std::string generateBoundary(size_t len);
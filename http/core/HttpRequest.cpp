@@ -5,45 +5,78 @@ namespace Miren
 namespace http
 {
 
-#define PARSE_PARAM(str, m, flag, trim) \
-    size_t pos = 0; \
-    do { \
-        size_t last = pos; \
-        pos = str.find('=', pos); \
-        if(pos == std::string::npos) { \
-            break; \
-        } \
-        size_t key = pos; \
-        pos = str.find(flag, pos); \
-        m.insert(std::make_pair(trim(str.substr(last, key - last)), \
-                    Miren::base::StringUtil::UrlDecode(str.substr(key + 1, pos - key - 1)))); \
-        if(pos == std::string::npos) { \
-            break; \
-        } \
-        ++pos; \
+namespace {
+
+std::string_view trimView(std::string_view str) {
+    size_t begin = str.find_first_not_of(" \t\r\n");
+    if(begin == std::string_view::npos) {
+        return std::string_view();
+    }
+    size_t end = str.find_last_not_of(" \t\r\n");
+    return str.substr(begin, end - begin + 1);
+}
+
+// 解析"k1=v1&k2=v2"形式的参数，已经存在的key不覆盖
+// 值里没有'%'和'+'时不需要解码，直接从原字符串构造，不产生临时的std::string
+void parseParam(std::string_view str, HttpMap& m, char flag, bool trim) {
+    size_t pos = 0;
+    do {
+        size_t last = pos;
+        pos = str.find('=', pos);
+        if(pos == std::string_view::npos) {
+            break;
+        }
+        size_t key = pos;
+        pos = str.find(flag, pos);
+        std::string_view k = str.substr(last, key - last);
+        if(trim) {
+            k = trimView(k);
+        }
+        std::string_view v = str.substr(key + 1, pos == std::string_view::npos ? pos : pos - key - 1);
+        if(m.find(k) == m.end()) {
+            if(v.find_first_of("%+") == std::string_view::npos) {
+                m.emplace(k, v);
+            } else {
+                m.emplace(k, Miren::base::StringUtil::UrlDecode(std::string(v)));
+            }
+        }
+        if(pos == std::string_view::npos) {
+            break;
+        }
+        ++pos;
     } while(true);
+}
 
+}
 
-HttpRequest::HttpRequest(HttpVersion version, bool close)
+HttpRequest::HttpRequest(HttpVersion version, bool close, std::pmr::memory_resource* resource)
     :method_(llhttp_method::HTTP_GET)
     ,version_(version)
     ,close_(close)
-    ,url_("/")
+    ,url_("/", resource)
+    ,requestUrl_(resource)
+    ,body_(resource)
+    ,headers_(resource)
+    ,params_(resource)
+    ,cookies_(resource)
     ,init_(false) {
 }
 
 std::string HttpRequest::getHeader(const std::string& key
                             ,const std::string& def) const {
     auto it = headers_.find(key);
-    return it == headers_.end() ? def : it->second;
+    return it == headers_.end() ? def : std::string(it->second);
 }
 
-void HttpRequest::setHeader(const std::string& key, const std::string& val) {
-    headers_[key] = val;
+void HttpRequest::setHeader(std::string_view key, std::string_view val) {
+    setField(headers_, key, val);
 }
 
 void HttpRequest::delHeader(const std::string& key) {
-    headers_.erase(key);
+    auto it = headers_.find(key);
+    if(it != headers_.end()) {
+        headers_.erase(it);
+    }
 }
 
 bool HttpRequest::hasHeader(const std::string& key, std::string* val) {
@@ -60,15 +93,18 @@ bool HttpRequest::hasHeader(const std::string& key, std::string* val) {
 std::string HttpRequest::getParam(const std::string& key
                             ,const std::string& def) {
     auto it = params_.find(key);
-    return it == params_.end() ? def : it->second;
+    return it == params_.end() ? def : std::string(it->second);
 }
 
-void HttpRequest::setParam(const std::string& key, const std::string& val) {
-    params_[key] = val;
+void HttpRequest::setParam(std::string_view key, std::string_view val) {
+    setField(params_, key, val);
 }
 
 void HttpRequest::delParam(const std::string& key) {
-    params_.erase(key);
+    auto it = params_.find(key);
+    if(it != params_.end()) {
+        params_.erase(it);
+    }
 }
 
 bool HttpRequest::hasParam(const std::string& key, std::string* val) {
@@ -86,15 +122,18 @@ std::string HttpRequest::getCookie(const std::string& key
                             ,const std::string& def) {
     initCookies();
     auto it = cookies_.find(key);
-    return it == cookies_.end() ? def : it->second;
+    return it == cookies_.end() ? def : std::string(it->second);
 }
 
-void HttpRequest::setCookie(const std::string& key, const std::string& val) {
-    cookies_[key] = val;
+void HttpRequest::setCookie(std::string_view key, std::string_view val) {
+    setField(cookies_, key, val);
 }
 
 void HttpRequest::delCookie(const std::string& key) {
-    cookies_.erase(key);
+    auto it = cookies_.find(key);
+    if(it != cookies_.end()) {
+        cookies_.erase(it);
+    }
 }
 
 bool HttpRequest::hasCookie(const std::string& key, std::string* val) {
@@ -136,9 +175,9 @@ bool HttpRequest::init() {
     if(init_) {
         return true;
     }
-    std::string conn = getHeader("connection");
-    if(!conn.empty()) {
-        if(strcasecmp(conn.c_str(), "keep-alive") == 0) {
+    auto conn = headers_.find("connection");
+    if(conn != headers_.end() && !conn->second.empty()) {
+        if(strcasecmp(conn->second.c_str(), "keep-alive") == 0) {
             close_ = false;
         } else {
             close_ = true;
@@ -157,7 +196,7 @@ void HttpRequest::initParam() {
 
 
 void HttpRequest::initQueryParam() {
-    PARSE_PARAM(requestUrl_.query, params_, '&',);
+    parseParam(requestUrl_.query, params_, '&', false);
 }
 
 bool HttpRequest::initBody() {
@@ -172,16 +211,16 @@ bool HttpRequest::initBody() {
         }
         return true;
     }
-    PARSE_PARAM(body_, params_, '&',);
+    parseParam(body_, params_, '&', false);
     return true;
 }
 
 void HttpRequest::initCookies() {
-    std::string cookie = getHeader("cookie");
-    if(cookie.empty()) {
+    auto cookie = headers_.find("cookie");
+    if(cookie == headers_.end() || cookie->second.empty()) {
         return;
     }
-    PARSE_PARAM(cookie, cookies_, ';', base::StringUtil::Trim);
+    parseParam(cookie->second, cookies_, ';', true);
 }
 
 std::ostream& operator<<(std::ostream& os, const HttpRequest& req) {
@@ -14,12 +14,14 @@ namespace Miren
 namespace http
 {
 struct Url {
+    explicit Url(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        :path(resource), query(resource), fragment(resource) {}
     /// 请求路径
-    std::string path;
+    std::pmr::string path;
     /// 请求参数
-    std::string query;
+    std::pmr::string query;
     /// @brief 
-    std::string fragment;
+    std::pmr::string fragment;
 };
 /////
  // @brief HTTP请求结构
@@ -29,12 +31,14 @@ public:
     /// HTTP请求的智能指针
     typedef std::shared_ptr<HttpRequest> ptr;
     /// MAP结构
-    typedef std::map<std::string, std::string, CaseInsensitiveLess> MapType;
+    typedef HttpMap MapType;
 
     // @brief 构造函数
     // @param[in] version 版本
     // @param[in] close 是否keepalive
-    HttpRequest(HttpVersion version = HttpVersion::HTTP_1_0, bool close = true);
+    // @param[in] resource URL、消息体、头部和参数的内存来源，HttpSession传入EventLoop的Arena
+    HttpRequest(HttpVersion version = HttpVersion::HTTP_1_0, bool close = true,
+                std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
     void reset();
     
@@ -45,9 +49,9 @@ public:
     
     
     // @brief 返回HTTP请求的路径
-    void setUrl(const std::string& url) { url_ = url; }
-    const std::string& url() const { return url_; }
-    void appendUrl(const std::string& url) { url_ += url; }
+    void setUrl(std::string_view url) { url_ = url; }
+    const std::pmr::string& url() const { return url_; }
+    void appendUrl(std::string_view url) { url_ += url; }
     void appendUrl(const char* url, size_t len) { url_.append(url, len); }
 
 
@@ -66,11 +70,11 @@ public:
 
 
     // @brief 返回HTTP请求体
-    void setBody(const std::string& body) { body_ = body; }
+    void setBody(std::string_view body) { body_ = body; }
     void setBody(const char* body, size_t len) { body_.assign(body, len); }
-    void appendBody(const std::string& body) { body_ += body; }
+    void appendBody(std::string_view body) { body_ += body; }
     void appendBody(const char* body, size_t len) { body_.append(body, len); }
-    const std::string& body() const { return body_; }
+    const std::pmr::string& body() const { return body_; }
 
 
 
@@ -86,7 +90,7 @@ public:
     // @brief 设置HTTP请求的头部参数
     // @param[in] key 关键字
     // @param[in] val 值
-    void setHeader(const std::string& key, const std::string& val);
+    void setHeader(std::string_view key, std::string_view val);
      // @brief 删除HTTP请求的头部参数@param[in] key 关键字
     void delHeader(const std::string& key);
     // @brief 判断HTTP请求的头部参数是否存在
@@ -122,7 +126,7 @@ public:
     // @brief 获取HTTP请求的请求参数 @param[in] key 关键字 @param[in] def 默认值 @return 如果存在则返回对应值,否则返回默认值
     std::string getParam(const std::string& key, const std::string& def = "");
     // @brief 设置HTTP请求的请求参数 @param[in] key 关键字 @param[in] val 值
-    void setParam(const std::string& key, const std::string& val);
+    void setParam(std::string_view key, std::string_view val);
     // @brief 删除HTTP请求的请求参数@param[in] key 关键字
     void delParam(const std::string& key);
     // @brief 判断HTTP请求的请求参数是否存在
@@ -157,7 +161,7 @@ public:
     // @return 如果存在则返回对应值,否则返回默认值
     std::string getCookie(const std::string& key, const std::string& def = "");
     // @brief 设置HTTP请求的Cookie参数 @param[in] key 关键字 @param[in] val 值
-    void setCookie(const std::string& key, const std::string& val);
+    void setCookie(std::string_view key, std::string_view val);
     // @brief 删除HTTP请求的Cookie参数 @param[in] key 关键字
     void delCookie(const std::string& key);
     // @brief 判断HTTP请求的Cookie参数是否存在
@@ -200,7 +204,7 @@ public:
     std::string toString() const;
 
     bool init();
-    void setRequstUrl(Url& url) { requestUrl_ = url; }
+    void setRequstUrl(const Url& url) { requestUrl_ = url; }
     const Url& getRequestUrl() { return requestUrl_; }
     std::shared_ptr<HttpRequestBody>& mutlipartBody() { return multiBody_; }
 private:
@@ -218,11 +222,11 @@ private:
     bool close_;
 
     /// 请求url
-    std::string url_;
+    std::pmr::string url_;
     Url requestUrl_;
 
     /// 请求消息体
-    std::string body_;
+    std::pmr::string body_;
     /// 请求头部MAP
     MapType headers_;
     /// 请求参数MAP
@@ -1,29 +1,45 @@
 #include "http/core/HttpResponse.h"
+#include "base/Clock.h"
+#include "base/FastFormat.h"
 #include "base/Util.h"
 
+#include <type_traits>
+
 namespace Miren
 {
 namespace http
 {
 
-HttpResponse::HttpResponse(HttpVersion version, bool close)
+HttpResponse::HttpResponse(HttpVersion version, bool close, std::pmr::memory_resource* resource)
     :status_code_(llhttp_status::HTTP_STATUS_OK)
     ,version_(version)
     ,close_(close)
-    ,websocket_(false) {
+    ,websocket_(false)
+    ,body_(resource)
+    ,status_reason_(resource)
+    ,headers_(resource)
+    ,cookies_(resource) {
 }
 
 std::string HttpResponse::getHeader(const std::string& key, const std::string& def) const {
     auto it = headers_.find(key);
-    return it == headers_.end() ? def : it->second;
+    return it == headers_.end() ? def : std::string(it->second);
+}
+
+void HttpResponse::setHeader(std::string_view key, std::string_view val) {
+    setField(headers_, key, val);
 }
 
-void HttpResponse::setHeader(const std::string& key, const std::string& val) {
-    headers_[key] = val;
+void HttpResponse::setContentLength(uint64_t length) {
+    char buf[base::FastFormat::kMaxIntegerLength];
+    setField(headers_, "Content-Length", std::string_view(buf, base::FastFormat::formatUnsigned(buf, length)));
 }
 
 void HttpResponse::delHeader(const std::string& key) {
-    headers_.erase(key);
+    auto it = headers_.find(key);
+    if(it != headers_.end()) {
+        headers_.erase(it);
+    }
 }
 
 void HttpResponse::setRedirect(const std::string& uri) {
@@ -48,7 +64,7 @@ void HttpResponse::setCookie(const std::string& key, const std::string& val,
     if(secure) {
         ss << ";secure";
     }
-    cookies_.push_back(ss.str());
+    cookies_.emplace_back(ss.str());
 }
 
 
@@ -59,22 +75,62 @@ std::string HttpResponse::toString() const {
 }
 
 std::string HttpResponse::headerToString() const {
-    std::stringstream ss;
-    ss << HttpVersionToString(version_)
-       << " "
-       << (uint32_t)status_code_
-       << " "
-       << (status_reason_.empty() ? getStatusCodeString() : status_reason_)
-       << "\r\n";
-    
+    std::string header;
+    writeHeader(&header);
+    return header;
+}
+
+void HttpResponse::appendHeader(std::pmr::string* out) const {
+    writeHeader(out);
+}
+
+// 先算出总长度一次reserve，再逐段append，和dump()输出的头部相同
+template<class String>
+void HttpResponse::writeHeader(String* out) const {
+    const std::string version = HttpVersionToString(version_);     //短字符串，不会堆分配
+    std::string_view reason = status_reason_.empty() ? std::string_view(llhttp_status_name(status_code_))
+                                                     : std::string_view(status_reason_);
+    char code[base::FastFormat::kMaxIntegerLength];
+    size_t codeLen = base::FastFormat::formatUnsigned(code, static_cast<uint32_t>(status_code_));
+    bool hasDate = this->hasDate();
+
+    size_t size = version.size() + 1 + codeLen + 1 + reason.size() + 2 + 2;
+    if(!hasDate) {
+        size += 6 + base::CachedDate::kHttpDateLength + 2;
+    }
     for(auto& i : headers_) {
-        ss << i.first << ": " << i.second << "\r\n";
+        size += i.first.size() + 2 + i.second.size() + 2;
     }
     for(auto& i : cookies_) {
-        ss << "Set-Cookie: " << i << "\r\n";
+        size += 12 + i.size() + 2;
     }
-    ss << "\r\n";
-    return ss.str();
+    out->reserve(out->size() + size);
+
+    out->append(version.data(), version.size());
+    out->push_back(' ');
+    out->append(code, codeLen);
+    out->push_back(' ');
+    out->append(reason.data(), reason.size());
+    out->append("\r\n", 2);
+    if(!hasDate) {
+        char date[base::CachedDate::kHttpDateLength];
+        base::CachedDate::httpDate(base::Clock::coarseNow().secondSinceEpoch(), date);
+        out->append("Date: ", 6);
+        out->append(date, sizeof date);
+        out->append("\r\n", 2);
+    }
+    for(auto& i : headers_) {
+        out->append(i.first.data(), i.first.size());
+        out->append(": ", 2);
+        out->append(i.second.data(), i.second.size());
+        out->append("\r\n", 2);
+    }
+    for(auto& i : cookies_) {
+        out->append("Set-Cookie: ", 12);
+        out->append(i.data(), i.size());
+        out->append("\r\n", 2);
+    }
+    out->append("\r\n", 2);
 }
 
 std::ostream& HttpResponse::dump(std::ostream& os) const {
@@ -82,9 +138,10 @@ std::ostream& HttpResponse::dump(std::ostream& os) const {
        << " "
        << (uint32_t)status_code_
        << " "
-       << (status_reason_.empty() ? getStatusCodeString() : status_reason_)
+       << (status_reason_.empty() ? std::string_view(llhttp_status_name(status_code_)) : std::string_view(status_reason_))
        << "\r\n";
 
+    dumpDate(os);
     for(auto& i : headers_) {
         os << i.first << ": " << i.second << "\r\n";
     }
@@ -105,6 +162,26 @@ std::ostream& operator<<(std::ostream& os, const HttpResponse& rsp) {
 }
 
 
+// headers_按CaseInsensitiveLess排序，find()忽略大小写，用户设置的"date"、"DATE"也算
+static_assert(std::is_same<HttpResponse::MapType::key_compare, CaseInsensitiveLess>::value,
+              "Date header lookup relies on a case-insensitive header map");
+
+bool HttpResponse::hasDate() const {
+    return headers_.find("Date") != headers_.end();
+}
+
+// 没有设置Date时使用共享的按秒缓存的时间，不需要每个响应都格式化
+void HttpResponse::dumpDate(std::ostream& os) const {
+    if(hasDate()) {
+        return;
+    }
+    char date[base::CachedDate::kHttpDateLength];
+    base::CachedDate::httpDate(base::Clock::coarseNow().secondSinceEpoch(), date);
+    os << "Date: ";
+    os.write(date, sizeof date);
+    os << "\r\n";
+}
+
 // HTTP response
 void HttpResponse::reset() {
   status_code_ = llhttp_status::HTTP_STATUS_OK;
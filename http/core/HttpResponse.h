@@ -20,13 +20,15 @@ public:
     /// HTTP响应结构智能指针
     typedef std::shared_ptr<HttpResponse> ptr;
     /// MapType
-    typedef std::map<std::string, std::string, CaseInsensitiveLess> MapType;
+    typedef HttpMap MapType;
     /**
      * @brief 构造函数
      * @param[in] version 版本
      * @param[in] close 是否自动关闭
+     * @param[in] resource 消息体、头部和Cookie的内存来源，HttpSession传入EventLoop的Arena
      */
-    HttpResponse(HttpVersion version = HttpVersion::HTTP_1_0, bool close = true);
+    HttpResponse(HttpVersion version = HttpVersion::HTTP_1_0, bool close = true,
+                 std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
     void reset();
 
@@ -69,28 +71,28 @@ public:
      * @brief 返回响应消息体
      * @return 消息体
      */
-    const std::string& getBody() const { return body_;}
+    const std::pmr::string& getBody() const { return body_;}
 
     /**
      * @brief 设置响应消息体
      * @param[in] v 消息体
      */
-    void setBody(const std::string& v) { body_ = v;}
-    void appendBody(const std::string& body) { body_ += body; }
+    void setBody(std::string_view v) { body_ = v;}
+    void appendBody(std::string_view body) { body_ += body; }
     void appendBody(const char* body, size_t len) { body_.append(body, len); }
 
 
     /**
      * @brief 返回响应原因
      */
-    const std::string& getReason() const { return status_reason_;}
+    const std::pmr::string& getReason() const { return status_reason_;}
 
     /**
      * @brief 设置响应原因
      * @param[in] v 原因
      */
-    void setStatusReason(const std::string& v) { status_reason_ = v;}
-    void appendStatusReason(const std::string& reason) { status_reason_ += reason; }
+    void setStatusReason(std::string_view v) { status_reason_ = v;}
+    void appendStatusReason(std::string_view reason) { status_reason_ += reason; }
     void appendStatusReason(const char* reason, size_t len) { status_reason_.append(reason, len); }
 
     /**
@@ -138,7 +140,13 @@ public:
      * @param[in] key 关键字
      * @param[in] val 值
      */
-    void setHeader(const std::string& key, const std::string& val);
+    void setHeader(std::string_view key, std::string_view val);
+
+    /**
+     * @brief 设置Content-Length，数字用FastFormat格式化
+     * @param[in] length 消息体长度
+     */
+    void setContentLength(uint64_t length);
 
     /**
      * @brief 删除响应头部参数
@@ -184,10 +192,24 @@ public:
     std::string toString() const;
     std::string headerToString() const;
 
+    /**
+     * @brief 把状态行和头部追加到out，不经过stringstream
+     * @param[in, out] out 输出，和响应使用同一个memory_resource时整个头部不需要堆分配
+     */
+    void appendHeader(std::pmr::string* out) const;
+
     void setRedirect(const std::string& uri);
     void setCookie(const std::string& key, const std::string& val,
                    time_t expired = 0, const std::string& path = "",
                    const std::string& domain = "", bool secure = false);
+private:
+    /// 是否已经设置了Date头部，忽略大小写
+    bool hasDate() const;
+    /// 写入Date头部，已经设置过时跳过
+    void dumpDate(std::ostream& os) const;
+    template<class String>
+    void writeHeader(String* out) const;
+
 private:
     /// 响应状态
     llhttp_status status_code_;
@@ -198,13 +220,13 @@ private:
     /// 是否为websocket
     bool websocket_;
     /// 响应消息体
-    std::string body_;
+    std::pmr::string body_;
     /// 响应原因
-    std::string status_reason_;
+    std::pmr::string status_reason_;
     /// 响应头部MAP
     MapType headers_;
 
-    std::vector<std::string> cookies_;
+    std::pmr::vector<std::pmr::string> cookies_;
 };
 
 /**
@@ -128,9 +128,10 @@ std::string HttpVersionToString(HttpVersion ver)
     }
 }
 
-bool CaseInsensitiveLess::operator()(const std::string& lhs
-                            ,const std::string& rhs) const {
-    return strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
+bool CaseInsensitiveLess::operator()(std::string_view lhs
+                            ,std::string_view rhs) const {
+    int ret = strncasecmp(lhs.data(), rhs.data(), std::min(lhs.size(), rhs.size()));
+    return ret < 0 || (ret == 0 && lhs.size() < rhs.size());
 }
 
 
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <map>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <boost/lexical_cast.hpp>
 
@@ -36,14 +39,34 @@ std::string HttpVersionToString(HttpVersion ver) ;
 
 /**
  * @brief 忽略大小写比较仿函数
+ * @details 透明比较，std::string、std::pmr::string和字符串字面量都可以直接查找，不构造临时的key
  */
 struct CaseInsensitiveLess {
+    using is_transparent = void;
     /**
      * @brief 忽略大小写比较字符串
      */
-    bool operator()(const std::string& lhs, const std::string& rhs) const;
+    bool operator()(std::string_view lhs, std::string_view rhs) const;
 };
 
+/**
+ * @brief 请求和响应的头部、参数和Cookie
+ * @details 节点和字符串从构造时传入的memory_resource分配，HttpSession在IO线程中使用EventLoop的Arena
+ */
+typedef std::pmr::map<std::pmr::string, std::pmr::string, CaseInsensitiveLess> HttpMap;
+
+/**
+ * @brief m[key] = val，不存在时插入
+ */
+inline void setField(HttpMap& m, std::string_view key, std::string_view val) {
+    auto it = m.find(key);
+    if(it == m.end()) {
+        m.emplace(key, val);
+    } else {
+        it->second.assign(val.data(), val.size());
+    }
+}
+
 /**
  * @brief 获取Map中的key值,并转成对应类型,返回是否成功
  * @param[in] m Map数据结构
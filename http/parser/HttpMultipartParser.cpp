@@ -1,4 +1,5 @@
 #include "http/core/HttpMultipart.h"
+#include "net/Scan.h"
 
 namespace Miren {
 namespace http {
@@ -14,8 +15,7 @@ bool HttpRequestMultipartBody::parse(std::string_view body) {
 
     State state = start_body;
 
-    static constexpr const size_t buf_size = 4096;
-    char buffer[buf_size];
+    const std::string delimiter = "\r\n--" + boundary_;
 
     while(i < len) {
         switch (state) {
@@ -118,15 +118,15 @@ bool HttpRequestMultipartBody::parse(std::string_view body) {
             }
             case start_content_type:
             {
-                while (i < len) {
-                    if(i+1 < len && body[i] == CR && body[i+1] == LF) {
-                        i += 2;
-                        state = end_content_type;
-                        break;
-                    }
-                    else {
-                        type += body[i++];
-                    }
+                const char* crlf = net::scan::findCRLF(body.data()+i, body.data()+len);
+                if(crlf) {
+                    type.append(body.data()+i, crlf);
+                    i = static_cast<size_t>(crlf - body.data()) + 2;
+                    state = end_content_type;
+                }
+                else {
+                    type.append(body.data()+i, len-i);
+                    i = len;
                 }
                 break;
             }
@@ -145,32 +145,17 @@ bool HttpRequestMultipartBody::parse(std::string_view body) {
 
             case start_content_data:
             {
-                form_file_data.reserve(buf_size);
-                size_t k = 0;
-                size_t ix = 1;
-                size_t pi = i;
-
-                while(i < len) {
-                    if(i+4 < len && body[i] == CR && body[i+1] == LF &&
-                            body[i+2] == '-' && body[i+3] == '-' &&
-                            ::strncmp(body.data()+i+4, boundary_s, boundary_len) == 0) {
-                        if(k != 0) {
-                            form_file_data.append(buffer, k);
-                        }
-                        form_file_data.resize(i-pi);
-                        i += 2;
-                        state = end_content_data;
-                        break;
-                    }
-                    else {
-                        buffer[k++] = body[i++];
-                        if(k >= buf_size) {
-                            k = 0;
-                            ix++;
-                            form_file_data.append(buffer, buf_size);
-                            form_file_data.reserve(buf_size*ix);
-                        }
-                    }
+                // 数据一直到\r\n--boundary
+                const char* end = net::scan::find(body.data()+i, body.data()+len,
+                                                  delimiter.data(), delimiter.size());
+                if(end) {
+                    form_file_data.assign(body.data()+i, end);
+                    i = static_cast<size_t>(end - body.data()) + 2;
+                    state = end_content_data;
+                }
+                else {
+                    form_file_data.append(body.data()+i, len-i);
+                    i = len;
                 }
                 break;
             }
@@ -5,10 +5,13 @@
 
 namespace Miren::http {
 
-HttpParser::HttpParser(llhttp_type type) 
+HttpParser::HttpParser(llhttp_type type, std::pmr::memory_resource* resource) 
   : type_(type),
+  resource_(resource),
   request_(nullptr),
-  response_(nullptr)
+  response_(nullptr),
+  key_(resource),
+  value_(resource)
 {
   llhttp_settings_init(&settings_);
 
@@ -44,6 +47,12 @@ bool HttpParser::execute(const char* data, size_t len, size_t* offset) {
   }
 
   auto err = llhttp_execute(&parser_, data, len);
+  if (err == HPE_PAUSED && complete_) {
+    // OnMessageComplete暂停了解析，一次只解析一个消息，offset是这个消息结束的位置
+    *offset = size_t(llhttp_get_error_pos(&parser_) - start);
+    llhttp_resume(&parser_);
+    return true;
+  }
   *offset = size_t(length_ - start);
   
   if (err != HPE_OK) {
@@ -66,8 +75,11 @@ void HttpParser::reset() {
   length_ = nullptr;
   llhttp_reset(&parser_);
 
-  request_ = std::make_unique<HttpRequest>();
-  response_ = std::make_unique<HttpResponse>();
+  if (isRequest()) {
+    request_ = std::make_unique<HttpRequest>(HTTP_1_0, true, resource_);
+  } else {
+    response_ = std::make_unique<HttpResponse>(HTTP_1_0, true, resource_);
+  }
 
   key_.clear();
   value_.clear();
@@ -97,7 +109,8 @@ int HttpParser::OnMessageComplete(llhttp_t* h) {
     // }
   }
 
-  return 0;
+  // 暂停，后面的数据(pipeline的下一个请求)留在缓冲区中
+  return HPE_PAUSED;
 }
 
 int HttpParser::OnUrl(llhttp_t* h, const char* data, size_t len) {
@@ -168,8 +181,11 @@ int HttpParser::OnBody(llhttp_t* h, const char* data, size_t len) {
   HttpParser* parser = (HttpParser*)h->data;
   parser->setLength(data);
 
-  if(parser->request_->hasHeader("Content-Length")) {
-    size_t length = parser->request_->getHeaderAs<size_t>("Content-Length");
+  size_t length = 0;
+  bool hasLength = parser->isRequest()
+                 ? parser->request_->checkGetHeaderAs<size_t>("Content-Length", length)
+                 : parser->response_->checkGetHeaderAs<size_t>("Content-Length", length);
+  if(hasLength) {
     if(len < length) {
       parser->pause_ = true;
       return -1;
@@ -189,7 +205,8 @@ int HttpParser::OnBody(llhttp_t* h, const char* data, size_t len) {
 int HttpParser::OnUrlComplete(llhttp_t* h) { 
   HttpParser* parser = (HttpParser*)h->data;
 
-  auto result = ParseUrl(parser->request_->url());
+  Url result(parser->resource_);
+  ParseUrl(parser->request_->url(), &result);
   parser->request_->setRequstUrl(result);
   return 0; 
 }
@@ -198,7 +215,8 @@ int HttpParser::OnStatusComplete(llhttp_t* h) { return 0; }
 
 int HttpParser::OnHeaderFieldComplete(llhttp_t* h) { return 0; }
 
-inline std::string& Trim(std::string& s) {
+template<class String>
+inline String& Trim(String& s) {
   if (s.empty()) {
     return s;
   }
@@ -238,22 +256,25 @@ void HttpParser::reInit() {
 }
 
 
-struct Url ParseUrl(const std::string& url_) {
-  std::string url = urlDecode(url_);
-  struct Url result;
+void ParseUrl(std::string_view url, Url* result) {
+  // 大部分url不需要解码，只有含'%'或'+'时才生成解码后的临时字符串
+  std::string decoded;
+  if (url.find_first_of("%+") != std::string_view::npos) {
+    decoded = urlDecode(url);
+    url = decoded;
+  }
   if (url.empty()) {
-    return result;
+    return;
   }
 
-  const char* start = &url[0];
+  const char* start = url.data();
   const char* end = start + url.size();
   const char* query = std::find(start, end, '?');
   if (query != end) {
-    result.query = std::string(query + 1, end);
+    result->query.assign(query + 1, end);
   }
 
-  result.path = std::string(start, query);
-  return result;
+  result->path.assign(start, query);
 }
 
 }  // namespace ananas
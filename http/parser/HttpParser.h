@@ -10,7 +10,9 @@ namespace http
 //----- HTTP parser ---------
 class HttpParser {
  public:
-  explicit HttpParser(llhttp_type type= llhttp_type::HTTP_REQUEST);
+  // resource: 解析出的请求/响应和头部的临时字符串从这里分配
+  explicit HttpParser(llhttp_type type= llhttp_type::HTTP_REQUEST,
+                      std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
   HttpParser(const HttpParser&) = delete;
   void operator=(const HttpParser&) = delete;
@@ -60,10 +62,11 @@ class HttpParser {
   bool pause_ = false;
   const char* length_ = nullptr;
   const llhttp_type type_;  // request or response
+  std::pmr::memory_resource* resource_;
   std::unique_ptr<HttpRequest> request_;
   std::unique_ptr<HttpResponse> response_;
 
-  std::string key_, value_;  // temp vars for parse header
+  std::pmr::string key_, value_;  // temp vars for parse header
   std::string error_reason_;
 
 //   HttpRequestHandler req_handler_;
@@ -71,6 +74,7 @@ class HttpParser {
 };
 
 
-struct Url ParseUrl(const std::string& url);
+// 解码url并拆分出路径和查询参数，结果的字符串使用result自己的memory_resource
+void ParseUrl(std::string_view url, Url* result);
 }
 }
\ No newline at end of file
@@ -0,0 +1,127 @@
+// 一次请求的完整处理(解析、回调、发送响应)中堆分配的次数和每秒处理的请求数
+// 替换全局operator new统计分配次数；连接用socketpair代替，对端读走响应
+// 用法: HttpSession_bench [requests]
+
+#include "http/HttpSession.h"
+#include "base/Clock.h"
+#include "base/log/Logging.h"
+#include "net/EventLoop.h"
+
+#include <atomic>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace Miren;
+using namespace Miren::http;
+
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+namespace
+{
+  std::atomic<int64_t> g_allocations(0);
+  std::atomic<int64_t> g_allocatedBytes(0);
+}
+
+void* operator new(size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocatedBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+  void* p = ::malloc(size == 0 ? 1 : size);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  ::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+  ::free(p);
+}
+
+namespace
+{
+  // 浏览器发出的典型GET请求，带查询参数和Cookie
+  const char kRequest[] =
+      "GET /api/user/profile?id=12345&fields=name,avatar,email&lang=zh-CN HTTP/1.1\r\n"
+      "Host: www.example.com\r\n"
+      "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0 Safari/537.36\r\n"
+      "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+      "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+      "Accept-Encoding: gzip, deflate, br\r\n"
+      "Cookie: session=7f3a9c2e4b1d8f6a0e5c; theme=dark; tracking=off\r\n"
+      "Connection: keep-alive\r\n"
+      "\r\n";
+
+  const std::string kBody = "{\"id\":12345,\"name\":\"miren\",\"avatar\":\"/static/a.png\",\"email\":\"m@example.com\"}";
+}
+
+int main(int argc, char* argv[])
+{
+  const int requests = argc > 1 ? atoi(argv[1]) : 200000;
+  log::Logger::setLogLevel(log::Logger::WARN);
+
+  net::EventLoop loop;
+  int fds[2];
+  if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) < 0)
+  {
+    perror("socketpair");
+    return 1;
+  }
+  auto conn = std::make_shared<HttpConnection>(&loop, "bench", fds[0], net::InetAddress(), net::InetAddress());
+  conn->setConnectionCallback([](const HttpConnectionPtr&) {});
+  conn->connectEstablished();
+
+  auto session = std::make_shared<HttpSession>(conn, [](std::shared_ptr<HttpSession> s) {
+    s->sendString(HTTP_STATUS_OK, kBody);
+  });
+
+  net::Buffer input;
+  char response[64 * 1024];
+  int64_t responseBytes = 0;
+  bool paused = false;
+
+  // 预热，让一次性的分配(日志、连接的缓冲区、Arena的块)不计入
+  for (int i = 0; i < 1000; ++i)
+  {
+    input.append(kRequest, sizeof kRequest - 1);
+    if (session->parse(&input, base::Timestamp(), &paused))
+      session->handleParsedMessage();
+    while (::read(fds[1], response, sizeof response) > 0) {}
+  }
+
+  int64_t allocations = g_allocations.load();
+  int64_t allocatedBytes = g_allocatedBytes.load();
+  int64_t start = base::Clock::monotonicNanos();
+  for (int i = 0; i < requests; ++i)
+  {
+    input.append(kRequest, sizeof kRequest - 1);
+    if (!session->parse(&input, base::Timestamp(), &paused))
+    {
+      fprintf(stderr, "parse failed\n");
+      return 1;
+    }
+    session->handleParsedMessage();
+    ssize_t n;
+    while ((n = ::read(fds[1], response, sizeof response)) > 0)
+      responseBytes += n;
+  }
+  int64_t elapsed = base::Clock::monotonicNanos() - start;
+  allocations = g_allocations.load() - allocations;
+  allocatedBytes = g_allocatedBytes.load() - allocatedBytes;
+
+  printf("requests %d  %.0f req/s  %.2f us/req\n", requests,
+         requests * 1e9 / static_cast<double>(elapsed), static_cast<double>(elapsed) / requests / 1000);
+  printf("allocations/request %.2f  bytes/request %.0f  response bytes/request %lld\n",
+         static_cast<double>(allocations) / requests, static_cast<double>(allocatedBytes) / requests,
+         static_cast<long long>(responseBytes / requests));
+
+  conn->connectDestroyed();
+  ::close(fds[1]);
+}
@@ -21,7 +21,7 @@ std::string HttpContext::Method() const {
   return session_->getRequest()->methodString();
 }
 
-const std::string& HttpContext::Path() const {
+std::string_view HttpContext::Path() const {
   return session_->getRequest()->getRequestUrl().path;
 }
 
@@ -41,7 +41,7 @@ public:
     }
 
     std::string Method() const;
-    const std::string& Path() const;
+    std::string_view Path() const;      //只在本次请求的回调中有效
     std::string RouterParam(const std::string& key, const std::string& def = "");
     std::string Query(const std::string& key, const std::string& def = "") const;
     std::string PostForm(const std::string& key, const std::string& def = "") const;
@@ -61,7 +61,7 @@ bool HttpRouter::findRoute(HttpContext* ctx)
   if(roots_.find(mth) == roots_.end()) return false;
    
     std::vector<std::string> parts;
-    detail::parsePattern(ctx->Path(), parts);
+    detail::parsePattern(std::string(ctx->Path()), parts);
     
     Node* node = roots_[ctx->Method()]->search(parts);
     
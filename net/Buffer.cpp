@@ -1,4 +1,5 @@
 #include "net/Buffer.h"
+#include "net/Scan.h"
 #include "net/sockets/Endian.h"
 #include "net/sockets/SocketsOps.h"
 #include "base/Types.h"
@@ -32,16 +33,26 @@ namespace Miren
 
         const char* Buffer::findCRLF() const
         {
-            const char* crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF+2);
-            return crlf == beginWrite() ? nullptr : crlf;
+            return scan::findCRLF(peek(), beginWrite());
         }
 
         const char* Buffer::findCRLF(const char* start) const
         {
             assert(peek() <= start);
             assert(start <= beginWrite());
-            const char* crlf = std::search(peek(), beginWrite(), kCRLF, kCRLF+2);
-            return crlf == beginWrite() ? nullptr : crlf;
+            return scan::findCRLF(start, beginWrite());
+        }
+
+        const char* Buffer::findCRLFCRLF() const
+        {
+            return scan::findCRLFCRLF(peek(), beginWrite());
+        }
+
+        const char* Buffer::find(const char* start, const char* delim, size_t len) const
+        {
+            assert(peek() <= start);
+            assert(start <= beginWrite());
+            return scan::find(start, beginWrite(), delim, len);
         }
         const char* Buffer::findEOL() const
         {
@@ -32,6 +32,10 @@ namespace Miren::net
         // 查找'\r\n'
         const char* findCRLF() const;
         const char* findCRLF(const char* start) const;
+        // 查找'\r\n\r\n'，即头部的结束位置
+        const char* findCRLFCRLF() const;
+        // 从start开始查找分隔符，没有找到返回nullptr
+        const char* find(const char* start, const char* delim, size_t len) const;
         // 查找'\n'
         const char* findEOL() const;
         const char* findEOL(const char* start) const;
@@ -6,6 +6,7 @@
 #include "base/log/Logging.h"
 #include "base/ErrorInfo.h"
 #include <errno.h>
+#include <random>
 
 
 namespace Miren
@@ -13,6 +14,18 @@ namespace Miren
 namespace net
 {
   const int Connector::kMaxRetryDelayMs;
+  const int Connector::kInitRetryDelayMs;
+
+  namespace
+  {
+    //在[delayMs/2, delayMs]中随机取一个值
+    int jitter(int delayMs)
+    {
+      thread_local std::minstd_rand rng(std::random_device{}());
+      int half = delayMs / 2;
+      return half + static_cast<int>(rng() % static_cast<unsigned>(delayMs - half + 1));
+    }
+  }
 
   //构造函数初始化了I/O线程，服务器地址，并设置为未连接状态以及初始化了重连延时时间
   Connector::Connector(EventLoop* loop, const InetAddress& serverAddr)
@@ -20,7 +33,9 @@ namespace net
       serverAddr_(serverAddr),
       connect_(false),
       state_(kDisconnected),
-      retryDelayMs_(kInitRetryDelayMs)
+      retryDelayMs_(kInitRetryDelayMs),
+      initRetryDelayMs_(kInitRetryDelayMs),
+      maxRetryDelayMs_(kMaxRetryDelayMs)
   {
     LOG_DEBUG << "Connector ctor[" << this << "]";
   }
@@ -55,11 +70,26 @@ namespace net
   {
     loop_->assertInLoopThread();
     setState(kDisconnected);
-    retryDelayMs_ = kInitRetryDelayMs;
+    retryDelayMs_ = initRetryDelayMs_;
     connect_ = true;
     startInLoop();
   }
 
+  void Connector::reconnect()
+  {
+    loop_->assertInLoopThread();
+    setState(kDisconnected);
+    connect_ = true;
+    scheduleRetry();
+  }
+
+  void Connector::setRetryDelayMs(int initMs, int maxMs)
+  {
+    initRetryDelayMs_ = std::max(initMs, 1);
+    maxRetryDelayMs_ = std::max(maxMs, initRetryDelayMs_);
+    retryDelayMs_ = initRetryDelayMs_;
+  }
+
   void Connector::stop()
   {
     connect_ = false;
@@ -207,12 +237,18 @@ namespace net
   {
     sockets::close(sockfd);//关闭原有的sockfd。每次尝试连接，都需要使用新sockfd
     setState(kDisconnected);
+    scheduleRetry();
+  }
+
+  void Connector::scheduleRetry()
+  {
     if(connect_) {
+      int delayMs = jitter(retryDelayMs_);
       LOG_INFO << "Connector::retry - Retry connecting to " << serverAddr_.toIpPort()
-          << " in " << retryDelayMs_ << " milliseconds.";
+          << " in " << delayMs << " milliseconds.";
       //隔一段时间后重连，重新启用startInLoop
-      loop_->runAfter(retryDelayMs_/1000.0, std::bind(&Connector::startInLoop, shared_from_this()));
-      retryDelayMs_ = std::min(retryDelayMs_ * 2, kMaxRetryDelayMs);
+      loop_->runAfter(delayMs/1000.0, std::bind(&Connector::startInLoop, shared_from_this()));
+      retryDelayMs_ = std::min(retryDelayMs_ * 2, maxRetryDelayMs_);
     }
     else {
       LOG_DEBUG << "do not connect";
@@ -30,6 +30,13 @@ namespace net
     void start();     // can be called in any thread
     void stop();      // can be called in any thread
     void restart();   // must be called in loop thread
+    // 连接断开后再次连接，must be called in loop thread
+    // 和restart()不同，等待当前的重连延迟后才连接，并且不重置延迟，用于连接刚建立就断开的情况
+    void reconnect();
+
+    // 重连延迟从initMs开始每次加倍直到maxMs，实际等待时间在[delay/2, delay]中随机，
+    // 避免大量客户端同时重连，在start()之前调用
+    void setRetryDelayMs(int initMs, int maxMs);
 
     const InetAddress& serverAddress() const { return serverAddr_; }
   private:
@@ -46,6 +53,7 @@ namespace net
     void handleWrite();
     void handleError();
     void retry(int sockfd);
+    void scheduleRetry();
     int removeAndResetChannel();
     void resetChannel();
   private:
@@ -56,6 +64,8 @@ namespace net
     std::unique_ptr<Channel> channel_;              //Connector所对应的Channel
     NewConnectionCallback newConnectionCallback_;   //连接成功回调函数
     int retryDelayMs_;                              //重连延迟时间(单位ms)
+    int initRetryDelayMs_;
+    int maxRetryDelayMs_;
   };
 } // namespace net
   
@@ -4,6 +4,8 @@
 #include "net/timer/TimerQueue.h"
 #include "net/sockets/SocketsOps.h"
 #include "base/log/Logging.h"
+#include "base/Clock.h"
+#include "base/Arena.h"
 #include "base/thread/CurrentThread.h"
 #include <sys/eventfd.h>
 #include <signal.h>
@@ -56,6 +58,23 @@ namespace Miren
             return t_loopInThisThread;
         }
 
+        base::Arena& EventLoop::arena()
+        {
+            assertInLoopThread();
+            if(!arena_) {
+                arena_.reset(new base::Arena());
+            }
+            return *arena_;
+        }
+
+        base::Timestamp EventLoop::cachedNow()
+        {
+            if(t_loopInThisThread && t_loopInThisThread->pollReturnTime_.valid()) {
+                return t_loopInThisThread->pollReturnTime_;
+            }
+            return base::Clock::now();
+        }
+
         EventLoop::EventLoop()
                     :looping_(false),
                     quit_(false),
@@ -11,6 +11,11 @@
 #include <map>
 namespace Miren
 {
+    namespace base
+    {
+        class Arena;
+    }
+
     namespace net
     {
         class Channel;
@@ -32,7 +37,10 @@ namespace Miren
             // 这个函数可以跨线程调用，停止事件循环
             void quit();
 
-            base::Timestamp pollReturnTime() const { return pollReturnTime_; }//poll返回的时间戳
+            //poll返回的时间戳，每轮poll由base::Clock::now()读一次，本轮的回调都可以把它当作当前时间
+            base::Timestamp pollReturnTime() const { return pollReturnTime_; }
+            //当前线程EventLoop的pollReturnTime()，线程没有EventLoop时读时钟
+            static base::Timestamp cachedNow();
             int64_t iteration() const { return iteration_; }
  /// 在它的IO线程内执行某个用户任务回调,避免线程不安全的问题，保证不会被多个线程同时访问
   /// 用来将非io线程内的任务放到pendingFunctors_中并唤醒wakeupChannel_事件来执行任务(在主循环中运行)
@@ -59,10 +67,15 @@ namespace Miren
 
             //用户自定义保存上下文,boost::any任何类型的数据都可以
             void setContext(const std::string& name, const std::any& context) { contexts_[name] = context; }
+            bool hasContext(const std::string& name) const { return contexts_.count(name) > 0; }
             const std::any& getContext(const std::string& name) const { return contexts_.at(name); }
             std::any* getMutableContext(const std::string& name) { return &contexts_.at(name); }
             void deleteContext(const std::string& name) { contexts_.erase(name); }
 
+            //本线程处理请求时共用的内存区(第一次调用时创建)，只能在IO线程中使用
+            //使用者在一次请求处理完后reset，例如HttpSession在请求的回调返回后释放请求和响应
+            base::Arena& arena();
+
             static EventLoop* getEventLoopOfCurrentThread();//返回当前线程的EventLoop对象指针(__thread类型)
 
         private:
@@ -88,6 +101,7 @@ namespace Miren
             std::unique_ptr<Channel> wakeupChannel_;    //wakeupFd_对于的通道。若此事件发生便会一次执行pendingFunctors_中的可调用对象
 
             std::map<std::string, std::any> contexts_;  //用来存储用户想要保存的信息，std::any任何类型的数据都可以
+            std::unique_ptr<base::Arena> arena_;
             
             ChannelList activeChannels_;                //保存的是poller类中的poll调用返回的所有活跃事件集
             Channel* currentActiveChannel_;             //当前正在处理的活动通道
@@ -0,0 +1,27 @@
+#include "net/EventLoopScheduler.h"
+#include "net/EventLoop.h"
+
+namespace Miren
+{
+    namespace net
+    {
+        EventLoopScheduler::EventLoopScheduler(EventLoop* loop)
+                    :loop_(loop)
+        {
+        }
+
+        EventLoopScheduler::~EventLoopScheduler() = default;
+
+        void EventLoopScheduler::Schedule(std::function<void()> f)
+        {
+            loop_->queueInLoop(std::move(f));
+        }
+
+        void EventLoopScheduler::ScheduleLater(std::chrono::milliseconds duration, std::function<void()> f)
+        {
+            // runAfter以秒为单位
+            loop_->runAfter(static_cast<double>(duration.count()) / 1000.0, std::move(f));
+        }
+    } // namespace net
+
+} // namespace Miren
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "future/Scheduler.h"
+
+#include <chrono>
+#include <functional>
+
+namespace Miren
+{
+    namespace net
+    {
+        class EventLoop;
+
+        /*
+        把EventLoop适配成future::Scheduler，使Future的回调回到IO线程执行
+        e.g.
+            EventLoopScheduler sched(conn->getLoop());
+            WhenAll(rpcs.begin(), rpcs.end())
+                .Then(&sched, [conn](std::vector<Try<Response>>&& rsps) {
+                    // 在conn所属的IO线程中执行，可以直接send
+                });
+        sched的生命期必须长于挂在它上面的回调，一般每个loop一个，在ThreadInitCallback中创建
+        */
+        class EventLoopScheduler : public Miren::Scheduler, base::NonCopyable
+        {
+        public:
+            explicit EventLoopScheduler(EventLoop* loop);
+            ~EventLoopScheduler() override;
+
+            // 可以跨线程调用，通过queueInLoop放入IO线程的任务队列，即使在IO线程中也不会立即执行
+            void Schedule(std::function<void()> f) override;
+            // 可以跨线程调用，通过runAfter注册定时器
+            void ScheduleLater(std::chrono::milliseconds duration, std::function<void()> f) override;
+
+            EventLoop* getLoop() const { return loop_; }
+        private:
+            EventLoop* loop_;
+        };
+    } // namespace net
+
+} // namespace Miren
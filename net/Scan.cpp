@@ -0,0 +1,284 @@
+#include "net/Scan.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MIREN_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Miren::net::scan
+{
+    namespace
+    {
+        constexpr bool isTokenChar(unsigned char c)
+        {
+            if((c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+                return true;
+            }
+            for(const char* p = "!#$%&'*+-.^_`|~"; *p; ++p) {
+                if(c == static_cast<unsigned char>(*p)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        struct TokenTables
+        {
+            bool chars[256];
+            // 按高4位和低4位查表：lo[c & 15] & hi[c >> 4]不为0时c是token字符
+            uint8_t lo[16];
+            uint8_t hi[16];
+        };
+
+        constexpr TokenTables makeTokenTables()
+        {
+            TokenTables t {};
+            for(int c = 0; c < 256; ++c) {
+                t.chars[c] = isTokenChar(static_cast<unsigned char>(c));
+                if(t.chars[c]) {
+                    t.lo[c & 15] = static_cast<uint8_t>(t.lo[c & 15] | (1 << (c >> 4)));
+                }
+            }
+            for(int h = 0; h < 8; ++h) {
+                t.hi[h] = static_cast<uint8_t>(1 << h);
+            }
+            return t;
+        }
+
+        constexpr TokenTables kToken = makeTokenTables();
+
+        const char* findScalar(const char* begin, const char* end, const char* needle, size_t len)
+        {
+            if(static_cast<size_t>(end - begin) < len) {
+                return nullptr;
+            }
+            const char* last = end - len;
+            for(const char* p = begin; p <= last; ++p) {
+                p = static_cast<const char*>(memchr(p, needle[0], static_cast<size_t>(last - p) + 1));
+                if(!p) {
+                    return nullptr;
+                }
+                if(memcmp(p + 1, needle + 1, len - 1) == 0) {
+                    return p;
+                }
+            }
+            return nullptr;
+        }
+
+        const char* findNonTokenScalar(const char* begin, const char* end)
+        {
+            const char* p = begin;
+            while(p != end && kToken.chars[static_cast<unsigned char>(*p)]) {
+                ++p;
+            }
+            return p;
+        }
+
+#ifdef MIREN_SCAN_X86
+        // 候选位置的首字节和尾字节都匹配，len<=2时不需要再比较
+        inline const char* checkCandidates(const char* p, uint32_t mask, const char* needle, size_t len)
+        {
+            while(mask) {
+                const char* candidate = p + __builtin_ctz(mask);
+                if(len <= 2 || memcmp(candidate + 1, needle + 1, len - 2) == 0) {
+                    return candidate;
+                }
+                mask &= mask - 1;
+            }
+            return nullptr;
+        }
+
+        // 首字节很少出现时(比如文件内容中的\r)，glibc的memchr比两次比较更快
+        // 连续kIdleBytes字节都没有首字节就用memchr跳到下一个首字节
+        const size_t kIdleBytes = 128;
+
+        // 返回下一个可能的候选位置，没有时返回nullptr
+        inline const char* skipToFirst(const char* p, const char* end, const char* needle, size_t len)
+        {
+            if(static_cast<size_t>(end - p) < len) {
+                return nullptr;
+            }
+            return static_cast<const char*>(memchr(p, needle[0], static_cast<size_t>(end - p) - len + 1));
+        }
+
+        // SSE2是x86-64的基本指令集，不需要检查CPU
+        const char* findSse2(const char* begin, const char* end, const char* needle, size_t len)
+        {
+            const __m128i first = _mm_set1_epi8(needle[0]);
+            const __m128i last = _mm_set1_epi8(needle[len - 1]);
+            const char* p = begin;
+            size_t idle = 0;
+            // 每次检查16个候选位置，最后一个候选位置要读到p + 15 + len - 1
+            while(static_cast<size_t>(end - p) >= 16 + len - 1) {
+                __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), first);
+                if(_mm_movemask_epi8(a) == 0) {
+                    p += 16;
+                    if((idle += 16) >= kIdleBytes) {
+                        idle = 0;
+                        if(!(p = skipToFirst(p, end, needle, len))) {
+                            return nullptr;
+                        }
+                    }
+                    continue;
+                }
+                idle = 0;
+                __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + len - 1)), last);
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(a, b)));
+                if(const char* found = checkCandidates(p, mask, needle, len)) {
+                    return found;
+                }
+                p += 16;
+            }
+            return findScalar(p, end, needle, len);
+        }
+
+        __attribute__((target("avx2")))
+        const char* findAvx2(const char* begin, const char* end, const char* needle, size_t len)
+        {
+            const __m256i first = _mm256_set1_epi8(needle[0]);
+            const __m256i last = _mm256_set1_epi8(needle[len - 1]);
+            const char* p = begin;
+            size_t idle = 0;
+            // 一次检查64个位置
+            while(static_cast<size_t>(end - p) >= 64 + len - 1) {
+                __m256i a0 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), first);
+                __m256i a1 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)), first);
+                __m256i any = _mm256_or_si256(a0, a1);
+                if(_mm256_testz_si256(any, any)) {
+                    p += 64;
+                    if((idle += 64) >= kIdleBytes) {
+                        idle = 0;
+                        if(!(p = skipToFirst(p, end, needle, len))) {
+                            return nullptr;
+                        }
+                    }
+                    continue;
+                }
+                idle = 0;
+                __m256i b0 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + len - 1)), last);
+                __m256i b1 = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 + len - 1)), last);
+                uint32_t mask0 = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(a0, b0)));
+                uint32_t mask1 = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(a1, b1)));
+                if(const char* found = checkCandidates(p, mask0, needle, len)) {
+                    return found;
+                }
+                if(const char* found = checkCandidates(p + 32, mask1, needle, len)) {
+                    return found;
+                }
+                p += 64;
+            }
+            return findSse2(p, end, needle, len);
+        }
+
+        // 查表需要pshufb(SSSE3)，没有时使用标量实现
+        __attribute__((target("ssse3")))
+        const char* findNonTokenSsse3(const char* begin, const char* end)
+        {
+            const __m128i lutLo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kToken.lo));
+            const __m128i lutHi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kToken.hi));
+            const __m128i nibble = _mm_set1_epi8(0x0f);
+            const char* p = begin;
+            while(end - p >= 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i lo = _mm_shuffle_epi8(lutLo, _mm_and_si128(v, nibble));
+                __m128i hi = _mm_shuffle_epi8(lutHi, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+                __m128i bad = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+                uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(bad));
+                if(mask) {
+                    return p + __builtin_ctz(mask);
+                }
+                p += 16;
+            }
+            return findNonTokenScalar(p, end);
+        }
+
+        __attribute__((target("avx2")))
+        const char* findNonTokenAvx2(const char* begin, const char* end)
+        {
+            const __m256i lutLo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(kToken.lo)));
+            const __m256i lutHi = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(kToken.hi)));
+            const __m256i nibble = _mm256_set1_epi8(0x0f);
+            const char* p = begin;
+            while(end - p >= 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                __m256i lo = _mm256_shuffle_epi8(lutLo, _mm256_and_si256(v, nibble));
+                __m256i hi = _mm256_shuffle_epi8(lutHi, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+                __m256i bad = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256());
+                uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(bad));
+                if(mask) {
+                    return p + __builtin_ctz(mask);
+                }
+                p += 32;
+            }
+            return findNonTokenSsse3(p, end);
+        }
+
+        bool hasSsse3()
+        {
+            static const bool supported = __builtin_cpu_supports("ssse3");
+            return supported;
+        }
+#endif
+
+        Level& currentLevel()
+        {
+            static Level current = supportedLevel();
+            return current;
+        }
+    }
+
+    Level supportedLevel()
+    {
+#ifdef MIREN_SCAN_X86
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? kAvx2 : kSse2;
+#else
+        return kScalar;
+#endif
+    }
+
+    Level level()
+    {
+        return currentLevel();
+    }
+
+    void setLevel(Level level)
+    {
+        Level supported = supportedLevel();
+        currentLevel() = level > supported ? supported : level;
+    }
+
+    const char* find(const char* begin, const char* end, const char* needle, size_t len)
+    {
+        if(len == 0) {
+            return begin;
+        }
+        switch(currentLevel()) {
+#ifdef MIREN_SCAN_X86
+            case kAvx2:
+                return findAvx2(begin, end, needle, len);
+            case kSse2:
+                return findSse2(begin, end, needle, len);
+#endif
+            default:
+                return findScalar(begin, end, needle, len);
+        }
+    }
+
+    const char* findNonToken(const char* begin, const char* end)
+    {
+        switch(currentLevel()) {
+#ifdef MIREN_SCAN_X86
+            case kAvx2:
+                return findNonTokenAvx2(begin, end);
+            case kSse2:
+                return hasSsse3() ? findNonTokenSsse3(begin, end) : findNonTokenScalar(begin, end);
+#endif
+            default:
+                return findNonTokenScalar(begin, end);
+        }
+    }
+}
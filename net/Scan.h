@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+
+namespace Miren::net
+{
+    /*
+    在收到的数据中查找分隔符和检查HTTP token，Buffer、multipart解析和按分隔符读取的codec使用
+    x86上用SSE2/AVX2一次比较16/32个字节：先用needle的首字节和尾字节筛选候选位置，再memcmp中间部分
+    运行时按CPU选择实现，不依赖编译选项；其他平台使用memchr+memcmp
+    */
+    namespace scan
+    {
+        enum Level
+        {
+            kScalar,
+            kSse2,
+            kAvx2,
+        };
+
+        // CPU支持的最好的实现
+        Level supportedLevel();
+        Level level();
+        // 强制使用某种实现，测试和benchmark使用；超过CPU支持的会降到supportedLevel()
+        // 不是线程安全的，需要在启动时调用
+        void setLevel(Level level);
+
+        // [begin, end)中needle第一次出现的位置，没有找到返回nullptr
+        const char* find(const char* begin, const char* end, const char* needle, size_t len);
+
+        inline const char* findCRLF(const char* begin, const char* end)
+        {
+            return find(begin, end, "\r\n", 2);
+        }
+
+        // 头部的结束位置
+        inline const char* findCRLFCRLF(const char* begin, const char* end)
+        {
+            return find(begin, end, "\r\n\r\n", 4);
+        }
+
+        // 第一个不是token字符(RFC 7230 tchar)的位置，都是token字符时返回end
+        // 头部字段名、方法名必须是token
+        const char* findNonToken(const char* begin, const char* end);
+
+        inline bool isToken(const char* begin, const char* end)
+        {
+            return begin != end && findNonToken(begin, end) == end;
+        }
+    }
+}
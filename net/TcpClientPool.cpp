@@ -0,0 +1,593 @@
+#include "net/TcpClientPool.h"
+#include "net/Connector.h"
+#include "net/EventLoop.h"
+#include "net/sockets/SocketsOps.h"
+#include "net/timer/TimerId.h"
+
+#include "base/log/Logging.h"
+#include "base/thread/Atomic.h"
+
+#include <algorithm>
+#include <map>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace Miren
+{
+namespace net
+{
+typedef std::shared_ptr<Connector> ConnectorPtr;
+
+namespace
+{
+  // 连接存活超过这个时间后断开，立即重连并重置退避延迟；否则按退避延迟重连
+  const double kStableConnectionSeconds = 1.0;
+  // 关闭多余的空闲连接时，shutdown后对端这么久还没关闭就强制关闭
+  const double kCloseTimeoutSeconds = 5.0;
+
+  void destroyConnection(const TcpConnectionPtr& conn)
+  {
+    conn->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
+  }
+
+  // Connector::stop()之后还有绑定了Connector的回调在队列中，保证它们执行时Connector还在
+  void removeConnector(const ConnectorPtr& connector)
+  {
+  }
+} // namespace
+
+TcpClientPool::Options::Options()
+    : minConnections(1),
+    maxConnections(8),
+    spareConnections(1),
+    healthCheckInterval(5.0),
+    idleTimeout(60.0),
+    initRetryDelayMs(100),
+    maxRetryDelayMs(30 * 1000)
+{
+}
+
+//start()之后只读，LoopPool和TcpClientPool共用
+struct TcpClientPool::Shared
+{
+  std::string name;
+  Options options;
+  ConnectionCallback connectionCallback;
+  MessageCallback messageCallback;
+  WriteCompleteCallback writeCompleteCallback;
+  HealthCheckCallback healthCheckCallback;
+
+  base::AtomicInt32 drainStarted;    //只有第一次drain()生效
+  base::AtomicInt32 drainingLoops;
+  base::AtomicInt64 reconnects;
+  DrainCallback drainCallback;
+};
+
+/*
+***一个IO线程中的连接，除了构造函数所有函数都在loop线程中调用
+***连接的回调只持有LoopPool的weak_ptr，TcpClientPool析构后LoopPool在loop线程中关闭连接后销毁
+*/
+class TcpClientPool::LoopPool : base::NonCopyable, public std::enable_shared_from_this<LoopPool>
+{
+public:
+  LoopPool(EventLoop* loop, const std::shared_ptr<Shared>& shared)
+      : loop_(loop),
+      shared_(shared),
+      draining_(false),
+      drained_(false)
+  {
+  }
+
+  EventLoop* loop() const { return loop_; }
+
+  void start()
+  {
+    loop_->assertInLoopThread();
+    std::weak_ptr<LoopPool> weakThis(shared_from_this());
+    healthCheckTimer_ = loop_->runEvery(shared_->options.healthCheckInterval, [weakThis]() {
+      LoopPoolPtr self(weakThis.lock());
+      if(self) {
+        self->checkHealth();
+      }
+    });
+  }
+
+  void addEndpoint(const InetAddress& addr)
+  {
+    loop_->assertInLoopThread();
+    getEndpoint(addr);
+  }
+
+  TcpConnectionPtr acquire(const InetAddress& addr)
+  {
+    loop_->assertInLoopThread();
+    if(draining_) {
+      return TcpConnectionPtr();
+    }
+    Endpoint* ep = getEndpoint(addr);
+    Slot* best = nullptr;
+    for(const SlotPtr& slot : ep->slots) {
+      if(usable(*slot) && (!best || slot->outstanding < best->outstanding)) {
+        best = slot.get();
+      }
+    }
+    if(!best) {
+      return TcpConnectionPtr();
+    }
+    best->lastActive = loop_->pollReturnTime();
+    if(best->outstanding++ == 0) {
+      ensureConnections(ep);    //用掉了一个空闲连接，补上
+    }
+    return best->conn;
+  }
+
+  void release(const TcpConnectionPtr& conn)
+  {
+    loop_->assertInLoopThread();
+    Endpoint* ep = findEndpoint(conn->peerAddr());
+    if(!ep) {
+      return;
+    }
+    for(const SlotPtr& slot : ep->slots) {
+      if(slot->conn == conn) {
+        if(slot->outstanding > 0) {
+          --slot->outstanding;
+        }
+        slot->lastActive = loop_->pollReturnTime();
+        if(slot->retiring && slot->outstanding == 0) {
+          closeIdle(*slot);
+        }
+        break;
+      }
+    }
+  }
+
+  int connections(const InetAddress& addr) const
+  {
+    loop_->assertInLoopThread();
+    Endpoint* ep = findEndpoint(addr);
+    if(!ep) {
+      return 0;
+    }
+    return static_cast<int>(std::count_if(ep->slots.begin(), ep->slots.end(),
+                                          [](const SlotPtr& slot) { return slot->conn && slot->conn->connected(); }));
+  }
+
+  void drain(double timeoutSeconds)
+  {
+    loop_->assertInLoopThread();
+    if(draining_) {
+      return;
+    }
+    draining_ = true;
+    loop_->cancel(healthCheckTimer_);
+    for(auto& it : endpoints_) {
+      Endpoint* ep = it.second.get();
+      std::vector<SlotPtr> slots(ep->slots);   //retire()会删除没有连接的slot
+      for(const SlotPtr& slot : slots) {
+        retire(ep, slot);
+      }
+    }
+    std::weak_ptr<LoopPool> weakThis(shared_from_this());
+    drainTimer_ = loop_->runAfter(timeoutSeconds, [weakThis]() {
+      LoopPoolPtr self(weakThis.lock());
+      if(self) {
+        self->forceCloseAll();
+      }
+    });
+    checkDrained();
+  }
+
+  //TcpClientPool析构后调用
+  void destroy()
+  {
+    loop_->assertInLoopThread();
+    loop_->cancel(healthCheckTimer_);
+    loop_->cancel(drainTimer_);
+    for(auto& it : endpoints_) {
+      for(const SlotPtr& slot : it.second->slots) {
+        stopConnector(*slot);
+        if(slot->conn) {
+          slot->conn->setCloseCallback(destroyConnection);
+          slot->conn->forceClose();
+        }
+      }
+    }
+    endpoints_.clear();
+  }
+
+private:
+  //一个连接位置：Connector以及它建立的连接，连接断开后用同一个Connector重连
+  struct Slot
+  {
+    Slot() : outstanding(0), retiring(false) {}
+
+    ConnectorPtr connector;
+    TcpConnectionPtr conn;
+    int outstanding;              //未完成的请求数
+    base::Timestamp lastActive;
+    base::Timestamp connectedAt;
+    bool retiring;                //关闭后不再重连
+  };
+  typedef std::shared_ptr<Slot> SlotPtr;
+
+  struct Endpoint
+  {
+    explicit Endpoint(const InetAddress& addrArg) : addr(addrArg), nextConnId(1) {}
+
+    InetAddress addr;
+    std::vector<SlotPtr> slots;   //最多maxConnections个，线性查找
+    int nextConnId;
+  };
+
+  //地址族、端口和IP，每次acquire()都要查找，不用toIpPort()拼字符串
+  struct EndpointKey
+  {
+    explicit EndpointKey(const InetAddress& addr)
+    {
+      const struct sockaddr* sa = addr.getSockAddr();
+      memset(bytes, 0, sizeof bytes);
+      memcpy(bytes, &sa->sa_family, 2);
+      if(sa->sa_family == AF_INET) {
+        const struct sockaddr_in* in = reinterpret_cast<const struct sockaddr_in*>(sa);
+        memcpy(bytes + 2, &in->sin_port, 2);
+        memcpy(bytes + 4, &in->sin_addr, 4);
+      }
+      else {
+        const struct sockaddr_in6* in6 = reinterpret_cast<const struct sockaddr_in6*>(sa);
+        memcpy(bytes + 2, &in6->sin6_port, 2);
+        memcpy(bytes + 4, &in6->sin6_addr, 16);
+      }
+    }
+
+    bool operator<(const EndpointKey& other) const { return memcmp(bytes, other.bytes, sizeof bytes) < 0; }
+
+    char bytes[2 + 2 + 16];
+  };
+
+  static bool usable(const Slot& slot)
+  {
+    return slot.conn && !slot.retiring && slot.conn->connected();
+  }
+
+  Endpoint* findEndpoint(const InetAddress& addr) const
+  {
+    auto it = endpoints_.find(EndpointKey(addr));
+    return it == endpoints_.end() ? nullptr : it->second.get();
+  }
+
+  Endpoint* getEndpoint(const InetAddress& addr)
+  {
+    std::unique_ptr<Endpoint>& ep = endpoints_[EndpointKey(addr)];
+    if(!ep) {
+      ep.reset(new Endpoint(addr));
+      ensureConnections(ep.get());
+    }
+    return ep.get();
+  }
+
+  //保持 max(minConnections, 使用中的连接数 + spareConnections) 个连接，不超过maxConnections
+  void ensureConnections(Endpoint* ep)
+  {
+    if(draining_) {
+      return;
+    }
+    const Options& options = shared_->options;
+    int total = 0;
+    int busy = 0;
+    for(const SlotPtr& slot : ep->slots) {
+      if(!slot->retiring) {
+        ++total;
+        if(slot->outstanding > 0) {
+          ++busy;
+        }
+      }
+    }
+    int want = std::min(std::max(options.minConnections, busy + options.spareConnections), options.maxConnections);
+    for(; total < want; ++total) {
+      addSlot(ep);
+    }
+  }
+
+  void addSlot(Endpoint* ep)
+  {
+    SlotPtr slot(new Slot);
+    slot->connector.reset(new Connector(loop_, ep->addr));
+    slot->connector->setRetryDelayMs(shared_->options.initRetryDelayMs, shared_->options.maxRetryDelayMs);
+    std::weak_ptr<LoopPool> weakThis(shared_from_this());
+    std::weak_ptr<Slot> weakSlot(slot);
+    slot->connector->setNewConnectionCallback([weakThis, ep, weakSlot](int sockfd) {
+      LoopPoolPtr self(weakThis.lock());
+      if(self) {
+        self->newConnection(ep, weakSlot, sockfd);
+      }
+      else {
+        sockets::close(sockfd);
+      }
+    });
+    ep->slots.push_back(slot);
+    slot->connector->start();
+  }
+
+  void newConnection(Endpoint* ep, const std::weak_ptr<Slot>& weakSlot, int sockfd)
+  {
+    loop_->assertInLoopThread();
+    SlotPtr slot(weakSlot.lock());
+    if(!slot || slot->retiring) {
+      sockets::close(sockfd);
+      return;
+    }
+    InetAddress peerAddr(sockets::getPeerAddr(sockfd));
+    char buf[64];
+    snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), ep->nextConnId);
+    ++ep->nextConnId;
+    std::string connName = shared_->name + buf;
+
+    InetAddress localAddr(sockets::getLocalAddr(sockfd));
+    TcpConnectionPtr conn(new TcpConnection(loop_, connName, sockfd, localAddr, peerAddr));
+    conn->setConnectionCallback(shared_->connectionCallback);
+    conn->setMessageCallback(shared_->messageCallback);
+    conn->setWriteCompleteCallback(shared_->writeCompleteCallback);
+    std::weak_ptr<LoopPool> weakThis(shared_from_this());
+    conn->setCloseCallback([weakThis, ep, weakSlot](const TcpConnectionPtr& c) {
+      LoopPoolPtr self(weakThis.lock());
+      if(self) {
+        self->removeConnection(ep, weakSlot, c);
+      }
+      else {
+        destroyConnection(c);
+      }
+    });
+    slot->conn = conn;
+    slot->outstanding = 0;
+    slot->connectedAt = loop_->pollReturnTime();
+    slot->lastActive = slot->connectedAt;
+    conn->connectEstablished();
+  }
+
+  void removeConnection(Endpoint* ep, const std::weak_ptr<Slot>& weakSlot, const TcpConnectionPtr& conn)
+  {
+    loop_->assertInLoopThread();
+    destroyConnection(conn);
+    SlotPtr slot(weakSlot.lock());
+    if(!slot || slot->conn != conn) {
+      return;
+    }
+    slot->conn.reset();
+    slot->outstanding = 0;    //未完成的请求由使用者根据连接断开自己处理
+    if(slot->retiring) {
+      eraseSlot(ep, slot);
+      checkDrained();
+      return;
+    }
+
+    shared_->reconnects.increment();
+    if(base::timeDifference(loop_->pollReturnTime(), slot->connectedAt) >= kStableConnectionSeconds) {
+      slot->connector->restart();
+    }
+    else {
+      LOG_WARN << "TcpClientPool[" << shared_->name << "] - " << conn->name()
+               << " closed right after connecting, reconnect later";
+      slot->connector->reconnect();
+    }
+  }
+
+  //关闭slot，有未完成的请求时等最后一个release()
+  void retire(Endpoint* ep, const SlotPtr& slot)
+  {
+    slot->retiring = true;
+    stopConnector(*slot);
+    if(!slot->conn) {
+      eraseSlot(ep, slot);
+    }
+    else if(slot->outstanding == 0) {
+      closeIdle(*slot);
+    }
+  }
+
+  void closeIdle(Slot& slot)
+  {
+    slot.conn->shutdown();
+    if(!draining_) {
+      slot.conn->forceCloseWithDelay(kCloseTimeoutSeconds);   //drain有自己的超时
+    }
+  }
+
+  void stopConnector(Slot& slot)
+  {
+    slot.connector->stop();
+    loop_->runAfter(1, std::bind(&removeConnector, slot.connector));
+  }
+
+  void eraseSlot(Endpoint* ep, const SlotPtr& slot)
+  {
+    auto it = std::find(ep->slots.begin(), ep->slots.end(), slot);
+    if(it != ep->slots.end()) {
+      ep->slots.erase(it);
+    }
+  }
+
+  //关闭有问题的空闲连接(断开后自动重连)以及空闲太久的多余连接，再补足连接数
+  void checkHealth()
+  {
+    const Options& options = shared_->options;
+    base::Timestamp now = loop_->pollReturnTime();
+    for(auto& it : endpoints_) {
+      Endpoint* ep = it.second.get();
+      int total = 0;
+      int busy = 0;
+      for(const SlotPtr& slot : ep->slots) {
+        if(!slot->retiring) {
+          ++total;
+          if(slot->outstanding > 0) {
+            ++busy;
+          }
+        }
+      }
+      int keep = std::max(options.minConnections, busy + options.spareConnections);
+
+      std::vector<SlotPtr> slots(ep->slots);
+      for(const SlotPtr& slot : slots) {
+        if(!usable(*slot) || slot->outstanding > 0) {
+          continue;
+        }
+        if(total > keep && base::timeDifference(now, slot->lastActive) >= options.idleTimeout) {
+          LOG_DEBUG << "TcpClientPool[" << shared_->name << "] - close idle " << slot->conn->name();
+          retire(ep, slot);
+          --total;
+        }
+        else if(!healthy(slot->conn)) {
+          LOG_WARN << "TcpClientPool[" << shared_->name << "] - " << slot->conn->name()
+                   << " failed health check";
+          slot->conn->forceClose();
+        }
+      }
+      ensureConnections(ep);
+    }
+  }
+
+  bool healthy(const TcpConnectionPtr& conn) const
+  {
+    struct tcp_info info;
+    if(!conn->getTcpInfo(&info) || info.tcpi_state != TCP_ESTABLISHED) {
+      return false;
+    }
+    return !shared_->healthCheckCallback || shared_->healthCheckCallback(conn);
+  }
+
+  void forceCloseAll()
+  {
+    for(auto& it : endpoints_) {
+      for(const SlotPtr& slot : it.second->slots) {
+        if(slot->conn) {
+          slot->conn->forceClose();
+        }
+      }
+    }
+  }
+
+  void checkDrained()
+  {
+    if(!draining_ || drained_) {
+      return;
+    }
+    for(auto& it : endpoints_) {
+      if(!it.second->slots.empty()) {
+        return;
+      }
+    }
+    drained_ = true;
+    loop_->cancel(drainTimer_);
+    if(shared_->drainingLoops.decrementAndGet() == 0 && shared_->drainCallback) {
+      shared_->drainCallback();
+    }
+  }
+
+  EventLoop* loop_;
+  std::shared_ptr<Shared> shared_;
+  std::map<EndpointKey, std::unique_ptr<Endpoint>> endpoints_;
+  TimerId healthCheckTimer_;
+  TimerId drainTimer_;
+  bool draining_;
+  bool drained_;
+};
+
+TcpClientPool::TcpClientPool(const std::vector<EventLoop*>& loops, const std::string& nameArg,
+                             const Options& options)
+    : name_(nameArg),
+    options_(options),
+    connectionCallback_(defaultConnectionCallback),
+    messageCallback_(defaultMessageCallback),
+    started_(false),
+    shared_(new Shared)
+{
+  assert(options_.minConnections >= 0 && options_.maxConnections >= 1);
+  assert(options_.minConnections <= options_.maxConnections);
+  for(EventLoop* loop : loops) {
+    loops_.push_back(std::make_shared<LoopPool>(CHECK_NOTNULL(loop), shared_));
+  }
+}
+
+TcpClientPool::~TcpClientPool()
+{
+  LOG_INFO << "TcpClientPool::~TcpClientPool[" << name_ << "]";
+  for(const LoopPoolPtr& lp : loops_) {
+    LoopPoolPtr pool(lp);
+    pool->loop()->runInLoop([pool]() { pool->destroy(); });
+  }
+}
+
+void TcpClientPool::start()
+{
+  assert(!started_);
+  started_ = true;
+  shared_->name = name_;
+  shared_->options = options_;
+  shared_->connectionCallback = connectionCallback_;
+  shared_->messageCallback = messageCallback_;
+  shared_->writeCompleteCallback = writeCompleteCallback_;
+  shared_->healthCheckCallback = healthCheckCallback_;
+  for(const LoopPoolPtr& lp : loops_) {
+    lp->loop()->runInLoop(std::bind(&LoopPool::start, lp));
+  }
+}
+
+void TcpClientPool::addEndpoint(const InetAddress& endpoint)
+{
+  assert(started_);
+  for(const LoopPoolPtr& lp : loops_) {
+    lp->loop()->runInLoop(std::bind(&LoopPool::addEndpoint, lp, endpoint));
+  }
+}
+
+TcpClientPool::LoopPool* TcpClientPool::currentLoopPool() const
+{
+  EventLoop* loop = EventLoop::getEventLoopOfCurrentThread();
+  for(const LoopPoolPtr& lp : loops_) {
+    if(lp->loop() == loop) {
+      return lp.get();
+    }
+  }
+  LOG_FATAL << "TcpClientPool[" << name_ << "] - called outside of its loops";
+  return nullptr;
+}
+
+TcpConnectionPtr TcpClientPool::acquire(const InetAddress& endpoint)
+{
+  assert(started_);
+  return currentLoopPool()->acquire(endpoint);
+}
+
+void TcpClientPool::release(const TcpConnectionPtr& conn)
+{
+  currentLoopPool()->release(conn);
+}
+
+int TcpClientPool::connections(const InetAddress& endpoint) const
+{
+  return currentLoopPool()->connections(endpoint);
+}
+
+int64_t TcpClientPool::reconnects() const
+{
+  return shared_->reconnects.get();
+}
+
+void TcpClientPool::drain(DrainCallback cb, double timeoutSeconds)
+{
+  //再次drain会重置drainingLoops，而各个loop已经在drain了不会再计数，回调就永远不会调用
+  if(shared_->drainStarted.getAndSet(1) != 0) {
+    LOG_WARN << "TcpClientPool[" << name_ << "] - already draining, ignore drain()";
+    return;
+  }
+  shared_->drainCallback = std::move(cb);
+  shared_->drainingLoops.getAndSet(static_cast<int32_t>(loops_.size()));
+  for(const LoopPoolPtr& lp : loops_) {
+    lp->loop()->runInLoop(std::bind(&LoopPool::drain, lp, timeoutSeconds));
+  }
+}
+
+} // namespace net
+
+} // namespace Miren
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "net/TcpConnection.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Miren
+{
+namespace net
+{
+  class EventLoop;
+
+  /*
+  ***按endpoint(服务器地址)组织的TcpClient连接池
+  ***每个IO线程对每个endpoint维护自己的一组连接，连接只在建立它的loop中使用，调用者不需要跨线程
+  ***一个连接上可以同时有多个未完成的请求(pipelining)，acquire()选择未完成请求最少的连接
+  ***除了正在使用的连接，再保持spareConnections个空闲连接，空闲连接定期做健康检查
+  ***连接断开后按带抖动的指数退避重连，drain()等未完成的请求结束后关闭所有连接
+  e.g.
+      TcpClientPool pool(threadPool->getAllLoops(), "backend");
+      pool.setMessageCallback(onResponse);    // 应答完整后调用pool.release(conn)
+      pool.start();
+      pool.addEndpoint(InetAddress("10.0.0.1", 9000));
+      // 在某个IO线程中
+      TcpConnectionPtr conn = pool.acquire(InetAddress("10.0.0.1", 9000));
+      if(conn) conn->send(request);
+  */
+  class TcpClientPool : base::NonCopyable
+  {
+  public:
+    struct Options
+    {
+      Options();
+
+      int minConnections;           // 每个loop对每个endpoint至少保持的连接数
+      int maxConnections;           // 每个loop对每个endpoint最多的连接数
+      int spareConnections;         // 正在使用的连接之外保持的空闲连接数
+      double healthCheckInterval;   // 检查空闲连接的间隔(秒)
+      double idleTimeout;           // 多余的连接空闲这么久后关闭(秒)
+      int initRetryDelayMs;         // 重连延迟从这里开始加倍
+      int maxRetryDelayMs;
+    };
+
+    // 检查一个空闲连接，返回false时关闭它并重连，在连接所在的IO线程中调用
+    typedef std::function<bool (const TcpConnectionPtr&)> HealthCheckCallback;
+    typedef std::function<void ()> DrainCallback;
+
+    TcpClientPool(const std::vector<EventLoop*>& loops, const std::string& nameArg,
+                  const Options& options = Options());
+    ~TcpClientPool();
+
+    // 在start()之前设置，所有连接共用
+    void setConnectionCallback(ConnectionCallback cb) { connectionCallback_ = std::move(cb); }
+    void setMessageCallback(MessageCallback cb) { messageCallback_ = std::move(cb); }
+    void setWriteCompleteCallback(WriteCompleteCallback cb) { writeCompleteCallback_ = std::move(cb); }
+    void setHealthCheckCallback(HealthCheckCallback cb) { healthCheckCallback_ = std::move(cb); }
+
+    void start();
+
+    // 可以跨线程调用，在每个loop中建立到endpoint的连接
+    void addEndpoint(const InetAddress& endpoint);
+
+    // 只能在loops中的IO线程调用，返回本线程中连到endpoint、未完成请求最少的连接，
+    // 并把它的未完成请求数加一，应答到达后调用release()。
+    // 没有可用的连接(正在连接或者在drain)时返回空，第一次acquire一个endpoint时开始连接
+    TcpConnectionPtr acquire(const InetAddress& endpoint);
+    void release(const TcpConnectionPtr& conn);
+
+    // 可以跨线程调用，不再建立连接，空闲的连接立即关闭，其余的在未完成的请求release()后关闭，
+    // timeoutSeconds后还没关闭的强制关闭。全部关闭后在最后一个完成的IO线程中调用cb。
+    // 只有第一次调用生效，之后的调用被忽略，它们的cb不会被调用
+    void drain(DrainCallback cb, double timeoutSeconds = 10.0);
+
+    // 只能在loops中的IO线程调用，本线程中到endpoint的已建立的连接数
+    int connections(const InetAddress& endpoint) const;
+    // 所有loop重连的次数
+    int64_t reconnects() const;
+
+    const std::string& name() const { return name_; }
+    const Options& options() const { return options_; }
+
+  private:
+    class LoopPool;
+    struct Shared;
+    typedef std::shared_ptr<LoopPool> LoopPoolPtr;
+
+    LoopPool* currentLoopPool() const;
+
+    const std::string name_;
+    const Options options_;
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    HealthCheckCallback healthCheckCallback_;
+
+    bool started_;
+    std::vector<LoopPoolPtr> loops_;
+    // LoopPool可能比TcpClientPool活得久，共用的计数放在这里
+    std::shared_ptr<Shared> shared_;
+  };
+} // namespace net
+
+} // namespace Miren
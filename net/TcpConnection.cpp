@@ -170,7 +170,7 @@ namespace Miren
         void TcpConnection::forceClose()
         {
             if(state_ == kConnected || state_ == kDisconnecting) {
-                setState(kDisconnected);
+                setState(kDisconnecting);
                 loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
             }
         }
@@ -186,7 +186,7 @@ namespace Miren
         void TcpConnection::forceCloseWithDelay(double seconds)
         {
             if(state_ == kConnected || state_ == kDisconnecting) {
-                setState(kDisconnected);
+                setState(kDisconnecting);
                 loop_->runAfter(seconds, base::makeWeakCallback(shared_from_this(), &TcpConnection::forceClose));
             }
         }
@@ -63,6 +63,7 @@ namespace Miren
             std::any& getContext(const std::string& name) { return contexts_.at(name); }
             std::any* getMutableContext(const std::string& name) { return &contexts_.at(name); }
             void deleteContext(const std::string& name) { contexts_.erase(name); }
+            bool hasContext(const std::string& name) const { return contexts_.count(name) != 0; }
 
 
             void setConnectionCallback(const ConnectionCallback& cb) { connectionCallback_ = cb;}
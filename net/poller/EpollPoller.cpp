@@ -1,6 +1,7 @@
 #include "net/poller/EpollPoller.h"
 #include "net/Channel.h"
 #include "base/log/Logging.h"
+#include "base/Clock.h"
 #include <sys/epoll.h>
 #include <poll.h>
 #include <unistd.h>
@@ -42,7 +43,7 @@ namespace Miren
             LOG_TRACE << "fd total count: " << channelsMap_.size();
             int numEvents = ::epoll_wait(epollfd_, &*events_.begin(), static_cast<int>(events_.size()), timeoutMs);
             int savedErrno = errno;
-            base::Timestamp now(base::Timestamp::now());
+            base::Timestamp now(base::Clock::now());
 
             if(numEvents > 0) {
                 LOG_TRACE << numEvents << " events happened";
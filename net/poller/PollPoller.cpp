@@ -1,6 +1,7 @@
 #include "net/poller/PollPoller.h"
 #include "net/Channel.h"
 #include "base/log/Logging.h"
+#include "base/Clock.h"
 #include <poll.h>
 #include <algorithm>
 #include <iterator>
@@ -19,7 +20,7 @@ namespace Miren
         {
             int numEvents = ::poll(&*pollfds_.begin(), pollfds_.size(), timeoutMs);
             int savedErrno = errno;
-            base::Timestamp now(base::Timestamp::now());
+            base::Timestamp now(base::Clock::now());
             if(numEvents > 0) {
                 LOG_TRACE << numEvents << " events happened";
                 fillActiveChannels(numEvents, activeChannels);
@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 #include "net/Buffer.h"
+#include "net/Scan.h"
+
+#include <algorithm>
+#include <random>
 
 using namespace std;
 using Miren::net::Buffer;
@@ -166,3 +170,78 @@ TEST(buffer, testMove)
   output(std::move(buf), inner);
 }
 #endif
+
+TEST(buffer, testBufferFindCRLF)
+{
+  Buffer buf;
+  buf.append(string(1000, 'x'));
+  buf.append("\r\nabc\r\n\r\n");
+  const char* null = NULL;
+  EXPECT_EQ(buf.findCRLF(), buf.peek() + 1000);
+  EXPECT_EQ(buf.findCRLF(buf.peek() + 1001), buf.peek() + 1005);
+  EXPECT_EQ(buf.findCRLFCRLF(), buf.peek() + 1005);
+  EXPECT_EQ(buf.find(buf.peek(), "abc", 3), buf.peek() + 1002);
+  EXPECT_EQ(buf.findCRLF(buf.peek() + 1008), null);
+}
+
+// 各种实现的结果都和std::search相同
+TEST(scan, testFindMatchesSearch)
+{
+  using namespace Miren::net;
+  const scan::Level saved = scan::level();
+  const string needles[] = { "\r\n", "\r\n\r\n", "\r", "--boundary", "\r\n--0123456789abcdefghijklmnopqrstuvwxyz" };
+  std::mt19937 rng(1);
+  for (int level = scan::kScalar; level <= scan::supportedLevel(); ++level)
+  {
+    scan::setLevel(static_cast<scan::Level>(level));
+    for (const string& needle : needles)
+    {
+      for (size_t size = 0; size < 200; ++size)
+      {
+        // 只用needle中的字符和'x'，经常出现部分匹配
+        string data(size, 'x');
+        for (char& c : data)
+        {
+          if (rng() % 4 == 0)
+          {
+            c = needle[rng() % needle.size()];
+          }
+        }
+        if (size > needle.size() && rng() % 2 == 0)
+        {
+          data.replace(rng() % (size - needle.size()), needle.size(), needle);
+        }
+        const char* begin = data.data();
+        const char* end = begin + data.size();
+        const char* expected = std::search(begin, end, needle.data(), needle.data() + needle.size());
+        const char* found = scan::find(begin, end, needle.data(), needle.size());
+        EXPECT_EQ(found ? found : end, expected) << "level " << level << " size " << size;
+      }
+    }
+  }
+  scan::setLevel(saved);
+}
+
+TEST(scan, testFindNonToken)
+{
+  using namespace Miren::net;
+  const scan::Level saved = scan::level();
+  const string token = "Content-Type!#$%&'*+.^_`|~0123456789abcdefghijklmnopqrstuvwxyz";
+  const string bad = " \t\r\n\"(),/:;<=>?@[\\]{}\x7f\x80\xff";
+  for (int level = scan::kScalar; level <= scan::supportedLevel(); ++level)
+  {
+    scan::setLevel(static_cast<scan::Level>(level));
+    EXPECT_TRUE(scan::isToken(token.data(), token.data() + token.size()));
+    EXPECT_FALSE(scan::isToken(token.data(), token.data()));
+    for (size_t pos = 0; pos < token.size(); ++pos)
+    {
+      for (char c : bad)
+      {
+        string s = token;
+        s[pos] = c;
+        EXPECT_EQ(scan::findNonToken(s.data(), s.data() + s.size()), s.data() + pos);
+      }
+    }
+  }
+  scan::setLevel(saved);
+}
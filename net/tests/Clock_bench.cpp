@@ -0,0 +1,135 @@
+// 各种时钟的单次调用耗时，以及按秒缓存的时间字符串和直接格式化的比较
+
+#include "base/Clock.h"
+#include "base/Timestamp.h"
+#include "base/thread/Thread.h"
+#include "net/EventLoop.h"
+
+#include <memory>
+#include <vector>
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+using Miren::base::CachedDate;
+using Miren::base::Clock;
+using Miren::base::Timestamp;
+using Miren::base::TscClock;
+
+namespace
+{
+  const int kIterations = 10 * 1000 * 1000;
+  volatile int64_t g_sink;
+
+  template<typename F>
+  void bench(const char* name, F f, int iterations = kIterations)
+  {
+    int64_t start = Clock::monotonicNanos();
+    int64_t sum = 0;
+    for(int i = 0; i < iterations; ++i) {
+      sum += f(i);
+    }
+    int64_t elapsed = Clock::monotonicNanos() - start;
+    g_sink = sum;
+    printf("%-36s %8.2f ns/call\n", name, static_cast<double>(elapsed) / iterations);
+  }
+
+  // 多个线程同时读共享的时间字符串，秒数每1000次调用前进一秒，经常需要更新缓存
+  void benchSharedDate(int numThreads)
+  {
+    const int kPerThread = 2 * 1000 * 1000;
+    std::vector<std::unique_ptr<Miren::base::Thread>> threads;
+    int64_t start = Clock::monotonicNanos();
+    for(int t = 0; t < numThreads; ++t) {
+      threads.emplace_back(new Miren::base::Thread([] {
+        char buf[CachedDate::kHttpDateLength];
+        char expect[CachedDate::kHttpDateLength];
+        time_t base = ::time(nullptr);
+        for(int i = 0; i < kPerThread; ++i) {
+          time_t seconds = base + i / 1000;
+          CachedDate::httpDate(seconds, buf);
+          if(i % 1000 == 0) {
+            CachedDate::formatHttpDate(seconds, expect);
+            assert(memcmp(buf, expect, sizeof buf) == 0);
+          }
+        }
+      }));
+      threads.back()->start();
+    }
+    for(auto& thr : threads) {
+      thr->join();
+    }
+    int64_t elapsed = Clock::monotonicNanos() - start;
+    printf("CachedDate::httpDate %2d threads       %8.2f ns/call\n",
+           numThreads, static_cast<double>(elapsed) / (static_cast<int64_t>(numThreads) * kPerThread));
+  }
+}
+
+int main()
+{
+  printf("TSC invariant %s, %.4f ticks/ns\n", TscClock::invariant() ? "yes" : "no", TscClock::ticksPerNanosecond());
+
+  bench("gettimeofday (Timestamp::now)", [](int) { return Timestamp::now().microSecondsSinceEpoch(); });
+  bench("CLOCK_REALTIME (Clock::now)", [](int) { return Clock::now().microSecondsSinceEpoch(); });
+  bench("CLOCK_REALTIME_COARSE", [](int) { return Clock::coarseNow().microSecondsSinceEpoch(); });
+  bench("CLOCK_MONOTONIC", [](int) { return Clock::monotonicNanos(); });
+  bench("CLOCK_MONOTONIC_COARSE", [](int) { return Clock::monotonicCoarseNanos(); });
+  bench("rdtsc (TscClock::ticks)", [](int) { return static_cast<int64_t>(TscClock::ticks()); });
+  bench("TscClock::toNanos(ticks)", [](int) { return TscClock::toNanos(TscClock::ticks()); });
+
+  // EventLoop每轮poll读一次时钟，回调中读到的是缓存值
+  Miren::net::EventLoop loop;
+  loop.runAfter(0.0, [&loop] {
+    bench("EventLoop::cachedNow", [](int) { return Miren::net::EventLoop::cachedNow().microSecondsSinceEpoch(); });
+    loop.quit();
+  });
+  loop.loop();
+
+  // TSC测量一个很短的区间
+  {
+    uint64_t start = TscClock::ticks();
+    int64_t sum = 0;
+    for(int i = 0; i < 100; ++i) {
+      sum += i * i;
+    }
+    g_sink = sum;
+    printf("%-36s %8ld ns\n", "100 multiply-adds measured by TSC", TscClock::toNanos(TscClock::ticks() - start));
+  }
+
+  time_t now = ::time(nullptr);
+  char buf[64];
+  bench("strftime http date", [now, &buf](int i) {
+    time_t seconds = now + i / 1000;
+    struct tm tm_time;
+    ::gmtime_r(&seconds, &tm_time);
+    return static_cast<int64_t>(::strftime(buf, sizeof buf, "%a, %d %b %Y %H:%M:%S GMT", &tm_time));
+  }, kIterations / 10);
+  bench("CachedDate::formatHttpDate", [now, &buf](int i) {
+    CachedDate::formatHttpDate(now + i / 1000, buf);
+    return static_cast<int64_t>(buf[0]);
+  }, kIterations / 10);
+  bench("CachedDate::httpDate (same second)", [now, &buf](int) {
+    CachedDate::httpDate(now, buf);
+    return static_cast<int64_t>(buf[0]);
+  });
+  bench("CachedDate::logTime (same second)", [now, &buf](int) {
+    CachedDate::logTime(now, buf);
+    return static_cast<int64_t>(buf[0]);
+  });
+
+  char strftimeBuf[64];
+  struct tm tm_time;
+  ::gmtime_r(&now, &tm_time);
+  ::strftime(strftimeBuf, sizeof strftimeBuf, "%a, %d %b %Y %H:%M:%S GMT", &tm_time);
+  CachedDate::httpDate(now, buf);
+  assert(memcmp(buf, strftimeBuf, CachedDate::kHttpDateLength) == 0);
+  ::strftime(strftimeBuf, sizeof strftimeBuf, "%Y%m%d %H:%M:%S", &tm_time);
+  CachedDate::logTime(now, buf);
+  assert(memcmp(buf, strftimeBuf, CachedDate::kLogTimeLength) == 0);
+  (void)strftimeBuf;
+
+  benchSharedDate(1);
+  benchSharedDate(4);
+}
@@ -0,0 +1,82 @@
+#include "net/EventLoopScheduler.h"
+#include "net/EventLoop.h"
+#include "base/thread/CurrentThread.h"
+#include "future/Future.h"
+#include "future/WorkStealingPool.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace Miren;
+using namespace Miren::base;
+using namespace Miren::net;
+
+// 模拟一次耗时的后端调用
+int fakeRpc(int i)
+{
+  ::usleep(10 * 1000);
+  return i * i;
+}
+
+int main()
+{
+  printf("main(): pid = %d, tid = %d\n", getpid(), CurrentThread::tid());
+
+  EventLoop loop;
+  EventLoopScheduler sched(&loop);
+  WorkStealingPool pool;
+  pool.SetNumOfThreads(4);
+
+  const int kBackends = 16;
+  int pending = 4;
+  auto done = [&]() {
+    if (--pending == 0)
+      loop.quit();
+  };
+
+  // fan out to kBackends, join on the loop thread without blocking it
+  std::vector<Future<int>> calls;
+  for (int i = 0; i < kBackends; ++i)
+    calls.push_back(pool.Execute(fakeRpc, i));
+
+  WhenAll(calls.begin(), calls.end())
+    .Then(&sched, [&](std::vector<Try<int>>&& results) {
+      assert(loop.isInLoopThread());
+      int sum = 0;
+      for (auto& r : results)
+        sum += r.Value();
+      printf("WhenAll: sum = %d, tid = %d\n", sum, CurrentThread::tid());
+      assert(sum == 1240);
+      done();
+    });
+
+  WhenAny(pool.Execute(fakeRpc, 3), pool.Execute(fakeRpc, 4))
+    .Then(&sched, [&](std::pair<size_t, Try<int>>&& first) {
+      assert(loop.isInLoopThread());
+      printf("WhenAny: index = %zu, value = %d\n", first.first, first.second.Value());
+      done();
+    });
+
+  WhenN(2, pool.Execute(fakeRpc, 1), pool.Execute(fakeRpc, 2), pool.Execute(fakeRpc, 3))
+    .Then(&sched, [&](std::vector<std::pair<size_t, Try<int>>>&& results) {
+      assert(loop.isInLoopThread());
+      assert(results.size() == 2);
+      printf("WhenN: got %zu results\n", results.size());
+      done();
+    });
+
+  // OnTimeout 通过ScheduleLater回到IO线程
+  Promise<int> never;
+  never.GetFuture()
+    .Then([](int) { assert(false); })
+    .OnTimeout(std::chrono::milliseconds(50), [&]() {
+      assert(loop.isInLoopThread());
+      printf("timeout in tid = %d\n", CurrentThread::tid());
+      done();
+    }, &sched);
+
+  loop.loop();
+  pool.JoinAll();
+  printf("done\n");
+}
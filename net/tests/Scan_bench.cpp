@@ -0,0 +1,156 @@
+// 查找分隔符的吞吐量：原来的std::search/逐字节strncmp和scan的各种实现比较
+// 用法: Scan_bench [每项处理的总字节数，默认256MB]
+
+#include "base/Clock.h"
+#include "net/Scan.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using Miren::base::Clock;
+namespace scan = Miren::net::scan;
+
+namespace
+{
+  volatile size_t g_sink;
+  size_t g_totalBytes = 256 * 1024 * 1024;
+
+  const char* levelName(scan::Level level)
+  {
+    switch(level) {
+      case scan::kScalar:
+        return "scan scalar";
+      case scan::kSse2:
+        return "scan sse2";
+      case scan::kAvx2:
+        return "scan avx2";
+    }
+    return "?";
+  }
+
+  // f在data中查找一次，返回找到的位置；打印GB/s
+  template<typename F>
+  void bench(const char* name, const std::string& data, F f)
+  {
+    size_t iterations = g_totalBytes / data.size() + 1;
+    size_t sum = 0;
+    int64_t start = Clock::monotonicNanos();
+    for(size_t i = 0; i < iterations; ++i) {
+      const char* found = f(data.data(), data.data() + data.size());
+      sum += found ? static_cast<size_t>(found - data.data()) : 0;
+    }
+    int64_t elapsed = Clock::monotonicNanos() - start;
+    g_sink = sum;
+    printf("  %-24s %8.2f GB/s\n", name,
+           static_cast<double>(data.size() * iterations) / static_cast<double>(elapsed));
+  }
+
+  template<typename F>
+  void benchLevels(const std::string& data, F f)
+  {
+    scan::Level saved = scan::level();
+    for(int level = scan::kScalar; level <= scan::supportedLevel(); ++level) {
+      scan::setLevel(static_cast<scan::Level>(level));
+      bench(levelName(static_cast<scan::Level>(level)), data, f);
+    }
+    scan::setLevel(saved);
+  }
+
+  // 原来Buffer::findCRLF的实现
+  const char* searchCRLF(const char* begin, const char* end)
+  {
+    static const char kCRLF[] = "\r\n";
+    const char* crlf = std::search(begin, end, kCRLF, kCRLF + 2);
+    return crlf == end ? nullptr : crlf;
+  }
+
+  // 原来multipart解析中查找数据结尾的方式
+  const char* strncmpBoundary(const char* begin, const char* end, const std::string& boundary)
+  {
+    size_t len = static_cast<size_t>(end - begin);
+    for(size_t i = 0; i < len; ++i) {
+      if(i + 4 < len && begin[i] == '\r' && begin[i + 1] == '\n' && begin[i + 2] == '-' && begin[i + 3] == '-' &&
+         ::strncmp(begin + i + 4, boundary.data(), boundary.size()) == 0) {
+        return begin + i;
+      }
+    }
+    return nullptr;
+  }
+
+  const char* scalarNonToken(const char* begin, const char* end)
+  {
+    static const char kSpecials[] = "!#$%&'*+-.^_`|~";
+    const char* p = begin;
+    while(p != end && (isalnum(static_cast<unsigned char>(*p)) || strchr(kSpecials, *p))) {
+      ++p;
+    }
+    return p;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  if(argc > 1) {
+    g_totalBytes = static_cast<size_t>(atoll(argv[1]));
+  }
+  std::mt19937 rng(1);
+
+  // 一行请求头，CRLF在最后
+  for(size_t lineLength : { 32, 128, 1024, 16 * 1024 }) {
+    std::string line(lineLength - 2, 'a');
+    for(auto& c : line) {
+      c = static_cast<char>('a' + rng() % 26);
+    }
+    line += "\r\n";
+    printf("findCRLF, line of %zu bytes\n", lineLength);
+    bench("std::search", line, searchCRLF);
+    benchLevels(line, [](const char* b, const char* e) { return scan::findCRLF(b, e); });
+  }
+
+  // 头部块：很多行，查找空行
+  {
+    std::string headers;
+    while(headers.size() < 2000) {
+      headers += "X-Header-" + std::to_string(headers.size()) + ": some value here\r\n";
+    }
+    headers += "\r\n";
+    printf("findCRLFCRLF, %zu bytes of headers\n", headers.size());
+    bench("std::search", headers, [](const char* b, const char* e) {
+      static const char kEnd[] = "\r\n\r\n";
+      const char* found = std::search(b, e, kEnd, kEnd + 4);
+      return found == e ? nullptr : found;
+    });
+    benchLevels(headers, [](const char* b, const char* e) { return scan::findCRLFCRLF(b, e); });
+  }
+
+  // multipart文件内容，随机二进制数据中查找\r\n--boundary
+  const std::string boundary = "---------------------------9051914041544843365972754266";
+  const std::string delimiter = "\r\n--" + boundary;
+  for(size_t fileSize : { 1024, 64 * 1024, 1024 * 1024 }) {
+    std::string data(fileSize, '\0');
+    for(auto& c : data) {
+      c = static_cast<char>(rng() & 0xFF);
+    }
+    data += delimiter + "--\r\n";
+    printf("multipart boundary, %zu bytes of file data\n", fileSize);
+    bench("strncmp per byte", data, [&](const char* b, const char* e) { return strncmpBoundary(b, e, boundary); });
+    bench("std::search", data, [&](const char* b, const char* e) {
+      const char* found = std::search(b, e, delimiter.data(), delimiter.data() + delimiter.size());
+      return found == e ? nullptr : found;
+    });
+    benchLevels(data, [&](const char* b, const char* e) { return scan::find(b, e, delimiter.data(), delimiter.size()); });
+  }
+
+  // 头部字段名
+  for(const char* name : { "Content-Type", "Sec-WebSocket-Extensions-And-Some-Longer-Custom-Name" }) {
+    std::string field(name);
+    printf("findNonToken, \"%s\"\n", name);
+    bench("isalnum+strchr", field, scalarNonToken);
+    benchLevels(field, [](const char* b, const char* e) { return scan::findNonToken(b, e); });
+  }
+}
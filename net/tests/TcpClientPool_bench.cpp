@@ -0,0 +1,297 @@
+// TcpClientPool对本机echo服务器的请求延迟
+// 每个endpoint是一个echo服务器，客户端的每个IO线程每毫秒按经过的时间补足应发的请求(开环，不等应答)，
+// 一个请求16字节：发送时间和序号，echo回来后算延迟并release()连接
+// single: 每个loop对每个endpoint一个连接(相当于每个loop一个TcpClient)
+// pool:   默认的Options，最少1个最多8个连接，保持1个空闲连接
+// 运行到一半时服务器关闭所有连接，统计丢失的请求、没有连接可用的请求以及重连次数
+// 用法: TcpClientPool_bench [每个endpoint每秒请求数，默认10000] [秒数，默认5] [endpoint数，默认2] [客户端线程数，默认2]
+
+#include "base/Clock.h"
+#include "base/log/Logging.h"
+#include "base/thread/CountDownLatch.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include "net/EventLoopThreadPool.h"
+#include "net/TcpClientPool.h"
+#include "net/TcpServer.h"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace Miren;
+using namespace Miren::net;
+using Miren::base::Clock;
+
+namespace
+{
+  const size_t kRequestSize = 16;
+
+  int64_t nowMicros()
+  {
+    return Clock::monotonicNanos() / 1000;
+  }
+
+  // 回显收到的数据，可以关闭所有连接
+  class EchoServer : base::NonCopyable
+  {
+  public:
+    EchoServer(EventLoop* loop, const InetAddress& listenAddr)
+        : server_(loop, listenAddr, "EchoServer")
+    {
+      server_.setConnectionCallback(std::bind(&EchoServer::onConnection, this, std::placeholders::_1));
+      server_.setMessageCallback(std::bind(&EchoServer::onMessage, this, std::placeholders::_1,
+                                           std::placeholders::_2, std::placeholders::_3));
+    }
+
+    void start() { server_.start(); }
+
+    void closeAll()
+    {
+      std::set<TcpConnectionPtr> conns;
+      conns.swap(conns_);
+      for(const TcpConnectionPtr& conn : conns) {
+        conn->forceClose();
+      }
+    }
+
+  private:
+    void onConnection(const TcpConnectionPtr& conn)
+    {
+      if(conn->connected()) {
+        conn->setTcpNoDelay(true);
+        conns_.insert(conn);
+      }
+      else {
+        conns_.erase(conn);
+      }
+    }
+
+    void onMessage(const TcpConnectionPtr& conn, Buffer* buf, base::Timestamp)
+    {
+      conn->send(buf);
+    }
+
+    TcpServer server_;
+    std::set<TcpConnectionPtr> conns_;
+  };
+
+  // 一个客户端IO线程的统计，只在这个线程中修改
+  struct LoopStats
+  {
+    LoopStats() : sent(0), rejected(0), completed(0) {}
+
+    int64_t sent;
+    int64_t rejected;       // acquire()没有可用的连接
+    int64_t completed;
+    std::vector<int32_t> latencies;
+    std::vector<int> connections;   // 结束时每个endpoint的连接数
+  };
+
+  thread_local LoopStats* t_stats = nullptr;
+
+  class Generator : base::NonCopyable
+  {
+  public:
+    Generator(TcpClientPool* pool, const std::vector<InetAddress>& endpoints, double rate)
+        : pool_(pool), endpoints_(endpoints), rate_(rate), startMicros_(0), issued_(0), seq_(0)
+    {
+    }
+
+    void start(EventLoop* loop)
+    {
+      t_stats = &stats_;
+      startMicros_ = nowMicros();
+      timerId_ = loop->runEvery(0.001, std::bind(&Generator::tick, this));
+    }
+
+    void stop(EventLoop* loop)
+    {
+      loop->cancel(timerId_);
+      for(const InetAddress& endpoint : endpoints_) {
+        stats_.connections.push_back(pool_->connections(endpoint));
+      }
+    }
+
+    const LoopStats& stats() const { return stats_; }
+
+  private:
+    // 定时器会晚到，按开始以来应发的请求数补足，而不是每次固定数量
+    void tick()
+    {
+      int64_t due = static_cast<int64_t>(static_cast<double>(nowMicros() - startMicros_) * rate_ / 1e6);
+      int64_t count = due - issued_;
+      issued_ = due;
+      for(const InetAddress& endpoint : endpoints_) {
+        for(int64_t i = 0; i < count; ++i) {
+          TcpConnectionPtr conn = pool_->acquire(endpoint);
+          if(!conn) {
+            ++stats_.rejected;
+            continue;
+          }
+          int64_t request[2] = { nowMicros(), ++seq_ };
+          conn->send(request, static_cast<int>(sizeof request));
+          ++stats_.sent;
+        }
+      }
+    }
+
+    TcpClientPool* pool_;
+    const std::vector<InetAddress> endpoints_;
+    const double rate_;           // 本线程对每个endpoint每秒的请求数
+    int64_t startMicros_;
+    int64_t issued_;
+    int64_t seq_;
+    TimerId timerId_;
+    LoopStats stats_;
+  };
+
+  void onResponse(TcpClientPool* pool, const TcpConnectionPtr& conn, Buffer* buf)
+  {
+    int64_t now = nowMicros();
+    while(buf->readableBytes() >= kRequestSize) {
+      int64_t sentAt;
+      memcpy(&sentAt, buf->peek(), sizeof sentAt);
+      buf->retrieve(kRequestSize);
+      t_stats->latencies.push_back(static_cast<int32_t>(now - sentAt));
+      ++t_stats->completed;
+      pool->release(conn);
+    }
+  }
+
+  void run(const char* mode, const TcpClientPool::Options& options, std::vector<EchoServer*>& servers,
+           EventLoop* serverLoop, const std::vector<InetAddress>& endpoints,
+           int rate, double seconds, int threads)
+  {
+    EventLoop* mainLoop = EventLoop::getEventLoopOfCurrentThread();
+    EventLoopThreadPool threadPool(mainLoop, "client");
+    threadPool.setThreadNum(threads);
+    threadPool.start();
+    std::vector<EventLoop*> loops = threadPool.getAllLoops();
+
+    TcpClientPool pool(loops, mode, options);
+    pool.setConnectionCallback([](const TcpConnectionPtr& conn) {
+      if(conn->connected()) {
+        conn->setTcpNoDelay(true);
+      }
+    });
+    pool.setMessageCallback(std::bind(&onResponse, &pool, std::placeholders::_1, std::placeholders::_2));
+    pool.start();
+    for(const InetAddress& endpoint : endpoints) {
+      pool.addEndpoint(endpoint);
+    }
+
+    std::vector<std::unique_ptr<Generator>> generators;
+    for(size_t i = 0; i < loops.size(); ++i) {
+      generators.emplace_back(new Generator(&pool, endpoints, static_cast<double>(rate) / threads));
+    }
+    // 先让连接建立
+    mainLoop->runAfter(0.2, [&]() {
+      for(size_t i = 0; i < loops.size(); ++i) {
+        loops[i]->runInLoop(std::bind(&Generator::start, generators[i].get(), loops[i]));
+      }
+    });
+    mainLoop->runAfter(0.2 + seconds / 2, [&]() {
+      serverLoop->runInLoop([&]() {
+        for(EchoServer* server : servers) {
+          server->closeAll();
+        }
+      });
+    });
+    mainLoop->runAfter(0.2 + seconds, [&]() { mainLoop->quit(); });
+    mainLoop->loop();
+
+    base::CountDownLatch stopped(static_cast<int>(loops.size()));
+    for(size_t i = 0; i < loops.size(); ++i) {
+      loops[i]->runInLoop([&, i]() {
+        generators[i]->stop(loops[i]);
+        stopped.countDown();
+      });
+    }
+    stopped.wait();
+
+    base::CountDownLatch drained(1);
+    int64_t drainStart = nowMicros();
+    pool.drain([&]() { drained.countDown(); });
+    drained.wait();
+    double drainMs = static_cast<double>(nowMicros() - drainStart) / 1000.0;
+
+    LoopStats total;
+    int connections = 0;
+    for(const auto& generator : generators) {
+      const LoopStats& stats = generator->stats();
+      total.sent += stats.sent;
+      total.rejected += stats.rejected;
+      total.completed += stats.completed;
+      total.latencies.insert(total.latencies.end(), stats.latencies.begin(), stats.latencies.end());
+      for(int n : stats.connections) {
+        connections = std::max(connections, n);
+      }
+    }
+    std::sort(total.latencies.begin(), total.latencies.end());
+    auto percentile = [&](double p) {
+      if(total.latencies.empty()) {
+        return 0;
+      }
+      return static_cast<int>(total.latencies[static_cast<size_t>(p * static_cast<double>(total.latencies.size() - 1))]);
+    };
+    double perEndpoint = static_cast<double>(total.sent) / seconds / static_cast<double>(endpoints.size());
+    printf("%-7s %12.0f %10lld %8lld %8lld %8d %8d %8d %6d %10lld %9.1f\n", mode, perEndpoint,
+           static_cast<long long>(total.completed), static_cast<long long>(total.sent - total.completed),
+           static_cast<long long>(total.rejected), percentile(0.5), percentile(0.99), percentile(1.0),
+           connections, static_cast<long long>(pool.reconnects()), drainMs);
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  // 服务器关闭连接时客户端的RST/EPIPE错误会打到stderr，结果在stdout
+  log::Logger::setLogLevel(log::Logger::ERROR);
+  int rate = argc > 1 ? atoi(argv[1]) : 10000;
+  double seconds = argc > 2 ? atof(argv[2]) : 5.0;
+  int numEndpoints = argc > 3 ? atoi(argv[3]) : 2;
+  int threads = argc > 4 ? atoi(argv[4]) : 2;
+
+  EventLoopThread serverThread;
+  EventLoop* serverLoop = serverThread.startLoop();
+  std::vector<InetAddress> endpoints;
+  std::vector<std::unique_ptr<EchoServer>> servers;
+  std::vector<EchoServer*> serverPtrs;
+  base::CountDownLatch started(1);
+  serverLoop->runInLoop([&]() {
+    for(int i = 0; i < numEndpoints; ++i) {
+      endpoints.push_back(InetAddress("127.0.0.1", static_cast<uint16_t>(24000 + i)));
+      servers.emplace_back(new EchoServer(serverLoop, endpoints.back()));
+      servers.back()->start();
+      serverPtrs.push_back(servers.back().get());
+    }
+    started.countDown();
+  });
+  started.wait();
+
+  printf("%d endpoints, %d requests/s each from %d client loops, %.0f s, "
+         "all server connections closed at %.1f s\n", numEndpoints, rate, threads, seconds, seconds / 2);
+  printf("%-7s %12s %10s %8s %8s %8s %8s %8s %6s %10s %9s\n", "mode", "req/s/ep", "completed", "lost",
+         "no-conn", "p50 us", "p99 us", "max us", "conns", "reconnect", "drain ms");
+
+  EventLoop mainLoop;
+  TcpClientPool::Options single;
+  single.minConnections = 1;
+  single.maxConnections = 1;
+  single.spareConnections = 0;
+  run("single", single, serverPtrs, serverLoop, endpoints, rate, seconds, threads);
+  run("pool", TcpClientPool::Options(), serverPtrs, serverLoop, endpoints, rate, seconds, threads);
+
+  base::CountDownLatch stopped(1);
+  serverLoop->runInLoop([&]() {
+    servers.clear();
+    stopped.countDown();
+  });
+  stopped.wait();
+  return 0;
+}
@@ -29,7 +29,7 @@ namespace Miren::net
             }
             struct timespec ts;
             ts.tv_sec = static_cast<time_t>(microseconds / base::Timestamp::kMicroSecondsPerSecond);
-            ts.tv_nsec = static_cast<long>(microseconds % base::Timestamp::kMicroSecondsPerSecond);
+            ts.tv_nsec = static_cast<long>((microseconds % base::Timestamp::kMicroSecondsPerSecond) * 1000);
             return ts;
         }
 
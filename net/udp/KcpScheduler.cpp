@@ -0,0 +1,258 @@
+#include "net/udp/KcpScheduler.h"
+
+#include "base/log/Logging.h"
+#include "net/EventLoop.h"
+
+#include <algorithm>
+#include <any>
+#include <functional>
+#include <memory>
+#include <time.h>
+
+namespace Miren
+{
+namespace net
+{
+
+namespace
+{
+	const char kContextName[] = "KcpScheduler";
+	const int64_t kWheelMask = KcpScheduler::kWheelSize - 1;
+}
+
+const int KcpScheduler::kTickMs;
+const int KcpScheduler::kWheelSize;
+const int KcpScheduler::kMaxIdleShift;
+const int KcpScheduler::kMaxIdleDelayMs;
+const int64_t KcpScheduler::kUnlinked;
+
+KcpScheduler::Session::Session()
+	: scheduler_(NULL),
+	dueTick_(KcpScheduler::kUnlinked),
+	index_(0),
+	flushIndex_(-1),
+	idleShift_(0),
+	active_(false)
+{
+}
+
+KcpScheduler::Session::~Session()
+{
+	if (scheduler_)
+		scheduler_->remove(this);
+}
+
+void KcpScheduler::Session::markKcpActive()
+{
+	active_ = true;
+	// a session in the middle of its update is rescheduled by the pass
+	if (idleShift_ > 0 && scheduler_ && dueTick_ != KcpScheduler::kUnlinked)
+	{
+		idleShift_ = 0;
+		scheduler_->wake(this);
+	}
+}
+
+bool KcpScheduler::Session::deferKcpFlush()
+{
+	if (!scheduler_ || !scheduler_->updating_)
+		return false;
+	if (flushIndex_ < 0)
+	{
+		flushIndex_ = static_cast<int>(scheduler_->flushing_.size());
+		scheduler_->flushing_.push_back(this);
+	}
+	return true;
+}
+
+KcpScheduler* KcpScheduler::forLoop(EventLoop* loop)
+{
+	loop->assertInLoopThread();
+	if (!loop->hasContext(kContextName))
+		loop->setContext(kContextName, std::make_shared<KcpScheduler>(loop));
+	return std::any_cast<std::shared_ptr<KcpScheduler>&>(*loop->getMutableContext(kContextName)).get();
+}
+
+KcpScheduler::KcpScheduler(EventLoop* loop)
+	: loop_(CHECK_NOTNULL(loop)),
+	wheel_(kWheelSize),
+	currentTick_(0),
+	sessions_(0),
+	ticking_(false),
+	updating_(false),
+	updates_(0),
+	passes_(0)
+{
+}
+
+KcpScheduler::~KcpScheduler()
+{
+	// destroyed with the loop, the timer goes with its TimerQueue
+	for (auto& bucket : wheel_)
+	{
+		for (Session* session : bucket)
+			session->scheduler_ = NULL;
+	}
+}
+
+int64_t KcpScheduler::nowMs()
+{
+	// monotonic, a wall clock step must not stall or flood the wheel
+	struct timespec ts;
+	::clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+int64_t KcpScheduler::dueTick(int delayMs) const
+{
+	// rounded up, kcp does nothing if updated before its time
+	int64_t tick = (nowMs() + std::max(delayMs, 0) + kTickMs - 1) / kTickMs;
+	return std::min(std::max(tick, currentTick_), currentTick_ + kWheelSize - 1);
+}
+
+void KcpScheduler::schedule(Session* session, int delayMs)
+{
+	loop_->assertInLoopThread();
+	if (!ticking_)
+	{
+		currentTick_ = nowMs() / kTickMs;
+		timerId_ = loop_->runEvery(kTickMs / 1000.0, std::bind(&KcpScheduler::onTick, this));
+		ticking_ = true;
+	}
+	if (session->scheduler_ == this)
+	{
+		unlink(session);
+	}
+	else
+	{
+		assert(session->scheduler_ == NULL);
+		session->scheduler_ = this;
+		++sessions_;
+	}
+	link(session, dueTick(delayMs));
+}
+
+void KcpScheduler::wake(Session* session)
+{
+	loop_->assertInLoopThread();
+	if (session->scheduler_ == this && session->dueTick_ != kUnlinked
+		&& session->dueTick_ <= currentTick_)
+		return;
+	schedule(session, 0);
+}
+
+void KcpScheduler::remove(Session* session)
+{
+	loop_->assertInLoopThread();
+	if (session->scheduler_ != this)
+		return;
+	unlink(session);
+	if (session->flushIndex_ >= 0)
+	{
+		flushing_[static_cast<size_t>(session->flushIndex_)] = NULL;
+		session->flushIndex_ = -1;
+	}
+	session->scheduler_ = NULL;
+	session->idleShift_ = 0;
+	session->active_ = false;
+	--sessions_;
+}
+
+void KcpScheduler::link(Session* session, int64_t tick)
+{
+	std::vector<Session*>& bucket = wheel_[static_cast<size_t>(tick & kWheelMask)];
+	session->dueTick_ = tick;
+	session->index_ = bucket.size();
+	bucket.push_back(session);
+}
+
+void KcpScheduler::unlink(Session* session)
+{
+	if (session->dueTick_ == kUnlinked)
+	{
+		// waiting for its turn in the current pass
+		if (session->index_ < running_.size() && running_[session->index_] == session)
+			running_[session->index_] = NULL;
+		return;
+	}
+	std::vector<Session*>& bucket = wheel_[static_cast<size_t>(session->dueTick_ & kWheelMask)];
+	Session* last = bucket.back();
+	bucket[session->index_] = last;
+	last->index_ = session->index_;
+	bucket.pop_back();
+	session->dueTick_ = kUnlinked;
+}
+
+void KcpScheduler::onTick()
+{
+	int64_t nowTick = nowMs() / kTickMs;
+	if (nowTick >= currentTick_)
+	{
+		// every bucket that came due, a late timer catches up in one pass
+		int64_t last = std::min(nowTick, currentTick_ + kWheelSize - 1);
+		for (int64_t tick = currentTick_; tick <= last; ++tick)
+		{
+			std::vector<Session*>& bucket = wheel_[static_cast<size_t>(tick & kWheelMask)];
+			for (Session* session : bucket)
+			{
+				session->dueTick_ = kUnlinked;
+				session->index_ = running_.size();
+				running_.push_back(session);
+			}
+			bucket.clear();
+		}
+		currentTick_ = nowTick + 1;
+		++passes_;
+
+		updating_ = true;
+		for (size_t i = 0; i < running_.size(); ++i)
+		{
+			Session* session = running_[i];
+			if (!session)
+				continue;
+			running_[i] = NULL;
+			++updates_;
+			int delayMs = session->onKcpUpdate();
+			// removed or woken during its own update
+			if (session->scheduler_ != this || session->dueTick_ != kUnlinked)
+				continue;
+			if (delayMs < 0)
+			{
+				remove(session);
+				continue;
+			}
+
+			// a session waiting for an ack is quiet until its RTO, that is not idle
+			if (session->active_ || session->kcpInFlight())
+				session->idleShift_ = 0;
+			else if (session->idleShift_ < kMaxIdleShift)
+				++session->idleShift_;
+			session->active_ = false;
+			if (session->idleShift_ > 0 && delayMs < kMaxIdleDelayMs)
+				delayMs = std::min(std::max(delayMs, kTickMs) << session->idleShift_, kMaxIdleDelayMs);
+			link(session, dueTick(delayMs));
+		}
+		running_.clear();
+		updating_ = false;
+
+		// one flush per session for everything its update wrote
+		for (size_t i = 0; i < flushing_.size(); ++i)
+		{
+			Session* session = flushing_[i];
+			if (!session)
+				continue;
+			session->flushIndex_ = -1;
+			session->onKcpFlush();
+		}
+		flushing_.clear();
+	}
+
+	if (sessions_ == 0)
+	{
+		loop_->cancel(timerId_);
+		ticking_ = false;
+	}
+}
+
+} // namespace net
+} // namespace Miren
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "net/timer/TimerId.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace Miren
+{
+	namespace net
+	{
+
+		class EventLoop;
+
+		// Drives the kcp Update() of every session of one IO loop.
+		// Sessions sit in a wheel of kTickMs buckets; one repeating timer runs all
+		// the sessions due in a tick in one pass, and what they wrote during the
+		// pass is flushed after it. A session whose update had nothing to do and
+		// that has nothing in flight is checked less often, up to kMaxIdleDelayMs,
+		// until it sees traffic again.
+		// Not thread safe, all member functions must be called in the loop thread.
+		class KcpScheduler : base::NonCopyable
+		{
+		public:
+			static const int kTickMs = 5;
+			static const int kWheelSize = 1024;			// power of two, about 5 s ahead
+			static const int kMaxIdleShift = 4;			// an idle delay doubles up to 16 times
+			static const int kMaxIdleDelayMs = 200;
+
+			class Session
+			{
+			public:
+				Session();
+				virtual ~Session();
+
+				Session(const Session&) = delete;
+				Session& operator=(const Session&) = delete;
+
+			protected:
+				// runs the kcp update, returns the milliseconds until the next one,
+				// < 0 takes the session off the scheduler
+				virtual int onKcpUpdate() = 0;
+				// sends what was written during the update pass
+				virtual void onKcpFlush() = 0;
+				// true while kcp may still send or resend data, such a session is never
+				// backed off and is updated exactly when onKcpUpdate() asked
+				virtual bool kcpInFlight() const = 0;
+
+				// called on input and output, an idle session is updated on the next tick
+				void markKcpActive();
+				// true inside an update pass, onKcpFlush() is then called once after the pass
+				bool deferKcpFlush();
+
+			private:
+				friend class KcpScheduler;
+
+				KcpScheduler* scheduler_;
+				int64_t dueTick_;		// kUnlinked while updated
+				size_t index_;			// in the bucket of dueTick_
+				int flushIndex_;		// in KcpScheduler::flushing_, -1 if none
+				int idleShift_;
+				bool active_;
+			};
+
+			// the scheduler of the loop, created on first use and owned by the loop
+			static KcpScheduler* forLoop(EventLoop* loop);
+
+			explicit KcpScheduler(EventLoop* loop);
+			~KcpScheduler();
+
+			// (re)schedules the session delayMs from now
+			void schedule(Session* session, int delayMs);
+			// schedules the session for the next tick unless it is due earlier
+			void wake(Session* session);
+			void remove(Session* session);
+
+			size_t sessions() const { return sessions_; }
+			int64_t updates() const { return updates_; }
+			int64_t passes() const { return passes_; }
+
+		private:
+			static const int64_t kUnlinked = -1;
+
+			static int64_t nowMs();
+
+			int64_t dueTick(int delayMs) const;
+			void link(Session* session, int64_t tick);
+			void unlink(Session* session);
+			void onTick();
+
+			EventLoop* loop_;
+			std::vector<std::vector<Session*>> wheel_;
+			std::vector<Session*> running_;
+			std::vector<Session*> flushing_;
+			int64_t currentTick_;		// the first tick not run yet
+			size_t sessions_;
+			TimerId timerId_;
+			bool ticking_;
+			bool updating_;
+			int64_t updates_;
+			int64_t passes_;
+		};
+
+	}
+}
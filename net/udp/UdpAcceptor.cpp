@@ -6,6 +6,8 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
 //#include <sys/types.h>
 //#include <sys/stat.h>
 #include <unistd.h>
@@ -50,21 +52,36 @@ void UdpAcceptor::listen()
 void UdpAcceptor::handleRead()
 {
 	loop_->assertInLoopThread();
-	InetAddress peerAddr;
 
-	struct sockaddr_in6 addr;
-	memset(&addr, 0, sizeof(addr));
-	ssize_t readByteCount = sockets::recvfrom(acceptSocket_.fd(), &addr, recvfromBuf_, krecvfromBufSize);
+	struct sockaddr_in6 addrs[kMaxBatch];
+	struct iovec iov;
+	struct mmsghdr msgs[kMaxBatch];
+	memset(addrs, 0, sizeof(addrs));
+	memset(msgs, 0, sizeof(msgs));
+	iov.iov_base = recvfromBuf_;
+	iov.iov_len = krecvfromBufSize;
+	for (int i = 0; i < kMaxBatch; ++i)
+	{
+		msgs[i].msg_hdr.msg_name = &addrs[i];
+		msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+		msgs[i].msg_hdr.msg_iov = &iov;
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+	int readCount = ::recvmmsg(acceptSocket_.fd(), msgs, kMaxBatch, 0, NULL);
 
-	if (readByteCount >= 0)
+	if (readCount >= 0)
 	{
-		peerAddr.setSockAddrInet6(addr);
-		//peerAddr.setSockAddrIn(addr);
-		if(newConnectorCallback_) {
-			newConnectorCallback_(peerAddr);
-		}
-		else {
-			LOG_SYSERR << "in UdpAcceptor::handleRead newConnectorCallback_";
+		for (int i = 0; i < readCount; ++i)
+		{
+			InetAddress peerAddr;
+			peerAddr.setSockAddrInet6(addrs[i]);
+			//peerAddr.setSockAddrIn(addr);
+			if(newConnectorCallback_) {
+				newConnectorCallback_(peerAddr);
+			}
+			else {
+				LOG_SYSERR << "in UdpAcceptor::handleRead newConnectorCallback_";
+			}
 		}
 	}
 	else
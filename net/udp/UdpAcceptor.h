@@ -46,6 +46,8 @@ namespace Miren
 			uint16_t listenPort_;
 			InetAddress listenAddr_;
 
+			// payloads are dropped, every datagram of a batch lands in recvfromBuf_
+			static const int kMaxBatch = 16;
 			static const size_t krecvfromBufSize = 1500;
 			char recvfromBuf_[krecvfromBufSize];
 		};
@@ -0,0 +1,347 @@
+#include "net/udp/UdpBatch.h"
+
+#include "base/log/Logging.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+namespace Miren
+{
+namespace net
+{
+
+namespace
+{
+	// a few batches may be in flight at once, anything beyond is freed
+	const size_t kMaxIdlePackets = 4 * UdpRecvBatch::kMaxBatch;
+
+	bool samePeer(const struct sockaddr_in6& a, const struct sockaddr_in6& b)
+	{
+		if (a.sin6_family != b.sin6_family || a.sin6_port != b.sin6_port)
+			return false;
+		if (a.sin6_family == AF_INET)
+		{
+			return reinterpret_cast<const struct sockaddr_in&>(a).sin_addr.s_addr
+				== reinterpret_cast<const struct sockaddr_in&>(b).sin_addr.s_addr;
+		}
+		return memcmp(&a.sin6_addr, &b.sin6_addr, sizeof a.sin6_addr) == 0;
+	}
+}
+
+UdpPacketPool& UdpPacketPool::threadLocal(size_t packetSize)
+{
+	static thread_local UdpPacketPool small(kPacketSize);
+	static thread_local UdpPacketPool gro(kGroPacketSize);
+	return packetSize > kPacketSize ? gro : small;
+}
+
+UdpPacketPool::~UdpPacketPool()
+{
+	for (char* packet : free_)
+		delete[] packet;
+}
+
+char* UdpPacketPool::get()
+{
+	if (free_.empty())
+		return new char[packetSize_];
+	char* packet = free_.back();
+	free_.pop_back();
+	return packet;
+}
+
+void UdpPacketPool::put(char* packet)
+{
+	if (free_.size() < kMaxIdlePackets)
+		free_.push_back(packet);
+	else
+		delete[] packet;
+}
+
+UdpRecvBatch::UdpRecvBatch(int batch)
+	: batch_(batch > 0 && batch < kMaxBatch ? batch : kMaxBatch),
+	gro_(false),
+	pool_(NULL),
+	index_(0),
+	count_(0),
+	syscalls_(0)
+{
+}
+
+UdpRecvBatch::~UdpRecvBatch()
+{
+	// may run on any thread, the thread local pool is not ours to touch
+	for (int i = index_; i < count_; ++i)
+		delete[] slots_[i].packet;
+}
+
+bool UdpRecvBatch::setGro(int fd, bool on)
+{
+	assert(count_ == 0);
+	int optval = on ? 1 : 0;
+	if (::setsockopt(fd, SOL_UDP, UDP_GRO, &optval, sizeof optval) < 0)
+	{
+		gro_ = false;
+		return !on;
+	}
+	gro_ = on;
+	return true;
+}
+
+ssize_t UdpRecvBatch::next(int fd, char** data)
+{
+	return next(fd, data, NULL);
+}
+
+ssize_t UdpRecvBatch::next(int fd, char** data, struct sockaddr_in6* peer)
+{
+	for (;;)
+	{
+		if (index_ < count_)
+		{
+			Slot& slot = slots_[index_];
+			if (slot.length == 0 && slot.offset == 0)
+			{
+				// an empty datagram is handed out once, like read() returning 0
+				slot.offset = 1;
+				*data = slot.packet;
+				if (peer)
+					*peer = slot.peer;
+				return 0;
+			}
+			if (slot.offset < slot.length)
+			{
+				size_t len = slot.length - slot.offset;
+				if (slot.segment > 0 && slot.segment < len)
+					len = slot.segment;
+				*data = slot.packet + slot.offset;
+				slot.offset += len;
+				if (peer)
+					*peer = slot.peer;
+				return static_cast<ssize_t>(len);
+			}
+			pool_->put(slot.packet);
+			++index_;
+			continue;
+		}
+		if (!refill(fd))
+		{
+			*data = NULL;
+			return -1;
+		}
+	}
+}
+
+bool UdpRecvBatch::refill(int fd)
+{
+	assert(index_ == count_);
+	index_ = count_ = 0;
+	if (slots_.empty())
+		slots_.resize(static_cast<size_t>(batch_));
+	pool_ = &UdpPacketPool::threadLocal(gro_ ? UdpPacketPool::kGroPacketSize : UdpPacketPool::kPacketSize);
+
+	struct mmsghdr msgs[kMaxBatch];
+	struct iovec iov[kMaxBatch];
+	char control[kMaxBatch][CMSG_SPACE(sizeof(int))];
+	memset(msgs, 0, sizeof msgs);
+	for (int i = 0; i < batch_; ++i)
+	{
+		slots_[i].packet = pool_->get();
+		iov[i].iov_base = slots_[i].packet;
+		iov[i].iov_len = pool_->packetSize();
+		msgs[i].msg_hdr.msg_name = &slots_[i].peer;
+		msgs[i].msg_hdr.msg_namelen = sizeof slots_[i].peer;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		if (gro_)
+		{
+			msgs[i].msg_hdr.msg_control = control[i];
+			msgs[i].msg_hdr.msg_controllen = sizeof control[i];
+		}
+	}
+
+	int n = ::recvmmsg(fd, msgs, static_cast<unsigned int>(batch_), 0, NULL);
+	++syscalls_;
+	int savedErrno = errno;
+	for (int i = n > 0 ? n : 0; i < batch_; ++i)
+		pool_->put(slots_[i].packet);
+	if (n <= 0)
+	{
+		errno = savedErrno;
+		return false;
+	}
+
+	for (int i = 0; i < n; ++i)
+	{
+		Slot& slot = slots_[i];
+		slot.length = msgs[i].msg_len;
+		slot.offset = 0;
+		slot.segment = 0;
+		if (!gro_)
+			continue;
+		for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != NULL;
+			cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+			{
+				int segment = 0;
+				memcpy(&segment, CMSG_DATA(cmsg), sizeof segment);
+				slot.segment = segment > 0 ? static_cast<size_t>(segment) : 0;
+			}
+		}
+	}
+	count_ = n;
+	return true;
+}
+
+UdpSendBatch::UdpSendBatch()
+	: gso_(false),
+	syscalls_(0)
+{
+}
+
+bool UdpSendBatch::setGso(int fd, bool on)
+{
+	// a zero segment size leaves plain sends untouched, it only probes for support
+	int optval = 0;
+	if (on && ::setsockopt(fd, SOL_UDP, UDP_SEGMENT, &optval, sizeof optval) < 0)
+	{
+		gso_ = false;
+		return false;
+	}
+	gso_ = on;
+	return true;
+}
+
+void UdpSendBatch::append(const void* data, size_t len)
+{
+	const char* p = static_cast<const char*>(data);
+	data_.insert(data_.end(), p, p + len);
+	sizes_.push_back(static_cast<uint32_t>(len));
+}
+
+void UdpSendBatch::append(const void* data, size_t len, const struct sockaddr* peer)
+{
+	assert(peers_.size() == sizes_.size());
+	struct sockaddr_in6 addr;
+	memset(&addr, 0, sizeof addr);
+	memcpy(&addr, peer, peer->sa_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in));
+	peers_.push_back(addr);
+	append(data, len);
+}
+
+int UdpSendBatch::flush(int fd)
+{
+	const size_t total = sizes_.size();
+	size_t index = 0;
+	size_t offset = 0;
+	int sent = 0;
+	int savedErrno = 0;
+
+	while (index < total)
+	{
+		struct mmsghdr msgs[kMaxBatch];
+		struct iovec iov[kMaxBatch];
+		char control[kMaxBatch][CMSG_SPACE(sizeof(uint16_t))];
+		size_t datagrams[kMaxBatch];
+		bool segmented = false;
+		memset(msgs, 0, sizeof msgs);
+
+		int m = 0;
+		size_t i = index;
+		size_t off = offset;
+		while (i < total && m < kMaxBatch)
+		{
+			const size_t begin = i;
+			const size_t segment = sizes_[i];
+			size_t bytes = sizes_[i++];
+			// equal sized segments to the same peer, only the last one may be shorter;
+			// an empty datagram is never a segment
+			while (gso_ && segment > 0 && i < total && i - begin < kMaxSegments
+				&& sizes_[i] > 0 && sizes_[i] <= segment && bytes + sizes_[i] <= kMaxGsoBytes
+				&& (peers_.empty() || samePeer(peers_[begin], peers_[i])))
+			{
+				bytes += sizes_[i];
+				if (sizes_[i++] < segment)
+					break;
+			}
+
+			iov[m].iov_base = &data_[off];
+			iov[m].iov_len = bytes;
+			msgs[m].msg_hdr.msg_iov = &iov[m];
+			msgs[m].msg_hdr.msg_iovlen = 1;
+			if (!peers_.empty())
+			{
+				msgs[m].msg_hdr.msg_name = &peers_[begin];
+				msgs[m].msg_hdr.msg_namelen = peers_[begin].sin6_family == AF_INET6 ?
+					sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+			}
+			if (i - begin > 1)
+			{
+				msgs[m].msg_hdr.msg_control = control[m];
+				msgs[m].msg_hdr.msg_controllen = sizeof control[m];
+				struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[m].msg_hdr);
+				cmsg->cmsg_level = SOL_UDP;
+				cmsg->cmsg_type = UDP_SEGMENT;
+				cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+				uint16_t gsoSize = static_cast<uint16_t>(segment);
+				memcpy(CMSG_DATA(cmsg), &gsoSize, sizeof gsoSize);
+				segmented = true;
+			}
+			datagrams[m] = i - begin;
+			off += bytes;
+			++m;
+		}
+
+		int n = ::sendmmsg(fd, msgs, static_cast<unsigned int>(m), 0);
+		++syscalls_;
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (segmented && (errno == EIO || errno == EINVAL))
+			{
+				// the device can not segment (e.g. no tx checksum offload), fall back for good
+				LOG_WARN << "UdpSendBatch::flush UDP_SEGMENT failed, errno = " << errno << ", disable gso";
+				gso_ = false;
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				savedErrno = errno;
+			break;
+		}
+		for (int k = 0; k < n; ++k)
+		{
+			index += datagrams[k];
+			offset += iov[k].iov_len;
+			sent += static_cast<int>(datagrams[k]);
+		}
+	}
+
+	data_.clear();
+	sizes_.clear();
+	peers_.clear();
+	if (savedErrno != 0)
+	{
+		errno = savedErrno;
+		return -1;
+	}
+	return sent;
+}
+
+} // namespace net
+} // namespace Miren
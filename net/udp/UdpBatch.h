@@ -0,0 +1,127 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+
+#include <netinet/in.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <vector>
+
+namespace Miren
+{
+	namespace net
+	{
+
+		// Datagram buffers shared by all connections of one IO thread.
+		// A connection borrows a batch only around recvmmsg and hands each
+		// buffer back once the datagram is consumed, so idle connections
+		// hold no receive memory.
+		class UdpPacketPool : base::NonCopyable
+		{
+		public:
+			static const size_t kPacketSize = 2048;			// above Ethernet MTU
+			static const size_t kGroPacketSize = 65536;		// largest UDP_GRO coalesced datagram
+
+			// pool of the calling thread, packetSize is kPacketSize or kGroPacketSize
+			static UdpPacketPool& threadLocal(size_t packetSize);
+
+			explicit UdpPacketPool(size_t packetSize) : packetSize_(packetSize) {}
+			~UdpPacketPool();
+
+			char* get();
+			void put(char* packet);
+
+			size_t packetSize() const { return packetSize_; }
+			size_t idle() const { return free_.size(); }
+
+		private:
+			const size_t packetSize_;
+			std::vector<char*> free_;
+		};
+
+		// Receives up to kMaxBatch datagrams per recvmmsg and hands them out
+		// one by one. With UDP_GRO the coalesced datagrams are split here by
+		// the segment size the kernel reports.
+		class UdpRecvBatch : base::NonCopyable
+		{
+		public:
+			static const int kMaxBatch = 16;
+
+			explicit UdpRecvBatch(int batch = kMaxBatch);
+			~UdpRecvBatch();
+
+			// Must be called before the first next(). Returns false if the kernel
+			// does not support UDP_GRO, the batch then keeps receiving plain datagrams.
+			bool setGro(int fd, bool on);
+			bool groEnabled() const { return gro_; }
+
+			// Returns the length of the next datagram, *data stays valid until
+			// the next call. Returns -1 with errno from recvmmsg if none is left.
+			ssize_t next(int fd, char** data);
+			// for unconnected sockets, *peer is the source of the datagram
+			ssize_t next(int fd, char** data, struct sockaddr_in6* peer);
+
+			size_t buffered() const { return static_cast<size_t>(count_ - index_); }
+			uint64_t syscalls() const { return syscalls_; }
+
+		private:
+			struct Slot
+			{
+				char* packet;
+				size_t length;
+				size_t offset;
+				size_t segment;		// GRO segment size, 0 if not coalesced
+				struct sockaddr_in6 peer;
+			};
+
+			bool refill(int fd);
+
+			const int batch_;
+			bool gro_;
+			UdpPacketPool* pool_;
+			std::vector<Slot> slots_;		// allocated by the first refill
+			int index_;
+			int count_;
+			uint64_t syscalls_;
+		};
+
+		// Datagrams are appended to one contiguous buffer and sent by a single
+		// sendmmsg on flush. With UDP_SEGMENT, a run of equal sized datagrams
+		// (the last may be shorter) goes out as one GSO message.
+		class UdpSendBatch : base::NonCopyable
+		{
+		public:
+			static const int kMaxBatch = 64;				// flush when reached
+			static const int kMaxSegments = 64;				// kernel UDP_MAX_SEGMENTS
+			static const size_t kMaxGsoBytes = 65000;
+
+			UdpSendBatch();
+
+			// returns false if the kernel does not support UDP_SEGMENT
+			bool setGso(int fd, bool on);
+			bool gsoEnabled() const { return gso_; }
+
+			void append(const void* data, size_t len);
+			// for unconnected sockets, either every datagram of a batch has a peer or none has
+			void append(const void* data, size_t len, const struct sockaddr* peer);
+			int pending() const { return static_cast<int>(sizes_.size()); }
+
+			// Sends everything and clears the batch. Returns the number of datagrams
+			// sent, or -1 with errno from sendmmsg. Datagrams left over when the
+			// socket buffer is full are dropped, as a failed write would be; kcp
+			// retransmits them.
+			int flush(int fd);
+
+			uint64_t syscalls() const { return syscalls_; }
+
+		private:
+			bool gso_;
+			std::vector<char> data_;
+			std::vector<uint32_t> sizes_;
+			std::vector<struct sockaddr_in6> peers_;
+			uint64_t syscalls_;
+		};
+
+	}
+}
@@ -39,6 +39,7 @@ UdpClient::UdpClient( EventLoop* loop,
 	messageCallback_( UdpDefaultMessageCallback ),
 	retry_( false ),
 	connect_( true ),
+	offload_( true ),
 	nextConnId_( 1 )
 {
 	connector_->setNewUdpConnectionCallback(
@@ -127,6 +128,8 @@ void UdpClient::newConnection(Socket* connectedSocket)
 	conn->setConnectionCallback( connectionCallback_ );
 	conn->setMessageCallback( messageCallback_ );
 	conn->setWriteCompleteCallback( writeCompleteCallback_ );
+	if ( !offload_ )
+		conn->setOffload( false );
 	conn->setCloseCallback(
 		std::bind( &UdpClient::removeConnection, this, std::placeholders::_1 ) ); // FIXME: unsafe
 	{
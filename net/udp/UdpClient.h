@@ -51,6 +51,11 @@ namespace Miren
 			void setWriteCompleteCallback( UdpWriteCompleteCallback cb )
 			{ writeCompleteCallback_ = std::move( cb ); }
 
+			/// UDP_SEGMENT/UDP_GRO offload, on by default.
+			/// Not thread safe.
+			void setOffload( bool on )
+			{ offload_ = on; }
+
 		private:
 			/// Not thread safe, but in loop
 			void newConnection(Socket* connectedSocket);
@@ -65,6 +70,7 @@ namespace Miren
 			UdpWriteCompleteCallback writeCompleteCallback_;
 			bool retry_;   // atomic
 			bool connect_; // atomic
+			bool offload_;
 						   // always in loop thread
 			int nextConnId_;
 			mutable base::MutexLock mutex_;
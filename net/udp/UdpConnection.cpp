@@ -32,6 +32,21 @@ namespace Miren
 namespace net
 {
 
+namespace
+{
+	// the clock of kcp, 32-bit milliseconds
+	int kcpClockMs()
+	{
+		return static_cast<int>(base::Timestamp::now().microSecondsSinceEpoch() / 1000);
+	}
+
+	// kcpp does not expose its send queue and buffer. Unacked data is resent until it is
+	// acked, so a session that wrote nothing for this long has nothing in flight; a
+	// retransmit later than that has an RTO of seconds, a backed off update adds at most
+	// KcpScheduler::kMaxIdleDelayMs to it
+	const uint32_t kKcpInFlightMs = 3000;
+}
+
 UdpConnection::UdpConnection(EventLoop* loop, const std::string& nameArg,
 	Socket* connectedSocket,
 	int ConnectionId,
@@ -44,28 +59,64 @@ UdpConnection::UdpConnection(EventLoop* loop, const std::string& nameArg,
 	state_(kConnecting),
 	reading_(true),
 	socket_(connectedSocket),
-	channel_(new Channel(loop, socket_->fd())),
+	channel_(connectedSocket ? new Channel(loop, connectedSocket->fd()) : NULL),
 	localAddr_(localAddr),
 	peerAddr_(peerAddr),
+	sendFlushQueued_(false),
+	socketIndex_(0),
+	inputData_(NULL),
+	inputLen_(-1),
 	//isCliKcpsessConned_(false),
 	kcpSession_(new KcpSession(
 		role,
 		std::bind(&UdpConnection::DoSend, this, std::placeholders::_1, std::placeholders::_2),
 		std::bind(&UdpConnection::DoRecv, this),
-		[]() { return static_cast<int>(
-		(base::Timestamp::now().microSecondsSinceEpoch() / 1000)); }))
-{
-	channel_->setReadCallback(
-		std::bind(&UdpConnection::handleRead, this, std::placeholders::_1));
-	channel_->setCloseCallback(
-		std::bind(&UdpConnection::handleClose, this));
-	channel_->setErrorCallback(
-		std::bind(&UdpConnection::handleError, this));
+		&kcpClockMs)),
+	kcpScheduler_(NULL),
+	lastKcpOutputMs_(0),
+	kcpOutputSeen_(false)
+{
+	if (channel_)
+	{
+		channel_->setReadCallback(
+			std::bind(&UdpConnection::handleRead, this, std::placeholders::_1));
+		channel_->setCloseCallback(
+			std::bind(&UdpConnection::handleClose, this));
+		channel_->setErrorCallback(
+			std::bind(&UdpConnection::handleError, this));
+	}
 	LOG_DEBUG << "UdpConnection::ctor[" << name_ << "] at " << this
-		<< " fd=" << socket_->fd();
+		<< " fd=" << fd();
 
 
 	kcpSession_->setConnectionCallback(std::bind(&UdpConnection::onKcpSessionConnection, this, std::placeholders::_1));
+	setOffload(true);
+}
+
+UdpConnection::UdpConnection(EventLoop* loop, const std::string& nameArg,
+	const UdpDemuxerPtr& demuxer,
+	int socketIndex,
+	int ConnectionId,
+	const InetAddress& localAddr,
+	const InetAddress& peerAddr, const kcpp::RoleTypeE role)
+	: UdpConnection(loop, nameArg, NULL, ConnectionId, localAddr, peerAddr, role)
+{
+	demuxer_ = demuxer;
+	socketIndex_ = socketIndex;
+}
+
+int UdpConnection::fd() const
+{
+	return socket_ ? socket_->fd() : -1;
+}
+
+void UdpConnection::setOffload(bool on)
+{
+	// the shared sockets are set up by UdpDemuxer
+	if (!socket_)
+		return;
+	sendBatch_.setGso(socket_->fd(), on);
+	recvBatch_.setGro(socket_->fd(), on);
 }
 
 void UdpConnection::onKcpSessionConnection(std::deque<std::string>* pendingSendDataDeque)
@@ -84,14 +135,12 @@ UdpConnection::~UdpConnection()
 {
 	assert(state_ == kDisconnected);
 	LOG_DEBUG << "UdpConnection::dtor[" << name_ << "] at " << this
-		<< " fd=" << channel_->fd()
+		<< " fd=" << fd()
 		<< " state=" << stateToString();
 
 	LOG_INFO << localAddress().toIpPort() << " -> "
 		<< peerAddress().toIpPort() << " is "
 		<< (connected() ? "UP" : "DOWN");
-
-	loop_->cancel(curKcpsessUpTimerId_);
 }
 
 // FIXME efficiency!!!
@@ -151,6 +200,7 @@ void UdpConnection::sendInLoop(const base::StringPiece& message,
 void UdpConnection::handleRead(base::Timestamp receiveTime)
 {
 	loop_->assertInLoopThread();
+	markKcpActive();
 	int n = 0;
 	while (kcpSession_->Recv(&kcpsessRcvBuf_, n))
 	{
@@ -165,55 +215,119 @@ void UdpConnection::handleRead(base::Timestamp receiveTime)
 			//messageCallback_(shared_from_this(), packetBuf_, n, receiveTime);
 		}
 	}
+	// the socket may be drained into recvBatch_ already, no readable event would come for the rest
+	if (recvBatch_.buffered() > 0 && state_ != kDisconnected)
+	{
+		std::weak_ptr<UdpConnection> weakThis(shared_from_this());
+		loop_->queueInLoop([weakThis]() {
+			UdpConnectionPtr conn(weakThis.lock());
+			if (conn)
+				conn->handleRead(base::Timestamp::now());
+		});
+	}
 }
 
-void UdpConnection::KcpSessionUpdate()
+int UdpConnection::onKcpUpdate()
 {
-	auto kcpsessUpdateFunc = [&]() {
-		auto nextUpdateTimeMs = kcpSession_->Update();
-		if (nextUpdateTimeMs < 0)
-		{
-			handleClose();
-			return;
-		}
-		curKcpsessUpTimerId_ = loop_->runAt(base::Timestamp(nextUpdateTimeMs * 1000), [&]() {
-			KcpSessionUpdate();
-			//if (!kcpSession_->CheckCanSend()/* || (kcpSession_->CheckTimeout() && kcpSession_->IsServer())*/)
-			//	handleClose();
-			//if (kcpSession_->IsClient() && !isCliKcpsessConned_ && kcpSession_->IsKcpsessConnected())
-			//{
-			//	isCliKcpsessConned_ = true;
-			//	connectionCallback_(shared_from_this());
-			//}
-		});
-	};
+	// handleClose() may drop the last reference UdpServer holds
+	UdpConnectionPtr guardThis(shared_from_this());
+	int now = kcpClockMs();
+	int nextUpdateTimeMs = kcpSession_->Update();
+	if (nextUpdateTimeMs < 0)
+	{
+		handleClose();
+		return -1;
+	}
+	// the 32-bit clock wraps, the difference does not
+	int delayMs = static_cast<int>(static_cast<uint32_t>(nextUpdateTimeMs) - static_cast<uint32_t>(now));
+	return delayMs > 0 ? delayMs : 0;
+}
 
-	if (loop_->isInLoopThread())
-		kcpsessUpdateFunc();
-	else
-		loop_->runInLoop([&]() { kcpsessUpdateFunc(); });
+void UdpConnection::onKcpFlush()
+{
+	flushSend();
+}
+
+bool UdpConnection::kcpInFlight() const
+{
+	return kcpOutputSeen_
+		&& static_cast<uint32_t>(kcpClockMs()) - lastKcpOutputMs_ < kKcpInFlightMs;
 }
 
 void UdpConnection::DoSend(const void* data, int len)
 {
-	ssize_t nwrote = 0;
-	nwrote = sockets::write(channel_->fd(), data, len);
-	if (nwrote >= 0)
+	loop_->assertInLoopThread();
+	markKcpActive();
+	lastKcpOutputMs_ = static_cast<uint32_t>(kcpClockMs());
+	kcpOutputSeen_ = true;
+	if (demuxer_)
+	{
+		// the shared socket is flushed by UdpDemuxer, once per loop iteration for all peers
+		demuxer_->send(socketIndex_, peerAddr_, data, len);
+		if (writeCompleteCallback_ && !deferKcpFlush())
+			queueFlushSend();
+		return;
+	}
+
+	sendBatch_.append(data, static_cast<size_t>(len));
+	if (sendBatch_.pending() >= UdpSendBatch::kMaxBatch)
+		flushSend();
+	else if (!deferKcpFlush())
+		queueFlushSend();
+}
+
+void UdpConnection::queueFlushSend()
+{
+	if (sendFlushQueued_)
+		return;
+	// runs after the channels of this iteration are handled, once for all of them
+	std::weak_ptr<UdpConnection> weakThis(weak_from_this());
+	sendFlushQueued_ = true;
+	loop_->queueInLoop([weakThis]() {
+		UdpConnectionPtr conn(weakThis.lock());
+		if (conn)
+			conn->flushSend();
+	});
+}
+
+void UdpConnection::flushSend()
+{
+	loop_->assertInLoopThread();
+	sendFlushQueued_ = false;
+	if (demuxer_)
 	{
-		if (len - nwrote == 0 && writeCompleteCallback_)
+		if (writeCompleteCallback_)
 			loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+		return;
 	}
-	else // nwrote < 0
+	if (sendBatch_.pending() == 0)
+		return;
+	int n = sendBatch_.flush(channel_->fd());
+	if (n >= 0)
 	{
-		//LOG_SYSERR << "UdpConnection::DoSend";
+		if (writeCompleteCallback_)
+			loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+	}
+	else if (state_ != kDisconnected)
+	{
+		//LOG_SYSERR << "UdpConnection::flushSend";
 		handleError();
 	}
 }
 
 kcpp::UserInputData UdpConnection::DoRecv()
 {
-	ssize_t n = 0;
-	n = sockets::read(channel_->fd(), static_cast<void*>(packetBuf_), kPacketBufSize);
+	if (demuxer_)
+	{
+		// the datagram passed to handleDatagram, handed out once
+		kcpp::UserInputData input(inputData_, inputLen_);
+		inputData_ = NULL;
+		inputLen_ = -1;
+		return input;
+	}
+
+	char* data = NULL;
+	ssize_t n = recvBatch_.next(channel_->fd(), &data);
 	if (n == 0)
 	{
 		handleClose();
@@ -223,12 +337,26 @@ kcpp::UserInputData UdpConnection::DoRecv()
 		//LOG_SYSERR << "UdpConnection::handleRead";
 		handleError();
 	}
-	return kcpp::UserInputData(packetBuf_, static_cast<int>(n));
+	return kcpp::UserInputData(data, static_cast<int>(n));
+}
+
+void UdpConnection::handleDatagram(char* data, int len, base::Timestamp receiveTime)
+{
+	loop_->assertInLoopThread();
+	assert(demuxer_);
+	inputData_ = data;
+	inputLen_ = len;
+	handleRead(receiveTime);
+	inputData_ = NULL;
+	inputLen_ = -1;
 }
 
 void UdpConnection::kcpSend(const void* data, int len,
 	kcpp::TransmitModeE transmitMode /*= kcpp::TransmitModeE::kReliable*/)
 {
+	markKcpActive();
+	lastKcpOutputMs_ = static_cast<uint32_t>(kcpClockMs());
+	kcpOutputSeen_ = true;
 	len = kcpSession_->Send(data, len, transmitMode);
 	if (len < 0)
 		LOG_ERROR << "kcpSession send failed";
@@ -314,9 +442,10 @@ void UdpConnection::startRead()
 void UdpConnection::startReadInLoop()
 {
 	loop_->assertInLoopThread();
-	if (!reading_ || !channel_->isReading())
+	if (!reading_ || (channel_ && !channel_->isReading()))
 	{
-		channel_->enableReading();
+		if (channel_)
+			channel_->enableReading();
 		reading_ = true;
 	}
 }
@@ -329,9 +458,10 @@ void UdpConnection::stopRead()
 void UdpConnection::stopReadInLoop()
 {
 	loop_->assertInLoopThread();
-	if (reading_ || channel_->isReading())
+	if (reading_ || (channel_ && channel_->isReading()))
 	{
-		channel_->disableReading();
+		if (channel_)
+			channel_->disableReading();
 		reading_ = false;
 	}
 }
@@ -341,10 +471,14 @@ void UdpConnection::connectEstablished()
 	loop_->assertInLoopThread();
 	assert(state_ == kConnecting);
 	setState(kConnected);
-	channel_->tie(shared_from_this());
-	channel_->enableReading();
+	if (channel_)
+	{
+		channel_->tie(shared_from_this());
+		channel_->enableReading();
+	}
 
-	KcpSessionUpdate();
+	kcpScheduler_ = KcpScheduler::forLoop(loop_);
+	kcpScheduler_->schedule(this, 0);
 
 	//if (kcpSession_->IsServer())
 	//{
@@ -359,21 +493,28 @@ void UdpConnection::connectDestroyed()
 	if (state_ == kConnected)
 	{
 		setState(kDisconnected);
-		channel_->disableAll();
+		if (channel_)
+			channel_->disableAll();
 
 		connectionCallback_(shared_from_this());
 	}
-	channel_->remove();
+	if (kcpScheduler_)
+		kcpScheduler_->remove(this);
+	if (channel_)
+		channel_->remove();
 }
 
 void UdpConnection::handleClose()
 {
 	loop_->assertInLoopThread();
-	LOG_TRACE << "fd = " << channel_->fd() << " state = " << stateToString();
+	LOG_TRACE << "fd = " << fd() << " state = " << stateToString();
 	//assert(state_ == kConnected || state_ == kDisconnecting);
 	// we don't close fd, leave it to dtor, so we can find leaks easily.
 	setState(kDisconnected);
-	channel_->disableAll();
+	if (channel_)
+		channel_->disableAll();
+	if (kcpScheduler_)
+		kcpScheduler_->remove(this);
 
 	UdpConnectionPtr guardThis(shared_from_this());
 	connectionCallback_(guardThis);
@@ -3,11 +3,13 @@
 #include "base/StringPiece.h"
 #include "base/Types.h"
 #include "base/Noncopyable.h"
+#include "net/udp/UdpBatch.h"
 #include "net/udp/UdpCallbacks.h"
+#include "net/udp/UdpDemuxer.h"
+#include "net/udp/KcpScheduler.h"
 #include "net/Callbacks.h"
 #include "net/Buffer.h"
 #include "net/sockets/InetAddress.h"
-#include "net/timer/TimerId.h"
 
 #include "third_party/kcpp/kcpp.h"
 
@@ -25,7 +27,8 @@ namespace Miren
 		class EventLoop;
 		class Socket;
 
-		class UdpConnection : base::NonCopyable,	public std::enable_shared_from_this<UdpConnection>
+		class UdpConnection : base::NonCopyable,	public std::enable_shared_from_this<UdpConnection>,
+			private KcpScheduler::Session
 		{
 		public:
 			/// Constructs a UdpConnection with a connected sockfd
@@ -39,6 +42,19 @@ namespace Miren
 				const InetAddress& peerAddr,
         const kcpp::RoleTypeE role);
 
+			/// Constructs a UdpConnection on a socket shared with other peers,
+			/// see UdpServer::kSharedSockets.
+			///
+			/// User should not create this object.
+			UdpConnection(EventLoop* loop,
+				const std::string& name,
+				const UdpDemuxerPtr& demuxer,
+				int socketIndex,
+				int ConnectionId,
+				const InetAddress& localAddr,
+				const InetAddress& peerAddr,
+				const kcpp::RoleTypeE role);
+
 			~UdpConnection();
 
 			enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
@@ -97,21 +113,36 @@ namespace Miren
 												 // called when TcpServer has removed me from its map
 			void connectDestroyed();  // should be called only once
 
+			/// Internal use only, UdpDemuxer hands over the datagrams of a shared socket.
+			void handleDatagram(char* data, int len, base::Timestamp receiveTime);
+
 			void setContext(const std::any& context) { context_ = context; }
 		  const std::any& getContext() const { return context_; }
 			std::any* getMutableContext() { return &context_; }
 
 			int GetConnId() const { return connId_; }
 
+			// UDP_SEGMENT/UDP_GRO offload, on by default where the kernel supports it.
+			// Must be called before connectEstablished().
+			void setOffload(bool on);
+			bool offload() const { return sendBatch_.gsoEnabled() || recvBatch_.groEnabled(); }
+
 		private:
 			void kcpSend(const void* message, int len,
 				kcpp::TransmitModeE transmitMode = kcpp::TransmitModeE::kReliable);
 
 			void onKcpSessionConnection(std::deque<std::string>* pendingSendDataDeque);
 
-			void KcpSessionUpdate();
+			// KcpScheduler::Session
+			int onKcpUpdate() override;
+			void onKcpFlush() override;
+			bool kcpInFlight() const override;
+
 			void DoSend(const void* message, int len);
 			kcpp::UserInputData DoRecv();
+			void queueFlushSend();
+			void flushSend();
+			int fd() const;
 
 			void handleRead(base::Timestamp receiveTime);
 			void handleClose();
@@ -143,16 +174,29 @@ namespace Miren
 
 			// new
 			int connId_;
-			static const size_t kPacketBufSize = 1500;
-			char packetBuf_[kPacketBufSize];
 			std::any context_;
 
+			// datagrams kcp writes during one loop iteration go out in one sendmmsg
+			UdpRecvBatch recvBatch_;
+			UdpSendBatch sendBatch_;
+			bool sendFlushQueued_;
+
+			// shared socket mode: no socket_ and channel_, datagrams go through demuxer_
+			UdpDemuxerPtr demuxer_;
+			int socketIndex_;
+			char* inputData_;
+			int inputLen_;
+
 			Buffer inputBuffer_;
 			kcpp::Buf kcpsessRcvBuf_;
 
 			// kcp
 			std::shared_ptr<kcpp::KcpSession> kcpSession_;
-			TimerId curKcpsessUpTimerId_;
+			// updates the session with the others of the loop, set by connectEstablished()
+			KcpScheduler* kcpScheduler_;
+			// kcp clock of the last datagram kcp wrote or data handed to it
+			uint32_t lastKcpOutputMs_;
+			bool kcpOutputSeen_;
 			//bool isCliKcpsessConned_;
 		};
 
@@ -0,0 +1,151 @@
+#include "net/udp/UdpDemuxer.h"
+
+#include "base/log/Logging.h"
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+#include "net/sockets/Socket.h"
+#include "net/sockets/SocketsOps.h"
+#include "net/udp/UdpConnection.h"
+
+#include <errno.h>
+
+namespace Miren
+{
+namespace net
+{
+
+UdpDemuxer::UdpDemuxer(EventLoop* loop, const InetAddress& listenAddr, int sockets, bool offload)
+	: loop_(CHECK_NOTNULL(loop)),
+	flushQueued_(false)
+{
+	for (int i = 0; i < sockets; ++i)
+	{
+		std::unique_ptr<Endpoint> endpoint(new Endpoint);
+		endpoint->socket.reset(new Socket(sockets::createUdpNonblockingOrDie(listenAddr.family())));
+		endpoint->socket->setReuseAddr(true);
+		endpoint->socket->setReusePort(true);
+		endpoint->socket->bindAddress(listenAddr);
+		endpoint->recvBatch.setGro(endpoint->socket->fd(), offload);
+		endpoint->sendBatch.setGso(endpoint->socket->fd(), offload);
+		endpoints_.push_back(std::move(endpoint));
+	}
+}
+
+UdpDemuxer::~UdpDemuxer()
+{
+	for (auto& endpoint : endpoints_)
+		assert(!endpoint->channel);
+}
+
+void UdpDemuxer::start()
+{
+	loop_->assertInLoopThread();
+	for (size_t i = 0; i < endpoints_.size(); ++i)
+	{
+		Endpoint* endpoint = endpoints_[i].get();
+		endpoint->channel.reset(new Channel(loop_, endpoint->socket->fd()));
+		endpoint->channel->setReadCallback(
+			std::bind(&UdpDemuxer::handleRead, this, static_cast<int>(i), std::placeholders::_1));
+		endpoint->channel->tie(shared_from_this());
+		endpoint->channel->enableReading();
+	}
+}
+
+void UdpDemuxer::stop()
+{
+	loop_->assertInLoopThread();
+	flush();
+	for (auto& endpoint : endpoints_)
+	{
+		if (endpoint->channel)
+		{
+			endpoint->channel->disableAll();
+			endpoint->channel->remove();
+			endpoint->channel.reset();
+		}
+	}
+	peers_.clear();
+}
+
+void UdpDemuxer::handleRead(int index, base::Timestamp receiveTime)
+{
+	loop_->assertInLoopThread();
+	Endpoint* endpoint = endpoints_[static_cast<size_t>(index)].get();
+	char* data = NULL;
+	struct sockaddr_in6 peer;
+	ssize_t n;
+	while ((n = endpoint->recvBatch.next(endpoint->socket->fd(), &data, &peer)) >= 0)
+	{
+		// an empty datagram carries nothing for kcp, and must not close the session
+		if (n == 0)
+			continue;
+
+		// a copy, the connection may remove itself from the table while handling the datagram
+		UdpConnectionPtr conn;
+		UdpConnectionPtr* found = peers_.find(peer);
+		if (found)
+		{
+			conn = *found;
+		}
+		else if (newPeerCallback_)
+		{
+			conn = newPeerCallback_(shared_from_this(), index, InetAddress(peer));
+			if (conn && !conn->disconnected())
+				peers_.insert(peer, conn);
+		}
+
+		if (conn && conn->connected() && conn->isReading())
+			conn->handleDatagram(data, static_cast<int>(n), receiveTime);
+	}
+	if (errno != EAGAIN && errno != EWOULDBLOCK)
+		LOG_SYSERR << "UdpDemuxer::handleRead";
+}
+
+void UdpDemuxer::send(int socketIndex, const InetAddress& peerAddr, const void* data, int len)
+{
+	loop_->assertInLoopThread();
+	Endpoint* endpoint = endpoints_[static_cast<size_t>(socketIndex)].get();
+	endpoint->sendBatch.append(data, static_cast<size_t>(len), peerAddr.getSockAddr());
+	if (endpoint->sendBatch.pending() >= UdpSendBatch::kMaxBatch)
+	{
+		flush(endpoint);
+	}
+	else if (!flushQueued_)
+	{
+		// one flush per loop iteration for all the peers of this loop
+		std::weak_ptr<UdpDemuxer> weakThis(shared_from_this());
+		flushQueued_ = true;
+		loop_->queueInLoop([weakThis]() {
+			UdpDemuxerPtr demuxer(weakThis.lock());
+			if (demuxer)
+				demuxer->flush();
+		});
+	}
+}
+
+void UdpDemuxer::remove(const InetAddress& peerAddr, const UdpConnection* conn)
+{
+	loop_->assertInLoopThread();
+	UdpConnectionPtr* found = peers_.find(*peerAddr.getSockAddr6());
+	if (found && found->get() == conn)
+		peers_.erase(*peerAddr.getSockAddr6());
+}
+
+void UdpDemuxer::flush()
+{
+	flushQueued_ = false;
+	for (auto& endpoint : endpoints_)
+		flush(endpoint.get());
+}
+
+void UdpDemuxer::flush(Endpoint* endpoint)
+{
+	if (endpoint->sendBatch.pending() == 0)
+		return;
+	// a full socket buffer drops the datagrams like a connected socket does, kcp resends them
+	if (endpoint->sendBatch.flush(endpoint->socket->fd()) < 0)
+		LOG_SYSERR << "UdpDemuxer::flush";
+}
+
+} // namespace net
+} // namespace Miren
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+#include "base/Timestamp.h"
+#include "net/sockets/InetAddress.h"
+#include "net/udp/UdpBatch.h"
+#include "net/udp/UdpPeerTable.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace Miren
+{
+	namespace net
+	{
+
+		class Channel;
+		class EventLoop;
+		class Socket;
+		class UdpConnection;
+		typedef std::shared_ptr<UdpConnection> UdpConnectionPtr;
+
+		// The sockets of one IO loop in the shared socket mode of UdpServer.
+		// A few SO_REUSEPORT sockets bound to the listen address receive the datagrams
+		// of every peer the kernel hashes to this loop; they are handed to the peer's
+		// UdpConnection through a UdpPeerTable. What the connections send is queued per
+		// socket and leaves in one sendmmsg per loop iteration.
+		// All member functions except the constructor must be called in the loop thread.
+		class UdpDemuxer : base::NonCopyable, public std::enable_shared_from_this<UdpDemuxer>
+		{
+		public:
+			// creates the connection of an unknown peer, an empty pointer drops the datagram
+			typedef std::function<UdpConnectionPtr(const std::shared_ptr<UdpDemuxer>&, int socketIndex,
+				const InetAddress& peerAddr)> NewPeerCallback;
+
+			UdpDemuxer(EventLoop* loop, const InetAddress& listenAddr, int sockets, bool offload);
+			~UdpDemuxer();
+
+			void setNewPeerCallback(const NewPeerCallback& cb) { newPeerCallback_ = cb; }
+
+			void start();
+			// drops the peer table, the connections are destroyed by UdpServer
+			void stop();
+
+			void send(int socketIndex, const InetAddress& peerAddr, const void* data, int len);
+			void remove(const InetAddress& peerAddr, const UdpConnection* conn);
+
+			EventLoop* getLoop() const { return loop_; }
+			int sockets() const { return static_cast<int>(endpoints_.size()); }
+			size_t peers() const { return peers_.size(); }
+
+		private:
+			struct Endpoint
+			{
+				std::unique_ptr<Socket> socket;
+				std::unique_ptr<Channel> channel;
+				UdpRecvBatch recvBatch;
+				UdpSendBatch sendBatch;
+			};
+
+			void handleRead(int index, base::Timestamp receiveTime);
+			void flush();
+			void flush(Endpoint* endpoint);
+
+			EventLoop* loop_;
+			std::vector<std::unique_ptr<Endpoint>> endpoints_;
+			UdpPeerTable<UdpConnectionPtr> peers_;
+			NewPeerCallback newPeerCallback_;
+			bool flushQueued_;
+		};
+
+		typedef std::shared_ptr<UdpDemuxer> UdpDemuxerPtr;
+
+	}
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "base/Noncopyable.h"
+
+#include <netinet/in.h>
+#include <stdint.h>
+#include <string.h>
+#include <utility>
+#include <vector>
+
+namespace Miren
+{
+	namespace net
+	{
+
+		// Open addressing table from a peer address to its connection state, used by
+		// the shared socket mode of UdpServer. The local half of the 4-tuple is the
+		// listen address, the same for every socket of a server, so the peer half is
+		// the key. Linear probing over one flat array keeps a lookup to one or two
+		// cache lines; erase shifts the following entries back, there are no tombstones.
+		// Not thread safe, each IO loop owns its table.
+		template <typename Value>
+		class UdpPeerTable : base::NonCopyable
+		{
+		public:
+			explicit UdpPeerTable(size_t capacity = 64)
+				: size_(0)
+			{
+				size_t n = 16;
+				while (n < capacity * 2)
+					n *= 2;
+				buckets_.resize(n);
+			}
+
+			// NULL if the peer is unknown, valid until the next insert or erase
+			Value* find(const struct sockaddr_in6& peer)
+			{
+				Key key(peer);
+				for (size_t i = key.hash() & mask(); buckets_[i].used; i = (i + 1) & mask())
+				{
+					if (buckets_[i].key == key)
+						return &buckets_[i].value;
+				}
+				return NULL;
+			}
+
+			// replaces the value of a known peer
+			void insert(const struct sockaddr_in6& peer, Value value)
+			{
+				if ((size_ + 1) * 2 > buckets_.size())
+					rehash(buckets_.size() * 2);
+				Key key(peer);
+				size_t i = key.hash() & mask();
+				for (; buckets_[i].used; i = (i + 1) & mask())
+				{
+					if (buckets_[i].key == key)
+					{
+						buckets_[i].value = std::move(value);
+						return;
+					}
+				}
+				buckets_[i].key = key;
+				buckets_[i].value = std::move(value);
+				buckets_[i].used = true;
+				++size_;
+			}
+
+			bool erase(const struct sockaddr_in6& peer)
+			{
+				Key key(peer);
+				size_t i = key.hash() & mask();
+				for (; buckets_[i].used; i = (i + 1) & mask())
+				{
+					if (buckets_[i].key == key)
+						break;
+				}
+				if (!buckets_[i].used)
+					return false;
+
+				// move back every following entry whose home slot is not between the hole and itself
+				size_t hole = i;
+				for (size_t j = (i + 1) & mask(); buckets_[j].used; j = (j + 1) & mask())
+				{
+					size_t home = buckets_[j].key.hash() & mask();
+					if (((j - home) & mask()) >= ((j - hole) & mask()))
+					{
+						buckets_[hole] = std::move(buckets_[j]);
+						hole = j;
+					}
+				}
+				buckets_[hole].used = false;
+				buckets_[hole].value = Value();
+				--size_;
+				return true;
+			}
+
+			template <typename Func>
+			void forEach(Func func)
+			{
+				for (Bucket& bucket : buckets_)
+				{
+					if (bucket.used)
+						func(bucket.value);
+				}
+			}
+
+			void clear()
+			{
+				std::vector<Bucket> empty(buckets_.size());
+				buckets_.swap(empty);
+				size_ = 0;
+			}
+
+			size_t size() const { return size_; }
+			size_t capacity() const { return buckets_.size(); }
+			size_t memoryBytes() const { return buckets_.capacity() * sizeof(Bucket); }
+
+		private:
+			// IPv4 peers keep their address in the first 4 bytes
+			struct Key
+			{
+				Key() : port(0), family(0) { memset(addr, 0, sizeof addr); }
+
+				explicit Key(const struct sockaddr_in6& peer)
+					: port(peer.sin6_port),
+					family(peer.sin6_family)
+				{
+					memset(addr, 0, sizeof addr);
+					if (peer.sin6_family == AF_INET)
+						memcpy(addr, &reinterpret_cast<const struct sockaddr_in&>(peer).sin_addr, 4);
+					else
+						memcpy(addr, &peer.sin6_addr, sizeof addr);
+				}
+
+				bool operator==(const Key& other) const
+				{
+					return port == other.port && family == other.family
+						&& memcmp(addr, other.addr, sizeof addr) == 0;
+				}
+
+				size_t hash() const
+				{
+					uint64_t a, b;
+					memcpy(&a, addr, 8);
+					memcpy(&b, addr + 8, 8);
+					uint64_t h = a * 0x9E3779B97F4A7C15ULL ^ (b + port + (static_cast<uint64_t>(family) << 16));
+					h ^= h >> 32;
+					h *= 0xD6E8FEB86659FD93ULL;
+					h ^= h >> 32;
+					return static_cast<size_t>(h);
+				}
+
+				unsigned char addr[16];
+				uint16_t port;
+				uint16_t family;
+			};
+
+			struct Bucket
+			{
+				Bucket() : used(false) {}
+
+				Key key;
+				bool used;
+				Value value;
+			};
+
+			size_t mask() const { return buckets_.size() - 1; }
+
+			void rehash(size_t n)
+			{
+				std::vector<Bucket> old(n);
+				old.swap(buckets_);
+				for (Bucket& bucket : old)
+				{
+					if (!bucket.used)
+						continue;
+					size_t i = bucket.key.hash() & mask();
+					while (buckets_[i].used)
+						i = (i + 1) & mask();
+					buckets_[i] = std::move(bucket);
+				}
+			}
+
+			std::vector<Bucket> buckets_;
+			size_t size_;
+		};
+
+	}
+}
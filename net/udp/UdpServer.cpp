@@ -24,15 +24,19 @@ UdpServer::UdpServer( EventLoop* loop,
 	: loop_( CHECK_NOTNULL( loop ) ),
 	listenAddr_(listenAddr),
 	name_( nameArg ),
-	acceptor_( new UdpAcceptor( loop, listenAddr, option == kReusePort ) ),
+	acceptor_( option == kSharedSockets ? NULL : new UdpAcceptor( loop, listenAddr, option == kReusePort ) ),
 	threadPool_( new EventLoopThreadPool( loop, name_ ) ),
 	connectionCallback_( UdpDefaultConnectionCallback ),
 	messageCallback_( UdpDefaultMessageCallback ),
-	nextConnId_( 1 )
+	offload_( true ),
+	socketsPerLoop_( 1 )
 {
-	acceptor_->setNewConnectionCallback(
-		std::bind( &UdpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2 ) );
-	acceptor_->setNewConnectorCallback(std::bind(&UdpServer::newUdpConnector, this, std::placeholders::_1));
+	if ( acceptor_ )
+	{
+		acceptor_->setNewConnectionCallback(
+			std::bind( &UdpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2 ) );
+		acceptor_->setNewConnectorCallback(std::bind(&UdpServer::newUdpConnector, this, std::placeholders::_1));
+	}
 }
 
 UdpServer::~UdpServer()
@@ -48,6 +52,12 @@ UdpServer::~UdpServer()
 			std::bind( &UdpConnection::connectDestroyed, conn ) );
 	}
 	peerAddrToUdpConnectors_.clear();
+
+	for ( auto& demuxer : demuxers_ )
+	{
+		demuxer->getLoop()->runInLoop(
+			std::bind( &UdpDemuxer::stop, demuxer ) );
+	}
 }
 
 void UdpServer::setThreadNum( int numThreads )
@@ -62,9 +72,17 @@ void UdpServer::start()
 	{
 		threadPool_->start( threadInitCallback_ );
 
-		assert( !acceptor_->listenning() );
-		loop_->runInLoop(
-			std::bind( &UdpAcceptor::listen, get_pointer( acceptor_ ) ) );
+		if ( acceptor_ )
+		{
+			assert( !acceptor_->listenning() );
+			loop_->runInLoop(
+				std::bind( &UdpAcceptor::listen, get_pointer( acceptor_ ) ) );
+		}
+		else
+		{
+			loop_->runInLoop(
+				std::bind( &UdpServer::startSharedSockets, this ) );
+		}
 	}
 }
 
@@ -72,8 +90,9 @@ void UdpServer::newConnection(Socket* connectedSocket, const InetAddress& peerAd
 {
 	loop_->assertInLoopThread();
 	EventLoop* ioLoop = threadPool_->getNextLoop();
+	int connId = nextConnId_.incrementAndGet();
 	char buf[64];
-	snprintf( buf, sizeof buf, "-%s#%d", listenAddr_.toIpPort().c_str(), nextConnId_ );
+	snprintf( buf, sizeof buf, "-%s#%d", listenAddr_.toIpPort().c_str(), connId );
 	std::string connName = name_ + buf;
 
 	LOG_INFO << "UdpServer::newConnection [" << name_
@@ -86,14 +105,14 @@ void UdpServer::newConnection(Socket* connectedSocket, const InetAddress& peerAd
 	// FIXME poll with zero timeout to double confirm the new connection
 	// FIXME use make_shared if necessary
 	UdpConnectionPtr conn( new UdpConnection( ioLoop,
-		connName, connectedSocket, nextConnId_, localAddr, peerAddr , kcpp::RoleTypeE::kSrv) );
-
-	++nextConnId_;
+		connName, connectedSocket, connId, localAddr, peerAddr , kcpp::RoleTypeE::kSrv) );
 
 	connections_[connName] = conn;
 	conn->setConnectionCallback( connectionCallback_ );
 	conn->setMessageCallback( messageCallback_ );
 	conn->setWriteCompleteCallback( writeCompleteCallback_ );
+	if ( !offload_ )
+		conn->setOffload( false );
 	conn->setCloseCallback(
 		std::bind( &UdpServer::removeConnection, this, std::placeholders::_1 ) ); // FIXME: unsafe
 	ioLoop->runInLoop( std::bind( &UdpConnection::connectEstablished, conn ) );
@@ -115,14 +134,74 @@ void UdpServer::removeConnectionInLoop( const UdpConnectionPtr& conn )
 	( void )n;
 	assert( n == 1 );
 
-	acceptor_->getLoop()->queueInLoop(
-		std::bind( &UdpServer::RemoveConnector, this, conn->peerAddress()));
+	if ( acceptor_ )
+	{
+		acceptor_->getLoop()->queueInLoop(
+			std::bind( &UdpServer::RemoveConnector, this, conn->peerAddress()));
+	}
 	conn->getLoop()->queueInLoop(
 		std::bind( &UdpConnection::connectDestroyed, conn ) );
 }
 
 
 
+void UdpServer::startSharedSockets()
+{
+	loop_->assertInLoopThread();
+	for ( EventLoop* ioLoop : threadPool_->getAllLoops() )
+	{
+		UdpDemuxerPtr demuxer( new UdpDemuxer( ioLoop, listenAddr_, socketsPerLoop_, offload_ ) );
+		demuxer->setNewPeerCallback(
+			std::bind( &UdpServer::newPeer, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3 ) );
+		demuxers_.push_back( demuxer );
+		ioLoop->runInLoop( std::bind( &UdpDemuxer::start, demuxer ) );
+	}
+	LOG_INFO << "UdpServer::startSharedSockets [" << name_ << "] - " << demuxers_.size()
+		<< " loops x " << socketsPerLoop_ << " sockets on " << listenAddr_.toIpPort();
+}
+
+UdpConnectionPtr UdpServer::newPeer( const UdpDemuxerPtr& demuxer, int socketIndex, const InetAddress& peerAddr )
+{
+	EventLoop* ioLoop = demuxer->getLoop();
+	ioLoop->assertInLoopThread();
+	int connId = nextConnId_.incrementAndGet();
+	char buf[64];
+	snprintf( buf, sizeof buf, "-%s#%d", listenAddr_.toIpPort().c_str(), connId );
+	std::string connName = name_ + buf;
+
+	LOG_INFO << "UdpServer::newPeer [" << name_
+		<< "] - new connection [" << connName
+		<< "] on shared socket " << socketIndex
+		<< " from " << peerAddr.toIpPort();
+	InetAddress localAddr( listenAddr_.toPort() );
+
+	// created in the io loop, so the datagram that announced the peer is not lost
+	UdpConnectionPtr conn( new UdpConnection( ioLoop,
+		connName, demuxer, socketIndex, connId, localAddr, peerAddr, kcpp::RoleTypeE::kSrv ) );
+	conn->setConnectionCallback( connectionCallback_ );
+	conn->setMessageCallback( messageCallback_ );
+	conn->setWriteCompleteCallback( writeCompleteCallback_ );
+	conn->setCloseCallback(
+		std::bind( &UdpServer::removeSharedConnection, this, demuxer, std::placeholders::_1 ) ); // FIXME: unsafe
+	// queued before any removeConnection of conn, so connections_ sees them in order
+	loop_->runInLoop( std::bind( &UdpServer::addConnectionInLoop, this, conn ) );
+	conn->connectEstablished();
+	return conn;
+}
+
+void UdpServer::addConnectionInLoop( const UdpConnectionPtr& conn )
+{
+	loop_->assertInLoopThread();
+	connections_[conn->name()] = conn;
+}
+
+void UdpServer::removeSharedConnection( const UdpDemuxerPtr& demuxer, const UdpConnectionPtr& conn )
+{
+	// in the io loop: a datagram of the peer arriving after this starts a new connection
+	demuxer->remove( conn->peerAddress(), get_pointer( conn ) );
+	removeConnection( conn );
+}
+
 void UdpServer::newUdpConnector(const InetAddress& peerAddr)
 {
 	if (peerAddrToUdpConnectors_.find(peerAddr)
@@ -5,8 +5,10 @@
 #include "base/Types.h"
 #include "base/thread/Atomic.h"
 #include "net/udp/UdpConnection.h"
+#include "net/udp/UdpDemuxer.h"
 
 #include <map>
+#include <vector>
 
 namespace Miren
 {
@@ -27,6 +29,9 @@ namespace net
     {
       kNoReusePort,
       kReusePort,
+      // no socket per peer: every loop reads all its peers from its own SO_REUSEPORT
+      // sockets and demultiplexes them by address, see UdpDemuxer
+      kSharedSockets,
     };
 
     //UdpServer(EventLoop* loop, const InetAddress& listenAddr);
@@ -78,6 +83,16 @@ namespace net
     void setWriteCompleteCallback( const UdpWriteCompleteCallback& cb )
     { writeCompleteCallback_ = cb; }
 
+    /// UDP_SEGMENT/UDP_GRO offload for new connections, on by default.
+    /// Not thread safe.
+    void setOffload( bool on )
+    { offload_ = on; }
+
+    /// Number of SO_REUSEPORT sockets of each loop with kSharedSockets, 1 by default.
+    /// Must be called before @c start
+    void setSocketsPerLoop( int sockets )
+    { socketsPerLoop_ = sockets; }
+
   private:
     /// Not thread safe, but in loop
     void newConnection(Socket* connectedSocket, const InetAddress& peerAddr);
@@ -86,6 +101,13 @@ namespace net
     /// Not thread safe, but in loop
     void removeConnectionInLoop( const UdpConnectionPtr& conn );
 
+    /// Not thread safe, but in loop
+    void startSharedSockets();
+    /// in the io loop of the demuxer
+    UdpConnectionPtr newPeer( const UdpDemuxerPtr& demuxer, int socketIndex, const InetAddress& peerAddr );
+    void addConnectionInLoop( const UdpConnectionPtr& conn );
+    void removeSharedConnection( const UdpDemuxerPtr& demuxer, const UdpConnectionPtr& conn );
+
     void newUdpConnector(const InetAddress& peerAddress);
     void RemoveConnector( const InetAddress& peerAddr );
     void EraseConnector( const InetAddress& peerAddr );
@@ -94,17 +116,20 @@ namespace net
     EventLoop* loop_;  // the acceptor loop
     InetAddress listenAddr_;
     const std::string name_;
-    std::unique_ptr<UdpAcceptor> acceptor_; // avoid revealing Acceptor
+    std::unique_ptr<UdpAcceptor> acceptor_; // avoid revealing Acceptor, NULL with kSharedSockets
     std::shared_ptr<EventLoopThreadPool> threadPool_;
     UdpConnectionCallback connectionCallback_;
     UdpMessageCallback messageCallback_;
     UdpWriteCompleteCallback writeCompleteCallback_;
     ThreadInitCallback threadInitCallback_;
+    bool offload_;
+    int socketsPerLoop_;
+    std::vector<UdpDemuxerPtr> demuxers_;
 
     base::AtomicInt32 started_;
 
+    base::AtomicInt32 nextConnId_;  // kSharedSockets creates connections in io loops
     // always in loop thread
-    int nextConnId_;
     ConnectionMap connections_;
 
     typedef std::map<InetAddress, UdpConnectorPtr> InetAddressToUdpConnectorMap;
@@ -0,0 +1,159 @@
+#include "net/udp/UdpPeerTable.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <map>
+#include <random>
+#include <string.h>
+#include <vector>
+
+using Miren::net::UdpPeerTable;
+
+namespace
+{
+	struct sockaddr_in6 makePeer(uint32_t n)
+	{
+		struct sockaddr_in6 peer;
+		memset(&peer, 0, sizeof peer);
+		if (n % 3 == 0)
+		{
+			// IPv6 peers differ in the last bytes of the address
+			peer.sin6_family = AF_INET6;
+			peer.sin6_addr.s6_addr[0] = 0x20;
+			peer.sin6_addr.s6_addr[1] = 0x01;
+			uint32_t be = htonl(n);
+			memcpy(&peer.sin6_addr.s6_addr[12], &be, 4);
+			peer.sin6_port = htons(static_cast<uint16_t>(40000 + n % 1000));
+		}
+		else
+		{
+			// many IPv4 peers behind one NAT address, only the port differs
+			struct sockaddr_in& in = reinterpret_cast<struct sockaddr_in&>(peer);
+			in.sin_family = AF_INET;
+			in.sin_addr.s_addr = htonl(0x0A000001 + n / 60000);
+			in.sin_port = htons(static_cast<uint16_t>(1024 + n % 60000));
+		}
+		return peer;
+	}
+
+	// every live peer is found with its value, every erased one is not
+	void expectMatches(UdpPeerTable<int>& table, const std::map<uint32_t, bool>& live)
+	{
+		size_t count = 0;
+		for (const auto& item : live)
+		{
+			struct sockaddr_in6 peer = makePeer(item.first);
+			int* value = table.find(peer);
+			if (item.second)
+			{
+				++count;
+				ASSERT_TRUE(value != NULL) << "peer " << item.first << " lost";
+				EXPECT_EQ(*value, static_cast<int>(item.first));
+			}
+			else
+			{
+				EXPECT_TRUE(value == NULL) << "peer " << item.first << " still found";
+			}
+		}
+		EXPECT_EQ(table.size(), count);
+	}
+}
+
+// grows through several rehashes, then erases inside long probe chains
+TEST(UdpPeerTableTest, eraseKeepsOtherPeersAfterRehash)
+{
+	const uint32_t kPeers = 5000;
+	UdpPeerTable<int> table(4);
+	size_t initialCapacity = table.capacity();
+	std::map<uint32_t, bool> live;
+	for (uint32_t i = 0; i < kPeers; ++i)
+	{
+		table.insert(makePeer(i), static_cast<int>(i));
+		live[i] = true;
+	}
+	EXPECT_GT(table.capacity(), initialCapacity * 8);
+	expectMatches(table, live);
+
+	// every third peer first, then the rest in random order
+	for (uint32_t i = 0; i < kPeers; i += 3)
+	{
+		EXPECT_TRUE(table.erase(makePeer(i)));
+		live[i] = false;
+	}
+	expectMatches(table, live);
+	EXPECT_FALSE(table.erase(makePeer(0)));
+
+	std::vector<uint32_t> rest;
+	for (const auto& item : live)
+	{
+		if (item.second)
+			rest.push_back(item.first);
+	}
+	std::mt19937 rng(42);
+	std::shuffle(rest.begin(), rest.end(), rng);
+	for (size_t i = 0; i < rest.size(); ++i)
+	{
+		EXPECT_TRUE(table.erase(makePeer(rest[i])));
+		live[rest[i]] = false;
+		if (i % 97 == 0)
+			expectMatches(table, live);
+	}
+	expectMatches(table, live);
+	EXPECT_EQ(table.size(), 0u);
+}
+
+// A 16 bucket table holds 8 peers before it grows. At that load most trials
+// have colliding chains, and roughly one in seven has a chain that runs off
+// the last bucket and continues at the first one. Erasing in random order over
+// many trials runs the backward shift inside chains, across chains and around the end.
+TEST(UdpPeerTableTest, eraseAcrossChainsAndWrapAround)
+{
+	std::mt19937 rng(7);
+	for (int trial = 0; trial < 2000; ++trial)
+	{
+		UdpPeerTable<int> table(8);
+		ASSERT_EQ(table.capacity(), 16u);
+		std::map<uint32_t, bool> live;
+		std::vector<uint32_t> peers;
+		while (peers.size() < 8)
+		{
+			uint32_t n = static_cast<uint32_t>(rng() % 1000000);
+			if (live.count(n))
+				continue;
+			table.insert(makePeer(n), static_cast<int>(n));
+			live[n] = true;
+			peers.push_back(n);
+		}
+		ASSERT_EQ(table.capacity(), 16u);
+		expectMatches(table, live);
+
+		std::shuffle(peers.begin(), peers.end(), rng);
+		for (uint32_t n : peers)
+		{
+			ASSERT_TRUE(table.erase(makePeer(n)));
+			live[n] = false;
+			expectMatches(table, live);
+			if (HasFailure())
+				return;
+		}
+	}
+}
+
+// erasing an unknown peer changes nothing, re-inserting after erase works
+TEST(UdpPeerTableTest, eraseUnknownAndReinsert)
+{
+	UdpPeerTable<int> table;
+	table.insert(makePeer(1), 1);
+	table.insert(makePeer(2), 2);
+	EXPECT_FALSE(table.erase(makePeer(3)));
+	EXPECT_EQ(table.size(), 2u);
+	EXPECT_TRUE(table.erase(makePeer(1)));
+	EXPECT_TRUE(table.find(makePeer(1)) == NULL);
+	table.insert(makePeer(1), 10);
+	ASSERT_TRUE(table.find(makePeer(1)) != NULL);
+	EXPECT_EQ(*table.find(makePeer(1)), 10);
+	EXPECT_EQ(*table.find(makePeer(2)), 2);
+	EXPECT_EQ(table.size(), 2u);
+}
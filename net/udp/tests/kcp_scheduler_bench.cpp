@@ -0,0 +1,217 @@
+// CPU used to drive the kcp updates of many sessions in one IO loop.
+// timer: one TimerQueue timer per session, re-armed after every update like UdpConnection
+//        did before KcpScheduler, output flushed by one queued functor per session.
+// wheel: KcpScheduler, due sessions updated in one pass per tick, idle ones backed off,
+//        output flushed after the pass.
+// The update stands in for ikcp_update with a 10 ms interval, so only the scheduling
+// cost differs. Active sessions write a datagram on every update, idle ones never do.
+// usage: kcp_scheduler_bench [sessions] [seconds]
+
+#include "base/Timestamp.h"
+#include "base/log/Logging.h"
+#include "net/EventLoop.h"
+#include "net/udp/KcpScheduler.h"
+
+#include <memory>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <vector>
+
+using namespace Miren;
+using namespace Miren::net;
+
+namespace
+{
+	const int kIntervalMs = 10;
+
+	int64_t cpuMicros()
+	{
+		struct rusage usage;
+		::getrusage(RUSAGE_SELF, &usage);
+		return static_cast<int64_t>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+			+ usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+	}
+
+	struct Counters
+	{
+		Counters() : updates(0), datagrams(0), flushes(0) {}
+
+		int64_t updates;
+		int64_t datagrams;
+		int64_t flushes;
+	};
+
+	uint32_t clockMs()
+	{
+		return static_cast<uint32_t>(base::Timestamp::now().microSecondsSinceEpoch() / 1000);
+	}
+
+	// ikcp_update followed by ikcp_check: flushes every interval, an active session writes
+	// a segment then, returns the milliseconds to the next flush
+	int fakeUpdate(Counters* counters, uint32_t* tsFlush, bool active, bool* wrote)
+	{
+		++counters->updates;
+		uint32_t now = clockMs();
+		*wrote = false;
+		if (*tsFlush == 0)
+			*tsFlush = now;
+		if (static_cast<int32_t>(now - *tsFlush) >= 0)
+		{
+			*tsFlush += kIntervalMs;
+			if (static_cast<int32_t>(now - *tsFlush) >= 0)
+				*tsFlush = now + kIntervalMs;
+			*wrote = active;
+		}
+		return static_cast<int32_t>(*tsFlush - now);
+	}
+
+	class TimerSession : base::NonCopyable
+	{
+	public:
+		TimerSession(EventLoop* loop, Counters* counters, bool active)
+			: loop_(loop), counters_(counters), active_(active), tsFlush_(0), pending_(0), flushQueued_(false)
+		{
+		}
+
+		~TimerSession() { loop_->cancel(timerId_); }
+
+		void start(int delayMs)
+		{
+			timerId_ = loop_->runAfter(delayMs / 1000.0, [this]() { update(); });
+		}
+
+	private:
+		void update()
+		{
+			bool wrote;
+			int delayMs = fakeUpdate(counters_, &tsFlush_, active_, &wrote);
+			if (wrote)
+				output();
+			timerId_ = loop_->runAfter(delayMs / 1000.0, [this]() { update(); });
+		}
+
+		void output()
+		{
+			++pending_;
+			if (!flushQueued_)
+			{
+				flushQueued_ = true;
+				loop_->queueInLoop([this]() { flush(); });
+			}
+		}
+
+		void flush()
+		{
+			flushQueued_ = false;
+			counters_->datagrams += pending_;
+			++counters_->flushes;
+			pending_ = 0;
+		}
+
+		EventLoop* loop_;
+		Counters* counters_;
+		const bool active_;
+		uint32_t tsFlush_;
+		int pending_;
+		bool flushQueued_;
+		TimerId timerId_;
+	};
+
+	class WheelSession : public KcpScheduler::Session
+	{
+	public:
+		WheelSession(EventLoop* loop, Counters* counters, bool active)
+			: scheduler_(KcpScheduler::forLoop(loop)), counters_(counters), active_(active),
+			tsFlush_(0), pending_(0)
+		{
+		}
+
+		~WheelSession() { scheduler_->remove(this); }
+
+		void start(int delayMs) { scheduler_->schedule(this, delayMs); }
+
+	private:
+		int onKcpUpdate() override
+		{
+			bool wrote;
+			int delayMs = fakeUpdate(counters_, &tsFlush_, active_, &wrote);
+			if (wrote)
+			{
+				++pending_;
+				markKcpActive();
+				deferKcpFlush();
+			}
+			return delayMs;
+		}
+
+		void onKcpFlush() override
+		{
+			counters_->datagrams += pending_;
+			++counters_->flushes;
+			pending_ = 0;
+		}
+
+		// an active session always has a segment waiting for its ack
+		bool kcpInFlight() const override { return active_; }
+
+		KcpScheduler* scheduler_;
+		Counters* counters_;
+		const bool active_;
+		uint32_t tsFlush_;
+		int pending_;
+	};
+
+	template <typename SessionType>
+	void run(const char* mode, bool active, int sessions, double seconds)
+	{
+		EventLoop loop;
+		Counters counters;
+		std::vector<std::unique_ptr<SessionType>> all;
+		for (int i = 0; i < sessions; ++i)
+		{
+			all.emplace_back(new SessionType(&loop, &counters, active));
+			// connections come and go at any time, spread their phases over an interval
+			all.back()->start(i % kIntervalMs);
+		}
+
+		// the first second settles the idle backoff
+		int64_t cpuStart = 0;
+		Counters start;
+		base::Timestamp wallStart;
+		loop.runAfter(1.0, [&]() {
+			cpuStart = cpuMicros();
+			start = counters;
+			wallStart = base::Timestamp::now();
+		});
+		loop.runAfter(1.0 + seconds, [&]() { loop.quit(); });
+		loop.loop();
+
+		double wall = base::timeDifference(base::Timestamp::now(), wallStart);
+		double cpu = static_cast<double>(cpuMicros() - cpuStart) / 1e6;
+		double updates = static_cast<double>(counters.updates - start.updates);
+		printf("%-6s %-7s %9d %12.0f %14.0f %12.0f %8.1f %12.0f\n", mode, active ? "active" : "idle",
+			sessions, updates / wall,
+			static_cast<double>(counters.datagrams - start.datagrams) / wall,
+			static_cast<double>(counters.flushes - start.flushes) / wall,
+			100.0 * cpu / wall,
+			updates > 0 ? 1e9 * cpu / updates : 0.0);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	log::Logger::setLogLevel(log::Logger::WARN);
+	int sessions = argc > 1 ? atoi(argv[1]) : 10000;
+	double seconds = argc > 2 ? atof(argv[2]) : 3.0;
+	printf("kcp updates of %d sessions with a %d ms interval in one loop, %.0f s each\n",
+		sessions, kIntervalMs, seconds);
+	printf("%-6s %-7s %9s %12s %14s %12s %8s %12s\n", "mode", "traffic", "sessions",
+		"updates/s", "datagrams/s", "flushes/s", "cpu %", "ns/update");
+	for (int active = 0; active < 2; ++active)
+	{
+		run<TimerSession>("timer", active != 0, sessions, seconds);
+		run<WheelSession>("wheel", active != 0, sessions, seconds);
+	}
+	return 0;
+}
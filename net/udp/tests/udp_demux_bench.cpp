@@ -0,0 +1,420 @@
+// Connected socket per peer (UdpConnector/UdpConnection) vs shared SO_REUSEPORT sockets (UdpDemuxer),
+// measured at the socket level with the same UdpRecvBatch/UdpSendBatch/UdpPeerTable the server uses.
+// One client socket plays every peer by picking a different 127.x.y.z source address (IP_PKTINFO)
+// per datagram; the server echoes each datagram. Reports server side fds, memory and echoed datagrams/s.
+// usage: udp_demux_bench [peers] [rounds] [size] [sockets]
+
+#include "net/udp/UdpBatch.h"
+#include "net/udp/UdpPeerTable.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace Miren::net;
+
+namespace
+{
+	const int kWindow = 256;			// datagrams in flight, fits in one receive buffer
+	const uint16_t kServerPort = 23460;
+
+	int64_t nowMicros()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	struct Usage
+	{
+		long fds;
+		long rssKb;
+		long slabKb;	// kernel objects, system wide
+	};
+
+	Usage usage()
+	{
+		Usage u = { 0, 0, 0 };
+		DIR* dir = ::opendir("/proc/self/fd");
+		if (dir)
+		{
+			while (::readdir(dir))
+				++u.fds;
+			::closedir(dir);
+			u.fds -= 3;		// ".", ".." and the directory itself
+		}
+		FILE* fp = ::fopen("/proc/self/statm", "r");
+		if (fp)
+		{
+			long pages = 0, resident = 0;
+			if (fscanf(fp, "%ld %ld", &pages, &resident) == 2)
+				u.rssKb = resident * (::sysconf(_SC_PAGESIZE) / 1024);
+			::fclose(fp);
+		}
+		fp = ::fopen("/proc/meminfo", "r");
+		if (fp)
+		{
+			char line[256];
+			while (fgets(line, sizeof line, fp))
+			{
+				if (sscanf(line, "Slab: %ld kB", &u.slabKb) == 1)
+					break;
+			}
+			::fclose(fp);
+		}
+		return u;
+	}
+
+	struct sockaddr_in loopback(uint32_t host, uint16_t port)
+	{
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof addr);
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(host);
+		addr.sin_port = htons(port);
+		return addr;
+	}
+
+	const struct sockaddr_in kServerAddr = loopback(0x7F000001, kServerPort);
+
+	// peer i is 127.(1 + i / 65536).(i / 256 % 256).(i % 256)
+	struct in_addr peerIp(int i)
+	{
+		struct in_addr ip;
+		ip.s_addr = htonl(0x7F010000u + static_cast<uint32_t>(i));
+		return ip;
+	}
+
+	int udpSocket()
+	{
+		int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (fd < 0)
+		{
+			perror("socket");
+			exit(1);
+		}
+		int rcvbuf = 4 << 20;
+		::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+		return fd;
+	}
+
+	int serverSocket()
+	{
+		int fd = udpSocket();
+		int on = 1;
+		::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+		::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on);
+		if (::bind(fd, reinterpret_cast<const struct sockaddr*>(&kServerAddr), sizeof kServerAddr) < 0)
+		{
+			perror("bind");
+			exit(1);
+		}
+		return fd;
+	}
+
+	// every peer sends from the same port of a different address
+	class Peers
+	{
+	public:
+		explicit Peers(size_t size)
+			: fd_(udpSocket()),
+			payload_(size, 'x')
+		{
+			struct sockaddr_in any = loopback(INADDR_ANY, 0);
+			socklen_t len = sizeof any;
+			::bind(fd_, reinterpret_cast<struct sockaddr*>(&any), len);
+			::getsockname(fd_, reinterpret_cast<struct sockaddr*>(&any), &len);
+			port_ = ntohs(any.sin_port);
+		}
+
+		~Peers() { ::close(fd_); }
+
+		uint16_t port() const { return port_; }
+
+		void send(int first, int count)
+		{
+			struct mmsghdr msgs[UdpSendBatch::kMaxBatch];
+			struct iovec iov;
+			char control[UdpSendBatch::kMaxBatch][CMSG_SPACE(sizeof(struct in_pktinfo))];
+			iov.iov_base = const_cast<char*>(payload_.data());
+			iov.iov_len = payload_.size();
+			for (int sent = 0; sent < count; )
+			{
+				int m = count - sent < UdpSendBatch::kMaxBatch ? count - sent : UdpSendBatch::kMaxBatch;
+				memset(msgs, 0, sizeof msgs);
+				memset(control, 0, sizeof control);
+				for (int i = 0; i < m; ++i)
+				{
+					struct msghdr& hdr = msgs[i].msg_hdr;
+					hdr.msg_name = const_cast<struct sockaddr_in*>(&kServerAddr);
+					hdr.msg_namelen = sizeof kServerAddr;
+					hdr.msg_iov = &iov;
+					hdr.msg_iovlen = 1;
+					hdr.msg_control = control[i];
+					hdr.msg_controllen = sizeof control[i];
+					struct cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+					cmsg->cmsg_level = IPPROTO_IP;
+					cmsg->cmsg_type = IP_PKTINFO;
+					cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+					struct in_pktinfo info;
+					memset(&info, 0, sizeof info);
+					info.ipi_spec_dst = peerIp(first + sent + i);
+					memcpy(CMSG_DATA(cmsg), &info, sizeof info);
+				}
+				int n = ::sendmmsg(fd_, msgs, static_cast<unsigned int>(m), 0);
+				if (n <= 0)
+				{
+					perror("sendmmsg");
+					exit(1);
+				}
+				sent += n;
+			}
+		}
+
+		int drain()
+		{
+			int n = 0;
+			char* data = NULL;
+			while (recvBatch_.next(fd_, &data) >= 0)
+				++n;
+			return n;
+		}
+
+	private:
+		int fd_;
+		uint16_t port_;
+		std::string payload_;
+		UdpRecvBatch recvBatch_;
+	};
+
+	class Server
+	{
+	public:
+		Server() : epollfd_(::epoll_create1(EPOLL_CLOEXEC)) {}
+		virtual ~Server() { ::close(epollfd_); }
+
+		// handles whatever is readable now, returns the datagrams echoed
+		virtual int poll() = 0;
+
+	protected:
+		void watch(int fd, uint32_t index)
+		{
+			struct epoll_event event;
+			memset(&event, 0, sizeof event);
+			event.events = EPOLLIN;
+			event.data.u32 = index;
+			if (::epoll_ctl(epollfd_, EPOLL_CTL_ADD, fd, &event) < 0)
+			{
+				perror("epoll_ctl");
+				exit(1);
+			}
+		}
+
+		int wait()
+		{
+			return ::epoll_wait(epollfd_, events_, kMaxEvents, 0);
+		}
+
+		static const int kMaxEvents = 1024;
+		int epollfd_;
+		struct epoll_event events_[kMaxEvents];
+	};
+
+	// UdpServer without kSharedSockets: a socket, a channel and batches per peer
+	class ConnectedServer : public Server
+	{
+	public:
+		ConnectedServer(int peers, uint16_t peerPort)
+		{
+			for (int i = 0; i < peers; ++i)
+			{
+				std::unique_ptr<Peer> peer(new Peer);
+				peer->fd = serverSocket();
+				struct sockaddr_in addr = loopback(0, peerPort);
+				addr.sin_addr = peerIp(i);
+				if (::connect(peer->fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0)
+				{
+					perror("connect");
+					exit(1);
+				}
+				watch(peer->fd, static_cast<uint32_t>(i));
+				peers_.push_back(std::move(peer));
+			}
+		}
+
+		~ConnectedServer()
+		{
+			for (auto& peer : peers_)
+				::close(peer->fd);
+		}
+
+		int poll()
+		{
+			int echoed = 0;
+			int n = wait();
+			for (int e = 0; e < n; ++e)
+			{
+				Peer* peer = peers_[events_[e].data.u32].get();
+				char* data = NULL;
+				ssize_t len;
+				while ((len = peer->recvBatch.next(peer->fd, &data)) >= 0)
+				{
+					peer->sendBatch.append(data, static_cast<size_t>(len));
+					++echoed;
+				}
+				peer->sendBatch.flush(peer->fd);
+			}
+			return echoed;
+		}
+
+	private:
+		struct Peer
+		{
+			int fd;
+			UdpRecvBatch recvBatch;
+			UdpSendBatch sendBatch;
+		};
+		std::vector<std::unique_ptr<Peer>> peers_;
+	};
+
+	// UdpServer with kSharedSockets: what UdpDemuxer does
+	class SharedServer : public Server
+	{
+	public:
+		explicit SharedServer(int sockets)
+		{
+			for (int i = 0; i < sockets; ++i)
+			{
+				std::unique_ptr<Endpoint> endpoint(new Endpoint);
+				endpoint->fd = serverSocket();
+				watch(endpoint->fd, static_cast<uint32_t>(i));
+				endpoints_.push_back(std::move(endpoint));
+			}
+		}
+
+		~SharedServer()
+		{
+			for (auto& endpoint : endpoints_)
+				::close(endpoint->fd);
+		}
+
+		int poll()
+		{
+			int echoed = 0;
+			int n = wait();
+			for (int e = 0; e < n; ++e)
+			{
+				Endpoint* endpoint = endpoints_[events_[e].data.u32].get();
+				char* data = NULL;
+				struct sockaddr_in6 peer;
+				ssize_t len;
+				while ((len = endpoint->recvBatch.next(endpoint->fd, &data, &peer)) >= 0)
+				{
+					int* state = peers_.find(peer);
+					if (!state)
+					{
+						peers_.insert(peer, 0);
+						state = peers_.find(peer);
+					}
+					++*state;
+					endpoint->sendBatch.append(data, static_cast<size_t>(len),
+						reinterpret_cast<const struct sockaddr*>(&peer));
+					if (endpoint->sendBatch.pending() >= UdpSendBatch::kMaxBatch)
+						endpoint->sendBatch.flush(endpoint->fd);
+					++echoed;
+				}
+			}
+			for (auto& endpoint : endpoints_)
+				endpoint->sendBatch.flush(endpoint->fd);
+			return echoed;
+		}
+
+		size_t tableBytes() const { return peers_.memoryBytes(); }
+
+	private:
+		struct Endpoint
+		{
+			int fd;
+			UdpRecvBatch recvBatch;
+			UdpSendBatch sendBatch;
+		};
+		std::vector<std::unique_ptr<Endpoint>> endpoints_;
+		UdpPeerTable<int> peers_;
+	};
+
+	void run(const char* name, int peers, int rounds, size_t size, int sockets)
+	{
+		Peers client(size);
+		Usage before = usage();
+		std::unique_ptr<Server> server;
+		if (sockets > 0)
+			server.reset(new SharedServer(sockets));
+		else
+			server.reset(new ConnectedServer(peers, client.port()));
+		Usage setUp = usage();
+
+		int64_t serverMicros = 0;
+		int64_t echoed = 0;
+		int64_t received = 0;
+		int64_t start = nowMicros();
+		for (int r = 0; r < rounds; ++r)
+		{
+			for (int first = 0; first < peers; first += kWindow)
+			{
+				int count = peers - first < kWindow ? peers - first : kWindow;
+				client.send(first, count);
+				int64_t begin = nowMicros();
+				int served = 0;
+				for (int idle = 0; served < count && idle < 1000; )
+				{
+					int n = server->poll();
+					served += n;
+					idle = n > 0 ? 0 : idle + 1;
+				}
+				serverMicros += nowMicros() - begin;
+				echoed += served;
+				received += client.drain();
+			}
+		}
+		int64_t total = nowMicros() - start;
+		Usage after = usage();
+
+		printf("%-12s %8d %8ld %12.0f %12.0f %14.0f %14.0f %8.4f\n", name, peers, setUp.fds - before.fds,
+			static_cast<double>(after.rssKb - before.rssKb) * 1024 / peers,
+			static_cast<double>(setUp.slabKb - before.slabKb) * 1024 / peers,
+			1e6 * static_cast<double>(echoed) / static_cast<double>(serverMicros),
+			1e6 * static_cast<double>(received) / static_cast<double>(total),
+			1.0 - static_cast<double>(received) / (static_cast<double>(peers) * rounds));
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int peers = argc > 1 ? atoi(argv[1]) : 10000;
+	int rounds = argc > 2 ? atoi(argv[2]) : 20;
+	size_t size = argc > 3 ? static_cast<size_t>(atoi(argv[3])) : 200;
+	int sockets = argc > 4 ? atoi(argv[4]) : 1;
+
+	struct rlimit limit;
+	::getrlimit(RLIMIT_NOFILE, &limit);
+	printf("%d rounds of one %zu byte datagram from each peer, %d in flight\n", rounds, size, kWindow);
+	printf("%-12s %8s %8s %12s %12s %14s %14s %8s\n", "mode", "peers", "fds",
+		"user B/peer", "slab B/peer", "server dgram/s", "echo dgram/s", "lost");
+	// shared first, so its memory is not served from what the connected run freed
+	run("shared", peers, rounds, size, sockets);
+	if (static_cast<rlim_t>(peers) + 64 < limit.rlim_cur)
+		run("connected", peers, rounds, size, 0);
+	else
+		printf("%-12s %8d needs %d fds, RLIMIT_NOFILE is %ld\n", "connected", peers, peers, static_cast<long>(limit.rlim_cur));
+	return 0;
+}
@@ -0,0 +1,296 @@
+// Packets per second of the UDP transport.
+// socket: bursts over a connected loopback socket pair, one write/read per datagram
+//         vs UdpSendBatch/UdpRecvBatch (sendmmsg/recvmmsg) vs the same with UDP_SEGMENT/UDP_GRO.
+// chat:   udp_chat_server and udp_chat_client in one process, the server echoes every message
+//         back and the client keeps the kcp window full, with offload on and off.
+// usage: udp_pps_bench socket [datagrams] [size] | chat [messages] [size]
+
+#include "net/udp/tests/udp_codec.h"
+
+#include "base/log/Logging.h"
+#include "base/thread/CountDownLatch.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include "net/udp/UdpBatch.h"
+#include "net/udp/UdpClient.h"
+#include "net/udp/UdpServer.h"
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace Miren;
+using namespace Miren::net;
+using namespace std::placeholders;
+
+namespace
+{
+	const int kBurst = UdpSendBatch::kMaxBatch;
+
+	int64_t nowMicros()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	void report(const char* name, int64_t datagrams, int64_t micros, double syscalls)
+	{
+		printf("%-20s %12.0f %16.3f\n", name,
+			1e6 * static_cast<double>(datagrams) / static_cast<double>(micros),
+			syscalls / static_cast<double>(datagrams));
+	}
+
+	// two nonblocking sockets on 127.0.0.1 connected to each other, like UdpConnector makes
+	void socketPair(int* sender, int* receiver)
+	{
+		int fds[2];
+		for (int i = 0; i < 2; ++i)
+		{
+			fds[i] = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			struct sockaddr_in addr;
+			memset(&addr, 0, sizeof addr);
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			int rcvbuf = 8 << 20;
+			::setsockopt(fds[i], SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+			if (fds[i] < 0 || ::bind(fds[i], reinterpret_cast<struct sockaddr*>(&addr), sizeof addr) < 0)
+			{
+				perror("socket");
+				exit(1);
+			}
+		}
+		for (int i = 0; i < 2; ++i)
+		{
+			struct sockaddr_in peer;
+			socklen_t len = sizeof peer;
+			::getsockname(fds[1 - i], reinterpret_cast<struct sockaddr*>(&peer), &len);
+			if (::connect(fds[i], reinterpret_cast<struct sockaddr*>(&peer), len) < 0)
+			{
+				perror("connect");
+				exit(1);
+			}
+		}
+		*sender = fds[0];
+		*receiver = fds[1];
+	}
+
+	// the burst fits in the receive buffer, so nothing is dropped and only syscalls are measured
+	void perDatagram(int datagrams, const std::string& payload)
+	{
+		int sender, receiver;
+		socketPair(&sender, &receiver);
+		char buf[UdpPacketPool::kPacketSize];
+		int64_t received = 0;
+		int64_t syscalls = 0;
+		int64_t start = nowMicros();
+		for (int sent = 0; sent < datagrams; sent += kBurst)
+		{
+			for (int i = 0; i < kBurst; ++i, ++syscalls)
+			{
+				if (::write(sender, payload.data(), payload.size()) < 0)
+					perror("write");
+			}
+			for (;;)
+			{
+				++syscalls;
+				if (::read(receiver, buf, sizeof buf) < 0)
+					break;
+				++received;
+			}
+		}
+		report("write/read", received, nowMicros() - start, static_cast<double>(syscalls));
+		::close(sender);
+		::close(receiver);
+	}
+
+	void batched(const char* name, int datagrams, const std::string& payload, bool offload)
+	{
+		int sender, receiver;
+		socketPair(&sender, &receiver);
+		UdpSendBatch sendBatch;
+		UdpRecvBatch recvBatch;
+		if (offload && (!sendBatch.setGso(sender, true) || !recvBatch.setGro(receiver, true)))
+		{
+			printf("%-20s not supported by the kernel\n", name);
+			return;
+		}
+		int64_t received = 0;
+		int64_t start = nowMicros();
+		for (int sent = 0; sent < datagrams; sent += kBurst)
+		{
+			for (int i = 0; i < kBurst; ++i)
+				sendBatch.append(payload.data(), payload.size());
+			if (sendBatch.flush(sender) < 0)
+				perror("sendmmsg");
+			char* data = NULL;
+			ssize_t n;
+			while ((n = recvBatch.next(receiver, &data)) >= 0)
+			{
+				if (static_cast<size_t>(n) != payload.size())
+				{
+					fprintf(stderr, "datagram of %zd bytes, expected %zu\n", n, payload.size());
+					abort();
+				}
+				++received;
+			}
+		}
+		report(name, received, nowMicros() - start,
+			static_cast<double>(sendBatch.syscalls() + recvBatch.syscalls()));
+		::close(sender);
+		::close(receiver);
+	}
+
+	void socketBench(int datagrams, size_t size)
+	{
+		std::string payload(size, 'x');
+		printf("%d datagrams of %zu bytes in bursts of %d over loopback\n", datagrams, size, kBurst);
+		printf("%-20s %12s %16s\n", "mode", "datagrams/s", "syscalls/dgram");
+		perDatagram(datagrams, payload);
+		batched("sendmmsg/recvmmsg", datagrams, payload, false);
+		batched("gso/gro", datagrams, payload, true);
+	}
+
+	// udp_chat_server, answering only the sender
+	class EchoServer : base::NonCopyable
+	{
+	public:
+		EchoServer(EventLoop* loop, const InetAddress& listenAddr, bool offload)
+			: server_(loop, listenAddr, "UdpEchoServer"),
+			codec_(std::bind(&EchoServer::onStringMessage, this, _1, _2, _3))
+		{
+			server_.setMessageCallback(
+				std::bind(&UdpLengthHeaderCodec::onMessage, &codec_, _1, _2, _3));
+			server_.setOffload(offload);
+		}
+
+		void start() { server_.start(); }
+
+	private:
+		void onStringMessage(const UdpConnectionPtr& conn, const std::string& message, base::Timestamp)
+		{
+			codec_.send(get_pointer(conn), message);
+		}
+
+		UdpServer server_;
+		UdpLengthHeaderCodec codec_;
+	};
+
+	// udp_chat_client, writing as long as the kcp window has room
+	class FloodClient : base::NonCopyable
+	{
+	public:
+		FloodClient(EventLoop* loop, const InetAddress& serverAddr, bool offload,
+			int messages, size_t size)
+			: client_(loop, serverAddr, "UdpFloodClient"),
+			codec_(std::bind(&FloodClient::onStringMessage, this, _1, _2, _3)),
+			message_(size, 'x'),
+			messages_(messages),
+			sent_(0),
+			received_(0),
+			start_(0),
+			done_(1)
+		{
+			client_.setConnectionCallback(std::bind(&FloodClient::onConnection, this, _1));
+			client_.setMessageCallback(
+				std::bind(&UdpLengthHeaderCodec::onMessage, &codec_, _1, _2, _3));
+			client_.setOffload(offload);
+		}
+
+		void connect() { client_.connect(); }
+		void disconnect() { client_.disconnect(); }
+		int64_t wait() { done_.wait(); return nowMicros() - start_; }
+
+	private:
+		void onConnection(const UdpConnectionPtr& conn)
+		{
+			if (conn->connected() && sent_ == 0)
+			{
+				start_ = nowMicros();
+				pump(conn);
+			}
+		}
+
+		void onStringMessage(const UdpConnectionPtr& conn, const std::string&, base::Timestamp)
+		{
+			if (++received_ == messages_)
+				done_.countDown();
+			else
+				pump(conn);
+		}
+
+		void pump(const UdpConnectionPtr& conn)
+		{
+			while (sent_ < messages_ && conn->canSend())
+			{
+				codec_.send(get_pointer(conn), message_);
+				++sent_;
+			}
+		}
+
+		UdpClient client_;
+		UdpLengthHeaderCodec codec_;
+		const std::string message_;
+		const int messages_;
+		int sent_;
+		int received_;
+		int64_t start_;
+		base::CountDownLatch done_;
+	};
+
+	void chatBench(int messages, size_t size)
+	{
+		printf("%d echoed messages of %zu bytes through UdpServer/UdpClient\n", messages, size);
+		printf("%-20s %12s\n", "mode", "messages/s");
+		uint16_t port = 23456;
+		for (int offload = 0; offload < 2; ++offload)
+		{
+			EventLoopThread serverThread;
+			EventLoopThread clientThread;
+			EventLoop* serverLoop = serverThread.startLoop();
+			InetAddress serverAddr("127.0.0.1", port++);
+
+			// UdpServer is created and destroyed in its loop thread
+			std::unique_ptr<EchoServer> server;
+			base::CountDownLatch started(1);
+			serverLoop->runInLoop([&]() {
+				server.reset(new EchoServer(serverLoop, serverAddr, offload != 0));
+				server->start();
+				started.countDown();
+			});
+			started.wait();
+
+			FloodClient client(clientThread.startLoop(), serverAddr, offload != 0, messages, size);
+			client.connect();
+			int64_t micros = client.wait();
+			printf("%-20s %12.0f\n", offload ? "offload" : "no offload",
+				1e6 * messages / static_cast<double>(micros));
+			client.disconnect();
+
+			base::CountDownLatch stopped(1);
+			serverLoop->runInLoop([&]() {
+				server.reset();
+				stopped.countDown();
+			});
+			stopped.wait();
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	log::Logger::setLogLevel(log::Logger::WARN);
+	std::string mode = argc > 1 ? argv[1] : "socket";
+	int count = argc > 2 ? atoi(argv[2]) : 1000000;
+	size_t size = argc > 3 ? static_cast<size_t>(atoi(argv[3])) : 1200;
+	if (mode == "chat")
+		chatBench(count / 10, size);
+	else
+		socketBench(count, size);
+	return 0;
+}